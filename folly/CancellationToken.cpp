@@ -0,0 +1,109 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/CancellationToken.h>
+
+#include <mutex>
+
+namespace folly {
+namespace detail {
+
+bool CancellationState::requestCancellation() noexcept {
+  std::unique_lock<MicroSpinLock> lock(lock_);
+  if (cancellationRequested_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  signallingThreadId_ = std::this_thread::get_id();
+  cancellationRequested_.store(true, std::memory_order_release);
+
+  while (head_ != nullptr) {
+    auto callback = head_;
+    head_ = callback->next_;
+    if (head_) {
+      head_->prevNext_ = &head_;
+    }
+    callback->prevNext_ = nullptr;
+    executing_ = callback;
+
+    // The callback may destroy its own CancellationCallback, in which case we
+    // must not touch it again once it returns.
+    bool destructorHasRunInsideCallback = false;
+    callback->destructorHasRunInsideCallback_ = &destructorHasRunInsideCallback;
+
+    lock.unlock();
+    callback->invokeCallback();
+    if (!destructorHasRunInsideCallback) {
+      callback->destructorHasRunInsideCallback_ = nullptr;
+      callback->callbackCompleted_.store(true, std::memory_order_release);
+    }
+    lock.lock();
+    executing_ = nullptr;
+  }
+  return true;
+}
+
+bool CancellationState::tryAddCallback(
+    CancellationCallback* callback) noexcept {
+  std::lock_guard<MicroSpinLock> lock(lock_);
+  if (cancellationRequested_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  callback->next_ = head_;
+  if (head_) {
+    head_->prevNext_ = &callback->next_;
+  }
+  callback->prevNext_ = &head_;
+  head_ = callback;
+  return true;
+}
+
+void CancellationState::removeCallback(
+    CancellationCallback* callback) noexcept {
+  std::unique_lock<MicroSpinLock> lock(lock_);
+  if (callback->prevNext_ != nullptr) {
+    // Still registered, so it hasn't run and now never will.
+    *callback->prevNext_ = callback->next_;
+    if (callback->next_) {
+      callback->next_->prevNext_ = callback->prevNext_;
+    }
+    callback->prevNext_ = nullptr;
+    return;
+  }
+
+  bool isExecuting = executing_ == callback;
+  lock.unlock();
+
+  if (!isExecuting) {
+    // Already finished running.
+    return;
+  }
+
+  if (signallingThreadId_ == std::this_thread::get_id()) {
+    // Destroyed from within its own callback.
+    if (callback->destructorHasRunInsideCallback_) {
+      *callback->destructorHasRunInsideCallback_ = true;
+    }
+  } else {
+    // Running concurrently on the signalling thread; wait for it to finish
+    // before the callback's captured state goes away.
+    while (!callback->callbackCompleted_.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+} // detail
+} // folly
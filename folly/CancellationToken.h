@@ -0,0 +1,190 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include <folly/Function.h>
+#include <folly/MicroSpinLock.h>
+
+/**
+ * Cooperative cancellation.
+ *
+ * A CancellationSource is held by whoever decides that some work is no longer
+ * wanted (a hedging policy, a request timeout, a client disconnect). It hands
+ * out CancellationTokens to the code doing that work, which can either poll
+ *
+ *   while (!token.isCancellationRequested()) { ...crunch... }
+ *
+ * (a single atomic load, cheap enough for hot loops), or register a
+ * CancellationCallback to be told when cancellation is requested:
+ *
+ *   CancellationCallback cb(token, [&] { socket.closeNow(); });
+ *
+ * Callbacks run synchronously in the thread that calls
+ * requestCancellation(), or inline in the CancellationCallback constructor if
+ * cancellation was already requested. Destroying a CancellationCallback
+ * deregisters it, blocking until the callback has finished if it is running
+ * concurrently on another thread. It is fine to destroy a
+ * CancellationCallback from within its own callback.
+ *
+ * A default-constructed CancellationToken can never be cancelled.
+ *
+ * See also Future::withCancellation(), Promise::getCancellationToken(),
+ * FiberManager::addTaskFuture(F, CancellationToken),
+ * AsyncTimeout::scheduleTimeout(timeout_type, CancellationToken) and
+ * AsyncSocket::setCancellableReadCB().
+ */
+
+namespace folly {
+
+class CancellationCallback;
+class CancellationSource;
+
+namespace detail {
+
+class CancellationState {
+ public:
+  CancellationState() {
+    lock_.init();
+  }
+
+  CancellationState(const CancellationState&) = delete;
+  CancellationState& operator=(const CancellationState&) = delete;
+
+  bool isCancellationRequested() const noexcept {
+    return cancellationRequested_.load(std::memory_order_acquire);
+  }
+
+  bool requestCancellation() noexcept;
+
+  // Returns false (without registering) if cancellation was already
+  // requested, in which case the caller should invoke the callback itself.
+  bool tryAddCallback(CancellationCallback* callback) noexcept;
+
+  void removeCallback(CancellationCallback* callback) noexcept;
+
+ private:
+  std::atomic<bool> cancellationRequested_{false};
+  MicroSpinLock lock_;
+  CancellationCallback* head_{nullptr};
+  CancellationCallback* executing_{nullptr};
+  std::thread::id signallingThreadId_;
+};
+
+} // detail
+
+class CancellationToken {
+ public:
+  /// A token that can never be cancelled.
+  CancellationToken() noexcept = default;
+
+  bool isCancellationRequested() const noexcept {
+    return state_ != nullptr && state_->isCancellationRequested();
+  }
+
+  bool canBeCancelled() const noexcept {
+    return state_ != nullptr;
+  }
+
+  friend bool operator==(
+      const CancellationToken& a,
+      const CancellationToken& b) noexcept {
+    return a.state_ == b.state_;
+  }
+
+  friend bool operator!=(
+      const CancellationToken& a,
+      const CancellationToken& b) noexcept {
+    return !(a == b);
+  }
+
+ private:
+  friend class CancellationSource;
+  friend class CancellationCallback;
+
+  explicit CancellationToken(
+      std::shared_ptr<detail::CancellationState> state) noexcept
+      : state_(std::move(state)) {}
+
+  std::shared_ptr<detail::CancellationState> state_;
+};
+
+class CancellationSource {
+ public:
+  CancellationSource()
+      : state_(std::make_shared<detail::CancellationState>()) {}
+
+  CancellationToken getToken() const noexcept {
+    return CancellationToken(state_);
+  }
+
+  /// Request cancellation and run all registered callbacks. Returns true if
+  /// this call was the one that requested cancellation.
+  bool requestCancellation() const noexcept {
+    return state_->requestCancellation();
+  }
+
+  bool isCancellationRequested() const noexcept {
+    return state_->isCancellationRequested();
+  }
+
+ private:
+  std::shared_ptr<detail::CancellationState> state_;
+};
+
+class CancellationCallback {
+ public:
+  template <typename F>
+  CancellationCallback(const CancellationToken& token, F&& callback)
+      : callback_(std::forward<F>(callback)), state_(token.state_) {
+    if (state_ && !state_->tryAddCallback(this)) {
+      state_.reset();
+      invokeCallback();
+    }
+  }
+
+  CancellationCallback(const CancellationCallback&) = delete;
+  CancellationCallback& operator=(const CancellationCallback&) = delete;
+  CancellationCallback(CancellationCallback&&) = delete;
+  CancellationCallback& operator=(CancellationCallback&&) = delete;
+
+  ~CancellationCallback() {
+    if (state_) {
+      state_->removeCallback(this);
+    }
+  }
+
+ private:
+  friend class detail::CancellationState;
+
+  void invokeCallback() noexcept {
+    callback_();
+  }
+
+  CancellationCallback* next_{nullptr};
+  CancellationCallback** prevNext_{nullptr};
+  bool* destructorHasRunInsideCallback_{nullptr};
+  std::atomic<bool> callbackCompleted_{false};
+  Function<void()> callback_;
+  std::shared_ptr<detail::CancellationState> state_;
+};
+
+} // folly
@@ -0,0 +1,531 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * ConcurrentEvictingCacheMap --
+ *
+ * A thread-safe bounded cache, for workloads where an EvictingCacheMap
+ * behind a mutex becomes the contention point.
+ *
+ * Implementation:
+ *   Keys are spread over shards by the top bits of the mixed hash. Each
+ *   shard is a hash map guarded by a SharedMutex, with CLOCK replacement
+ *   instead of an LRU list: a hit only sets the entry's reference bit, so
+ *   lookups run under the shared lock and never write list pointers. When
+ *   a shard is over capacity, the clock hand sweeps its entries, clearing
+ *   reference bits, and evicts the first entry whose bit was already
+ *   clear.
+ *
+ *   Capacity is a total weight rather than an entry count; set() takes
+ *   each entry's weight (1 by default), and is split evenly between
+ *   shards.
+ *
+ *   With Config::admission, each shard also keeps a TinyLFU filter: a
+ *   count-min sketch of small saturating counters that estimates how often
+ *   every key, cached or not, was requested recently. A new key that would
+ *   force an eviction is only admitted if it is estimated to be more
+ *   popular than the victim, so a one-off scan can't flush the working
+ *   set. Counters are halved periodically, so the estimates follow shifts
+ *   in popularity. Only one get() in kSketchSampling is recorded, so that
+ *   hits mostly leave the sketch's cache lines alone; set() always is.
+ *
+ * Differences from EvictingCacheMap:
+ *   - get() returns a copy, since the entry may be evicted as soon as the
+ *     shard lock is released. Use a shared_ptr value for large objects.
+ *   - There is no iteration and no prune(); eviction order is approximate
+ *     and per shard.
+ *   - The prune hook runs after the shard lock is released, on the thread
+ *     whose set() caused the eviction, and is not called for erase(),
+ *     clear() or destruction.
+ *   - THash and TKeyEqual are default constructed where needed, so they
+ *     must be stateless.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <folly/Bits.h>
+#include <folly/Hash.h>
+#include <folly/Optional.h>
+#include <folly/Portability.h>
+#include <folly/SharedMutex.h>
+#include <folly/ThreadCachedInt.h>
+
+namespace folly {
+
+template <
+    class TKey,
+    class TValue,
+    class THash = std::hash<TKey>,
+    class TKeyEqual = std::equal_to<TKey>>
+class ConcurrentEvictingCacheMap {
+ public:
+  typedef std::function<void(TKey, TValue&&)> PruneHookCall;
+
+  struct Config {
+    /// Number of shards, rounded up to a power of two. 0 picks a count
+    /// based on the number of cores, reduced so that every shard can hold
+    /// at least kMinShardWeight.
+    size_t numShards = 0;
+    /// Enables the TinyLFU admission filter.
+    bool admission = false;
+    /// Called with every entry evicted to make room for another.
+    PruneHookCall pruneHook = nullptr;
+  };
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    /// New keys that the admission filter kept out of the cache.
+    uint64_t rejections = 0;
+
+    Stats& operator+=(const Stats& other) {
+      hits += other.hits;
+      misses += other.misses;
+      evictions += other.evictions;
+      rejections += other.rejections;
+      return *this;
+    }
+  };
+
+  static constexpr size_t kMinShardWeight = 64;
+  /// One get() in this many updates the admission filter.
+  static constexpr uint32_t kSketchSampling = 4;
+
+  explicit ConcurrentEvictingCacheMap(size_t maxWeight, Config config = {})
+      : maxWeight_(maxWeight), pruneHook_(std::move(config.pruneHook)) {
+    size_t shards = config.numShards;
+    if (shards == 0) {
+      shards = 4 * std::max(std::thread::hardware_concurrency(), 1u);
+      while (shards > 1 && maxWeight / shards < kMinShardWeight) {
+        shards /= 2;
+      }
+    }
+    shards = nextPowTwo(shards);
+    shardShift_ = 64 - findLastSet(shards - 1);
+    auto shardWeight = std::max<size_t>((maxWeight + shards - 1) / shards, 1);
+    shards_.reserve(shards);
+    for (size_t i = 0; i < shards; ++i) {
+      shards_.emplace_back(new Shard(shardWeight, config.admission));
+    }
+  }
+
+  ConcurrentEvictingCacheMap(const ConcurrentEvictingCacheMap&) = delete;
+  ConcurrentEvictingCacheMap& operator=(const ConcurrentEvictingCacheMap&) =
+      delete;
+
+  /**
+   * Get a copy of the value associated with key, marking the entry as
+   *     recently used.
+   * @return the value, or none if key isn't cached
+   */
+  Optional<TValue> get(const TKey& key) {
+    auto h = hash(key);
+    return shardFor(h).get(key, h);
+  }
+
+  /**
+   * Check for existence of key. Has no effect on replacement, statistics
+   *     or the admission filter.
+   */
+  bool exists(const TKey& key) const {
+    auto h = hash(key);
+    return shardFor(h).exists(key);
+  }
+
+  /**
+   * Set a key-value pair, evicting entries from the key's shard if it
+   *     exceeds its share of maxWeight.
+   * @param weight this entry's share of the capacity
+   * @return false if the entry was not stored: the admission filter
+   *     rejected it, or it is heavier than a whole shard
+   */
+  bool set(const TKey& key, TValue value, size_t weight = 1) {
+    auto h = hash(key);
+    std::vector<std::pair<TKey, TValue>> evicted;
+    auto stored = shardFor(h).set(
+        key, std::move(value), weight, h, pruneHook_ ? &evicted : nullptr);
+    for (auto& kv : evicted) {
+      pruneHook_(std::move(kv.first), std::move(kv.second));
+    }
+    return stored;
+  }
+
+  /**
+   * Erase key if it is cached.
+   * @return true if the key existed and was erased, else false
+   */
+  bool erase(const TKey& key) {
+    auto h = hash(key);
+    return shardFor(h).erase(key);
+  }
+
+  void clear() {
+    for (auto& shard : shards_) {
+      shard->clear();
+    }
+  }
+
+  /// Number of entries; approximate while writers are active.
+  size_t size() const {
+    size_t n = 0;
+    for (auto& shard : shards_) {
+      n += shard->size();
+    }
+    return n;
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  /// Total weight of the cached entries.
+  size_t weight() const {
+    size_t w = 0;
+    for (auto& shard : shards_) {
+      w += shard->weight();
+    }
+    return w;
+  }
+
+  size_t getMaxWeight() const {
+    return maxWeight_;
+  }
+
+  size_t numShards() const {
+    return shards_.size();
+  }
+
+  Stats shardStats(size_t shard) const {
+    return shards_[shard]->stats();
+  }
+
+  Stats stats() const {
+    Stats total;
+    for (auto& shard : shards_) {
+      total += shard->stats();
+    }
+    return total;
+  }
+
+ private:
+  struct Entry {
+    Entry(TValue&& v, size_t w, size_t s)
+        : value(std::move(v)), weight(w), slot(s) {}
+
+    TValue value;
+    size_t weight;
+    size_t slot; // position in Shard::clock_
+    std::atomic<bool> referenced{false};
+  };
+
+  typedef std::unordered_map<TKey, Entry, THash, TKeyEqual> Map;
+  typedef typename Map::value_type Item;
+
+  /**
+   * Count-min sketch of recent request frequencies, saturating at 15, with
+   * conservative update: only the counters at the key's current minimum
+   * are incremented, which usually means one write per request. record()
+   * takes no lock, so increments race benignly with each other and with
+   * the aging done under the exclusive lock; the occasional lost update
+   * only makes the estimate a little off.
+   */
+  class FrequencySketch {
+   public:
+    // Sized so that a counter sees only a few increments per sample period
+    // on average; a narrower sketch saturates and stops telling keys apart.
+    explicit FrequencySketch(size_t expectedEntries)
+        : mask_(nextPowTwo(16 * std::max<size_t>(expectedEntries, 1)) - 1),
+          counters_(new std::atomic<uint8_t>[mask_ + 1]),
+          sampleSize_(10 * std::max<size_t>(expectedEntries, 1)) {
+      for (size_t i = 0; i <= mask_; ++i) {
+        counters_[i].store(0, std::memory_order_relaxed);
+      }
+    }
+
+    void record(uint64_t h) {
+      auto min = estimate(h);
+      if (min < kMaxCount) {
+        for (size_t i = 0; i < kDepth; ++i) {
+          auto& c = counters_[index(h, i)];
+          if (c.load(std::memory_order_relaxed) == min) {
+            c.store(min + 1, std::memory_order_relaxed);
+          }
+        }
+      }
+      additions_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint8_t estimate(uint64_t h) const {
+      uint8_t v = kMaxCount;
+      for (size_t i = 0; i < kDepth; ++i) {
+        v = std::min(v, counters_[index(h, i)].load(std::memory_order_relaxed));
+      }
+      return v;
+    }
+
+    /// Halves every counter once enough requests have been recorded.
+    void maybeAge() {
+      if (additions_.load(std::memory_order_relaxed) < sampleSize_) {
+        return;
+      }
+      additions_.store(0, std::memory_order_relaxed);
+      for (size_t i = 0; i <= mask_; ++i) {
+        auto v = counters_[i].load(std::memory_order_relaxed);
+        counters_[i].store(v / 2, std::memory_order_relaxed);
+      }
+    }
+
+   private:
+    static constexpr size_t kDepth = 4;
+    static constexpr uint8_t kMaxCount = 15;
+
+    size_t index(uint64_t h, size_t i) const {
+      // Double hashing: row i probes h1 + i * h2
+      return (h + i * ((h >> 32) | 1)) & mask_;
+    }
+
+    const size_t mask_;
+    std::unique_ptr<std::atomic<uint8_t>[]> counters_;
+    const size_t sampleSize_;
+    std::atomic<size_t> additions_{0};
+  };
+
+  class Shard {
+   public:
+    Shard(size_t maxWeight, bool admission)
+        : maxWeight_(maxWeight),
+          sketch_(admission ? new FrequencySketch(maxWeight) : nullptr) {}
+
+    Optional<TValue> get(const TKey& key, uint64_t h) {
+      if (sketch_ && sampleRequest()) {
+        sketch_->record(h);
+      }
+      SharedMutex::ReadHolder g(lock_);
+      auto it = map_.find(key);
+      if (it == map_.end()) {
+        ++misses_;
+        return none;
+      }
+      ++hits_;
+      auto& referenced = it->second.referenced;
+      // Avoid dirtying the cache line when the bit is already set
+      if (!referenced.load(std::memory_order_relaxed)) {
+        referenced.store(true, std::memory_order_relaxed);
+      }
+      return it->second.value;
+    }
+
+    bool exists(const TKey& key) const {
+      SharedMutex::ReadHolder g(lock_);
+      return map_.find(key) != map_.end();
+    }
+
+    bool set(
+        const TKey& key,
+        TValue&& value,
+        size_t weight,
+        uint64_t h,
+        std::vector<std::pair<TKey, TValue>>* evicted) {
+      if (sketch_) {
+        sketch_->record(h);
+      }
+      SharedMutex::WriteHolder g(lock_);
+      if (sketch_) {
+        sketch_->maybeAge();
+      }
+      auto it = map_.find(key);
+      if (it != map_.end()) {
+        auto& entry = it->second;
+        entry.value = std::move(value);
+        weight_ += weight - entry.weight;
+        entry.weight = weight;
+        entry.referenced.store(true, std::memory_order_relaxed);
+        evictLocked(&*it, evicted);
+        return map_.find(key) != map_.end();
+      }
+      if (weight > maxWeight_) {
+        rejections_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      if (sketch_ && weight_ + weight > maxWeight_) {
+        // TinyLFU: admit only if more popular than the next victim
+        auto victim = nextVictimLocked();
+        if (sketch_->estimate(h) <= sketch_->estimate(hash(victim->first))) {
+          rejections_.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+      }
+      auto res = map_.emplace(
+          std::piecewise_construct,
+          std::forward_as_tuple(key),
+          std::forward_as_tuple(std::move(value), weight, clock_.size()));
+      clock_.push_back(&*res.first);
+      weight_ += weight;
+      evictLocked(&*res.first, evicted);
+      return true;
+    }
+
+    bool erase(const TKey& key) {
+      SharedMutex::WriteHolder g(lock_);
+      auto it = map_.find(key);
+      if (it == map_.end()) {
+        return false;
+      }
+      removeLocked(it);
+      return true;
+    }
+
+    void clear() {
+      SharedMutex::WriteHolder g(lock_);
+      map_.clear();
+      clock_.clear();
+      hand_ = 0;
+      weight_ = 0;
+    }
+
+    size_t size() const {
+      SharedMutex::ReadHolder g(lock_);
+      return map_.size();
+    }
+
+    size_t weight() const {
+      SharedMutex::ReadHolder g(lock_);
+      return weight_;
+    }
+
+    Stats stats() const {
+      Stats s;
+      s.hits = hits_.readFull();
+      s.misses = misses_.readFull();
+      s.evictions = evictions_.load(std::memory_order_relaxed);
+      s.rejections = rejections_.load(std::memory_order_relaxed);
+      return s;
+    }
+
+   private:
+    /// Whether this get() goes into the sketch. A per-thread xorshift
+    /// rather than a counter, so that sampling can't alias with a periodic
+    /// access pattern.
+    static bool sampleRequest() {
+      static FOLLY_TLS uint32_t state = 0x9e3779b9;
+      auto x = state;
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      state = x;
+      return x % kSketchSampling == 0;
+    }
+
+    /// Advances the clock hand to the next entry without a reference bit,
+    /// clearing the bits it passes. Requires a non-empty shard.
+    Item* nextVictimLocked() {
+      for (;;) {
+        if (hand_ >= clock_.size()) {
+          hand_ = 0;
+        }
+        auto item = clock_[hand_];
+        if (!item->second.referenced.load(std::memory_order_relaxed)) {
+          return item;
+        }
+        item->second.referenced.store(false, std::memory_order_relaxed);
+        ++hand_;
+      }
+    }
+
+    /// Evicts until the shard fits, sparing keep unless nothing else is
+    /// left.
+    void evictLocked(
+        Item* keep,
+        std::vector<std::pair<TKey, TValue>>* evicted) {
+      while (weight_ > maxWeight_ && !clock_.empty()) {
+        auto victim = nextVictimLocked();
+        if (victim == keep && clock_.size() > 1) {
+          ++hand_;
+          continue;
+        }
+        if (evicted) {
+          evicted->emplace_back(victim->first, std::move(victim->second.value));
+        }
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+        removeLocked(map_.find(victim->first));
+        // The hole under the hand now holds the newest entry; step past it
+        // so that it gets a full sweep before it can be evicted
+        ++hand_;
+      }
+    }
+
+    void removeLocked(typename Map::iterator it) {
+      // Fill the hole with the last entry; CLOCK only needs every entry to
+      // be visited once per sweep, not a particular order.
+      auto slot = it->second.slot;
+      clock_[slot] = clock_.back();
+      clock_[slot]->second.slot = slot;
+      clock_.pop_back();
+      weight_ -= it->second.weight;
+      map_.erase(it);
+    }
+
+    mutable SharedMutex lock_;
+    Map map_;
+    std::vector<Item*> clock_;
+    size_t hand_{0};
+    size_t weight_{0};
+    const size_t maxWeight_;
+    std::unique_ptr<FrequencySketch> sketch_;
+
+    // Bumped under the shared lock by every get(), so thread cached
+    ThreadCachedInt<uint64_t> hits_;
+    ThreadCachedInt<uint64_t> misses_;
+    std::atomic<uint64_t> evictions_{0};
+    std::atomic<uint64_t> rejections_{0};
+  };
+
+  static uint64_t hash(const TKey& key) {
+    return hash::twang_mix64(THash()(key));
+  }
+
+  Shard& shardFor(uint64_t h) const {
+    // Top bits, so that shard selection is independent of the bucket
+    // chosen within the shard's map
+    return *shards_[shardShift_ == 64 ? 0 : h >> shardShift_];
+  }
+
+  const size_t maxWeight_;
+  const PruneHookCall pruneHook_;
+  size_t shardShift_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+template <class TKey, class TValue, class THash, class TKeyEqual>
+constexpr size_t
+    ConcurrentEvictingCacheMap<TKey, TValue, THash, TKeyEqual>::kMinShardWeight;
+
+template <class TKey, class TValue, class THash, class TKeyEqual>
+constexpr uint32_t
+    ConcurrentEvictingCacheMap<TKey, TValue, THash, TKeyEqual>::kSketchSampling;
+
+} // namespace folly
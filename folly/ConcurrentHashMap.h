@@ -0,0 +1,493 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * ConcurrentHashMap --
+ *
+ * A general purpose concurrent hash map: any copyable or movable key and
+ * value types, unbounded growth, and erase that actually frees memory.
+ * Compared to AtomicHashMap, it has no sentinel keys, no capacity limit, no
+ * slowdown from chained submaps, and erased entries are reclaimed. Compared
+ * to a std::unordered_map behind a SharedMutex, readers never block and
+ * never write to shared cache lines.
+ *
+ * Implementation:
+ *   The map is split into 2^ShardBits segments, selected by the top bits
+ *   of the mixed hash and allocated on first use. Each segment is a
+ *   split-ordered hash table (see folly/detail/ConcurrentHashMapSegment.h)
+ *   with its own mutex for writers. Readers take no locks and never wait:
+ *   lookups and iteration run under an epoch guard (see
+ *   folly/detail/EpochReclamation.h), and erased or replaced entries are
+ *   reclaimed only after every reader that could have seen them is gone.
+ *
+ *   Segments grow independently, and growing never moves entries: it
+ *   doubles the segment's bucket count, and the new buckets are split off
+ *   a few at a time by later inserts, so no single insert pays for a full
+ *   rehash.
+ *
+ * Differences from std::unordered_map:
+ *   - Values are immutable once inserted, and the iterator is a
+ *     ConstIterator. Use assign(), insert_or_assign() or assign_if_equal()
+ *     to replace a value; readers see either the old or the new pair.
+ *   - at() and operator[] return copies, since the stored pair may be
+ *     reclaimed as soon as nothing protects it.
+ *   - size() is approximate while writers are active.
+ *   - Iterators are weakly consistent: they may or may not see concurrent
+ *     insertions and erasures, but see every other element exactly once,
+ *     even if segments grow meanwhile. Iteration is always memory safe.
+ *   - An iterator pins memory: entries erased while it is alive are
+ *     reclaimed only after it is destroyed. Iterators must be destroyed on
+ *     the thread that created them.
+ *   - HashFn, KeyEqual and Allocator are default constructed where needed
+ *     rather than stored, so they must be stateless.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include <folly/Bits.h>
+#include <folly/Hash.h>
+#include <folly/Optional.h>
+#include <folly/detail/ConcurrentHashMapSegment.h>
+#include <folly/detail/EpochReclamation.h>
+
+namespace folly {
+
+template <
+    typename KeyType,
+    typename ValueType,
+    typename HashFn = std::hash<KeyType>,
+    typename KeyEqual = std::equal_to<KeyType>,
+    typename Allocator = std::allocator<uint8_t>,
+    uint8_t ShardBits = 8>
+class ConcurrentHashMap {
+  static_assert(
+      ShardBits > 0 && ShardBits < 32,
+      "ShardBits must be between 1 and 31");
+
+  typedef detail::ConcurrentHashMapSegment<
+      KeyType,
+      ValueType,
+      HashFn,
+      KeyEqual,
+      Allocator>
+      Segment;
+  typedef typename Segment::InsertType InsertType;
+  typedef typename Segment::Link Link;
+  typedef typename Segment::Node Node;
+
+  static constexpr size_t kNumShards = size_t(1) << ShardBits;
+
+ public:
+  class ConstIterator;
+
+  typedef KeyType key_type;
+  typedef ValueType mapped_type;
+  typedef std::pair<const KeyType, ValueType> value_type;
+  typedef std::size_t size_type;
+  typedef HashFn hasher;
+  typedef KeyEqual key_equal;
+  typedef ConstIterator const_iterator;
+
+  /**
+   * size is a hint for the total number of elements; segments start with
+   * enough buckets for their share of it.
+   */
+  explicit ConcurrentHashMap(size_t size = 8, float maxLoadFactor = 1.05f)
+      : loadFactor_(maxLoadFactor),
+        initialBuckets_(size_t(size / (kNumShards * maxLoadFactor))) {
+    for (auto& segment : segments_) {
+      segment.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+  ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+  /// Moving is not thread safe: nothing may access either map meanwhile.
+  ConcurrentHashMap(ConcurrentHashMap&& other) noexcept
+      : loadFactor_(other.max_load_factor()),
+        initialBuckets_(other.initialBuckets_) {
+    for (size_t i = 0; i < kNumShards; ++i) {
+      segments_[i].store(
+          other.segments_[i].exchange(nullptr, std::memory_order_relaxed),
+          std::memory_order_relaxed);
+    }
+  }
+
+  ConcurrentHashMap& operator=(ConcurrentHashMap&& other) noexcept {
+    if (this != &other) {
+      destroySegments();
+      loadFactor_.store(other.max_load_factor(), std::memory_order_relaxed);
+      initialBuckets_ = other.initialBuckets_;
+      for (size_t i = 0; i < kNumShards; ++i) {
+        segments_[i].store(
+            other.segments_[i].exchange(nullptr, std::memory_order_relaxed),
+            std::memory_order_relaxed);
+      }
+    }
+    return *this;
+  }
+
+  /**
+   * Entries erased earlier may still be waiting for readers on other
+   * threads; those are reclaimed independently of the map.
+   */
+  ~ConcurrentHashMap() {
+    destroySegments();
+  }
+
+  bool empty() const noexcept {
+    for (auto& segment : segments_) {
+      auto seg = segment.load(std::memory_order_acquire);
+      if (seg && seg->size() != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  size_t size() const noexcept {
+    size_t res = 0;
+    for (auto& segment : segments_) {
+      auto seg = segment.load(std::memory_order_acquire);
+      if (seg) {
+        res += seg->size();
+      }
+    }
+    return res;
+  }
+
+  ConstIterator find(const KeyType& k) const {
+    auto h = hashKey(k);
+    ConstIterator res(this);
+    auto seg = segments_[shardOf(h)].load(std::memory_order_acquire);
+    if (seg) {
+      auto node = seg->find(h, k);
+      if (node) {
+        res.setPosition(shardOf(h), node);
+        return res;
+      }
+    }
+    return cend();
+  }
+
+  ConstIterator cbegin() const {
+    ConstIterator res(this);
+    res.seekSegment(0);
+    return res;
+  }
+
+  ConstIterator cend() const noexcept {
+    return ConstIterator();
+  }
+
+  ConstIterator begin() const {
+    return cbegin();
+  }
+
+  ConstIterator end() const noexcept {
+    return cend();
+  }
+
+  std::pair<ConstIterator, bool> insert(std::pair<KeyType, ValueType>&& kv) {
+    const KeyType& key = kv.first;
+    return insertImpl(
+        InsertType::DOES_NOT_EXIST, key, nullptr, [&](size_t h, Link* next) {
+          return Segment::makeNode(h, next, std::move(kv));
+        });
+  }
+
+  template <typename Key, typename Value>
+  std::pair<ConstIterator, bool> insert(Key&& k, Value&& v) {
+    return try_emplace(std::forward<Key>(k), std::forward<Value>(v));
+  }
+
+  template <typename Key, typename... Args>
+  std::pair<ConstIterator, bool> try_emplace(Key&& k, Args&&... args) {
+    const KeyType& key = k;
+    return insertImpl(
+        InsertType::DOES_NOT_EXIST, key, nullptr, [&](size_t h, Link* next) {
+          return Segment::makeNode(
+              h,
+              next,
+              std::piecewise_construct,
+              std::forward_as_tuple(std::forward<Key>(k)),
+              std::forward_as_tuple(std::forward<Args>(args)...));
+        });
+  }
+
+  template <typename... Args>
+  std::pair<ConstIterator, bool> emplace(Args&&... args) {
+    // The key is only known once the pair exists
+    auto node = Segment::makeNode(0, nullptr, std::forward<Args>(args)...);
+    bool consumed = false;
+    auto res = insertImpl(
+        InsertType::DOES_NOT_EXIST,
+        node->value.first,
+        nullptr,
+        [&](size_t h, Link* next) {
+          consumed = true;
+          node->setHash(h);
+          node->next.store(next, std::memory_order_relaxed);
+          return node;
+        });
+    if (!consumed) {
+      Segment::reclaimNode(node);
+    }
+    return res;
+  }
+
+  template <typename Key, typename Value>
+  std::pair<ConstIterator, bool> insert_or_assign(Key&& k, Value&& v) {
+    return assignImpl(
+        InsertType::ANY,
+        std::forward<Key>(k),
+        nullptr,
+        std::forward<Value>(v));
+  }
+
+  /// Replaces the value of an existing key; none if the key is absent.
+  template <typename Key, typename Value>
+  Optional<ConstIterator> assign(Key&& k, Value&& v) {
+    auto res = assignImpl(
+        InsertType::MUST_EXIST,
+        std::forward<Key>(k),
+        nullptr,
+        std::forward<Value>(v));
+    return res.second ? Optional<ConstIterator>(std::move(res.first))
+                      : Optional<ConstIterator>();
+  }
+
+  /// Replaces the value of k only if it currently equals expected.
+  template <typename Key, typename Value>
+  Optional<ConstIterator>
+  assign_if_equal(Key&& k, const ValueType& expected, Value&& desired) {
+    auto res = assignImpl(
+        InsertType::MATCH,
+        std::forward<Key>(k),
+        &expected,
+        std::forward<Value>(desired));
+    return res.second ? Optional<ConstIterator>(std::move(res.first))
+                      : Optional<ConstIterator>();
+  }
+
+  /// Inserts a default constructed value if k is absent.
+  const ValueType operator[](const KeyType& k) {
+    return try_emplace(k).first->second;
+  }
+
+  const ValueType at(const KeyType& k) const {
+    auto it = find(k);
+    if (it == cend()) {
+      throw std::out_of_range("at(): value out of range");
+    }
+    return it->second;
+  }
+
+  size_type erase(const key_type& k) {
+    auto h = hashKey(k);
+    auto seg = segments_[shardOf(h)].load(std::memory_order_acquire);
+    if (!seg) {
+      return 0;
+    }
+    auto res = seg->erase(h, k);
+    detail::EpochDomain::defaultDomain().maybeCollect();
+    return res;
+  }
+
+  /// Erases the element at pos and returns an iterator to the next one.
+  ConstIterator erase(ConstIterator& pos) {
+    auto next = pos;
+    ++next;
+    erase(pos->first);
+    return next;
+  }
+
+  void clear() {
+    for (auto& segment : segments_) {
+      auto seg = segment.load(std::memory_order_acquire);
+      if (seg) {
+        seg->clear();
+      }
+    }
+    detail::EpochDomain::defaultDomain().maybeCollect();
+  }
+
+  /// Preallocates buckets so that count elements fit without rehashing.
+  void reserve(size_t count) {
+    for (size_t i = 0; i < kNumShards; ++i) {
+      ensureSegment(i)->reserve((count + kNumShards - 1) / kNumShards);
+    }
+    detail::EpochDomain::defaultDomain().maybeCollect();
+  }
+
+  float max_load_factor() const {
+    return loadFactor_.load(std::memory_order_relaxed);
+  }
+
+  /// Takes effect for each segment the next time it grows.
+  void max_load_factor(float factor) {
+    loadFactor_.store(factor, std::memory_order_relaxed);
+    for (auto& segment : segments_) {
+      auto seg = segment.load(std::memory_order_acquire);
+      if (seg) {
+        seg->setLoadFactor(factor);
+      }
+    }
+  }
+
+  class ConstIterator
+      : public std::iterator<std::forward_iterator_tag, const value_type> {
+   public:
+    ConstIterator() : guard_(nullptr) {}
+
+    const value_type& operator*() const {
+      return node_->value;
+    }
+
+    const value_type* operator->() const {
+      return &node_->value;
+    }
+
+    ConstIterator& operator++() {
+      node_ = Segment::nextNode(node_);
+      if (!node_) {
+        seekSegment(segment_ + 1);
+      }
+      return *this;
+    }
+
+    ConstIterator operator++(int) {
+      auto res = *this;
+      ++*this;
+      return res;
+    }
+
+    bool operator==(const ConstIterator& other) const {
+      return node_ == other.node_;
+    }
+
+    bool operator!=(const ConstIterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class ConcurrentHashMap;
+
+    explicit ConstIterator(const ConcurrentHashMap* parent)
+        : parent_(parent) {}
+
+    void setPosition(size_t segment, Node* node) {
+      segment_ = segment;
+      node_ = node;
+    }
+
+    // Moves to the first element of the first non-empty segment at or
+    // after the given one.
+    void seekSegment(size_t segment) {
+      for (; segment < kNumShards; ++segment) {
+        auto seg = parent_->segments_[segment].load(std::memory_order_acquire);
+        if (seg) {
+          node_ = seg->first();
+          if (node_) {
+            segment_ = segment;
+            return;
+          }
+        }
+      }
+      node_ = nullptr;
+    }
+
+    detail::EpochGuard guard_;
+    const ConcurrentHashMap* parent_{nullptr};
+    size_t segment_{0};
+    Node* node_{nullptr};
+  };
+
+ private:
+  static size_t hashKey(const KeyType& k) {
+    return hash::twang_mix64(HashFn()(k));
+  }
+
+  static size_t shardOf(size_t hash) {
+    return hash >> (64 - ShardBits);
+  }
+
+  Segment* ensureSegment(size_t i) {
+    auto seg = segments_[i].load(std::memory_order_acquire);
+    if (!seg) {
+      auto fresh = new Segment(initialBuckets_, max_load_factor());
+      if (segments_[i].compare_exchange_strong(
+              seg, fresh, std::memory_order_acq_rel)) {
+        seg = fresh;
+      } else {
+        delete fresh;
+      }
+    }
+    return seg;
+  }
+
+  void destroySegments() {
+    for (auto& segment : segments_) {
+      delete segment.exchange(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  template <typename MakeNode>
+  std::pair<ConstIterator, bool> insertImpl(
+      InsertType type,
+      const KeyType& key,
+      const ValueType* expected,
+      MakeNode&& makeNode) {
+    auto h = hashKey(key);
+    auto shard = shardOf(h);
+    // Protects the returned node from concurrent erasure once unlocked
+    ConstIterator it(this);
+    auto res = ensureSegment(shard)->insert(type, h, key, expected, makeNode);
+    detail::EpochDomain::defaultDomain().maybeCollect();
+    if (!res.first) {
+      return {cend(), false};
+    }
+    it.setPosition(shard, res.first);
+    return {std::move(it), res.second};
+  }
+
+  template <typename Key, typename Value>
+  std::pair<ConstIterator, bool> assignImpl(
+      InsertType type,
+      Key&& k,
+      const ValueType* expected,
+      Value&& v) {
+    const KeyType& key = k;
+    return insertImpl(type, key, expected, [&](size_t h, Link* next) {
+      return Segment::makeNode(
+          h, next, std::forward<Key>(k), std::forward<Value>(v));
+    });
+  }
+
+  std::atomic<Segment*> segments_[kNumShards];
+  std::atomic<float> loadFactor_;
+  size_t initialBuckets_;
+};
+
+} // namespace folly
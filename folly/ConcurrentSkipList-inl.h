@@ -228,90 +228,137 @@ class SkipListRandomHeight {
 template<typename NodeType, typename NodeAlloc, typename = void>
 class NodeRecycler;
 
+// Frees removed nodes once no Accessor that could still reach them is
+// alive.
+//
+// Accessors register in one of two generations: the current one, or (for
+// copies) the one of the Accessor they were copied from. Nodes removed
+// during generation g are kept in that generation's list. Once every
+// Accessor of the previous generation is gone, its list (holding nodes
+// removed before g started) is freed and generation g + 1 begins, reusing
+// the previous generation's slot. So a long-lived Accessor delays
+// reclamation of nodes removed after it was created, but short-lived ones
+// never need the Accessor count to drop to zero.
 template<typename NodeType, typename NodeAlloc>
 class NodeRecycler<NodeType, NodeAlloc, typename std::enable_if<
   !NodeType::template destroyIsNoOp<NodeAlloc>()>::type> {
  public:
   explicit NodeRecycler(const NodeAlloc& alloc)
-    : refs_(0), dirty_(false), alloc_(alloc) { lock_.init(); }
+    : gen_(0), dirty_(false), alloc_(alloc) { init(); }
 
-  explicit NodeRecycler() : refs_(0), dirty_(false) { lock_.init(); }
+  explicit NodeRecycler() : gen_(0), dirty_(false) { init(); }
 
   ~NodeRecycler() {
     CHECK_EQ(refs(), 0);
-    if (nodes_) {
-      for (auto& node : *nodes_) {
+    for (auto& nodes : nodes_) {
+      for (auto& node : nodes) {
         NodeType::destroy(alloc_, node);
       }
     }
   }
 
   void add(NodeType* node) {
-    std::lock_guard<MicroSpinLock> g(lock_);
-    if (nodes_.get() == nullptr) {
-      nodes_.reset(new std::vector<NodeType*>(1, node));
-    } else {
-      nodes_->push_back(node);
+    bool reclaim;
+    {
+      std::lock_guard<MicroSpinLock> g(lock_);
+      auto& nodes = nodes_[gen_.load(std::memory_order_relaxed) & 1];
+      nodes.push_back(node);
+      DCHECK_GT(refs(), 0);
+      dirty_.store(true, std::memory_order_relaxed);
+      reclaim = nodes.size() % kReclaimBatch == 0;
+    }
+    // The caller's own Accessor only pins the current generation, so the
+    // previous one may well be reclaimable now.
+    if (reclaim) {
+      tryReclaim();
     }
-    DCHECK_GT(refs(), 0);
-    dirty_.store(true, std::memory_order_relaxed);
   }
 
+  // Returns the generation slot to pass to releaseRef().
   int addRef() {
-    return refs_.fetch_add(1, std::memory_order_relaxed);
-  }
-
-  int releaseRef() {
-    // We don't expect to clean the recycler immediately everytime it is OK
-    // to do so. Here, it is possible that multiple accessors all release at
-    // the same time but nobody would clean the recycler here. If this
-    // happens, the recycler will usually still get cleaned when
-    // such a race doesn't happen. The worst case is the recycler will
-    // eventually get deleted along with the skiplist.
-    if (LIKELY(!dirty_.load(std::memory_order_relaxed) || refs() > 1)) {
-      return refs_.fetch_add(-1, std::memory_order_relaxed);
-    }
-
-    std::unique_ptr<std::vector<NodeType*>> newNodes;
-    {
-      std::lock_guard<MicroSpinLock> g(lock_);
-      if (nodes_.get() == nullptr || refs() > 1) {
-        return refs_.fetch_add(-1, std::memory_order_relaxed);
+    for (;;) {
+      auto gen = gen_.load(std::memory_order_seq_cst);
+      int slot = gen & 1;
+      refs_[slot].fetch_add(1, std::memory_order_seq_cst);
+      // If the generation moved on before we registered, a concurrent
+      // tryReclaim() may not have seen us; register again.
+      if (LIKELY(gen_.load(std::memory_order_seq_cst) == gen)) {
+        return slot;
       }
-      // once refs_ reaches 1 and there is no other accessor, it is safe to
-      // remove all the current nodes in the recycler, as we already acquired
-      // the lock here so no more new nodes can be added, even though new
-      // accessors may be added after that.
-      newNodes.swap(nodes_);
-      dirty_.store(false, std::memory_order_relaxed);
+      refs_[slot].fetch_add(-1, std::memory_order_relaxed);
     }
+  }
 
-    // TODO(xliu) should we spawn a thread to do this when there are large
-    // number of nodes in the recycler?
-    for (auto& node : *newNodes) {
-      NodeType::destroy(alloc_, node);
-    }
+  // Registers in the same generation as an existing reference to slot,
+  // which keeps that generation from being reclaimed meanwhile.
+  int addRef(int slot) {
+    refs_[slot].fetch_add(1, std::memory_order_relaxed);
+    return slot;
+  }
 
-    // decrease the ref count at the very end, to minimize the
-    // chance of other threads acquiring lock_ to clear the deleted
-    // nodes again.
-    return refs_.fetch_add(-1, std::memory_order_relaxed);
+  int releaseRef(int slot) {
+    auto prev = refs_[slot].fetch_add(-1, std::memory_order_seq_cst);
+    if (UNLIKELY(prev == 1 && dirty_.load(std::memory_order_relaxed))) {
+      tryReclaim();
+    }
+    return prev;
   }
 
   NodeAlloc& alloc() { return alloc_; }
 
  private:
+  static constexpr size_t kReclaimBatch = 128;
+
+  void init() {
+    lock_.init();
+    refs_[0].store(0, std::memory_order_relaxed);
+    refs_[1].store(0, std::memory_order_relaxed);
+  }
+
   int refs() const {
-    return refs_.load(std::memory_order_relaxed);
+    return refs_[0].load(std::memory_order_relaxed) +
+      refs_[1].load(std::memory_order_relaxed);
   }
 
-  std::unique_ptr<std::vector<NodeType*>> nodes_;
-  std::atomic<int32_t> refs_; // current number of visitors to the list
-  std::atomic<bool> dirty_; // whether *nodes_ is non-empty
-  MicroSpinLock lock_; // protects access to *nodes_
+  void tryReclaim() {
+    std::vector<NodeType*> garbage;
+    {
+      std::lock_guard<MicroSpinLock> g(lock_);
+      // At most two rounds: the second frees what the current generation
+      // removed, if its Accessors are all gone too.
+      for (int round = 0; round < 2; ++round) {
+        auto gen = gen_.load(std::memory_order_relaxed);
+        int prev = (gen & 1) ^ 1;
+        if (refs_[prev].load(std::memory_order_seq_cst) != 0) {
+          break;
+        }
+        garbage.insert(garbage.end(), nodes_[prev].begin(), nodes_[prev].end());
+        nodes_[prev].clear();
+        gen_.store(gen + 1, std::memory_order_seq_cst);
+        if (nodes_[gen & 1].empty()) {
+          break;
+        }
+      }
+      dirty_.store(!nodes_[0].empty() || !nodes_[1].empty(),
+                   std::memory_order_relaxed);
+    }
+    for (auto& node : garbage) {
+      NodeType::destroy(alloc_, node);
+    }
+  }
+
+  std::vector<NodeType*> nodes_[2]; // removed nodes, by generation
+  std::atomic<int32_t> refs_[2]; // live Accessors, by generation
+  std::atomic<uint64_t> gen_;
+  std::atomic<bool> dirty_; // whether any of nodes_ is non-empty
+  MicroSpinLock lock_; // protects nodes_ and generation changes
   NodeAlloc alloc_;
 };
 
+template<typename NodeType, typename NodeAlloc>
+constexpr size_t NodeRecycler<NodeType, NodeAlloc, typename std::enable_if<
+  !NodeType::template destroyIsNoOp<NodeAlloc>()>::type>::kReclaimBatch;
+
 // In case of arena allocator, no recycling is necessary, and it's possible
 // to save on ConcurrentSkipList size.
 template<typename NodeType, typename NodeAlloc>
@@ -320,8 +367,9 @@ class NodeRecycler<NodeType, NodeAlloc, typename std::enable_if<
  public:
   explicit NodeRecycler(const NodeAlloc& alloc) : alloc_(alloc) { }
 
-  void addRef() { }
-  void releaseRef() { }
+  int addRef() { return 0; }
+  int addRef(int slot) { return slot; }
+  int releaseRef(int /* slot */) { return 0; }
 
   void add(NodeType* /* node */) {}
 
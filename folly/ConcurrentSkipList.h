@@ -55,8 +55,12 @@ Features:
      better cache locality.  Based on that, it's also faster to
      intersect two skiplists.
 
-  4. Lazy removal with GC support.  The removed nodes get deleted when
-     the last Accessor to the skiplist is destroyed.
+  4. Lazy removal with GC support.  The removed nodes get deleted once
+     every Accessor that existed when they were removed is destroyed,
+     so overlapping short-lived Accessors do not pin them.
+
+  5. Bulk loading of sorted input in O(N) (createInstanceFromSorted),
+     and prefetching range scans (Accessor::forEachInRange).
 
 Caveats:
 
@@ -74,8 +78,8 @@ Caveats:
 
   5. Currently x64 only, due to use of MicroSpinLock.
 
-  6. Freed nodes will not be reclaimed as long as there are ongoing
-     uses of the list.
+  6. Freed nodes will not be reclaimed as long as an Accessor created
+     before their removal is alive.
 
 Sample usage:
 
@@ -189,6 +193,26 @@ class ConcurrentSkipList {
     return std::make_shared<ConcurrentSkipList>(height);
   }
 
+  // Create a shared_ptr skiplist object holding the elements of [first,
+  // last), which must be sorted by Comp; equivalent elements are stored
+  // once. This takes O(N), instead of the O(N log N) of adding them one
+  // by one, as nodes are simply appended to every layer.
+  template <typename InputIt>
+  static std::shared_ptr<SkipListType> createInstanceFromSorted(
+      InputIt first, InputIt last, const NodeAlloc& alloc) {
+    auto sl = createInstance(1, alloc);
+    sl->appendSorted(first, last);
+    return sl;
+  }
+
+  template <typename InputIt>
+  static std::shared_ptr<SkipListType> createInstanceFromSorted(
+      InputIt first, InputIt last) {
+    auto sl = createInstance(1);
+    sl->appendSorted(first, last);
+    return sl;
+  }
+
   //===================================================================
   // Below are implementation details.
   // Please see ConcurrentSkipList::Accessor for stdlib-like APIs.
@@ -508,6 +532,67 @@ class ConcurrentSkipList {
     recycle(oldHead);
   }
 
+  // Only for building a list nobody else has access to yet. The head
+  // grows on the same schedule as in addOrGetData().
+  template <typename InputIt>
+  void appendSorted(InputIt first, InputIt last) {
+    DCHECK_EQ(0, size());
+    auto random = detail::SkipListRandomHeight::instance();
+    NodeType* head = head_.load(std::memory_order_relaxed);
+    NodeType* tails[MAX_HEIGHT];
+    std::fill(tails, tails + head->height(), head);
+    size_t n = 0;
+    for (; first != last; ++first) {
+      if (n > 0 && !Comp()(tails[0]->data(), *first)) {
+        DCHECK(!Comp()(*first, tails[0]->data())) << "input is not sorted";
+        continue;
+      }
+      int hgt = head->height();
+      if (hgt < MAX_HEIGHT && n + 1 > random->getSizeLimit(hgt)) {
+        NodeType* newHead =
+          NodeType::create(recycler_.alloc(), hgt + 1, value_type(), true);
+        newHead->copyHead(head);
+        std::replace(tails, tails + hgt, head, newHead);
+        tails[hgt] = newHead;
+        NodeType::destroy(recycler_.alloc(), head);
+        head = newHead;
+        head_.store(head, std::memory_order_relaxed);
+      }
+      int nodeHeight = random->getHeight(head->height());
+      NodeType* node =
+        NodeType::create(recycler_.alloc(), nodeHeight, *first);
+      for (int layer = 0; layer < nodeHeight; ++layer) {
+        tails[layer]->setSkip(layer, node);
+        tails[layer] = node;
+      }
+      node->setFullyLinked();
+      ++n;
+    }
+    size_.store(n, std::memory_order_release);
+  }
+
+  // Calls fn on every element in [from, to), in order. Walks the bottom
+  // layer directly, prefetching the nodes the upper layers of the current
+  // node point to, which is where the walk will be a few steps later.
+  template <typename Fn>
+  size_t forEachInRange(const value_type& from, const value_type& to,
+                        Fn& fn) const {
+    size_t count = 0;
+    for (NodeType* node = lower_bound(from);
+         node != nullptr && Comp()(node->data(), to);
+         node = node->skip(0)) {
+      if (node->height() > 1) {
+        __builtin_prefetch(node->skip(node->height() - 1));
+        __builtin_prefetch(node->skip(1));
+      }
+      if (!node->markedForRemoval()) {
+        fn(node->data());
+        ++count;
+      }
+    }
+    return count;
+  }
+
   void recycle(NodeType *node) {
     recycler_.add(node);
   }
@@ -541,34 +626,38 @@ class ConcurrentSkipList<T, Comp, NodeAlloc, MAX_HEIGHT>::Accessor {
   {
     sl_ = slHolder_.get();
     DCHECK(sl_ != nullptr);
-    sl_->recycler_.addRef();
+    recyclerSlot_ = sl_->recycler_.addRef();
   }
 
   // Unsafe initializer: the caller assumes the responsibility to keep
   // skip_list valid during the whole life cycle of the Acessor.
   explicit Accessor(ConcurrentSkipList *skip_list) : sl_(skip_list) {
     DCHECK(sl_ != nullptr);
-    sl_->recycler_.addRef();
+    recyclerSlot_ = sl_->recycler_.addRef();
   }
 
   Accessor(const Accessor &accessor) :
       sl_(accessor.sl_),
-      slHolder_(accessor.slHolder_) {
-    sl_->recycler_.addRef();
+      slHolder_(accessor.slHolder_),
+      recyclerSlot_(sl_->recycler_.addRef(accessor.recyclerSlot_)) {
   }
 
   Accessor& operator=(const Accessor &accessor) {
     if (this != &accessor) {
+      auto holder = slHolder_;
+      auto sl = sl_;
+      auto slot = recyclerSlot_;
       slHolder_ = accessor.slHolder_;
-      sl_->recycler_.releaseRef();
       sl_ = accessor.sl_;
-      sl_->recycler_.addRef();
+      recyclerSlot_ = sl_->recycler_.addRef(accessor.recyclerSlot_);
+      // Released last, as it may free the list we were using
+      sl->recycler_.releaseRef(slot);
     }
     return *this;
   }
 
   ~Accessor() {
-    sl_->recycler_.releaseRef();
+    sl_->recycler_.releaseRef(recyclerSlot_);
   }
 
   bool empty() const { return sl_->size() == 0; }
@@ -604,6 +693,15 @@ class ConcurrentSkipList<T, Comp, NodeAlloc, MAX_HEIGHT>::Accessor {
     return iterator(sl_->lower_bound(data));
   }
 
+  // Calls fn(const key_type&) on every element in [from, to), in order,
+  // and returns how many there were. Faster than iterating from
+  // lower_bound(from) over long ranges, as upcoming nodes are prefetched.
+  template <typename Fn>
+  size_t forEachInRange(const key_type &from, const key_type &to,
+                        Fn fn) const {
+    return sl_->forEachInRange(from, to, fn);
+  }
+
   size_t height() const { return sl_->height(); }
 
   // first() returns pointer to the first element in the skiplist, or
@@ -648,6 +746,7 @@ class ConcurrentSkipList<T, Comp, NodeAlloc, MAX_HEIGHT>::Accessor {
  private:
   SkipListType *sl_;
   std::shared_ptr<SkipListType> slHolder_;
+  int recyclerSlot_;
 };
 
 // implements forward iterator concept.
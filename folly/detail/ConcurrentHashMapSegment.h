@@ -0,0 +1,459 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+
+#include <folly/Bits.h>
+#include <folly/detail/EpochReclamation.h>
+
+namespace folly {
+namespace detail {
+
+enum class ConcurrentHashMapInsertType {
+  DOES_NOT_EXIST, // insert only if the key is absent
+  MUST_EXIST, // replace only if the key is present
+  ANY, // insert or replace
+  MATCH, // replace only if the current value equals the expected one
+};
+
+/**
+ * One shard of a ConcurrentHashMap: a split-ordered hash table whose
+ * writers serialize on a mutex and whose readers never lock or wait.
+ *
+ * All entries of the segment live in a single linked list, sorted by their
+ * bit-reversed hash, so that the entries of any bucket (any hash suffix)
+ * are contiguous. Each bucket has a sentinel link where its run starts.
+ * Sentinels live in arrays that are never reallocated: the first holds the
+ * initial buckets, and each doubling of the bucket count adds an array for
+ * the new half. Growing therefore moves nothing. The new sentinels are
+ * linked in by the first writer that needs one, or a few at a time by each
+ * insert, and until then lookups start from the sentinel of the bucket
+ * they split from, which precedes them in the list. Rehashing is thus
+ * spread over later inserts, and a reader never sees a chain being
+ * rewritten.
+ *
+ * A node's key/value pair is immutable once published. A replacement
+ * links in a new node and retires the old one, so a reader always sees
+ * either the old or the new pair, never a torn one. Everything unlinked is
+ * handed to the epoch domain, so readers must hold an EpochGuard.
+ */
+template <
+    typename KeyType,
+    typename ValueType,
+    typename HashFn,
+    typename KeyEqual,
+    typename Allocator>
+class ConcurrentHashMapSegment {
+ public:
+  typedef std::pair<const KeyType, ValueType> value_type;
+  typedef ConcurrentHashMapInsertType InsertType;
+
+  /**
+   * A list element: a Node or a bucket sentinel. Pointers to sentinels have
+   * their low bit set, so that a lookup can tell where its bucket ends
+   * without touching the next bucket's sentinel.
+   */
+  struct Link {
+    Link(uint64_t o, Link* n) : order(o), next(n) {}
+
+    uint64_t order;
+    std::atomic<Link*> next;
+  };
+
+  struct Node : Link, EpochRetired {
+    template <typename... Args>
+    Node(size_t h, Link* n, Args&&... args)
+        : Link(nodeOrder(h), n), value(std::forward<Args>(args)...) {}
+
+    void setHash(size_t h) {
+      this->order = nodeOrder(h);
+    }
+
+    value_type value;
+  };
+
+  ConcurrentHashMapSegment(size_t initialBuckets, float loadFactor)
+      : loadFactor_(loadFactor) {
+    auto count = nextPowTwo(std::max<size_t>(initialBuckets, 1));
+    initialShift_ = findLastSet(count) - 1;
+    generations_[0] = makeSentinels(count);
+    generations_[0][0].next.store(nullptr, std::memory_order_relaxed);
+    bucketCount_.store(count, std::memory_order_relaxed);
+    maxLoad_ = size_t(count * loadFactor_);
+  }
+
+  ConcurrentHashMapSegment(const ConcurrentHashMapSegment&) = delete;
+  ConcurrentHashMapSegment& operator=(const ConcurrentHashMapSegment&) =
+      delete;
+
+  /// Not thread safe; nothing may access the segment concurrently.
+  ~ConcurrentHashMapSegment() {
+    auto link = generations_[0][0].next.load(std::memory_order_relaxed);
+    while (link) {
+      auto next = untagged(link)->next.load(std::memory_order_relaxed);
+      if (!isSentinel(link)) {
+        reclaimNode(static_cast<Node*>(link));
+      }
+      link = next;
+    }
+    auto count = size_t(1) << initialShift_;
+    for (size_t g = 0; g < kMaxGenerations && generations_[g]; ++g) {
+      destroySentinels(generations_[g], count);
+      count = size_t(1) << (initialShift_ + g);
+    }
+  }
+
+  size_t size() const {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+  /// The first node of the segment, if any. Caller must hold an EpochGuard.
+  Node* first() const {
+    return nextNode(&generations_[0][0]);
+  }
+
+  /// The node after link, skipping sentinels.
+  static Node* nextNode(const Link* link) {
+    auto next = link->next.load(std::memory_order_acquire);
+    while (isSentinel(next)) {
+      next = untagged(next)->next.load(std::memory_order_acquire);
+    }
+    return static_cast<Node*>(next);
+  }
+
+  /// Caller must hold an EpochGuard for as long as it uses the result.
+  Node* find(size_t hash, const KeyType& key) const {
+    auto count = bucketCount_.load(std::memory_order_acquire);
+    auto order = nodeOrder(hash);
+    auto bucket = hash & (count - 1);
+    bool own = true;
+    Link* link;
+    // A sentinel points to itself until it's linked in; start from the
+    // bucket this one was split from until then. Bucket 0's always is.
+    for (;;) {
+      auto s = sentinel(bucket);
+      link = s->next.load(std::memory_order_acquire);
+      if (link != s) {
+        break;
+      }
+      bucket = parentBucket(bucket);
+      own = false;
+    }
+    for (; link; link = link->next.load(std::memory_order_acquire)) {
+      if (isSentinel(link)) {
+        link = untagged(link);
+        // From our own sentinel, the next one ends our bucket, unless the
+        // table grew since and finer buckets were linked in meanwhile.
+        if ((own && bucketCount_.load(std::memory_order_acquire) == count) ||
+            link->order > order) {
+          return nullptr;
+        }
+        continue;
+      }
+      if (link->order > order) {
+        return nullptr;
+      }
+      auto node = static_cast<Node*>(link);
+      if (link->order == order && KeyEqual()(node->value.first, key)) {
+        return node;
+      }
+    }
+    return nullptr;
+  }
+
+  /**
+   * Inserts or replaces according to type. makeNode(hash, next) is called
+   * at most once, and only when the segment will publish its result;
+   * ownership of the returned node passes to the segment.
+   *
+   * Returns the node now holding key (null if nothing matched for
+   * MUST_EXIST / MATCH) and whether anything was published.
+   */
+  template <typename MakeNode>
+  std::pair<Node*, bool> insert(
+      InsertType type,
+      size_t hash,
+      const KeyType& key,
+      const ValueType* expected,
+      MakeNode&& makeNode) {
+    std::lock_guard<std::mutex> g(mutex_);
+    std::atomic<Link*>* prev;
+    auto node = findLocked(hash, key, prev);
+
+    if (node) {
+      if (type == InsertType::DOES_NOT_EXIST) {
+        return {node, false};
+      }
+      if (type == InsertType::MATCH && !(node->value.second == *expected)) {
+        return {nullptr, false};
+      }
+      auto replacement =
+          makeNode(hash, node->next.load(std::memory_order_relaxed));
+      prev->store(replacement, std::memory_order_release);
+      epochRetire(node, &reclaimRetired);
+      return {replacement, true};
+    }
+
+    if (type == InsertType::MUST_EXIST || type == InsertType::MATCH) {
+      return {nullptr, false};
+    }
+    // Nodes don't move when growing, so prev stays valid
+    if (size() >= maxLoad_) {
+      growLocked(bucketCount_.load(std::memory_order_relaxed) * 2);
+    }
+    node = makeNode(hash, prev->load(std::memory_order_relaxed));
+    prev->store(node, std::memory_order_release);
+    size_.store(size() + 1, std::memory_order_relaxed);
+    migrateLocked();
+    return {node, true};
+  }
+
+  /// Removes key, returning the number of elements erased.
+  size_t erase(size_t hash, const KeyType& key) {
+    std::lock_guard<std::mutex> g(mutex_);
+    std::atomic<Link*>* prev;
+    auto node = findLocked(hash, key, prev);
+    if (!node) {
+      return 0;
+    }
+    // node->next is left intact for readers standing on node
+    prev->store(
+        node->next.load(std::memory_order_relaxed), std::memory_order_release);
+    size_.store(size() - 1, std::memory_order_relaxed);
+    epochRetire(node, &reclaimRetired);
+    return 1;
+  }
+
+  /// Unlinks every node, keeping the sentinels and the bucket count.
+  void clear() {
+    std::lock_guard<std::mutex> g(mutex_);
+    Link* sentinel = &generations_[0][0];
+    auto link = sentinel->next.load(std::memory_order_relaxed);
+    while (link) {
+      auto next = untagged(link)->next.load(std::memory_order_relaxed);
+      if (isSentinel(link)) {
+        sentinel->next.store(link, std::memory_order_release);
+        sentinel = untagged(link);
+      } else {
+        epochRetire(static_cast<Node*>(link), &reclaimRetired);
+      }
+      link = next;
+    }
+    sentinel->next.store(nullptr, std::memory_order_release);
+    size_.store(0, std::memory_order_relaxed);
+  }
+
+  /// Grows the bucket array so that count elements fit without growing.
+  void reserve(size_t count) {
+    std::lock_guard<std::mutex> g(mutex_);
+    auto buckets = nextPowTwo(std::max<size_t>(size_t(count / loadFactor_), 1));
+    if (buckets > bucketCount_.load(std::memory_order_relaxed)) {
+      growLocked(buckets);
+    }
+  }
+
+  void setLoadFactor(float loadFactor) {
+    std::lock_guard<std::mutex> g(mutex_);
+    loadFactor_ = loadFactor;
+    maxLoad_ =
+        size_t(bucketCount_.load(std::memory_order_relaxed) * loadFactor_);
+  }
+
+  template <typename... Args>
+  static Node* makeNode(size_t hash, Link* next, Args&&... args) {
+    return create<Node>(sizeof(Node), hash, next, std::forward<Args>(args)...);
+  }
+
+  static void reclaimNode(Node* node) {
+    destroy(node, sizeof(Node));
+  }
+
+ private:
+  typedef typename std::allocator_traits<Allocator>::template rebind_alloc<
+      uint8_t>
+      ByteAllocator;
+
+  // Enough doublings for any realistic segment; beyond that chains just
+  // get longer.
+  static constexpr size_t kMaxGenerations = 32;
+  static constexpr size_t kMigrateBatch = 4;
+
+  static uint64_t reverseBits(uint64_t x) {
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((x & 0x0f0f0f0f0f0f0f0fULL) << 4);
+    return Endian::swap(x);
+  }
+
+  // A sentinel sorts before the nodes of equal order, hence before every
+  // node of its bucket.
+  static uint64_t nodeOrder(size_t hash) {
+    return reverseBits(hash);
+  }
+
+  static uint64_t sentinelOrder(size_t bucket) {
+    return reverseBits(bucket);
+  }
+
+  // The bucket that bucket was split from when the table last doubled
+  static size_t parentBucket(size_t bucket) {
+    return bucket & ~(size_t(1) << (findLastSet(bucket) - 1));
+  }
+
+  Link* sentinel(size_t bucket) const {
+    if (bucket < (size_t(1) << initialShift_)) {
+      return &generations_[0][bucket];
+    }
+    auto high = findLastSet(bucket) - 1;
+    return &generations_[high - initialShift_ + 1]
+                        [bucket - (size_t(1) << high)];
+  }
+
+  static bool isSentinel(const Link* link) {
+    return reinterpret_cast<uintptr_t>(link) & 1;
+  }
+
+  static Link* tagged(Link* sentinel) {
+    return reinterpret_cast<Link*>(reinterpret_cast<uintptr_t>(sentinel) | 1);
+  }
+
+  static Link* untagged(Link* link) {
+    return reinterpret_cast<Link*>(reinterpret_cast<uintptr_t>(link) & ~1);
+  }
+
+  // The sentinel of bucket, linking it (and its ancestors) in if needed
+  Link* initSentinelLocked(size_t bucket) {
+    auto s = sentinel(bucket);
+    if (s->next.load(std::memory_order_relaxed) != s) {
+      return s;
+    }
+    Link* prev = initSentinelLocked(parentBucket(bucket));
+    auto order = sentinelOrder(bucket);
+    auto next = prev->next.load(std::memory_order_relaxed);
+    while (next && untagged(next)->order < order) {
+      prev = untagged(next);
+      next = prev->next.load(std::memory_order_relaxed);
+    }
+    s->order = order;
+    s->next.store(next, std::memory_order_release);
+    prev->next.store(tagged(s), std::memory_order_release);
+    return s;
+  }
+
+  // Returns the node holding key, or null, and sets prev to the pointer
+  // to the node, or to where a new node for key belongs.
+  Node* findLocked(size_t hash, const KeyType& key, std::atomic<Link*>*& prev) {
+    auto count = bucketCount_.load(std::memory_order_relaxed);
+    auto order = nodeOrder(hash);
+    prev = &initSentinelLocked(hash & (count - 1))->next;
+    for (auto link = prev->load(std::memory_order_relaxed);
+         link && untagged(link)->order <= order;
+         link = prev->load(std::memory_order_relaxed)) {
+      if (!isSentinel(link) && link->order == order) {
+        auto node = static_cast<Node*>(link);
+        if (KeyEqual()(node->value.first, key)) {
+          return node;
+        }
+      }
+      prev = &untagged(link)->next;
+    }
+    return nullptr;
+  }
+
+  template <typename T, typename... Args>
+  static T* create(size_t bytes, Args&&... args) {
+    auto mem = ByteAllocator().allocate(bytes);
+    try {
+      return new (mem) T(std::forward<Args>(args)...);
+    } catch (...) {
+      ByteAllocator().deallocate(mem, bytes);
+      throw;
+    }
+  }
+
+  template <typename T>
+  static void destroy(T* obj, size_t bytes) {
+    obj->~T();
+    ByteAllocator().deallocate(reinterpret_cast<uint8_t*>(obj), bytes);
+  }
+
+  static Link* makeSentinels(size_t count) {
+    auto sentinels =
+        reinterpret_cast<Link*>(ByteAllocator().allocate(count * sizeof(Link)));
+    for (size_t i = 0; i < count; ++i) {
+      new (&sentinels[i]) Link(0, &sentinels[i]);
+    }
+    return sentinels;
+  }
+
+  static void destroySentinels(Link* sentinels, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      sentinels[i].~Link();
+    }
+    ByteAllocator().deallocate(
+        reinterpret_cast<uint8_t*>(sentinels), count * sizeof(Link));
+  }
+
+  static void reclaimRetired(EpochRetired* obj) {
+    reclaimNode(static_cast<Node*>(obj));
+  }
+
+  // Links in the next few sentinels that no writer has needed yet, so that
+  // lookups stop falling back to parent buckets. Linking kMigrateBatch per
+  // insert finishes a generation well before the table doubles again.
+  void migrateLocked() {
+    auto count = bucketCount_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < kMigrateBatch && migrated_ < count; ++i) {
+      initSentinelLocked(migrated_++);
+    }
+  }
+
+  // Adds sentinel arrays up to count buckets; see the class comment.
+  void growLocked(size_t count) {
+    auto current = bucketCount_.load(std::memory_order_relaxed);
+    auto limit = size_t(1) << (initialShift_ + kMaxGenerations - 1);
+    count = std::min(count, limit);
+    for (; current < count; current *= 2) {
+      auto g = findLastSet(current) - initialShift_;
+      generations_[g] = makeSentinels(current);
+      // Readers only look at the new generation once they see the count
+      bucketCount_.store(current * 2, std::memory_order_release);
+      maxLoad_ = size_t(current * 2 * loadFactor_);
+    }
+  }
+
+  std::mutex mutex_;
+  std::atomic<size_t> bucketCount_{0};
+  std::atomic<size_t> size_{0};
+  size_t maxLoad_;
+  float loadFactor_;
+  size_t initialShift_;
+  // Sentinels of buckets below this are linked in
+  size_t migrated_{1};
+  // Written before bucketCount_ is raised to cover them, never changed
+  Link* generations_[kMaxGenerations] = {};
+};
+
+} // namespace detail
+} // namespace folly
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/detail/DelimiterScan.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <folly/Bits.h>
+#include <folly/CpuId.h>
+#include <folly/Portability.h>
+
+#if FOLLY_X64 && (defined(__clang__) || __GNUC_PREREQ(4, 9))
+#define FOLLY_DELIMITER_SCAN_SIMD 1
+#include <immintrin.h>
+#else
+#define FOLLY_DELIMITER_SCAN_SIMD 0
+#endif
+
+namespace folly {
+namespace detail {
+
+namespace {
+
+// Offsets stay within uint32_t as long as a single call scans at most this.
+constexpr size_t kMaxScan = size_t(1) << 30;
+
+inline size_t emitOffsets(uint64_t mask,
+                          size_t base,
+                          uint32_t* offsets,
+                          size_t n) {
+  while (mask) {
+    offsets[n++] = uint32_t(base + findFirstSet(mask) - 1);
+    mask &= mask - 1;
+  }
+  return n;
+}
+
+inline const char* scanLimit(const char* begin, const char* end) {
+  return begin + std::min<size_t>(end - begin, kMaxScan);
+}
+
+// Scans the final partial block, if it fits in the remaining capacity.
+inline const char* scanTail(const char* begin,
+                            const char* p,
+                            const char* end,
+                            const DelimiterSet& set,
+                            uint32_t* offsets,
+                            size_t capacity,
+                            size_t* count) {
+  size_t n = *count;
+  if (size_t(end - p) < kDelimiterScanBlock &&
+      n + kDelimiterScanBlock <= capacity) {
+    for (; p != end; ++p) {
+      if (set.contains(*p)) {
+        offsets[n++] = uint32_t(p - begin);
+      }
+    }
+    *count = n;
+  }
+  return p;
+}
+
+}  // namespace
+
+size_t scanDelimitersScalar(const char* begin,
+                            const char* end,
+                            const DelimiterSet& set,
+                            uint32_t* offsets,
+                            size_t capacity,
+                            size_t* count) {
+  end = scanLimit(begin, end);
+  const char* p = begin;
+  size_t n = 0;
+  while (size_t(end - p) >= kDelimiterScanBlock &&
+         n + kDelimiterScanBlock <= capacity) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < kDelimiterScanBlock; ++i) {
+      mask |= uint64_t(set.contains(p[i])) << i;
+    }
+    n = emitOffsets(mask, p - begin, offsets, n);
+    p += kDelimiterScanBlock;
+  }
+  *count = n;
+  return scanTail(begin, p, end, set, offsets, capacity, count) - begin;
+}
+
+#if FOLLY_DELIMITER_SCAN_SIMD
+
+size_t scanDelimitersSse2(const char* begin,
+                          const char* end,
+                          const DelimiterSet& set,
+                          uint32_t* offsets,
+                          size_t capacity,
+                          size_t* count) {
+  end = scanLimit(begin, end);
+  __m128i needles[DelimiterSet::kMaxSize];
+  const size_t numNeedles = set.size();
+  for (size_t i = 0; i < numNeedles; ++i) {
+    needles[i] = _mm_set1_epi8(set.bytes()[i]);
+  }
+  auto match = [&](const char* q) -> uint64_t {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(q));
+    __m128i eq = _mm_cmpeq_epi8(v, needles[0]);
+    for (size_t i = 1; i < numNeedles; ++i) {
+      eq = _mm_or_si128(eq, _mm_cmpeq_epi8(v, needles[i]));
+    }
+    return uint32_t(_mm_movemask_epi8(eq));
+  };
+  const char* p = begin;
+  size_t n = 0;
+  while (size_t(end - p) >= kDelimiterScanBlock &&
+         n + kDelimiterScanBlock <= capacity) {
+    uint64_t mask = match(p) | match(p + 16) << 16 | match(p + 32) << 32 |
+        match(p + 48) << 48;
+    n = emitOffsets(mask, p - begin, offsets, n);
+    p += kDelimiterScanBlock;
+  }
+  *count = n;
+  return scanTail(begin, p, end, set, offsets, capacity, count) - begin;
+}
+
+FOLLY_TARGET_ATTRIBUTE("avx2")
+size_t scanDelimitersAvx2(const char* begin,
+                          const char* end,
+                          const DelimiterSet& set,
+                          uint32_t* offsets,
+                          size_t capacity,
+                          size_t* count) {
+  end = scanLimit(begin, end);
+  __m256i needles[DelimiterSet::kMaxSize];
+  const size_t numNeedles = set.size();
+  for (size_t i = 0; i < numNeedles; ++i) {
+    needles[i] = _mm256_set1_epi8(set.bytes()[i]);
+  }
+  const char* p = begin;
+  size_t n = 0;
+  while (size_t(end - p) >= kDelimiterScanBlock &&
+         n + kDelimiterScanBlock <= capacity) {
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+    __m256i eqLo = _mm256_cmpeq_epi8(lo, needles[0]);
+    __m256i eqHi = _mm256_cmpeq_epi8(hi, needles[0]);
+    for (size_t i = 1; i < numNeedles; ++i) {
+      eqLo = _mm256_or_si256(eqLo, _mm256_cmpeq_epi8(lo, needles[i]));
+      eqHi = _mm256_or_si256(eqHi, _mm256_cmpeq_epi8(hi, needles[i]));
+    }
+    uint64_t mask = uint32_t(_mm256_movemask_epi8(eqLo)) |
+        uint64_t(uint32_t(_mm256_movemask_epi8(eqHi))) << 32;
+    n = emitOffsets(mask, p - begin, offsets, n);
+    p += kDelimiterScanBlock;
+  }
+  *count = n;
+  return scanTail(begin, p, end, set, offsets, capacity, count) - begin;
+}
+
+bool scanDelimitersSse2Supported() {
+  return true;
+}
+
+bool scanDelimitersAvx2Supported() {
+  static bool supported = folly::CpuId().avx2();
+  return supported;
+}
+
+#else
+
+size_t scanDelimitersSse2(const char* begin,
+                          const char* end,
+                          const DelimiterSet& set,
+                          uint32_t* offsets,
+                          size_t capacity,
+                          size_t* count) {
+  throw std::runtime_error("scanDelimitersSse2 is not implemented on this "
+                           "platform");
+}
+
+size_t scanDelimitersAvx2(const char* begin,
+                          const char* end,
+                          const DelimiterSet& set,
+                          uint32_t* offsets,
+                          size_t capacity,
+                          size_t* count) {
+  throw std::runtime_error("scanDelimitersAvx2 is not implemented on this "
+                           "platform");
+}
+
+bool scanDelimitersSse2Supported() {
+  return false;
+}
+
+bool scanDelimitersAvx2Supported() {
+  return false;
+}
+
+#endif
+
+size_t scanDelimiters(const char* begin,
+                      const char* end,
+                      const DelimiterSet& set,
+                      uint32_t* offsets,
+                      size_t capacity,
+                      size_t* count) {
+  static auto const scan = scanDelimitersAvx2Supported()
+      ? scanDelimitersAvx2
+      : scanDelimitersSse2Supported() ? scanDelimitersSse2
+                                      : scanDelimitersScalar;
+  return scan(begin, end, set, offsets, capacity, count);
+}
+
+}  // namespace detail
+}  // namespace folly
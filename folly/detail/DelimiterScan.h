@@ -0,0 +1,116 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include <folly/Range.h>
+
+namespace folly {
+
+namespace detail {
+
+/**
+ * A small set of bytes to search for at once, such as the field and record
+ * delimiters and quote character of a CSV file.
+ */
+class DelimiterSet {
+ public:
+  static constexpr size_t kMaxSize = 8;
+
+  /**
+   * Throws std::invalid_argument if 'bytes' is empty or has more than
+   * kMaxSize bytes.
+   */
+  explicit DelimiterSet(StringPiece bytes) : size_(0) {
+    if (bytes.empty() || bytes.size() > kMaxSize) {
+      throw std::invalid_argument("DelimiterSet needs 1 to 8 bytes");
+    }
+    for (char c : bytes) {
+      if (!contains(c)) {
+        bytes_[size_++] = c;
+      }
+    }
+  }
+
+  size_t size() const { return size_; }
+  const char* bytes() const { return bytes_; }
+
+  bool contains(char c) const {
+    for (size_t i = 0; i < size_; ++i) {
+      if (bytes_[i] == c) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  size_t size_;
+  char bytes_[kMaxSize];
+};
+
+/**
+ * Minimum capacity of the offset buffer passed to scanDelimiters(); bytes are
+ * scanned in blocks of up to this many, and every byte of a block may match.
+ */
+constexpr size_t kDelimiterScanBlock = 64;
+
+/**
+ * Scans [begin, end) for bytes in 'set', storing the offsets (relative to
+ * 'begin') of the matches in 'offsets' and their number in '*count'.
+ * Whole blocks are scanned while at least kDelimiterScanBlock slots of
+ * 'capacity' remain, so the return value, the number of bytes scanned, may
+ * be less than end - begin; scan the rest with another call.
+ *
+ * Uses AVX2 or SSE2 when available, chosen at runtime through CpuId.
+ */
+size_t scanDelimiters(const char* begin,
+                      const char* end,
+                      const DelimiterSet& set,
+                      uint32_t* offsets,
+                      size_t capacity,
+                      size_t* count);
+
+// Implementations behind scanDelimiters(), exposed for testing. The SIMD
+// ones must only be called if the corresponding *Supported() is true.
+size_t scanDelimitersScalar(const char* begin,
+                            const char* end,
+                            const DelimiterSet& set,
+                            uint32_t* offsets,
+                            size_t capacity,
+                            size_t* count);
+size_t scanDelimitersSse2(const char* begin,
+                          const char* end,
+                          const DelimiterSet& set,
+                          uint32_t* offsets,
+                          size_t capacity,
+                          size_t* count);
+size_t scanDelimitersAvx2(const char* begin,
+                          const char* end,
+                          const DelimiterSet& set,
+                          uint32_t* offsets,
+                          size_t capacity,
+                          size_t* count);
+bool scanDelimitersSse2Supported();
+bool scanDelimitersAvx2Supported();
+
+}
+
+}
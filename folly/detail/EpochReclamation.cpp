@@ -0,0 +1,220 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/detail/EpochReclamation.h>
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#include <glog/logging.h>
+
+#include <folly/Indestructible.h>
+#include <folly/portability/Memory.h>
+
+namespace folly {
+namespace detail {
+
+constexpr size_t EpochDomain::kRetireBatch;
+constexpr size_t EpochDomain::kMaxDomains;
+
+std::atomic<size_t> EpochDomain::numDomains_{0};
+std::atomic<EpochDomain*> EpochDomain::domains_[kMaxDomains];
+FOLLY_TLS EpochRecord* EpochDomain::tlsRecords_[kMaxDomains];
+
+namespace {
+
+void appendList(EpochRetired*& to, EpochRetired* list) {
+  while (list) {
+    auto next = list->retiredNext_;
+    list->retiredNext_ = to;
+    to = list;
+    list = next;
+  }
+}
+
+} // namespace
+
+// Epoch 0 marks a quiescent record, so counting starts at 1.
+EpochDomain::EpochDomain()
+    : id_(numDomains_.fetch_add(1)),
+      epoch_(1),
+      records_(nullptr),
+      orphans_(nullptr),
+      numOrphans_(0),
+      hasOrphans_(false) {
+  CHECK_LT(id_, kMaxDomains) << "too many epoch domains";
+  domains_[id_].store(this, std::memory_order_release);
+}
+
+EpochDomain& EpochDomain::defaultDomain() {
+  // Used from thread exit hooks, so it must never be destroyed
+  static Indestructible<EpochDomain> domain;
+  return *domain;
+}
+
+struct EpochThreadExit {
+  EpochRecord* recs[EpochDomain::kMaxDomains] = {};
+
+  ~EpochThreadExit() {
+    for (size_t i = 0; i < EpochDomain::kMaxDomains; ++i) {
+      if (recs[i]) {
+        EpochDomain::domains_[i].load(std::memory_order_acquire)
+            ->releaseThread(recs[i]);
+      }
+    }
+  }
+};
+
+namespace {
+thread_local EpochThreadExit threadExit;
+} // namespace
+
+EpochRecord* EpochDomain::registerThread() {
+  EpochRecord* rec = records_.load(std::memory_order_acquire);
+  for (; rec; rec = rec->next) {
+    if (!rec->active.load(std::memory_order_relaxed) &&
+        !rec->active.exchange(true, std::memory_order_acquire)) {
+      break;
+    }
+  }
+  if (!rec) {
+    // Never freed; over-aligned, so plain operator new won't do before C++17
+    rec = new (aligned_malloc(sizeof(EpochRecord), alignof(EpochRecord)))
+        EpochRecord;
+    rec->active.store(true, std::memory_order_relaxed);
+    auto head = records_.load(std::memory_order_relaxed);
+    do {
+      rec->next = head;
+    } while (!records_.compare_exchange_weak(
+        head, rec, std::memory_order_release, std::memory_order_relaxed));
+  }
+  rec->nextCollect = kRetireBatch;
+  threadExit.recs[id_] = rec;
+  tlsRecords_[id_] = rec;
+  return rec;
+}
+
+void EpochDomain::releaseThread(EpochRecord* rec) {
+  if (rec->retired) {
+    std::lock_guard<std::mutex> g(orphanMutex_);
+    appendList(orphans_, rec->retired);
+    numOrphans_ += rec->numRetired;
+    hasOrphans_.store(true, std::memory_order_relaxed);
+  }
+  rec->retired = nullptr;
+  rec->numRetired = 0;
+  rec->depth = 0;
+  rec->epoch.store(0, std::memory_order_relaxed);
+  tlsRecords_[id_] = nullptr;
+  rec->active.store(false, std::memory_order_release);
+}
+
+void EpochDomain::scheduleCollect(EpochRecord* rec) {
+  // While a long-lived guard pins objects, each collect rescans everything
+  // still pending; waiting for the backlog to double keeps that linear.
+  rec->nextCollect =
+      rec->numRetired + std::max(rec->numRetired, kRetireBatch);
+}
+
+bool EpochDomain::tryAdvance(uint64_t epoch) {
+  if (epoch_.load(std::memory_order_acquire) != epoch) {
+    return true;
+  }
+  // Either a reader's epoch store is visible below, or its subsequent loads
+  // will observe every unlink that happened before this barrier.
+  asymmetricHeavyBarrier();
+  for (auto rec = records_.load(std::memory_order_acquire); rec;
+       rec = rec->next) {
+    auto e = rec->epoch.load(std::memory_order_acquire);
+    if (e != 0 && e != epoch) {
+      return false;
+    }
+  }
+  epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel);
+  return true;
+}
+
+void EpochDomain::reclaimList(
+    EpochRetired*& list,
+    size_t& count,
+    uint64_t epoch) {
+  // Detach first: reclaiming an object may retire others onto this list.
+  EpochRetired* pending = list;
+  list = nullptr;
+  count = 0;
+  EpochRetired* keep = nullptr;
+  size_t kept = 0;
+  EpochRetired* done = nullptr;
+  while (pending) {
+    auto next = pending->retiredNext_;
+    // An object unlinked during epoch E may still be seen by readers that
+    // entered during E, which are all gone once the epoch reaches E + 2.
+    if (pending->retiredEpoch_ + 2 <= epoch) {
+      pending->retiredNext_ = done;
+      done = pending;
+    } else {
+      pending->retiredNext_ = keep;
+      keep = pending;
+      ++kept;
+    }
+    pending = next;
+  }
+  appendList(list, keep);
+  count += kept;
+  while (done) {
+    auto next = done->retiredNext_;
+    done->reclaim_(done);
+    done = next;
+  }
+}
+
+void EpochDomain::collect(EpochRecord* rec) {
+  auto epoch = currentEpoch();
+  if (tryAdvance(epoch)) {
+    epoch = currentEpoch();
+  }
+  if (hasOrphans_.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> g(orphanMutex_);
+    appendList(rec->retired, orphans_);
+    rec->numRetired += numOrphans_;
+    orphans_ = nullptr;
+    numOrphans_ = 0;
+    hasOrphans_.store(false, std::memory_order_relaxed);
+  }
+  reclaimList(rec->retired, rec->numRetired, epoch);
+  scheduleCollect(rec);
+}
+
+void EpochDomain::synchronize() {
+  auto rec = threadRecord();
+  auto target = currentEpoch() + 2;
+  for (;;) {
+    auto epoch = currentEpoch();
+    if (epoch >= target) {
+      break;
+    }
+    if (!tryAdvance(epoch)) {
+      std::this_thread::yield();
+    }
+  }
+  reclaimList(rec->retired, rec->numRetired, currentEpoch());
+  scheduleCollect(rec);
+}
+
+} // namespace detail
+} // namespace folly
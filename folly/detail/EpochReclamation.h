@@ -0,0 +1,215 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+#include <folly/Portability.h>
+#include <folly/detail/CacheLocality.h>
+#include <folly/experimental/AsymmetricMemoryBarrier.h>
+
+namespace folly {
+namespace detail {
+
+/**
+ * Epoch-based deferred reclamation for data structures with lock-free
+ * readers.
+ *
+ * Readers hold an EpochGuard while they dereference shared pointers.
+ * Writers unlink an object and pass it to epochRetire(); it is reclaimed
+ * once every guard that could have observed it has been released, by a
+ * later EpochDomain::maybeCollect() on the retiring thread.
+ *
+ * Entering a guard costs a thread-local store and asymmetricLightBarrier()
+ * (a compiler barrier on Linux). The expensive half lives on the writer
+ * side: retired objects are batched per thread, and each batch pays one
+ * asymmetricHeavyBarrier() to advance the global epoch.
+ *
+ * Guards nest and must be released on the thread that acquired them. A
+ * guard held for a long time delays reclamation of everything retired in
+ * the meantime, and blocks synchronize(), but never blocks writers that
+ * only retire.
+ *
+ * Guards only hold back their own EpochDomain, so independent users should
+ * not share one: a long-lived ConcurrentHashMap iterator would otherwise
+ * stall every RCUSynchronize() in the process. Domains are meant to be
+ * static singletons; there can be at most kMaxDomains of them, and each
+ * must outlive every thread that uses it.
+ */
+
+/// Base class for objects handed to epochRetire().
+struct EpochRetired {
+  EpochRetired* retiredNext_{nullptr};
+  uint64_t retiredEpoch_{0};
+  void (*reclaim_)(EpochRetired*){nullptr};
+};
+
+/// Per-thread reader state. Records are never freed; a record released by
+/// an exiting thread is reused by the next thread that registers.
+struct FOLLY_ALIGN_TO_AVOID_FALSE_SHARING EpochRecord {
+  /// Epoch observed on entry to the outermost guard, 0 while quiescent.
+  std::atomic<uint64_t> epoch{0};
+  std::atomic<bool> active{false};
+  EpochRecord* next{nullptr};
+
+  // Owned by the thread currently bound to this record
+  size_t depth{0};
+  EpochRetired* retired{nullptr};
+  size_t numRetired{0};
+  size_t nextCollect{0};
+};
+
+class EpochDomain {
+ public:
+  /// Retired objects a thread accumulates before it tries to reclaim.
+  static constexpr size_t kRetireBatch = 1024;
+  /// Number of domains a process can create.
+  static constexpr size_t kMaxDomains = 8;
+
+  EpochDomain();
+
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+
+  /// The domain used by ConcurrentHashMap.
+  static EpochDomain& defaultDomain();
+
+  EpochRecord* threadRecord() {
+    auto rec = tlsRecords_[id_];
+    return LIKELY(rec != nullptr) ? rec : registerThread();
+  }
+
+  uint64_t currentEpoch() const {
+    return epoch_.load(std::memory_order_acquire);
+  }
+
+  /// Enters a reader section on the calling thread; sections nest. Returns
+  /// the record to pass to exit().
+  EpochRecord* enter() {
+    auto rec = threadRecord();
+    if (rec->depth++ == 0) {
+      rec->epoch.store(currentEpoch(), std::memory_order_relaxed);
+      asymmetricLightBarrier();
+    }
+    return rec;
+  }
+
+  static void exit(EpochRecord* rec) {
+    if (--rec->depth == 0) {
+      rec->epoch.store(0, std::memory_order_release);
+    }
+  }
+
+  /// Schedules obj for reclamation once every guard active now has been
+  /// released. Never reclaims anything itself, so it is safe to call with
+  /// locks held; follow up with maybeCollect() once they are released.
+  void retire(EpochRetired* obj, void (*reclaim)(EpochRetired*)) {
+    auto rec = threadRecord();
+    obj->reclaim_ = reclaim;
+    obj->retiredEpoch_ = currentEpoch();
+    obj->retiredNext_ = rec->retired;
+    rec->retired = obj;
+    ++rec->numRetired;
+  }
+
+  /// Reclaims what it can if this thread has retired a full batch.
+  void maybeCollect() {
+    auto rec = tlsRecords_[id_];
+    if (rec && rec->numRetired >= rec->nextCollect) {
+      collect(rec);
+    }
+  }
+
+  /// Waits until every guard of this domain active at the time of the call
+  /// has been released, then reclaims everything this thread has retired.
+  /// Must not be called while the calling thread holds such a guard.
+  void synchronize();
+
+ private:
+  EpochRecord* registerThread();
+  void releaseThread(EpochRecord* rec);
+  void collect(EpochRecord* rec);
+  void scheduleCollect(EpochRecord* rec);
+  bool tryAdvance(uint64_t epoch);
+  static void reclaimList(EpochRetired*& list, size_t& count, uint64_t epoch);
+
+  const size_t id_;
+  std::atomic<uint64_t> epoch_;
+  std::atomic<EpochRecord*> records_;
+
+  // Objects retired by threads that exited before they could be reclaimed.
+  // They are adopted by the next thread that collects.
+  std::mutex orphanMutex_;
+  EpochRetired* orphans_;
+  size_t numOrphans_;
+  std::atomic<bool> hasOrphans_;
+
+  static std::atomic<size_t> numDomains_;
+  static std::atomic<EpochDomain*> domains_[kMaxDomains];
+  static FOLLY_TLS EpochRecord* tlsRecords_[kMaxDomains];
+
+  friend struct EpochThreadExit;
+};
+
+/// RAII reader section. Movable, but bound to the acquiring thread.
+class EpochGuard {
+ public:
+  explicit EpochGuard(EpochDomain& domain = EpochDomain::defaultDomain())
+      : rec_(domain.enter()) {}
+
+  /// An empty guard that protects nothing.
+  explicit EpochGuard(std::nullptr_t) noexcept : rec_(nullptr) {}
+
+  EpochGuard(const EpochGuard& other) : rec_(other.rec_) {
+    if (rec_) {
+      ++rec_->depth;
+    }
+  }
+
+  EpochGuard(EpochGuard&& other) noexcept : rec_(other.rec_) {
+    other.rec_ = nullptr;
+  }
+
+  EpochGuard& operator=(EpochGuard other) noexcept {
+    std::swap(rec_, other.rec_);
+    return *this;
+  }
+
+  ~EpochGuard() {
+    if (rec_) {
+      EpochDomain::exit(rec_);
+    }
+  }
+
+ private:
+  EpochRecord* rec_;
+};
+
+template <class T>
+void epochRetire(
+    T* obj,
+    void (*reclaim)(EpochRetired*),
+    EpochDomain& domain = EpochDomain::defaultDomain()) {
+  domain.retire(obj, reclaim);
+}
+
+} // namespace detail
+} // namespace folly
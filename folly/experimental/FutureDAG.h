@@ -15,6 +15,9 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+
 #include <folly/futures/Future.h>
 #include <folly/futures/SharedPromise.h>
 
@@ -29,11 +32,59 @@ class FutureDAG : public std::enable_shared_from_this<FutureDAG> {
   typedef size_t Handle;
   typedef std::function<Future<Unit>()> FutureFunc;
 
-  Handle add(FutureFunc func, Executor* executor = nullptr) {
-    nodes.emplace_back(std::move(func), executor);
+  /**
+   * Add a node. cost is an estimate of how long func takes to run, in any
+   * unit as long as it is the same for every node of the DAG. go() uses it to
+   * give nodes on the critical path (the most expensive chain of dependents)
+   * a higher priority on executors that support Executor::addWithPriority.
+   */
+  Handle add(FutureFunc func, Executor* executor = nullptr, size_t cost = 1) {
+    nodes.emplace_back(std::move(func), executor, cost);
     return nodes.size() - 1;
   }
 
+  /**
+   * The priority a node is dispatched with, based on its estimated cost plus
+   * the most expensive chain of nodes depending on it. Valid after go().
+   */
+  int8_t priority(Handle a) const {
+    return nodes[a].priority;
+  }
+
+  /// How long a node's func took to complete in the last run of go().
+  std::chrono::nanoseconds latency(Handle a) const {
+    return nodes[a].finish - nodes[a].start;
+  }
+
+  /**
+   * The chain of nodes that determined how long the last run of go() took,
+   * from first to last: the node that finished last, preceded by whichever
+   * of its dependencies finished last, and so on.
+   */
+  std::vector<Handle> criticalPath() const {
+    std::vector<Handle> path;
+    if (nodes.empty()) {
+      return path;
+    }
+    auto finishedLast = [this](Handle a, Handle b) {
+      return nodes[a].finish < nodes[b].finish;
+    };
+    std::vector<Handle> handles(nodes.size());
+    for (Handle handle = 0; handle < nodes.size(); handle++) {
+      handles[handle] = handle;
+    }
+    auto handle =
+        *std::max_element(handles.begin(), handles.end(), finishedLast);
+    path.push_back(handle);
+    while (!nodes[handle].dependencies.empty()) {
+      auto& deps = nodes[handle].dependencies;
+      handle = *std::max_element(deps.begin(), deps.end(), finishedLast);
+      path.push_back(handle);
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+  }
+
   void remove(Handle a) {
     if (a >= nodes.size()) {
       return;
@@ -110,11 +161,15 @@ class FutureDAG : public std::enable_shared_from_this<FutureDAG> {
       dependency(handle, sinkHandle);
     }
 
-    auto sourceHandle = add(nullptr);
+    nodes[sinkHandle].cost = 0;
+
+    auto sourceHandle = add(nullptr, nullptr, 0);
     for (auto handle : rootNodes) {
       dependency(sourceHandle, handle);
     }
 
+    computePriorities();
+
     for (Handle handle = 0; handle < nodes.size() - 1; handle++) {
       std::vector<Future<Unit>> dependencies;
       for (auto depHandle : nodes[handle].dependencies) {
@@ -122,9 +177,11 @@ class FutureDAG : public std::enable_shared_from_this<FutureDAG> {
       }
 
       collect(dependencies)
-          .via(nodes[handle].executor)
+          .via(nodes[handle].executor, nodes[handle].priority)
           .then([this, handle] {
+            nodes[handle].start = std::chrono::steady_clock::now();
             nodes[handle].func().then([this, handle](Try<Unit>&& t) {
+              nodes[handle].finish = std::chrono::steady_clock::now();
               nodes[handle].promise.setTry(std::move(t));
             });
           })
@@ -186,12 +243,72 @@ class FutureDAG : public std::enable_shared_from_this<FutureDAG> {
     return false;
   }
 
+  // Assumes there are no cycles.
+  void computePriorities() {
+    // Walk the DAG from the leaves up, so that every node's dependents have
+    // been costed before the node itself.
+    std::vector<std::vector<Handle>> dependents(nodes.size());
+    for (Handle handle = 0; handle < nodes.size(); handle++) {
+      for (auto depHandle : nodes[handle].dependencies) {
+        dependents[depHandle].push_back(handle);
+      }
+    }
+
+    std::vector<size_t> remaining(nodes.size());
+    std::vector<Handle> handles;
+    for (Handle handle = 0; handle < nodes.size(); handle++) {
+      remaining[handle] = dependents[handle].size();
+      if (remaining[handle] == 0) {
+        handles.push_back(handle);
+      }
+    }
+
+    size_t maxPathCost = 0;
+    while (!handles.empty()) {
+      auto handle = handles.back();
+      handles.pop_back();
+      size_t dependentsCost = 0;
+      for (auto dependent : dependents[handle]) {
+        dependentsCost = std::max(dependentsCost, nodes[dependent].pathCost);
+      }
+      nodes[handle].pathCost = nodes[handle].cost + dependentsCost;
+      maxPathCost = std::max(maxPathCost, nodes[handle].pathCost);
+      for (auto depHandle : nodes[handle].dependencies) {
+        if (--remaining[depHandle] == 0) {
+          handles.push_back(depHandle);
+        }
+      }
+    }
+
+    // Spread path costs linearly over the executor's priority range, which
+    // is centred on MID_PRI.
+    for (auto& node : nodes) {
+      node.priority = Executor::MID_PRI;
+      if (!node.executor || maxPathCost == 0) {
+        continue;
+      }
+      int numPriorities = node.executor->getNumPriorities();
+      if (numPriorities <= 1) {
+        continue;
+      }
+      int level = static_cast<int>(
+          node.pathCost * (numPriorities - 1) / maxPathCost);
+      node.priority = static_cast<int8_t>(level - numPriorities / 2);
+    }
+  }
+
   struct Node {
-    Node(FutureFunc&& funcArg, Executor* executorArg)
-        : func(std::move(funcArg)), executor(executorArg) {}
+    Node(FutureFunc&& funcArg, Executor* executorArg, size_t costArg)
+        : func(std::move(funcArg)), executor(executorArg), cost(costArg) {}
 
     FutureFunc func{nullptr};
     Executor* executor{nullptr};
+    size_t cost{1};
+    // cost plus that of the most expensive chain of dependents
+    size_t pathCost{0};
+    int8_t priority{Executor::MID_PRI};
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point finish;
     SharedPromise<Unit> promise;
     std::vector<Handle> dependencies;
     bool hasDependents{false};
@@ -0,0 +1,228 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/LoadSheddingExecutor.h>
+
+#include <cmath>
+#include <limits>
+
+namespace folly {
+
+namespace {
+
+using Clock = LoadSheddingExecutor::Clock;
+
+const Clock::rep kBusy = std::numeric_limits<Clock::rep>::max();
+
+std::chrono::seconds toSeconds(Clock::time_point t) {
+  return std::chrono::duration_cast<std::chrono::seconds>(t.time_since_epoch());
+}
+
+Clock::rep toTicks(Clock::time_point t) {
+  return t.time_since_epoch().count();
+}
+
+} // namespace
+
+constexpr size_t LoadSheddingExecutor::kNumSojournStripes;
+
+LoadSheddingExecutor::LoadSheddingExecutor(Executor* executor, Options options)
+    : executor_(executor),
+      options_(options),
+      sojournTimes_(
+          options.histogramBucketSize,
+          options.histogramMin,
+          options.histogramMax,
+          MultiLevelTimeSeries<int64_t>(
+              60,
+              {std::chrono::seconds(60),
+               std::chrono::seconds(600),
+               std::chrono::seconds(3600),
+               std::chrono::seconds(0)})) {
+  for (size_t i = 0; i < kNumSojournStripes; ++i) {
+    sojournStripes_.emplace_back(new SojournStripe(options_));
+  }
+}
+
+void LoadSheddingExecutor::add(Func func) {
+  addWithPriority(std::move(func), Executor::MID_PRI);
+}
+
+void LoadSheddingExecutor::addWithPriority(Func func, int8_t priority) {
+  enqueue(
+      Task{std::move(func),
+           nullptr,
+           Clock::now(),
+           Clock::time_point::max(),
+           false},
+      priority);
+}
+
+void LoadSheddingExecutor::addWithDeadline(
+    Func func,
+    Clock::time_point deadline,
+    Func onShed,
+    int8_t priority) {
+  enqueue(
+      Task{std::move(func), std::move(onShed), Clock::now(), deadline, true},
+      priority);
+}
+
+uint64_t LoadSheddingExecutor::getNumShed() const {
+  return numShed_.load(std::memory_order_relaxed);
+}
+
+TimeseriesHistogram<int64_t> LoadSheddingExecutor::getSojournTimes() const {
+  auto sojournTimes = [&] {
+    std::lock_guard<std::mutex> g(mutex_);
+    return sojournTimes_;
+  }();
+  for (auto& stripe : sojournStripes_) {
+    std::lock_guard<std::mutex> g(stripe->mutex);
+    if (stripe->numPending > 0) {
+      sojournTimes.addValues(stripe->second, stripe->pending);
+    }
+  }
+  sojournTimes.update(toSeconds(Clock::now()));
+  return sojournTimes;
+}
+
+void LoadSheddingExecutor::enqueue(Task task, int8_t priority) {
+  auto func = [ this, task = std::move(task) ]() mutable {
+    run(task);
+  };
+  if (executor_->getNumPriorities() == 1) {
+    executor_->add(std::move(func));
+  } else {
+    executor_->addWithPriority(std::move(func), priority);
+  }
+}
+
+void LoadSheddingExecutor::run(Task& task) {
+  auto now = Clock::now();
+  recordSojourn(
+      now,
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          now - task.enqueued));
+  bool shed = shouldShed(task, now);
+  if (shed) {
+    numShed_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if (!shed) {
+    task.func();
+  } else if (task.onShed) {
+    task.onShed();
+  }
+}
+
+void LoadSheddingExecutor::recordSojourn(
+    Clock::time_point now,
+    std::chrono::microseconds sojourn) {
+  auto& stripe = *sojournStripes_[detail::AccessSpreader<>::current(
+      kNumSojournStripes)];
+  std::lock_guard<std::mutex> g(stripe.mutex);
+  auto second = toSeconds(now);
+  if (second != stripe.second) {
+    flushLocked(stripe);
+    stripe.second = second;
+  }
+  stripe.pending.addValue(sojourn.count());
+  ++stripe.numPending;
+}
+
+void LoadSheddingExecutor::flushLocked(SojournStripe& stripe) {
+  if (stripe.numPending == 0) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> g(mutex_);
+    sojournTimes_.addValues(stripe.second, stripe.pending);
+  }
+  stripe.pending.clear();
+  stripe.numPending = 0;
+}
+
+bool LoadSheddingExecutor::shouldShed(const Task& task, Clock::time_point now) {
+  if (task.sheddable && now > task.deadline) {
+    return true;
+  }
+
+  if (now - task.enqueued < options_.targetDelay) {
+    // Only write when leaving the dropping state, so that the common case
+    // doesn't bounce the cache line between threads.
+    if (firstAboveTime_.load(std::memory_order_relaxed) != 0) {
+      firstAboveTime_.store(0, std::memory_order_relaxed);
+    }
+    // Leave dropNext_ to a thread that is shedding; the next task to get
+    // through in time will reset it instead.
+    auto dropNext = dropNext_.load(std::memory_order_relaxed);
+    if (dropNext != 0 && dropNext != kBusy) {
+      dropNext_.compare_exchange_strong(
+          dropNext, 0, std::memory_order_relaxed);
+    }
+    return false;
+  }
+
+  bool okToDrop = false;
+  auto firstAbove = firstAboveTime_.load(std::memory_order_relaxed);
+  if (firstAbove == 0) {
+    firstAboveTime_.compare_exchange_strong(
+        firstAbove,
+        toTicks(now + options_.interval),
+        std::memory_order_relaxed);
+  } else if (toTicks(now) >= firstAbove) {
+    okToDrop = true;
+  }
+
+  if (!task.sheddable) {
+    return false;
+  }
+
+  // Of the threads that find it's time to shed, only the one that moves
+  // dropNext_ to kBusy does; it then owns dropCount_ until it stores the
+  // next drop time.
+  auto dropNext = dropNext_.load(std::memory_order_relaxed);
+  uint64_t dropCount;
+  if (dropNext != 0) {
+    if (toTicks(now) < dropNext ||
+        !dropNext_.compare_exchange_strong(
+            dropNext, kBusy, std::memory_order_acquire)) {
+      return false;
+    }
+    dropCount = dropCount_.load(std::memory_order_relaxed) + 1;
+  } else if (okToDrop) {
+    if (!dropNext_.compare_exchange_strong(
+            dropNext, kBusy, std::memory_order_acquire)) {
+      return false;
+    }
+    dropCount = 1;
+  } else {
+    return false;
+  }
+  dropCount_.store(dropCount, std::memory_order_relaxed);
+
+  // Shed more often the longer we stay behind.
+  dropNext_.store(
+      toTicks(
+          now +
+          std::chrono::duration_cast<Clock::duration>(
+              options_.interval / std::sqrt(double(dropCount)))),
+      std::memory_order_release);
+  return true;
+}
+
+} // folly
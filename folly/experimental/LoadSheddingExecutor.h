@@ -0,0 +1,160 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <folly/Executor.h>
+#include <folly/detail/CacheLocality.h>
+#include <folly/stats/Histogram.h>
+#include <folly/stats/TimeseriesHistogram.h>
+
+namespace folly {
+
+/**
+ * An Executor that wraps another one and sheds work that has been queued for
+ * too long, so that an overloaded pool stops running tasks whose clients
+ * have already given up.
+ *
+ * Every task is timestamped when it is added and its queueing delay
+ * ("sojourn time") is measured when the underlying executor gets round to
+ * it. Sojourn times are recorded in a TimeseriesHistogram, and drive a
+ * CoDel-style policy: if sojourn times stay above targetDelay for a whole
+ * interval the executor starts shedding, first one task per interval and then
+ * more often (interval / sqrt(n) after the nth), until a task makes it
+ * through in less than targetDelay.
+ *
+ *   LoadSheddingExecutor executor(&threadPool);
+ *   executor.addWithDeadline(
+ *       [=] { handle(request); },
+ *       request.deadline(),
+ *       [=] { request.fail("overloaded"); });
+ *
+ * Only tasks added with addWithDeadline() can be shed, because they come with
+ * a function to run instead. Tasks added with add() (e.g. Future callbacks)
+ * are always run, but they are still measured and count towards the policy.
+ *
+ * Works over any Executor, including FiberManager and EventBase. Running a
+ * task takes no lock shared by the whole pool: the policy state is kept in
+ * atomics, and sojourn times go to per-CPU stripes, each with a mutex of its
+ * own, that are folded into the histogram about once a second, or when it
+ * is read.
+ */
+class LoadSheddingExecutor : public Executor {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    Options() {}
+
+    /// Sojourn time above which the executor is considered to be falling
+    /// behind.
+    std::chrono::microseconds targetDelay{std::chrono::milliseconds(5)};
+    /// How long sojourn times have to stay above targetDelay before tasks
+    /// are shed.
+    std::chrono::microseconds interval{std::chrono::milliseconds(100)};
+    /// Bucketing of the sojourn time histogram, in microseconds.
+    int64_t histogramBucketSize{1000};
+    int64_t histogramMin{0};
+    int64_t histogramMax{1000000};
+  };
+
+  explicit LoadSheddingExecutor(
+      Executor* executor,
+      Options options = Options());
+
+  void add(Func func) override;
+
+  void addWithPriority(Func func, int8_t priority) override;
+
+  uint8_t getNumPriorities() const override {
+    return executor_->getNumPriorities();
+  }
+
+  /**
+   * Run func, unless its deadline passes before it gets to run or the
+   * executor decides to shed it, in which case onShed (if any) is run
+   * instead.
+   */
+  void addWithDeadline(
+      Func func,
+      Clock::time_point deadline,
+      Func onShed,
+      int8_t priority = Executor::MID_PRI);
+
+  /// Number of tasks shed so far, because of their deadline or the policy.
+  uint64_t getNumShed() const;
+
+  /// Snapshot of the sojourn times, in microseconds, over the last minute,
+  /// ten minutes, hour and all time (levels 0 to 3).
+  TimeseriesHistogram<int64_t> getSojournTimes() const;
+
+ private:
+  struct Task {
+    Func func;
+    Func onShed;
+    Clock::time_point enqueued;
+    Clock::time_point deadline;
+    bool sheddable;
+  };
+
+  // Sojourn times recorded since the stripe was last flushed, all within
+  // the same second.
+  struct SojournStripe {
+    explicit SojournStripe(const Options& options)
+        : pending(
+              options.histogramBucketSize,
+              options.histogramMin,
+              options.histogramMax) {}
+
+    std::mutex mutex;
+    Histogram<int64_t> pending;
+    uint64_t numPending{0};
+    std::chrono::seconds second{0};
+    char padding[detail::CacheLocality::kFalseSharingRange];
+  };
+
+  static constexpr size_t kNumSojournStripes = 8;
+
+  void enqueue(Task task, int8_t priority);
+  void run(Task& task);
+  void recordSojourn(Clock::time_point now, std::chrono::microseconds sojourn);
+  // Caller must hold stripe.mutex.
+  void flushLocked(SojournStripe& stripe);
+  // Returns true if the task should be shed.
+  bool shouldShed(const Task& task, Clock::time_point now);
+
+  Executor* const executor_;
+  const Options options_;
+
+  std::vector<std::unique_ptr<SojournStripe>> sojournStripes_;
+  // Taken after a stripe's mutex, never before
+  mutable std::mutex mutex_;
+  TimeseriesHistogram<int64_t> sojournTimes_;
+  std::atomic<uint64_t> numShed_{0};
+  // CoDel state, in Clock ticks. 0 means unset, and dropNext_ is kBusy
+  // while the thread that won the right to shed updates it.
+  std::atomic<Clock::rep> firstAboveTime_{0};
+  std::atomic<Clock::rep> dropNext_{0};
+  std::atomic<uint64_t> dropCount_{0};
+};
+
+} // folly
@@ -0,0 +1,349 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/MembershipFilters.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <folly/CpuId.h>
+#include <folly/Portability.h>
+
+#if FOLLY_X64 && (defined(__clang__) || __GNUC_PREREQ(4, 9))
+#define FOLLY_MEMBERSHIP_FILTERS_AVX2 1
+#include <immintrin.h>
+#else
+#define FOLLY_MEMBERSHIP_FILTERS_AVX2 0
+#endif
+
+namespace folly {
+
+namespace detail {
+
+namespace {
+
+constexpr uint32_t kFormatVersion = 1;
+
+template <class T>
+MembershipFilterTable<T> copyTable(ByteRange table) {
+  MembershipFilterTable<T> copy(table.size() / sizeof(T));
+  memcpy(copy.mutableData(), table.data(), table.size());
+  return copy;
+}
+
+template <class T>
+MembershipFilterTable<T> viewTable(ByteRange table) {
+  if (reinterpret_cast<uintptr_t>(table.data()) % alignof(T) != 0) {
+    throw std::invalid_argument("misaligned membership filter");
+  }
+  return MembershipFilterTable<T>::view(
+      reinterpret_cast<const T*>(table.data()), table.size() / sizeof(T));
+}
+
+} // namespace
+
+std::unique_ptr<IOBuf> serializeMembershipFilter(
+    const MembershipFilterHeader& header, const void* table, size_t bytes) {
+  auto buf = IOBuf::create(sizeof(header) + bytes);
+  memcpy(buf->writableTail(), &header, sizeof(header));
+  memcpy(buf->writableTail() + sizeof(header), table, bytes);
+  buf->append(sizeof(header) + bytes);
+  return buf;
+}
+
+ByteRange parseMembershipFilter(
+    ByteRange data,
+    uint32_t magic,
+    size_t entrySize,
+    MembershipFilterHeader& header) {
+  if (data.size() < sizeof(header)) {
+    throw std::invalid_argument("membership filter too short");
+  }
+  memcpy(&header, data.data(), sizeof(header));
+  if (header.magic != magic) {
+    throw std::invalid_argument("not a membership filter of this type");
+  }
+  if (header.version != kFormatVersion) {
+    throw std::invalid_argument("unsupported membership filter version");
+  }
+  data.advance(sizeof(header));
+  if (header.tableSize == 0 || data.size() / entrySize != header.tableSize ||
+      data.size() % entrySize != 0) {
+    throw std::invalid_argument("membership filter size mismatch");
+  }
+  return data;
+}
+
+// Odd multipliers that spread the hash over the 8 words
+const uint32_t kBloomSalt[kBloomBlockWords] = {
+    0x47b6137b,
+    0x44974d91,
+    0x8824ad5b,
+    0xa2b7289d,
+    0x705495c7,
+    0x2df1424b,
+    0x9efc4947,
+    0x5c6bfb31,
+};
+
+void bloomAddScalar(uint32_t* block, uint32_t hash) {
+  uint32_t mask[kBloomBlockWords];
+  bloomMask(hash, mask);
+  for (size_t i = 0; i < kBloomBlockWords; ++i) {
+    block[i] |= mask[i];
+  }
+}
+
+bool bloomMayContainScalar(const uint32_t* block, uint32_t hash) {
+  uint32_t mask[kBloomBlockWords];
+  bloomMask(hash, mask);
+  uint32_t missing = 0;
+  for (size_t i = 0; i < kBloomBlockWords; ++i) {
+    missing |= mask[i] & ~block[i];
+  }
+  return missing == 0;
+}
+
+#if FOLLY_MEMBERSHIP_FILTERS_AVX2
+
+namespace {
+
+// bloomMask() for all 8 words at once
+FOLLY_TARGET_ATTRIBUTE("avx2")
+inline __m256i bloomMaskAvx2(uint32_t hash) {
+  const __m256i salt =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kBloomSalt));
+  auto shifts = _mm256_srli_epi32(
+      _mm256_mullo_epi32(_mm256_set1_epi32(hash), salt), 27);
+  return _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+}
+
+} // namespace
+
+FOLLY_TARGET_ATTRIBUTE("avx2")
+void bloomAddAvx2(uint32_t* block, uint32_t hash) {
+  auto p = reinterpret_cast<__m256i*>(block);
+  _mm256_storeu_si256(
+      p, _mm256_or_si256(_mm256_loadu_si256(p), bloomMaskAvx2(hash)));
+}
+
+FOLLY_TARGET_ATTRIBUTE("avx2")
+bool bloomMayContainAvx2(const uint32_t* block, uint32_t hash) {
+  auto bits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+  // Whether (~bits & mask) == 0, i.e. all bits of mask are set
+  return _mm256_testc_si256(bits, bloomMaskAvx2(hash));
+}
+
+bool bloomAvx2Supported() {
+  static bool supported = folly::CpuId().avx2();
+  return supported;
+}
+
+#else
+
+void bloomAddAvx2(uint32_t*, uint32_t) {
+  throw std::runtime_error("bloomAddAvx2 is not implemented on this platform");
+}
+
+bool bloomMayContainAvx2(const uint32_t*, uint32_t) {
+  throw std::runtime_error(
+      "bloomMayContainAvx2 is not implemented on this platform");
+}
+
+bool bloomAvx2Supported() {
+  return false;
+}
+
+#endif
+
+void bloomAdd(uint32_t* block, uint32_t hash) {
+  static auto const add =
+      bloomAvx2Supported() ? bloomAddAvx2 : bloomAddScalar;
+  add(block, hash);
+}
+
+bool bloomMayContain(const uint32_t* block, uint32_t hash) {
+  static auto const mayContain =
+      bloomAvx2Supported() ? bloomMayContainAvx2 : bloomMayContainScalar;
+  return mayContain(block, hash);
+}
+
+} // namespace detail
+
+BlockedBloomFilter::BlockedBloomFilter(size_t expectedKeys, double bitsPerKey)
+    : table_(kWords * std::max<size_t>(
+                          1,
+                          std::ceil(expectedKeys * bitsPerKey /
+                                    (kWords * 32)))) {}
+
+std::unique_ptr<IOBuf> BlockedBloomFilter::serialize() const {
+  detail::MembershipFilterHeader header{
+      kMagic, detail::kFormatVersion, numBlocks(), 0, 0};
+  return detail::serializeMembershipFilter(
+      header, table_.data(), sizeInBytes());
+}
+
+BlockedBloomFilter BlockedBloomFilter::deserialize(ByteRange data) {
+  detail::MembershipFilterHeader header;
+  auto table = detail::parseMembershipFilter(
+      data, kMagic, kWords * sizeof(uint32_t), header);
+  return BlockedBloomFilter(detail::copyTable<uint32_t>(table));
+}
+
+BlockedBloomFilter BlockedBloomFilter::view(ByteRange data) {
+  detail::MembershipFilterHeader header;
+  auto table = detail::parseMembershipFilter(
+      data, kMagic, kWords * sizeof(uint32_t), header);
+  return BlockedBloomFilter(detail::viewTable<uint32_t>(table));
+}
+
+CuckooFilter::CuckooFilter(size_t capacity)
+    : table_(nextPowTwo(std::max<size_t>(
+          1, std::ceil(capacity / (kSlotsPerBucket * 0.95))))),
+      size_(0),
+      victimFp_(0),
+      victimIndex_(0),
+      rng_(0x9e3779b97f4a7c15ULL) {}
+
+CuckooFilter::CuckooFilter(
+    detail::MembershipFilterTable<uint64_t> table,
+    const detail::MembershipFilterHeader& header)
+    : table_(std::move(table)),
+      size_(header.count),
+      victimFp_(uint16_t(header.extra)),
+      victimIndex_(header.extra >> 16),
+      rng_(0x9e3779b97f4a7c15ULL) {
+  if ((numBuckets() & (numBuckets() - 1)) != 0 ||
+      victimIndex_ >= numBuckets()) {
+    throw std::invalid_argument("corrupt cuckoo filter");
+  }
+}
+
+bool CuckooFilter::insertIntoBucket(size_t i, uint16_t fp) {
+  uint64_t& bucket = table_.mutableData()[i];
+  for (size_t slot = 0; slot < kSlotsPerBucket; ++slot) {
+    if (getSlot(bucket, slot) == 0) {
+      setSlot(bucket, slot, fp);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool CuckooFilter::removeFromBucket(size_t i, uint16_t fp) {
+  uint64_t& bucket = table_.mutableData()[i];
+  for (size_t slot = 0; slot < kSlotsPerBucket; ++slot) {
+    if (getSlot(bucket, slot) == fp) {
+      setSlot(bucket, slot, 0);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool CuckooFilter::addHash(uint64_t hash) {
+  // Even if the filter is full
+  table_.requireOwned();
+  if (victimFp_ != 0) {
+    return false;
+  }
+  auto fp = fingerprint(hash);
+  auto i = index(hash);
+  if (insertIntoBucket(i, fp) || insertIntoBucket(altIndex(i, fp), fp)) {
+    ++size_;
+    return true;
+  }
+
+  // Both buckets are full: evict a random fingerprint from one of them
+  // into its other bucket, and so on, until one finds a free slot.
+  auto nextRandom = [this] {
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 7;
+    rng_ ^= rng_ << 17;
+    return rng_;
+  };
+  if (nextRandom() & 1) {
+    i = altIndex(i, fp);
+  }
+  for (size_t kick = 0; kick < kMaxKicks; ++kick) {
+    uint64_t& bucket = table_.mutableData()[i];
+    auto slot = nextRandom() % kSlotsPerBucket;
+    auto evicted = getSlot(bucket, slot);
+    setSlot(bucket, slot, fp);
+    fp = evicted;
+    i = altIndex(i, fp);
+    if (insertIntoBucket(i, fp)) {
+      ++size_;
+      return true;
+    }
+  }
+
+  // Keep the last evicted fingerprint aside, so that no key is lost; the
+  // filter now counts as full.
+  victimFp_ = fp;
+  victimIndex_ = i;
+  ++size_;
+  return true;
+}
+
+bool CuckooFilter::removeHash(uint64_t hash) {
+  auto fp = fingerprint(hash);
+  auto i1 = index(hash);
+  auto i2 = altIndex(i1, fp);
+  if (removeFromBucket(i1, fp) || removeFromBucket(i2, fp)) {
+    --size_;
+    // There is room for the victim now, if it belongs here
+    if (victimFp_ != 0 &&
+        (insertIntoBucket(victimIndex_, victimFp_) ||
+         insertIntoBucket(altIndex(victimIndex_, victimFp_), victimFp_))) {
+      victimFp_ = 0;
+    }
+    return true;
+  }
+  if (victimFp_ == fp && (victimIndex_ == i1 || victimIndex_ == i2)) {
+    victimFp_ = 0;
+    --size_;
+    return true;
+  }
+  return false;
+}
+
+std::unique_ptr<IOBuf> CuckooFilter::serialize() const {
+  detail::MembershipFilterHeader header{
+      kMagic,
+      detail::kFormatVersion,
+      numBuckets(),
+      size_,
+      victimFp_ | (uint64_t(victimIndex_) << 16)};
+  return detail::serializeMembershipFilter(
+      header, table_.data(), sizeInBytes());
+}
+
+CuckooFilter CuckooFilter::deserialize(ByteRange data) {
+  detail::MembershipFilterHeader header;
+  auto table =
+      detail::parseMembershipFilter(data, kMagic, sizeof(uint64_t), header);
+  return CuckooFilter(detail::copyTable<uint64_t>(table), header);
+}
+
+CuckooFilter CuckooFilter::view(ByteRange data) {
+  detail::MembershipFilterHeader header;
+  auto table =
+      detail::parseMembershipFilter(data, kMagic, sizeof(uint64_t), header);
+  return CuckooFilter(detail::viewTable<uint64_t>(table), header);
+}
+
+} // namespace folly
@@ -0,0 +1,383 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Approximate membership filters, for guarding expensive lookups: a key
+ * that was added is always reported as present, a key that was not is
+ * reported as present only with a small false positive probability.
+ *
+ *   BlockedBloomFilter  Each key sets 8 bits in a single 32-byte block,
+ *                       one in each 32-bit word, so a lookup reads one
+ *                       cache line and, on CPUs with AVX2 (detected at
+ *                       runtime), tests all 8 bits with one
+ *                       instruction. Keys can be added from many
+ *                       threads at once with addConcurrent(), and
+ *                       looked up meanwhile with mayContainConcurrent().
+ *                       About 1.2% false positives at 10 bits per key.
+ *
+ *   CuckooFilter        Stores a 16-bit fingerprint per key in one of
+ *                       two buckets of four; supports remove(). About
+ *                       0.01% false positives, at 16.8 bits per key
+ *                       when 95% full.
+ *
+ * Keys are strings (anything convertible to StringPiece) or integers,
+ * hashed with SpookyHashV2 and twang_mix64 respectively; add*Hash() and
+ * mayContain*Hash() take a precomputed 64-bit hash instead.
+ *
+ * Both filters can be serialized into an IOBuf and loaded back, either
+ * by copying (deserialize()) or, e.g. for a memory-mapped file, by using
+ * the serialized bytes in place (view()); modifying a view throws
+ * std::logic_error.
+ * The format is the in-memory layout, so it is only portable between
+ * machines of the same endianness.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+#include <folly/Bits.h>
+#include <folly/Hash.h>
+#include <folly/Range.h>
+#include <folly/io/IOBuf.h>
+#include <folly/portability/Memory.h>
+
+namespace folly {
+
+namespace detail {
+
+inline uint64_t membershipHash(StringPiece key) {
+  return hash::SpookyHashV2::Hash64(key.data(), key.size(), 0);
+}
+
+template <class Key>
+typename std::enable_if<std::is_integral<Key>::value, uint64_t>::type
+membershipHash(Key key) {
+  return hash::twang_mix64(uint64_t(key));
+}
+
+// Serialized filters are this header followed by the filter's table.
+// 32 bytes, so that the table stays aligned in a page-aligned mapping.
+struct MembershipFilterHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t tableSize; // blocks or buckets
+  uint64_t count;
+  uint64_t extra;
+};
+
+static_assert(sizeof(MembershipFilterHeader) == 32, "unexpected padding");
+
+struct AlignedFree {
+  void operator()(void* p) const {
+    aligned_free(p);
+  }
+};
+
+// Storage of a filter's table: either owned, or a read-only view of
+// memory owned by someone else.
+template <class T>
+class MembershipFilterTable {
+ public:
+  MembershipFilterTable() : data_(nullptr), size_(0) {}
+
+  explicit MembershipFilterTable(size_t size)
+      : owned_(static_cast<T*>(aligned_malloc(size * sizeof(T), 64))),
+        data_(owned_.get()),
+        size_(size) {
+    if (!owned_) {
+      throw std::bad_alloc();
+    }
+    memset(owned_.get(), 0, size * sizeof(T));
+  }
+
+  static MembershipFilterTable view(const T* data, size_t size) {
+    MembershipFilterTable table;
+    table.data_ = data;
+    table.size_ = size;
+    return table;
+  }
+
+  const T* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  T* mutableData() {
+    requireOwned();
+    return owned_.get();
+  }
+
+  void requireOwned() const {
+    if (!owned_) {
+      throw std::logic_error("filter views are read-only");
+    }
+  }
+
+ private:
+  std::unique_ptr<T, AlignedFree> owned_;
+  const T* data_;
+  size_t size_;
+};
+
+std::unique_ptr<IOBuf> serializeMembershipFilter(
+    const MembershipFilterHeader& header, const void* table, size_t bytes);
+
+// Validates the header, and returns the table that follows it
+ByteRange parseMembershipFilter(
+    ByteRange data,
+    uint32_t magic,
+    size_t entrySize,
+    MembershipFilterHeader& header);
+
+// Block operations behind BlockedBloomFilter. A block is 8 words, and a
+// key sets one bit in each, picked by multiplying the low half of its hash
+// with a per-word salt. bloomAdd() and bloomMayContain() use AVX2 when
+// CpuId reports it; the implementations are exposed for testing, and the
+// AVX2 ones must only be called if bloomAvx2Supported() is true.
+constexpr size_t kBloomBlockWords = 8;
+extern const uint32_t kBloomSalt[kBloomBlockWords];
+
+inline void bloomMask(uint32_t hash, uint32_t* mask) {
+  for (size_t i = 0; i < kBloomBlockWords; ++i) {
+    mask[i] = uint32_t(1) << ((hash * kBloomSalt[i]) >> 27);
+  }
+}
+
+void bloomAdd(uint32_t* block, uint32_t hash);
+bool bloomMayContain(const uint32_t* block, uint32_t hash);
+void bloomAddScalar(uint32_t* block, uint32_t hash);
+bool bloomMayContainScalar(const uint32_t* block, uint32_t hash);
+void bloomAddAvx2(uint32_t* block, uint32_t hash);
+bool bloomMayContainAvx2(const uint32_t* block, uint32_t hash);
+bool bloomAvx2Supported();
+
+} // namespace detail
+
+class BlockedBloomFilter {
+ public:
+  static constexpr uint32_t kMagic = 0x4d4c4242; // "BBLM"
+
+  // Sized for expectedKeys keys at (about) bitsPerKey bits each
+  explicit BlockedBloomFilter(size_t expectedKeys, double bitsPerKey = 10);
+
+  BlockedBloomFilter(BlockedBloomFilter&&) = default;
+  BlockedBloomFilter& operator=(BlockedBloomFilter&&) = default;
+
+  template <class Key>
+  void add(const Key& key) {
+    addHash(detail::membershipHash(key));
+  }
+
+  void addHash(uint64_t hash) {
+    detail::bloomAdd(blockFor(table_.mutableData(), hash), uint32_t(hash));
+  }
+
+  // May be called from many threads at once, and alongside
+  // mayContainConcurrent(), which will find the key once this returns.
+  // Other lookups must wait until the writers are done (e.g. joined).
+  template <class Key>
+  void addConcurrent(const Key& key) {
+    addHashConcurrent(detail::membershipHash(key));
+  }
+
+  void addHashConcurrent(uint64_t hash) {
+    uint32_t mask[kWords];
+    detail::bloomMask(uint32_t(hash), mask);
+    auto pairs = blockPairs(blockFor(table_.mutableData(), hash));
+    for (size_t i = 0; i < kWords / 2; ++i) {
+      pairs[i].fetch_or(maskPair(mask, i), std::memory_order_release);
+    }
+  }
+
+  // Not safe alongside addConcurrent(); see mayContainConcurrent()
+  template <class Key>
+  bool mayContain(const Key& key) const {
+    return mayContainHash(detail::membershipHash(key));
+  }
+
+  bool mayContainHash(uint64_t hash) const {
+    return detail::bloomMayContain(
+        blockFor(table_.data(), hash), uint32_t(hash));
+  }
+
+  // As mayContain(), but may be called alongside addConcurrent(). Slower,
+  // as it reads the block with atomic loads rather than with AVX2.
+  template <class Key>
+  bool mayContainConcurrent(const Key& key) const {
+    return mayContainHashConcurrent(detail::membershipHash(key));
+  }
+
+  bool mayContainHashConcurrent(uint64_t hash) const {
+    uint32_t mask[kWords];
+    detail::bloomMask(uint32_t(hash), mask);
+    auto pairs = blockPairs(blockFor(table_.data(), hash));
+    for (size_t i = 0; i < kWords / 2; ++i) {
+      auto bits = maskPair(mask, i);
+      if ((pairs[i].load(std::memory_order_acquire) & bits) != bits) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  size_t numBlocks() const { return table_.size() / kWords; }
+  size_t sizeInBytes() const { return table_.size() * sizeof(uint32_t); }
+
+  std::unique_ptr<IOBuf> serialize() const;
+  static BlockedBloomFilter deserialize(ByteRange data);
+  // Uses data in place, so it must stay valid and unchanged
+  static BlockedBloomFilter view(ByteRange data);
+
+ private:
+  static constexpr size_t kWords = detail::kBloomBlockWords;
+
+  explicit BlockedBloomFilter(detail::MembershipFilterTable<uint32_t> table)
+      : table_(std::move(table)) {}
+
+  // The upper half of the hash picks the block, the lower half the bits
+  template <class T>
+  T* blockFor(T* words, uint64_t hash) const {
+    return words + ((hash >> 32) * numBlocks() >> 32) * kWords;
+  }
+
+  // Concurrent operations go two words at a time; blocks are 8-byte aligned
+  static std::atomic<uint64_t>* blockPairs(uint32_t* block) {
+    return reinterpret_cast<std::atomic<uint64_t>*>(block);
+  }
+
+  static const std::atomic<uint64_t>* blockPairs(const uint32_t* block) {
+    return reinterpret_cast<const std::atomic<uint64_t>*>(block);
+  }
+
+  static uint64_t maskPair(const uint32_t* mask, size_t i) {
+    uint64_t lo = mask[2 * i];
+    uint64_t hi = mask[2 * i + 1];
+    return kIsLittleEndian ? lo | (hi << 32) : hi | (lo << 32);
+  }
+
+  detail::MembershipFilterTable<uint32_t> table_;
+};
+
+class CuckooFilter {
+ public:
+  static constexpr uint32_t kMagic = 0x4d4c4643; // "CFLM"
+  static constexpr size_t kSlotsPerBucket = 4;
+  // How many keys to displace before giving up on an insertion
+  static constexpr size_t kMaxKicks = 500;
+
+  // Sized to hold capacity keys at a load factor of at most 95%
+  explicit CuckooFilter(size_t capacity);
+
+  CuckooFilter(CuckooFilter&&) = default;
+  CuckooFilter& operator=(CuckooFilter&&) = default;
+
+  // Returns false, without adding the key, if the filter is full.
+  template <class Key>
+  bool add(const Key& key) {
+    return addHash(detail::membershipHash(key));
+  }
+
+  bool addHash(uint64_t hash);
+
+  template <class Key>
+  bool mayContain(const Key& key) const {
+    return mayContainHash(detail::membershipHash(key));
+  }
+
+  bool mayContainHash(uint64_t hash) const {
+    auto fp = fingerprint(hash);
+    auto i1 = index(hash);
+    auto buckets = table_.data();
+    return hasFingerprint(buckets[i1], fp) ||
+        hasFingerprint(buckets[altIndex(i1, fp)], fp) ||
+        (victimFp_ == fp && (victimIndex_ == i1 ||
+                             victimIndex_ == altIndex(i1, fp)));
+  }
+
+  // Only remove keys that were added; removing any other key may remove
+  // one that collides with it.
+  template <class Key>
+  bool remove(const Key& key) {
+    return removeHash(detail::membershipHash(key));
+  }
+
+  bool removeHash(uint64_t hash);
+
+  size_t size() const { return size_; }
+  size_t numBuckets() const { return table_.size(); }
+  size_t sizeInBytes() const { return table_.size() * sizeof(uint64_t); }
+  double loadFactor() const {
+    return double(size_) / (numBuckets() * kSlotsPerBucket);
+  }
+
+  std::unique_ptr<IOBuf> serialize() const;
+  static CuckooFilter deserialize(ByteRange data);
+  // Uses data in place, so it must stay valid and unchanged
+  static CuckooFilter view(ByteRange data);
+
+ private:
+  // A bucket holds four 16-bit fingerprints; 0 marks an empty slot
+  static constexpr uint64_t kLanes = 0x0001000100010001ULL;
+
+  CuckooFilter(detail::MembershipFilterTable<uint64_t> table,
+               const detail::MembershipFilterHeader& header);
+
+  static uint16_t fingerprint(uint64_t hash) {
+    auto fp = uint16_t(hash >> 48);
+    return fp == 0 ? 1 : fp;
+  }
+
+  size_t index(uint64_t hash) const {
+    return hash & (numBuckets() - 1);
+  }
+
+  // The other bucket of a fingerprint in bucket i; altIndex(altIndex(i))
+  // is i again, so displaced fingerprints can find their other bucket.
+  size_t altIndex(size_t i, uint16_t fp) const {
+    return (i ^ hash::twang_mix64(fp)) & (numBuckets() - 1);
+  }
+
+  // Whether any of the four lanes equals fp, all at once
+  static bool hasFingerprint(uint64_t bucket, uint16_t fp) {
+    uint64_t x = bucket ^ (kLanes * fp);
+    return ((x - kLanes) & ~x & (kLanes << 15)) != 0;
+  }
+
+  static uint16_t getSlot(uint64_t bucket, size_t slot) {
+    return uint16_t(bucket >> (16 * slot));
+  }
+
+  static void setSlot(uint64_t& bucket, size_t slot, uint16_t fp) {
+    bucket &= ~(uint64_t(0xffff) << (16 * slot));
+    bucket |= uint64_t(fp) << (16 * slot);
+  }
+
+  bool insertIntoBucket(size_t i, uint16_t fp);
+  bool removeFromBucket(size_t i, uint16_t fp);
+
+  detail::MembershipFilterTable<uint64_t> table_;
+  size_t size_;
+  // A fingerprint that could not be placed, which makes the filter full
+  uint16_t victimFp_;
+  size_t victimIndex_;
+  uint64_t rng_;
+};
+
+} // namespace folly
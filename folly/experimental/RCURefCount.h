@@ -107,7 +107,7 @@ class RCURefCount {
       refCountPtr->state_ = State::GLOBAL_TRANSITION;
     }
 
-    synchronize_rcu();
+    RCUSynchronize();
     // At this point everyone is using the global count
 
     for (auto refCountPtr : refCountPtrs) {
@@ -119,7 +119,7 @@ class RCURefCount {
       refCountPtr->state_ = State::GLOBAL;
     }
 
-    synchronize_rcu();
+    RCUSynchronize();
     // After this ++ or -- can return 0.
   }
 
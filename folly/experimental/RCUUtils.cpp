@@ -15,36 +15,32 @@
  */
 #include <folly/experimental/RCUUtils.h>
 
+#include <folly/Indestructible.h>
 #include <folly/Portability.h>
-#include <folly/ThreadLocal.h>
-
 
 namespace folly {
 
-namespace {
+namespace detail {
+
+EpochDomain& rcuDomain() {
+  // Used from thread exit hooks, so it must never be destroyed
+  static Indestructible<EpochDomain> domain;
+  return *domain;
+}
 
-struct RCURegisterThreadHelper {
-  RCURegisterThreadHelper() {
-    rcu_register_thread();
-  }
+} // namespace detail
 
-  ~RCURegisterThreadHelper() {
-    rcu_unregister_thread();
-  }
+namespace {
 
-  bool alive{false};
-};
+FOLLY_TLS bool rcuThreadRegistered = false;
 
 }
 
 bool RCURegisterThread() {
-  static folly::ThreadLocal<RCURegisterThreadHelper>* rcuRegisterThreadHelper =
-    new folly::ThreadLocal<RCURegisterThreadHelper>();
-
-  auto& helper = **rcuRegisterThreadHelper;
+  detail::rcuDomain().threadRecord();
 
-  auto ret = !helper.alive;
-  helper.alive = true;
+  auto ret = !rcuThreadRegistered;
+  rcuThreadRegistered = true;
 
   return ret;
 }
@@ -15,14 +15,52 @@
  */
 #pragma once
 
-#include <urcu.h>
+#include <memory>
+#include <utility>
+
+#include <folly/detail/EpochReclamation.h>
+
+/**
+ * Read-copy-update without external dependencies.
+ *
+ * Readers bracket their accesses with RCUReadLock (BasicLockable, so
+ * std::lock_guard works) and never block. Writers publish a new version,
+ * then either wait for pre-existing readers with RCUSynchronize() or hand
+ * the old version to RCURetire(), which frees it in batches once no reader
+ * can still see it.
+ *
+ * Grace periods are detected by a folly::detail::EpochDomain of RCU's own,
+ * so other users of epoch reclamation (such as ConcurrentHashMap iterators)
+ * never delay them: entering a read section is a thread-local store plus
+ * asymmetricLightBarrier() (a compiler barrier on Linux), and each grace
+ * period costs the writer one asymmetricHeavyBarrier(). Threads register
+ * automatically on first use.
+ *
+ * Typical use, for a read-mostly config:
+ *
+ *   std::atomic<Config*> config;
+ *
+ *   // Reader
+ *   std::lock_guard<RCUReadLock> g(RCUReadLock::instance());
+ *   use(*config.load(std::memory_order_acquire));
+ *
+ *   // Writer
+ *   auto old = config.exchange(new Config(...));
+ *   RCURetire(old);
+ */
 
 namespace folly {
 
+namespace detail {
+
+/// The epoch domain behind RCUReadLock, RCUSynchronize() and RCURetire().
+EpochDomain& rcuDomain();
+
+} // namespace detail
+
 /**
- * This must be called at least once from any thread, which uses RCUReadLock.
- * First call should happen before RCUReadLock is used for the first time. Can
- * be safely called more that once.
+ * Registers the calling thread for RCU. Kept for compatibility: threads
+ * now register automatically on their first read section.
  *
  * Returns true when called for the first time from current thread.
  */
@@ -37,17 +75,59 @@ class RCUReadLock {
     return instance;
   }
 
+  /// Read sections nest, and must not span RCUSynchronize() calls made by
+  /// the same thread.
   static void lock() {
-    assert(RCURegisterThread() == false);
-    rcu_read_lock();
+    detail::rcuDomain().enter();
   }
 
   static void unlock() {
-    rcu_read_unlock();
+    detail::EpochDomain::exit(detail::rcuDomain().threadRecord());
   }
 
  private:
   RCUReadLock() {}
 };
 
+/**
+ * Waits until every read section in progress at the time of the call has
+ * ended, then runs the deleters of everything this thread has retired.
+ * Must not be called from inside a read section.
+ */
+inline void RCUSynchronize() {
+  detail::rcuDomain().synchronize();
 }
+
+namespace detail {
+
+template <typename T, typename D>
+struct RCURetiredPtr : EpochRetired {
+  RCURetiredPtr(T* p, D&& d) : ptr(p), deleter(std::move(d)) {}
+
+  static void reclaim(EpochRetired* obj) {
+    auto retired = static_cast<RCURetiredPtr*>(obj);
+    retired->deleter(retired->ptr);
+    delete retired;
+  }
+
+  T* ptr;
+  D deleter;
+};
+
+} // namespace detail
+
+/**
+ * Calls deleter(p) once every read section in progress now has ended.
+ * Deleters run in batches on the retiring thread, from a later call to
+ * RCURetire() or RCUSynchronize(); objects retired by a thread that exits
+ * are adopted by another one.
+ */
+template <typename T, typename D = std::default_delete<T>>
+void RCURetire(T* p, D deleter = {}) {
+  auto retired = new detail::RCURetiredPtr<T, D>(p, std::move(deleter));
+  auto& domain = detail::rcuDomain();
+  domain.retire(retired, &detail::RCURetiredPtr<T, D>::reclaim);
+  domain.maybeCollect();
+}
+
+} // namespace folly
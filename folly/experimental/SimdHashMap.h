@@ -0,0 +1,1105 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Open-addressing hash maps and sets for single-threaded use, as drop-in
+ * replacements for std::unordered_map and std::unordered_set:
+ *
+ *   SimdValueMap<K, V>  SimdValueSet<K>  store values inline in the table
+ *   SimdNodeMap<K, V>   SimdNodeSet<K>   store pointers to separately
+ *                                        allocated values
+ *
+ * The table is an array of chunks, each with 14 slots and a 16-byte header
+ * holding a one-byte tag (7 bits of the key's hash) per slot. A lookup loads
+ * the header of the key's home chunk and compares all 14 tags at once with
+ * SSE2, so only slots whose tags match are compared with the key; a full
+ * chunk records how many keys overflowed past it, so a miss usually stops
+ * after one chunk. With inline storage a lookup typically touches the
+ * header and one slot, both in the same chunk.
+ *
+ * Differences from the std containers:
+ *  - Inserting may rehash, which invalidates iterators, and, for the value
+ *    variants, references to elements. The node variants keep references to
+ *    elements stable, like the std containers.
+ *  - Erasing does not invalidate iterators or references to other elements.
+ *  - There is no bucket interface; max_load_factor() is fixed.
+ *  - Values are moved when the table grows, so their move constructors
+ *    should not throw.
+ *
+ * With the default hasher and equality, maps and sets keyed by std::string,
+ * fbstring or StringPiece can be searched with any of those types without
+ * building a key, like StringKeyedUnorderedMap:
+ *
+ *   SimdValueMap<std::string, int> m;
+ *   m.find(StringPiece("abc"));
+ *   m.try_emplace(StringPiece("abc"), 1);  // copies the key only if new
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <folly/Bits.h>
+#include <folly/FBString.h>
+#include <folly/Hash.h>
+#include <folly/Portability.h>
+#include <folly/Range.h>
+
+#if FOLLY_SSE >= 2
+#include <emmintrin.h>
+#endif
+
+namespace folly {
+
+/**
+ * Default hasher for the Simd* containers; transparent for strings.
+ */
+template <class Key>
+struct SimdHash : std::hash<Key> {};
+
+template <>
+struct SimdHash<StringPiece> {
+  typedef void is_transparent;
+  size_t operator()(StringPiece key) const {
+    return StringPieceHash()(key);
+  }
+};
+
+template <>
+struct SimdHash<std::string> : SimdHash<StringPiece> {};
+
+template <>
+struct SimdHash<fbstring> : SimdHash<StringPiece> {};
+
+/**
+ * Default key equality for the Simd* containers; transparent for strings.
+ */
+template <class Key>
+struct SimdEqualTo : std::equal_to<Key> {};
+
+template <>
+struct SimdEqualTo<StringPiece> {
+  typedef void is_transparent;
+  bool operator()(StringPiece lhs, StringPiece rhs) const {
+    return lhs == rhs;
+  }
+};
+
+template <>
+struct SimdEqualTo<std::string> : SimdEqualTo<StringPiece> {};
+
+template <>
+struct SimdEqualTo<fbstring> : SimdEqualTo<StringPiece> {};
+
+namespace detail {
+
+FOLLY_CREATE_HAS_MEMBER_TYPE_TRAITS(simd_hash_is_transparent, is_transparent);
+
+// Whether K2 may be used to look up keys, without converting it to Key.
+template <class Key, class K2, class Hash, class KeyEqual>
+struct SimdHashHeterogeneous
+    : std::integral_constant<
+          bool,
+          !std::is_same<typename std::decay<K2>::type, Key>::value &&
+              simd_hash_is_transparent<Hash>::value &&
+              simd_hash_is_transparent<KeyEqual>::value> {};
+
+// Builds a Key from a key of another type used with try_emplace and the like.
+template <class Key, class K2>
+typename std::enable_if<std::is_constructible<Key, K2&&>::value, K2&&>::type
+simdHashKey(K2&& key) {
+  return std::forward<K2>(key);
+}
+
+// Converts to Key only when the item is constructed, so that looking up a
+// StringPiece that is already present doesn't build a Key.
+template <class Key>
+struct SimdHashKeyFromPiece {
+  StringPiece key;
+
+  operator Key() const {
+    return Key(key.data(), key.size());
+  }
+};
+
+template <class Key>
+typename std::enable_if<!std::is_constructible<Key, StringPiece>::value,
+                        SimdHashKeyFromPiece<Key>>::type
+simdHashKey(StringPiece key) {
+  return SimdHashKeyFromPiece<Key>{key};
+}
+
+/**
+ * 14 slots and their tags. A tag is 0 for an empty slot, or 0x80 | 7 bits of
+ * the hash for a full one.
+ */
+template <class Item>
+struct alignas(16) SimdHashChunk {
+  static constexpr unsigned kCapacity = 14;
+  static constexpr unsigned kFullMask = (1u << kCapacity) - 1;
+  // Saturates; once there, the chunk always looks like it overflowed.
+  static constexpr uint8_t kMaxOverflow = 255;
+
+  uint8_t tags[kCapacity];
+  uint8_t unused;
+  // Number of keys whose probe sequence passed this chunk because it was full
+  uint8_t outboundOverflow;
+  typename std::aligned_storage<sizeof(Item), alignof(Item)>::type
+      items[kCapacity];
+
+  Item& item(unsigned i) {
+    return *reinterpret_cast<Item*>(&items[i]);
+  }
+
+  // Bit i is set if slot i holds 'tag'
+  unsigned matchTag(uint8_t tag) const {
+#if FOLLY_SSE >= 2
+    auto header = _mm_load_si128(reinterpret_cast<const __m128i*>(tags));
+    auto eq = _mm_cmpeq_epi8(header, _mm_set1_epi8(static_cast<char>(tag)));
+    return unsigned(_mm_movemask_epi8(eq)) & kFullMask;
+#else
+    unsigned mask = 0;
+    for (unsigned i = 0; i < kCapacity; ++i) {
+      mask |= unsigned(tags[i] == tag) << i;
+    }
+    return mask;
+#endif
+  }
+
+  // Bit i is set if slot i is full
+  unsigned occupied() const {
+#if FOLLY_SSE >= 2
+    auto header = _mm_load_si128(reinterpret_cast<const __m128i*>(tags));
+    return unsigned(_mm_movemask_epi8(header)) & kFullMask;
+#else
+    unsigned mask = 0;
+    for (unsigned i = 0; i < kCapacity; ++i) {
+      mask |= unsigned(tags[i] >> 7) << i;
+    }
+    return mask;
+#endif
+  }
+
+  void incrementOverflow() {
+    if (outboundOverflow != kMaxOverflow) {
+      ++outboundOverflow;
+    }
+  }
+
+  void decrementOverflow() {
+    if (outboundOverflow != kMaxOverflow) {
+      --outboundOverflow;
+    }
+  }
+};
+
+/**
+ * What the table stores for maps (Mapped = mapped_type) and sets
+ * (Mapped = void).
+ */
+template <class Key, class Mapped>
+struct SimdHashValue {
+  typedef std::pair<const Key, Mapped> type;
+  // What emplace() builds when it can't find the key in its arguments
+  typedef std::pair<Key, Mapped> temp_type;
+
+  static const Key& key(const type& value) {
+    return value.first;
+  }
+  static const Key& key(const temp_type& value) {
+    return value.first;
+  }
+
+  // Move-constructs *to from from, moving the key too, and destroys from.
+  static void relocate(type* to, type& from) {
+    new (to) type(std::move(const_cast<Key&>(from.first)),
+                  std::move(from.second));
+    from.~type();
+  }
+};
+
+template <class Key>
+struct SimdHashValue<Key, void> {
+  typedef Key type;
+  typedef Key temp_type;
+
+  static const Key& key(const Key& value) {
+    return value;
+  }
+
+  static void relocate(Key* to, Key& from) {
+    new (to) Key(std::move(from));
+    from.~Key();
+  }
+};
+
+template <class Item, class Value>
+class SimdHashIterator
+    : public std::iterator<std::forward_iterator_tag, Value> {
+  typedef SimdHashChunk<Item> Chunk;
+  typedef typename std::remove_const<Value>::type MutableValue;
+
+ public:
+  SimdHashIterator() : chunk_(nullptr), end_(nullptr), slot_(0) {}
+
+  // iterator -> const_iterator
+  template <class OtherValue,
+            class = typename std::enable_if<
+                std::is_same<const OtherValue, Value>::value>::type>
+  /* implicit */ SimdHashIterator(
+      const SimdHashIterator<Item, OtherValue>& other)
+      : chunk_(other.chunk_), end_(other.end_), slot_(other.slot_) {}
+
+  Value& operator*() const {
+    return valueOf(chunk_->item(slot_));
+  }
+
+  Value* operator->() const {
+    return &**this;
+  }
+
+  SimdHashIterator& operator++() {
+    unsigned rest = chunk_->occupied() & ~((2u << slot_) - 1);
+    while (!rest) {
+      if (++chunk_ == end_) {
+        slot_ = 0;
+        return *this;
+      }
+      rest = chunk_->occupied();
+    }
+    slot_ = findFirstSet(rest) - 1;
+    return *this;
+  }
+
+  SimdHashIterator operator++(int) {
+    auto old = *this;
+    ++*this;
+    return old;
+  }
+
+  template <class OtherValue>
+  bool operator==(const SimdHashIterator<Item, OtherValue>& other) const {
+    return chunk_ == other.chunk_ && slot_ == other.slot_;
+  }
+
+  template <class OtherValue>
+  bool operator!=(const SimdHashIterator<Item, OtherValue>& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  template <class K, class M, class H, class E, class A, bool N>
+  friend class SimdHashTable;
+  template <class I, class V>
+  friend class SimdHashIterator;
+
+  SimdHashIterator(Chunk* chunk, Chunk* end, unsigned slot)
+      : chunk_(chunk), end_(end), slot_(slot) {}
+
+  static MutableValue& valueOf(MutableValue& value) {
+    return value;
+  }
+  static MutableValue& valueOf(MutableValue* value) {
+    return *value;
+  }
+
+  Chunk* chunk_;
+  Chunk* end_;
+  unsigned slot_;
+};
+
+/**
+ * The implementation of the Simd* containers; kNodes selects node storage.
+ */
+template <class Key,
+          class Mapped,
+          class Hash,
+          class KeyEqual,
+          class Alloc,
+          bool kNodes>
+class SimdHashTable {
+  typedef SimdHashValue<Key, Mapped> ValueTraits;
+
+ public:
+  typedef Key key_type;
+  typedef typename ValueTraits::type value_type;
+  typedef Hash hasher;
+  typedef KeyEqual key_equal;
+  typedef Alloc allocator_type;
+  typedef value_type& reference;
+  typedef const value_type& const_reference;
+  typedef value_type* pointer;
+  typedef const value_type* const_pointer;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+
+ private:
+  typedef typename std::conditional<kNodes, value_type*, value_type>::type
+      Item;
+  typedef SimdHashChunk<Item> Chunk;
+  typedef std::allocator_traits<Alloc> AllocTraits;
+  typedef typename AllocTraits::template rebind_alloc<Chunk> ChunkAlloc;
+  typedef std::allocator_traits<ChunkAlloc> ChunkAllocTraits;
+  // At most 12 of a chunk's 14 slots are used on average.
+  static constexpr size_t kMaxLoadNumerator = 12;
+
+ public:
+  // As in std::unordered_set, a set's iterator is a const_iterator, so that
+  // keys can't be modified in place.
+  typedef SimdHashIterator<
+      Item,
+      typename std::conditional<std::is_void<Mapped>::value,
+                                const value_type,
+                                value_type>::type>
+      iterator;
+  typedef SimdHashIterator<Item, const value_type> const_iterator;
+
+  SimdHashTable() : SimdHashTable(0) {}
+
+  explicit SimdHashTable(size_type n,
+                         const hasher& hash = hasher(),
+                         const key_equal& eq = key_equal(),
+                         const allocator_type& alloc = allocator_type())
+      : state_(hash, eq, alloc) {
+    reserve(n);
+  }
+
+  explicit SimdHashTable(const allocator_type& alloc)
+      : state_(hasher(), key_equal(), alloc) {}
+
+  template <class InputIterator>
+  SimdHashTable(InputIterator first,
+                InputIterator last,
+                size_type n = 0,
+                const hasher& hash = hasher(),
+                const key_equal& eq = key_equal(),
+                const allocator_type& alloc = allocator_type())
+      : SimdHashTable(n, hash, eq, alloc) {
+    insert(first, last);
+  }
+
+  SimdHashTable(std::initializer_list<value_type> values,
+                size_type n = 0,
+                const hasher& hash = hasher(),
+                const key_equal& eq = key_equal(),
+                const allocator_type& alloc = allocator_type())
+      : SimdHashTable(values.begin(), values.end(), n, hash, eq, alloc) {}
+
+  SimdHashTable(const SimdHashTable& other)
+      : state_(other.hash_function(),
+               other.key_eq(),
+               AllocTraits::select_on_container_copy_construction(
+                   other.get_allocator())) {
+    copyFrom(other);
+  }
+
+  SimdHashTable(SimdHashTable&& other) noexcept
+      : state_(std::move(other.state_)),
+        chunks_(other.chunks_),
+        chunkMask_(other.chunkMask_),
+        size_(other.size_) {
+    other.chunks_ = nullptr;
+    other.chunkMask_ = 0;
+    other.size_ = 0;
+  }
+
+  SimdHashTable& operator=(const SimdHashTable& other) {
+    if (this != &other) {
+      clear();
+      copyFrom(other);
+    }
+    return *this;
+  }
+
+  SimdHashTable& operator=(SimdHashTable&& other) noexcept {
+    if (this != &other) {
+      destroyAll();
+      deallocateChunks();
+      state_ = std::move(other.state_);
+      chunks_ = other.chunks_;
+      chunkMask_ = other.chunkMask_;
+      size_ = other.size_;
+      other.chunks_ = nullptr;
+      other.chunkMask_ = 0;
+      other.size_ = 0;
+    }
+    return *this;
+  }
+
+  SimdHashTable& operator=(std::initializer_list<value_type> values) {
+    clear();
+    insert(values);
+    return *this;
+  }
+
+  ~SimdHashTable() {
+    destroyAll();
+    deallocateChunks();
+  }
+
+  allocator_type get_allocator() const {
+    return allocator_type(chunkAlloc());
+  }
+  hasher hash_function() const {
+    return std::get<0>(state_);
+  }
+  key_equal key_eq() const {
+    return std::get<1>(state_);
+  }
+
+  // Iterators
+
+  iterator begin() {
+    return firstFrom<iterator>(0);
+  }
+  const_iterator begin() const {
+    return cbegin();
+  }
+  const_iterator cbegin() const {
+    return firstFrom<const_iterator>(0);
+  }
+
+  iterator end() {
+    return iterator(chunksEnd(), chunksEnd(), 0);
+  }
+  const_iterator end() const {
+    return cend();
+  }
+  const_iterator cend() const {
+    return const_iterator(chunksEnd(), chunksEnd(), 0);
+  }
+
+  // Capacity
+
+  bool empty() const {
+    return size_ == 0;
+  }
+  size_type size() const {
+    return size_;
+  }
+  size_type max_size() const {
+    return std::numeric_limits<size_type>::max() / sizeof(Chunk) *
+        kMaxLoadNumerator;
+  }
+
+  // Modifiers
+
+  void clear() {
+    destroyAll();
+    for (size_t i = 0; chunks_ && i <= chunkMask_; ++i) {
+      std::memset(&chunks_[i], 0, 16);
+    }
+    size_ = 0;
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    return emplaceKeyed(ValueTraits::key(value), value);
+  }
+
+  std::pair<iterator, bool> insert(value_type&& value) {
+    return emplaceKeyed(ValueTraits::key(value), std::move(value));
+  }
+
+  template <class P,
+            class = typename std::enable_if<
+                std::is_constructible<value_type, P&&>::value>::type>
+  std::pair<iterator, bool> insert(P&& value) {
+    return emplace(std::forward<P>(value));
+  }
+
+  iterator insert(const_iterator /* hint */, const value_type& value) {
+    return insert(value).first;
+  }
+
+  iterator insert(const_iterator /* hint */, value_type&& value) {
+    return insert(std::move(value)).first;
+  }
+
+  template <class InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  void insert(std::initializer_list<value_type> values) {
+    reserve(size_ + values.size());
+    insert(values.begin(), values.end());
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    typename ValueTraits::temp_type temp(std::forward<Args>(args)...);
+    return emplaceKeyed(ValueTraits::key(temp), std::move(temp));
+  }
+
+  template <class... Args>
+  iterator emplace_hint(const_iterator /* hint */, Args&&... args) {
+    return emplace(std::forward<Args>(args)...).first;
+  }
+
+  // Maps only: inserts (key, mapped_type(args...)) if key isn't present.
+  // key may be of any type the hasher and key_equal are transparent for.
+  template <class K2, class... Args>
+  std::pair<iterator, bool> try_emplace(K2&& key, Args&&... args) {
+    return emplaceKeyed(
+        key,
+        std::piecewise_construct,
+        std::forward_as_tuple(simdHashKey<Key>(std::forward<K2>(key))),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  template <class K2, class M>
+  std::pair<iterator, bool> insert_or_assign(K2&& key, M&& mapped) {
+    auto result = try_emplace(std::forward<K2>(key), std::forward<M>(mapped));
+    if (!result.second) {
+      result.first->second = std::forward<M>(mapped);
+    }
+    return result;
+  }
+
+  iterator erase(const_iterator pos) {
+    iterator next(pos.chunk_, pos.end_, pos.slot_);
+    ++next;
+    eraseAt(pos.chunk_, pos.slot_);
+    return next;
+  }
+
+  // Maps only; for sets, iterator is const_iterator
+  template <class It,
+            class = typename std::enable_if<
+                std::is_same<It, iterator>::value &&
+                !std::is_same<It, const_iterator>::value>::type>
+  iterator erase(It pos) {
+    return erase(const_iterator(pos));
+  }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    while (first != last) {
+      first = erase(first);
+    }
+    return iterator(last.chunk_, last.end_, last.slot_);
+  }
+
+  size_type erase(const key_type& key) {
+    return eraseKey(key);
+  }
+
+  template <class K2,
+            class = typename std::enable_if<
+                SimdHashHeterogeneous<Key, K2, Hash, KeyEqual>::value>::type>
+  size_type erase(const K2& key) {
+    return eraseKey(key);
+  }
+
+  void swap(SimdHashTable& other) noexcept {
+    using std::swap;
+    swap(state_, other.state_);
+    swap(chunks_, other.chunks_);
+    swap(chunkMask_, other.chunkMask_);
+    swap(size_, other.size_);
+  }
+
+  // Lookup
+
+  iterator find(const key_type& key) {
+    return findKey<iterator>(key);
+  }
+  const_iterator find(const key_type& key) const {
+    return findKey<const_iterator>(key);
+  }
+
+  template <class K2,
+            class = typename std::enable_if<
+                SimdHashHeterogeneous<Key, K2, Hash, KeyEqual>::value>::type>
+  iterator find(const K2& key) {
+    return findKey<iterator>(key);
+  }
+  template <class K2,
+            class = typename std::enable_if<
+                SimdHashHeterogeneous<Key, K2, Hash, KeyEqual>::value>::type>
+  const_iterator find(const K2& key) const {
+    return findKey<const_iterator>(key);
+  }
+
+  size_type count(const key_type& key) const {
+    return find(key) == end() ? 0 : 1;
+  }
+
+  template <class K2,
+            class = typename std::enable_if<
+                SimdHashHeterogeneous<Key, K2, Hash, KeyEqual>::value>::type>
+  size_type count(const K2& key) const {
+    return find(key) == end() ? 0 : 1;
+  }
+
+  std::pair<iterator, iterator> equal_range(const key_type& key) {
+    return rangeOf(find(key));
+  }
+  std::pair<const_iterator, const_iterator> equal_range(
+      const key_type& key) const {
+    return rangeOf(find(key));
+  }
+
+  // Maps only
+
+  template <class K2, class M = Mapped>
+  M& at(const K2& key) {
+    auto it = find(key);
+    if (it == end()) {
+      throw std::out_of_range("SimdHashMap::at");
+    }
+    return it->second;
+  }
+
+  template <class K2, class M = Mapped>
+  const M& at(const K2& key) const {
+    auto it = find(key);
+    if (it == end()) {
+      throw std::out_of_range("SimdHashMap::at");
+    }
+    return it->second;
+  }
+
+  template <class K2, class M = Mapped>
+  M& operator[](K2&& key) {
+    return try_emplace(std::forward<K2>(key)).first->second;
+  }
+
+  // Hash policy
+
+  size_type bucket_count() const {
+    return chunks_ ? (chunkMask_ + 1) * Chunk::kCapacity : 0;
+  }
+
+  float load_factor() const {
+    return chunks_ ? float(size_) / bucket_count() : 0.0f;
+  }
+
+  float max_load_factor() const {
+    return float(kMaxLoadNumerator) / Chunk::kCapacity;
+  }
+
+  void max_load_factor(float) {}
+
+  void rehash(size_type n) {
+    reserve(std::max<size_type>(
+        size_, size_type(n * max_load_factor())));
+  }
+
+  // Makes room for n values without another rehash.
+  void reserve(size_type n) {
+    size_t chunks = chunks_ ? chunkMask_ + 1 : 0;
+    if (n <= chunks * kMaxLoadNumerator) {
+      return;
+    }
+    size_t needed = (n + kMaxLoadNumerator - 1) / kMaxLoadNumerator;
+    rehashTo(nextPowTwo(std::max(needed, std::max<size_t>(chunks * 2, 1))));
+  }
+
+  bool operator==(const SimdHashTable& other) const {
+    if (size_ != other.size_) {
+      return false;
+    }
+    for (auto& value : *this) {
+      auto it = other.find(ValueTraits::key(value));
+      if (it == other.end() || !(*it == value)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator!=(const SimdHashTable& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  // Where a key's probe sequence starts, how it steps and what tag it has
+  struct HashPair {
+    size_t index;
+    size_t delta;
+    uint8_t tag;
+  };
+
+  template <class K2>
+  HashPair splitHash(const K2& key) const {
+    uint64_t h = hash::twang_mix64(hashRef()(key));
+    uint8_t tag = uint8_t(h >> 57) | 0x80;
+    // odd, so the probe sequence visits every chunk
+    return HashPair{size_t(h), 2 * size_t(tag) + 1, tag};
+  }
+
+  const hasher& hashRef() const {
+    return std::get<0>(state_);
+  }
+  const key_equal& eqRef() const {
+    return std::get<1>(state_);
+  }
+  ChunkAlloc& chunkAlloc() {
+    return std::get<2>(state_);
+  }
+  const ChunkAlloc& chunkAlloc() const {
+    return std::get<2>(state_);
+  }
+
+  Chunk* chunksEnd() const {
+    return chunks_ ? chunks_ + chunkMask_ + 1 : nullptr;
+  }
+
+  static value_type& valueOf(value_type& item) {
+    return item;
+  }
+  static value_type& valueOf(value_type* item) {
+    return *item;
+  }
+
+  template <class It>
+  It firstFrom(size_t chunk) const {
+    for (; chunks_ && chunk <= chunkMask_; ++chunk) {
+      unsigned occupied = chunks_[chunk].occupied();
+      if (occupied) {
+        return It(
+            &chunks_[chunk], chunksEnd(), findFirstSet(occupied) - 1);
+      }
+    }
+    return It(chunksEnd(), chunksEnd(), 0);
+  }
+
+  template <class It>
+  std::pair<It, It> rangeOf(It it) const {
+    auto next = it;
+    if (next != It(chunksEnd(), chunksEnd(), 0)) {
+      ++next;
+    }
+    return std::make_pair(it, next);
+  }
+
+  // Finds the chunk and slot holding key, or returns false
+  template <class K2>
+  bool findSlot(const K2& key,
+                const HashPair& hp,
+                Chunk*& chunk,
+                unsigned& slot) const {
+    if (!chunks_) {
+      return false;
+    }
+    size_t index = hp.index;
+    for (size_t tries = 0; tries <= chunkMask_; ++tries) {
+      chunk = &chunks_[index & chunkMask_];
+      unsigned hits = chunk->matchTag(hp.tag);
+      while (hits) {
+        slot = findFirstSet(hits) - 1;
+        if (eqRef()(key, ValueTraits::key(valueOf(chunk->item(slot))))) {
+          return true;
+        }
+        hits &= hits - 1;
+      }
+      if (chunk->outboundOverflow == 0) {
+        return false;
+      }
+      index += hp.delta;
+    }
+    return false;
+  }
+
+  template <class It, class K2>
+  It findKey(const K2& key) const {
+    Chunk* chunk;
+    unsigned slot;
+    if (findSlot(key, splitHash(key), chunk, slot)) {
+      return It(chunk, chunksEnd(), slot);
+    }
+    return It(chunksEnd(), chunksEnd(), 0);
+  }
+
+  // Claims an empty slot for a key not in the table, counting the overflow
+  // in each full chunk passed on the way.
+  Item* claimSlot(const HashPair& hp, Chunk*& chunk, unsigned& slot) {
+    size_t index = hp.index;
+    while (true) {
+      chunk = &chunks_[index & chunkMask_];
+      unsigned free = ~chunk->occupied() & Chunk::kFullMask;
+      if (free) {
+        slot = findFirstSet(free) - 1;
+        chunk->tags[slot] = hp.tag;
+        return &chunk->item(slot);
+      }
+      chunk->incrementOverflow();
+      index += hp.delta;
+    }
+  }
+
+  template <class... Args>
+  void constructItem(value_type** item, Args&&... args) {
+    typename AllocTraits::template rebind_alloc<value_type> alloc(
+        chunkAlloc());
+    typedef typename AllocTraits::template rebind_traits<value_type> Traits;
+    auto node = Traits::allocate(alloc, 1);
+    try {
+      Traits::construct(alloc, node, std::forward<Args>(args)...);
+    } catch (...) {
+      Traits::deallocate(alloc, node, 1);
+      throw;
+    }
+    *item = node;
+  }
+
+  template <class... Args>
+  void constructItem(value_type* item, Args&&... args) {
+    typename AllocTraits::template rebind_alloc<value_type> alloc(
+        chunkAlloc());
+    AllocTraits::template rebind_traits<value_type>::construct(
+        alloc, item, std::forward<Args>(args)...);
+  }
+
+  void destroyItem(Item& item) {
+    typename AllocTraits::template rebind_alloc<value_type> alloc(
+        chunkAlloc());
+    destroyItem(item, alloc);
+  }
+
+  template <class A>
+  static void destroyItem(value_type*& node, A& alloc) {
+    std::allocator_traits<A>::destroy(alloc, node);
+    std::allocator_traits<A>::deallocate(alloc, node, 1);
+  }
+
+  template <class A>
+  static void destroyItem(value_type& value, A& alloc) {
+    std::allocator_traits<A>::destroy(alloc, &value);
+  }
+
+  static void relocateItem(value_type** to, value_type*& from) {
+    *to = from;
+  }
+
+  static void relocateItem(value_type* to, value_type& from) {
+    ValueTraits::relocate(to, from);
+  }
+
+  template <class K2, class... Args>
+  std::pair<iterator, bool> emplaceKeyed(const K2& key, Args&&... args) {
+    auto hp = splitHash(key);
+    Chunk* chunk;
+    unsigned slot;
+    if (findSlot(key, hp, chunk, slot)) {
+      return std::make_pair(iterator(chunk, chunksEnd(), slot), false);
+    }
+    if (!chunks_ || size_ >= (chunkMask_ + 1) * kMaxLoadNumerator) {
+      return growAndInsert(
+          static_cast<Item*>(nullptr), hp, std::forward<Args>(args)...);
+    }
+    return insertNew(hp, std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool>
+  growAndInsert(value_type** /* nodes */, const HashPair& hp, Args&&... args) {
+    // Nodes stay put, so args remain valid even if they refer to one
+    reserve(size_ + 1);
+    return insertNew(hp, std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool>
+  growAndInsert(value_type* /* values */, const HashPair& hp, Args&&... args) {
+    // Growing relocates values, and args may refer to one of them
+    typename ValueTraits::temp_type temp(std::forward<Args>(args)...);
+    reserve(size_ + 1);
+    return insertNew(hp, std::move(temp));
+  }
+
+  // Inserts a key known to be absent; the table must have room for it.
+  template <class... Args>
+  std::pair<iterator, bool> insertNew(const HashPair& hp, Args&&... args) {
+    Chunk* chunk;
+    unsigned slot;
+    Item* item = claimSlot(hp, chunk, slot);
+    try {
+      constructItem(item, std::forward<Args>(args)...);
+    } catch (...) {
+      chunk->tags[slot] = 0;
+      undoOverflow(hp, chunk);
+      throw;
+    }
+    ++size_;
+    return std::make_pair(iterator(chunk, chunksEnd(), slot), true);
+  }
+
+  // Decrements the overflow counts of the chunks before 'last' in a key's
+  // probe sequence.
+  void undoOverflow(const HashPair& hp, Chunk* last) {
+    for (size_t index = hp.index; &chunks_[index & chunkMask_] != last;
+         index += hp.delta) {
+      chunks_[index & chunkMask_].decrementOverflow();
+    }
+  }
+
+  void eraseAt(Chunk* chunk, unsigned slot) {
+    Item& item = chunk->item(slot);
+    // rehash the key to find the chunks it overflowed through
+    undoOverflow(splitHash(ValueTraits::key(valueOf(item))), chunk);
+    destroyItem(item);
+    chunk->tags[slot] = 0;
+    --size_;
+  }
+
+  template <class K2>
+  size_type eraseKey(const K2& key) {
+    Chunk* chunk;
+    unsigned slot;
+    if (!findSlot(key, splitHash(key), chunk, slot)) {
+      return 0;
+    }
+    eraseAt(chunk, slot);
+    return 1;
+  }
+
+  void rehashTo(size_t chunkCount) {
+    Chunk* oldChunks = chunks_;
+    size_t oldCount = chunks_ ? chunkMask_ + 1 : 0;
+    chunks_ = ChunkAllocTraits::allocate(chunkAlloc(), chunkCount);
+    std::memset(chunks_, 0, chunkCount * sizeof(Chunk));
+    chunkMask_ = chunkCount - 1;
+    for (size_t i = 0; i < oldCount; ++i) {
+      Chunk& from = oldChunks[i];
+      unsigned occupied = from.occupied();
+      while (occupied) {
+        unsigned slot = findFirstSet(occupied) - 1;
+        occupied &= occupied - 1;
+        Item& item = from.item(slot);
+        Chunk* chunk;
+        unsigned to;
+        relocateItem(
+            claimSlot(splitHash(ValueTraits::key(valueOf(item))), chunk, to),
+            item);
+      }
+    }
+    if (oldChunks) {
+      ChunkAllocTraits::deallocate(chunkAlloc(), oldChunks, oldCount);
+    }
+  }
+
+  void destroyAll() {
+    if (!size_) {
+      return;
+    }
+    for (size_t i = 0; i <= chunkMask_; ++i) {
+      unsigned occupied = chunks_[i].occupied();
+      while (occupied) {
+        destroyItem(chunks_[i].item(findFirstSet(occupied) - 1));
+        occupied &= occupied - 1;
+      }
+    }
+  }
+
+  void deallocateChunks() {
+    if (chunks_) {
+      ChunkAllocTraits::deallocate(chunkAlloc(), chunks_, chunkMask_ + 1);
+      chunks_ = nullptr;
+      chunkMask_ = 0;
+    }
+  }
+
+  void copyFrom(const SimdHashTable& other) {
+    reserve(other.size());
+    for (auto& value : other) {
+      emplaceKeyed(ValueTraits::key(value), value);
+    }
+  }
+
+  // Empty hashers, equalities and allocators take no space in a tuple.
+  std::tuple<Hash, KeyEqual, ChunkAlloc> state_;
+  Chunk* chunks_{nullptr};
+  size_t chunkMask_{0};
+  size_t size_{0};
+};
+
+template <class K, class M, class H, class E, class A, bool N>
+void swap(SimdHashTable<K, M, H, E, A, N>& a,
+          SimdHashTable<K, M, H, E, A, N>& b) noexcept {
+  a.swap(b);
+}
+
+} // namespace detail
+
+template <class Key,
+          class Mapped,
+          class Hash = SimdHash<Key>,
+          class KeyEqual = SimdEqualTo<Key>,
+          class Alloc = std::allocator<std::pair<const Key, Mapped>>>
+class SimdValueMap
+    : public detail::SimdHashTable<Key, Mapped, Hash, KeyEqual, Alloc, false> {
+  typedef detail::SimdHashTable<Key, Mapped, Hash, KeyEqual, Alloc, false>
+      Base;
+
+ public:
+  typedef Mapped mapped_type;
+  using Base::Base;
+};
+
+template <class Key,
+          class Mapped,
+          class Hash = SimdHash<Key>,
+          class KeyEqual = SimdEqualTo<Key>,
+          class Alloc = std::allocator<std::pair<const Key, Mapped>>>
+class SimdNodeMap
+    : public detail::SimdHashTable<Key, Mapped, Hash, KeyEqual, Alloc, true> {
+  typedef detail::SimdHashTable<Key, Mapped, Hash, KeyEqual, Alloc, true>
+      Base;
+
+ public:
+  typedef Mapped mapped_type;
+  using Base::Base;
+};
+
+template <class Key,
+          class Hash = SimdHash<Key>,
+          class KeyEqual = SimdEqualTo<Key>,
+          class Alloc = std::allocator<Key>>
+class SimdValueSet
+    : public detail::SimdHashTable<Key, void, Hash, KeyEqual, Alloc, false> {
+  typedef detail::SimdHashTable<Key, void, Hash, KeyEqual, Alloc, false> Base;
+
+ public:
+  using Base::Base;
+};
+
+template <class Key,
+          class Hash = SimdHash<Key>,
+          class KeyEqual = SimdEqualTo<Key>,
+          class Alloc = std::allocator<Key>>
+class SimdNodeSet
+    : public detail::SimdHashTable<Key, void, Hash, KeyEqual, Alloc, true> {
+  typedef detail::SimdHashTable<Key, void, Hash, KeyEqual, Alloc, true> Base;
+
+ public:
+  using Base::Base;
+};
+
+} // namespace folly
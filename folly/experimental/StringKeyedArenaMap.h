@@ -0,0 +1,471 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include <folly/Arena.h>
+#include <folly/Range.h>
+
+namespace folly {
+
+namespace detail {
+
+/**
+ * Key of a StringKeyedArenaMap, always 16 bytes: keys of up to
+ * kMaxInline bytes are stored inline, longer ones are copied into the
+ * map's arena and referenced by pointer and size.
+ */
+class ArenaStringKey {
+ public:
+  static constexpr size_t kMaxInline = 15;
+
+  ArenaStringKey(StringPiece key, SysArena& arena) {
+    if (key.size() <= kMaxInline) {
+      memcpy(bytes_, key.data(), key.size());
+      bytes_[kTag] = static_cast<char>(key.size());
+      return;
+    }
+    if (key.size() > std::numeric_limits<uint32_t>::max()) {
+      throw std::length_error("StringKeyedArenaMap: key too long");
+    }
+    auto data = static_cast<char*>(arena.allocate(key.size()));
+    memcpy(data, key.data(), key.size());
+    uint32_t size = key.size();
+    memcpy(bytes_, &data, sizeof(data));
+    memcpy(bytes_ + sizeof(data), &size, sizeof(size));
+    bytes_[kTag] = kExternal;
+  }
+
+  StringPiece str() const {
+    if (bytes_[kTag] != kExternal) {
+      return StringPiece(bytes_, static_cast<size_t>(bytes_[kTag]));
+    }
+    const char* data;
+    uint32_t size;
+    memcpy(&data, bytes_, sizeof(data));
+    memcpy(&size, bytes_ + sizeof(data), sizeof(size));
+    return StringPiece(data, size);
+  }
+
+ private:
+  static constexpr size_t kTag = 15;
+  static constexpr char kExternal = -1;
+
+  char bytes_[16];
+};
+
+} // namespace detail
+
+/**
+ * A map from strings to Value for very large numbers of mostly short
+ * keys, looked up by StringPiece like StringKeyedUnorderedMap, but
+ * without a heap allocation per key:
+ *
+ *  - Keys of up to 15 bytes are stored inline in the table; longer ones
+ *    are copied into an arena owned by the map. Arena memory of erased
+ *    keys is only released by clear() or destruction.
+ *  - The table uses open addressing with linear probing, and keeps 31
+ *    bits of each key's hash in a separate array, which is all a probe
+ *    touches until the hash matches. Growing the table places entries by
+ *    their stored hash, without rehashing the keys.
+ *
+ * Unlike unordered_map, inserting may move entries (invalidating
+ * iterators and references), and so may erasing, which shifts later
+ * entries back instead of leaving tombstones. Values must be movable.
+ *
+ * Iterators dereference to a pair<StringPiece, Value&>; the StringPiece
+ * points into the map and stays valid until the entry is moved.
+ */
+template <class Value, class Hash = StringPieceHash>
+class StringKeyedArenaMap {
+  struct Slot {
+    template <class... Args>
+    Slot(StringPiece k, SysArena& arena, Args&&... args)
+        : key(k, arena), value(std::forward<Args>(args)...) {}
+
+    detail::ArenaStringKey key;
+    Value value;
+  };
+
+  template <class MapT, class ValueT>
+  class Iterator {
+   public:
+    typedef std::pair<StringPiece, ValueT&> value_type;
+    typedef value_type reference;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+
+    class pointer {
+     public:
+      explicit pointer(reference ref) : ref_(ref) {}
+      reference* operator->() { return &ref_; }
+
+     private:
+      reference ref_;
+    };
+
+    Iterator() : map_(nullptr), index_(0) {}
+
+    // iterator to const_iterator
+    template <class OtherMap, class OtherValue>
+    /* implicit */ Iterator(const Iterator<OtherMap, OtherValue>& other)
+        : map_(other.map_), index_(other.index_) {}
+
+    reference operator*() const {
+      auto& slot = map_->slots_[index_];
+      return reference(slot.key.str(), slot.value);
+    }
+
+    pointer operator->() const {
+      return pointer(**this);
+    }
+
+    Iterator& operator++() {
+      index_ = map_->nextOccupied(index_ + 1);
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      auto copy = *this;
+      ++*this;
+      return copy;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return index_ == other.index_;
+    }
+
+    bool operator!=(const Iterator& other) const {
+      return index_ != other.index_;
+    }
+
+   private:
+    friend class StringKeyedArenaMap;
+    template <class, class>
+    friend class Iterator;
+
+    Iterator(MapT* map, size_t index) : map_(map), index_(index) {}
+
+    MapT* map_;
+    size_t index_;
+  };
+
+ public:
+  typedef StringPiece key_type;
+  typedef Value mapped_type;
+  typedef Hash hasher;
+  typedef size_t size_type;
+  typedef Iterator<StringKeyedArenaMap, Value> iterator;
+  typedef Iterator<const StringKeyedArenaMap, const Value> const_iterator;
+
+  // Size of the arena blocks long keys are copied into
+  static constexpr size_t kKeyBlockSize = 64 * 1024;
+
+  explicit StringKeyedArenaMap(size_type n = 0, const hasher& hf = hasher())
+      : hash_(hf),
+        hashes_(nullptr),
+        slots_(nullptr),
+        capacity_(0),
+        size_(0) {
+    reserve(n);
+  }
+
+  StringKeyedArenaMap(const StringKeyedArenaMap& other)
+      : StringKeyedArenaMap(other.size(), other.hash_) {
+    for (auto entry : other) {
+      emplace(entry.first, entry.second);
+    }
+  }
+
+  StringKeyedArenaMap(StringKeyedArenaMap&& other) noexcept
+      : hash_(std::move(other.hash_)),
+        hashes_(std::move(other.hashes_)),
+        slots_(other.slots_),
+        capacity_(other.capacity_),
+        size_(other.size_),
+        keys_(std::move(other.keys_)) {
+    other.slots_ = nullptr;
+    other.capacity_ = 0;
+    other.size_ = 0;
+  }
+
+  StringKeyedArenaMap& operator=(StringKeyedArenaMap other) noexcept {
+    swap(other);
+    return *this;
+  }
+
+  ~StringKeyedArenaMap() {
+    destroySlots();
+  }
+
+  void swap(StringKeyedArenaMap& other) noexcept {
+    using std::swap;
+    swap(hash_, other.hash_);
+    swap(hashes_, other.hashes_);
+    swap(slots_, other.slots_);
+    swap(capacity_, other.capacity_);
+    swap(size_, other.size_);
+    swap(keys_, other.keys_);
+  }
+
+  bool empty() const { return size_ == 0; }
+  size_type size() const { return size_; }
+  size_type bucket_count() const { return capacity_; }
+  hasher hash_function() const { return hash_; }
+
+  iterator begin() { return iterator(this, nextOccupied(0)); }
+  iterator end() { return iterator(this, capacity_); }
+  const_iterator begin() const { return const_iterator(this, nextOccupied(0)); }
+  const_iterator end() const { return const_iterator(this, capacity_); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  iterator find(StringPiece key) {
+    return iterator(this, findIndex(key, hashOf(key)));
+  }
+
+  const_iterator find(StringPiece key) const {
+    return const_iterator(this, findIndex(key, hashOf(key)));
+  }
+
+  size_type count(StringPiece key) const {
+    return find(key) == end() ? 0 : 1;
+  }
+
+  mapped_type& at(StringPiece key) {
+    auto it = find(key);
+    if (it == end()) {
+      throw std::out_of_range("StringKeyedArenaMap::at");
+    }
+    return it->second;
+  }
+
+  const mapped_type& at(StringPiece key) const {
+    auto it = find(key);
+    if (it == end()) {
+      throw std::out_of_range("StringKeyedArenaMap::at");
+    }
+    return it->second;
+  }
+
+  mapped_type& operator[](StringPiece key) {
+    return emplace(key).first->second;
+  }
+
+  // Copies the key only if it is not present yet
+  template <class... Args>
+  std::pair<iterator, bool> emplace(StringPiece key, Args&&... args) {
+    auto hash = hashOf(key);
+    auto index = findIndex(key, hash);
+    if (index != capacity_) {
+      return std::make_pair(iterator(this, index), false);
+    }
+    if (size_ + 1 > maxSize(capacity_)) {
+      // Growing moves the entries, and key or args may point into one
+      Slot slot(key, keyArena(), std::forward<Args>(args)...);
+      grow(std::max<size_t>(capacity_ * 2, kMinCapacity));
+      return insertNew(hash, std::move(slot));
+    }
+    return insertNew(hash, key, keyArena(), std::forward<Args>(args)...);
+  }
+
+  template <class Pair>
+  std::pair<iterator, bool> insert(Pair&& value) {
+    return emplace(value.first, std::forward<Pair>(value).second);
+  }
+
+  size_type erase(StringPiece key) {
+    auto index = findIndex(key, hashOf(key));
+    if (index == capacity_) {
+      return 0;
+    }
+    slots_[index].~Slot();
+    // Move back the entries after it that are not at their home slot
+    // already, so that probes never have to skip holes.
+    auto mask = capacity_ - 1;
+    auto hole = index;
+    for (auto next = (hole + 1) & mask; hashes_[next] != 0;
+         next = (next + 1) & mask) {
+      auto home = hashes_[next] & mask;
+      // Can the entry at next move to the hole, i.e. is its home slot
+      // not in (hole, next], cyclically?
+      bool movable = hole < next ? (home <= hole || home > next)
+                                 : (home <= hole && home > next);
+      if (movable) {
+        new (&slots_[hole]) Slot(std::move(slots_[next]));
+        slots_[next].~Slot();
+        hashes_[hole] = hashes_[next];
+        hole = next;
+      }
+    }
+    hashes_[hole] = 0;
+    --size_;
+    return 1;
+  }
+
+  // Also releases the memory of all keys
+  void clear() {
+    destroySlots();
+    hashes_.reset();
+    slots_ = nullptr;
+    capacity_ = 0;
+    size_ = 0;
+    keys_.reset();
+  }
+
+  // Makes room for n entries without growing the table
+  void reserve(size_type n) {
+    if (n > maxSize(capacity_)) {
+      size_t capacity = std::max(capacity_, kMinCapacity);
+      while (n > maxSize(capacity)) {
+        capacity *= 2;
+      }
+      grow(capacity);
+    }
+  }
+
+  // Bytes used by the table and the arena of long keys
+  size_t memoryUsage() const {
+    return sizeof(*this) + capacity_ * (sizeof(uint32_t) + sizeof(Slot)) +
+        (keys_ ? keys_->totalSize() : 0);
+  }
+
+ private:
+  static constexpr size_t kMinCapacity = 8;
+  // Hashes are stored with this bit set, so that 0 marks empty slots
+  static constexpr uint32_t kOccupied = uint32_t(1) << 31;
+
+  static size_t maxSize(size_t capacity) {
+    return capacity - capacity / 4;
+  }
+
+  // Constructs the slot of a key known to be absent; the table must have
+  // room for it.
+  template <class... Args>
+  std::pair<iterator, bool> insertNew(uint32_t hash, Args&&... args) {
+    auto index = hash & (capacity_ - 1);
+    while (hashes_[index] != 0) {
+      index = (index + 1) & (capacity_ - 1);
+    }
+    new (&slots_[index]) Slot(std::forward<Args>(args)...);
+    hashes_[index] = hash;
+    ++size_;
+    return std::make_pair(iterator(this, index), true);
+  }
+
+  SysArena& keyArena() {
+    if (!keys_) {
+      keys_.reset(new SysArena(kKeyBlockSize, SysArena::kNoSizeLimit, 1));
+    }
+    return *keys_;
+  }
+
+  uint32_t hashOf(StringPiece key) const {
+    return static_cast<uint32_t>(hash_(key)) | kOccupied;
+  }
+
+  size_t findIndex(StringPiece key, uint32_t hash) const {
+    if (size_ == 0) {
+      return capacity_;
+    }
+    auto mask = capacity_ - 1;
+    for (auto index = hash & mask; hashes_[index] != 0;
+         index = (index + 1) & mask) {
+      if (hashes_[index] == hash && slots_[index].key.str() == key) {
+        return index;
+      }
+    }
+    return capacity_;
+  }
+
+  size_t nextOccupied(size_t index) const {
+    while (index < capacity_ && hashes_[index] == 0) {
+      ++index;
+    }
+    return index;
+  }
+
+  void grow(size_t capacity) {
+    if (capacity > size_t(kOccupied)) {
+      throw std::length_error("StringKeyedArenaMap: too many entries");
+    }
+    std::unique_ptr<uint32_t[]> hashes(new uint32_t[capacity]());
+    Slot* slots = std::allocator<Slot>().allocate(capacity);
+    auto mask = capacity - 1;
+    for (size_t i = 0; i < capacity_; ++i) {
+      if (hashes_[i] == 0) {
+        continue;
+      }
+      auto index = hashes_[i] & mask;
+      while (hashes[index] != 0) {
+        index = (index + 1) & mask;
+      }
+      new (&slots[index]) Slot(std::move(slots_[i]));
+      slots_[i].~Slot();
+      hashes[index] = hashes_[i];
+    }
+    if (slots_) {
+      std::allocator<Slot>().deallocate(slots_, capacity_);
+    }
+    hashes_ = std::move(hashes);
+    slots_ = slots;
+    capacity_ = capacity;
+  }
+
+  void destroySlots() {
+    if (!slots_) {
+      return;
+    }
+    for (size_t i = 0; i < capacity_; ++i) {
+      if (hashes_[i] != 0) {
+        slots_[i].~Slot();
+      }
+    }
+    std::allocator<Slot>().deallocate(slots_, capacity_);
+  }
+
+  hasher hash_;
+  std::unique_ptr<uint32_t[]> hashes_; // 0 for empty slots
+  Slot* slots_;
+  size_t capacity_; // a power of two, or 0
+  size_t size_;
+  std::unique_ptr<SysArena> keys_; // created on first insert
+};
+
+template <class Value, class Hash>
+constexpr size_t StringKeyedArenaMap<Value, Hash>::kKeyBlockSize;
+
+template <class Value, class Hash>
+constexpr size_t StringKeyedArenaMap<Value, Hash>::kMinCapacity;
+
+template <class Value, class Hash>
+constexpr uint32_t StringKeyedArenaMap<Value, Hash>::kOccupied;
+
+template <class Value, class Hash>
+void swap(StringKeyedArenaMap<Value, Hash>& a,
+          StringKeyedArenaMap<Value, Hash>& b) noexcept {
+  a.swap(b);
+}
+
+} // folly
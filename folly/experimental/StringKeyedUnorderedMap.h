@@ -32,6 +32,9 @@ namespace folly {
  *
  * It uses kind of hack: string pointed by StringPiece is copied when
  * StringPiece is inserted into map
+ *
+ * For very large maps of short keys, see StringKeyedArenaMap, which
+ * avoids allocating each key separately.
  */
 template <class Value,
           class Hash = StringPieceHash,
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Compiler support detection for coroutines.
+ *
+ * folly itself is built as C++14, so everything under folly/experimental/coro
+ * is only available when the including translation unit is compiled with
+ * coroutine support (C++20 <coroutine>, or the Coroutines TS via
+ * <experimental/coroutine>). Check FOLLY_HAS_COROUTINES before using it.
+ */
+
+#if defined(__has_include)
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define FOLLY_HAS_COROUTINES 1
+#define FOLLY_CORO_NAMESPACE std
+#elif defined(__cpp_coroutines) && __has_include(<experimental/coroutine>)
+#include <experimental/coroutine>
+#define FOLLY_HAS_COROUTINES 1
+#define FOLLY_CORO_NAMESPACE std::experimental
+#endif
+#endif
+
+#ifndef FOLLY_HAS_COROUTINES
+#define FOLLY_HAS_COROUTINES 0
+#endif
+
+#if FOLLY_HAS_COROUTINES
+
+namespace folly {
+namespace coro {
+
+using FOLLY_CORO_NAMESPACE::coroutine_handle;
+using FOLLY_CORO_NAMESPACE::suspend_always;
+using FOLLY_CORO_NAMESPACE::suspend_never;
+
+} // coro
+} // folly
+
+#endif // FOLLY_HAS_COROUTINES
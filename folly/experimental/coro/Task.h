@@ -0,0 +1,423 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/experimental/coro/Coroutine.h>
+
+#if FOLLY_HAS_COROUTINES
+
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+#include <folly/Executor.h>
+#include <folly/Optional.h>
+#include <folly/Try.h>
+#include <folly/Unit.h>
+#include <folly/experimental/coro/detail/FrameAllocator.h>
+#include <folly/futures/Future.h>
+#include <folly/futures/Promise.h>
+
+/**
+ * Task<T> is a lazily started coroutine producing a T (or an exception).
+ *
+ *   Task<int> fetch(int key) {
+ *     auto value = co_await client.get(key);  // any Future<T>
+ *     co_return value.size();
+ *   }
+ *
+ *   Task<int> twice(int key) {
+ *     co_return (co_await fetch(key)) * 2;   // symmetric transfer, no hop
+ *   }
+ *
+ *   Future<int> f = twice(42).scheduleOn(executor).toFuture();
+ *
+ * Nothing runs until the Task is either co_awaited from another coroutine or
+ * converted to a Future with toFuture(). Awaiting a Task from another Task
+ * transfers control directly to the child frame and back again without going
+ * through an executor, unless the child was explicitly scheduled on a
+ * different executor. An unscheduled child inherits its parent's executor.
+ *
+ * co_await on a Future<T> suspends until the future completes; the coroutine
+ * is then resumed via its executor if it has one, or inline in the thread
+ * that fulfilled the promise otherwise.
+ *
+ * Coroutine frames are allocated from a per-thread size-class cache (see
+ * detail/FrameAllocator.h), so steady-state chains of Tasks don't hit malloc.
+ */
+
+namespace folly {
+namespace coro {
+
+template <typename T>
+class Task;
+
+namespace detail {
+
+template <typename T>
+class TaskPromise;
+
+template <typename T>
+class TaskAwaiter;
+
+template <typename T>
+class FutureAwaiter;
+
+class TaskPromiseBase : public FramePooled {
+ public:
+  suspend_always initial_suspend() noexcept {
+    return {};
+  }
+
+  class FinalAwaiter {
+   public:
+    bool await_ready() noexcept {
+      return false;
+    }
+
+    template <typename Promise>
+    coroutine_handle<> await_suspend(coroutine_handle<Promise> h) noexcept {
+      auto& promise = h.promise();
+      auto continuation = promise.continuation_;
+      auto continuationExecutor = promise.continuationExecutor_;
+      if (!continuation) {
+        return FOLLY_CORO_NAMESPACE::noop_coroutine();
+      }
+      if (continuationExecutor &&
+          continuationExecutor != promise.executor_) {
+        // Hop back to the awaiting coroutine's executor. Nothing in this
+        // frame may be touched once add() returns, as the continuation may
+        // already be running and may destroy it.
+        continuationExecutor->add([continuation] { continuation.resume(); });
+        return FOLLY_CORO_NAMESPACE::noop_coroutine();
+      }
+      return continuation;
+    }
+
+    void await_resume() noexcept {}
+  };
+
+  FinalAwaiter final_suspend() noexcept {
+    return {};
+  }
+
+  template <typename U>
+  TaskAwaiter<U> await_transform(Task<U>&& task) noexcept;
+
+  template <typename U>
+  FutureAwaiter<U> await_transform(Future<U>&& future) noexcept;
+
+  template <typename Awaitable>
+  Awaitable&& await_transform(Awaitable&& awaitable) noexcept {
+    return static_cast<Awaitable&&>(awaitable);
+  }
+
+  Executor* getExecutor() const {
+    return executor_;
+  }
+
+ private:
+  template <typename>
+  friend class folly::coro::Task;
+  template <typename>
+  friend class TaskAwaiter;
+
+  coroutine_handle<> continuation_;
+  Executor* executor_{nullptr};
+  Executor* continuationExecutor_{nullptr};
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+ public:
+  using StorageType = typename Unit::Lift<T>::type;
+
+  Task<T> get_return_object() noexcept;
+
+  void unhandled_exception() noexcept {
+    result_ = Try<StorageType>(exception_wrapper(std::current_exception()));
+  }
+
+  template <
+      typename U,
+      typename = typename std::enable_if<
+          std::is_convertible<U&&, StorageType>::value>::type>
+  void return_value(U&& value) {
+    result_ = Try<StorageType>(StorageType(std::forward<U>(value)));
+  }
+
+  Try<StorageType>& result() {
+    return result_;
+  }
+
+ private:
+  Try<StorageType> result_;
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+ public:
+  using StorageType = Unit;
+
+  Task<void> get_return_object() noexcept;
+
+  void unhandled_exception() noexcept {
+    result_ = Try<Unit>(exception_wrapper(std::current_exception()));
+  }
+
+  void return_void() noexcept {
+    result_ = Try<Unit>(unit);
+  }
+
+  Try<Unit>& result() {
+    return result_;
+  }
+
+ private:
+  Try<Unit> result_;
+};
+
+/// Awaiter for a Task. Owns the child frame for the duration of the await.
+template <typename T>
+class TaskAwaiter {
+  using Handle = coroutine_handle<TaskPromise<T>>;
+
+ public:
+  using StorageType = typename TaskPromise<T>::StorageType;
+
+  TaskAwaiter(Handle handle, Executor* parentExecutor) noexcept
+      : handle_(handle), parentExecutor_(parentExecutor) {}
+
+  TaskAwaiter(TaskAwaiter&& other) noexcept
+      : handle_(std::exchange(other.handle_, {})),
+        parentExecutor_(other.parentExecutor_) {}
+
+  TaskAwaiter(const TaskAwaiter&) = delete;
+  TaskAwaiter& operator=(const TaskAwaiter&) = delete;
+  TaskAwaiter& operator=(TaskAwaiter&&) = delete;
+
+  ~TaskAwaiter() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  bool await_ready() noexcept {
+    return false;
+  }
+
+  coroutine_handle<> await_suspend(coroutine_handle<> continuation) noexcept {
+    auto& promise = handle_.promise();
+    promise.continuation_ = continuation;
+    promise.continuationExecutor_ = parentExecutor_;
+    if (!promise.executor_) {
+      promise.executor_ = parentExecutor_;
+    }
+    if (promise.executor_ == parentExecutor_) {
+      return handle_;
+    }
+    auto handle = handle_;
+    promise.executor_->add([handle] { handle.resume(); });
+    return FOLLY_CORO_NAMESPACE::noop_coroutine();
+  }
+
+  T await_resume() {
+    return resume(std::is_void<T>());
+  }
+
+  /// Like await_resume(), but returns the Try instead of throwing.
+  Try<StorageType> await_resume_try() {
+    return std::move(handle_.promise().result());
+  }
+
+ private:
+  T resume(std::false_type) {
+    return std::move(handle_.promise().result().value());
+  }
+
+  void resume(std::true_type) {
+    handle_.promise().result().throwIfFailed();
+  }
+
+  Handle handle_;
+  Executor* parentExecutor_;
+};
+
+/// Awaiter that yields a Try<T> rather than rethrowing.
+template <typename T>
+class TryTaskAwaiter : public TaskAwaiter<T> {
+ public:
+  using TaskAwaiter<T>::TaskAwaiter;
+
+  Try<typename TaskAwaiter<T>::StorageType> await_resume() {
+    return this->await_resume_try();
+  }
+};
+
+/// Awaiter for a folly::Future.
+template <typename T>
+class FutureAwaiter {
+ public:
+  FutureAwaiter(Future<T>&& future, Executor* executor) noexcept
+      : future_(std::move(future)), executor_(executor) {}
+
+  bool await_ready() {
+    return future_.isReady();
+  }
+
+  void await_suspend(coroutine_handle<> h) {
+    auto executor = executor_;
+    future_.setCallback_([this, h, executor](Try<T>&& t) mutable {
+      result_ = std::move(t);
+      if (executor) {
+        executor->add([h] { h.resume(); });
+      } else {
+        h.resume();
+      }
+    });
+  }
+
+  T await_resume() {
+    if (!result_) {
+      result_ = std::move(future_.getTry());
+    }
+    return std::move(result_->value());
+  }
+
+ private:
+  Future<T> future_;
+  Executor* executor_;
+  Optional<Try<T>> result_;
+};
+
+template <typename U>
+TaskAwaiter<U> TaskPromiseBase::await_transform(Task<U>&& task) noexcept {
+  return TaskAwaiter<U>(std::exchange(task.handle_, {}), executor_);
+}
+
+template <typename U>
+FutureAwaiter<U> TaskPromiseBase::await_transform(
+    Future<U>&& future) noexcept {
+  return FutureAwaiter<U>(std::move(future), executor_);
+}
+
+/// Fire-and-forget coroutine used to bridge a Task into a Promise.
+struct DetachedTask {
+  struct promise_type : FramePooled {
+    DetachedTask get_return_object() noexcept {
+      return {};
+    }
+    suspend_never initial_suspend() noexcept {
+      return {};
+    }
+    suspend_never final_suspend() noexcept {
+      return {};
+    }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept {
+      std::terminate();
+    }
+  };
+};
+
+} // detail
+
+template <typename T>
+class Task {
+ public:
+  using promise_type = detail::TaskPromise<T>;
+  using StorageType = typename promise_type::StorageType;
+
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  /// Start this Task on the given executor once it is awaited or converted
+  /// to a Future. The coroutine keeps resuming on that executor after
+  /// awaiting Futures.
+  Task scheduleOn(Executor* executor) && {
+    handle_.promise().executor_ = executor;
+    return std::move(*this);
+  }
+
+  /// Start the Task and return a Future for its result. If the Task was not
+  /// scheduled on an executor it starts running inline in this thread.
+  Future<StorageType> toFuture() && {
+    Promise<StorageType> promise;
+    auto future = promise.getFuture();
+    launch(std::move(*this), std::move(promise));
+    return future;
+  }
+
+  /// Await the result as a Try<T> instead of rethrowing exceptions.
+  detail::TryTaskAwaiter<T> co_awaitTry() && {
+    return detail::TryTaskAwaiter<T>(std::exchange(handle_, {}), nullptr);
+  }
+
+  /// Used when a Task is awaited from a coroutine other than another Task.
+  detail::TaskAwaiter<T> operator co_await() && {
+    return detail::TaskAwaiter<T>(std::exchange(handle_, {}), nullptr);
+  }
+
+ private:
+  friend class detail::TaskPromise<T>;
+  friend class detail::TaskPromiseBase;
+
+  explicit Task(coroutine_handle<promise_type> handle) noexcept
+      : handle_(handle) {}
+
+  static detail::DetachedTask launch(Task task, Promise<StorageType> promise) {
+    promise.setTry(co_await std::move(task).co_awaitTry());
+  }
+
+  coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+  return Task<T>(coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+  return Task<void>(coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+} // detail
+
+} // coro
+} // folly
+
+#endif // FOLLY_HAS_COROUTINES
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include <folly/Portability.h>
+
+namespace folly {
+namespace coro {
+namespace detail {
+
+/**
+ * Per-thread cache of coroutine frames, bucketed by size class.
+ *
+ * Coroutine frames for a given call site always have the same size, so a
+ * handful of small free lists absorbs nearly all frame allocations on a
+ * request path. Frames freed on a different thread than the one that
+ * allocated them simply migrate to the freeing thread's cache. Frames larger
+ * than the biggest size class go straight to the global allocator, and so
+ * do frames allocated or freed after the thread's cache has been destroyed
+ * (e.g. by the destructor of another thread_local).
+ */
+class FrameCache {
+ public:
+  static constexpr size_t kGranularity = 64;
+  static constexpr size_t kNumClasses = 32;
+  static constexpr size_t kMaxCachedPerClass = 128;
+
+  FrameCache() = default;
+  FrameCache(const FrameCache&) = delete;
+  FrameCache& operator=(const FrameCache&) = delete;
+
+  ~FrameCache() {
+    for (size_t i = 0; i < kNumClasses; ++i) {
+      while (heads_[i]) {
+        auto node = heads_[i];
+        heads_[i] = node->next;
+        ::operator delete(node);
+      }
+    }
+  }
+
+  void* allocate(size_t size) {
+    auto cls = sizeClass(size);
+    if (cls >= kNumClasses) {
+      return ::operator new(size);
+    }
+    if (auto node = heads_[cls]) {
+      heads_[cls] = node->next;
+      --counts_[cls];
+      return node;
+    }
+    return ::operator new((cls + 1) * kGranularity);
+  }
+
+  void deallocate(void* ptr, size_t size) noexcept {
+    auto cls = sizeClass(size);
+    if (cls >= kNumClasses || counts_[cls] >= kMaxCachedPerClass) {
+      ::operator delete(ptr);
+      return;
+    }
+    auto node = static_cast<FreeNode*>(ptr);
+    node->next = heads_[cls];
+    heads_[cls] = node;
+    ++counts_[cls];
+  }
+
+ private:
+  struct FreeNode {
+    FreeNode* next;
+  };
+
+  static size_t sizeClass(size_t size) {
+    return (size - 1) / kGranularity;
+  }
+
+  FreeNode* heads_[kNumClasses] = {};
+  uint32_t counts_[kNumClasses] = {};
+};
+
+/// The calling thread's cache, or null once it has been destroyed.
+inline FrameCache* frameCache() {
+  // Trivially destructible, so still readable after the cache is gone
+  static FOLLY_TLS bool destroyed = false;
+  struct ThreadCache : FrameCache {
+    ~ThreadCache() {
+      destroyed = true;
+    }
+  };
+  if (destroyed) {
+    return nullptr;
+  }
+  static thread_local ThreadCache cache;
+  return &cache;
+}
+
+inline void* allocateFrame(size_t size) {
+  if (auto cache = frameCache()) {
+    return cache->allocate(size);
+  }
+  return ::operator new(size);
+}
+
+inline void deallocateFrame(void* ptr, size_t size) noexcept {
+  if (auto cache = frameCache()) {
+    cache->deallocate(ptr, size);
+  } else {
+    ::operator delete(ptr);
+  }
+}
+
+/// Mix-in for promise types whose coroutine frames should come from the
+/// per-thread frame cache.
+struct FramePooled {
+  static void* operator new(size_t size) {
+    return allocateFrame(size);
+  }
+
+  static void operator delete(void* ptr, size_t size) noexcept {
+    deallocateFrame(ptr, size);
+  }
+};
+
+} // detail
+} // coro
+} // folly
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/experimental/coro/Task.h>
+#include <folly/futures/Future.h>
+#include <folly/portability/GFlags.h>
+
+using namespace folly;
+
+#if FOLLY_HAS_COROUTINES
+
+using folly::coro::Task;
+
+namespace {
+
+int incr(int x) {
+  return x + 1;
+}
+
+void futureChain(size_t iters, size_t depth) {
+  for (size_t i = 0; i < iters; ++i) {
+    Promise<int> p;
+    auto f = p.getFuture();
+    for (size_t j = 0; j < depth; ++j) {
+      f = f.then(incr);
+    }
+    p.setValue(0);
+    doNotOptimizeAway(f.value());
+  }
+}
+
+Task<int> leaf() {
+  co_return 0;
+}
+
+Task<int> coroChainImpl(size_t depth) {
+  if (depth == 0) {
+    co_return co_await leaf();
+  }
+  co_return incr(co_await coroChainImpl(depth - 1));
+}
+
+void coroChain(size_t iters, size_t depth) {
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(coroChainImpl(depth).toFuture().value());
+  }
+}
+
+void coroAwaitFutures(size_t iters, size_t depth) {
+  for (size_t i = 0; i < iters; ++i) {
+    Promise<int> p;
+    auto task = [&p](size_t n) -> Task<int> {
+      int x = co_await p.getFuture();
+      for (size_t j = 0; j < n; ++j) {
+        x = incr(co_await makeFuture(x));
+      }
+      co_return x;
+    }(depth);
+    auto f = std::move(task).toFuture();
+    p.setValue(0);
+    doNotOptimizeAway(f.value());
+  }
+}
+
+} // namespace
+
+BENCHMARK(futureThenChain_1, iters) {
+  futureChain(iters, 1);
+}
+
+BENCHMARK_RELATIVE(coroTaskChain_1, iters) {
+  coroChain(iters, 1);
+}
+
+BENCHMARK_RELATIVE(coroAwaitReadyFutures_1, iters) {
+  coroAwaitFutures(iters, 1);
+}
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(futureThenChain_4, iters) {
+  futureChain(iters, 4);
+}
+
+BENCHMARK_RELATIVE(coroTaskChain_4, iters) {
+  coroChain(iters, 4);
+}
+
+BENCHMARK_RELATIVE(coroAwaitReadyFutures_4, iters) {
+  coroAwaitFutures(iters, 4);
+}
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(futureThenChain_16, iters) {
+  futureChain(iters, 16);
+}
+
+BENCHMARK_RELATIVE(coroTaskChain_16, iters) {
+  coroChain(iters, 16);
+}
+
+BENCHMARK_RELATIVE(coroAwaitReadyFutures_16, iters) {
+  coroAwaitFutures(iters, 16);
+}
+
+#endif // FOLLY_HAS_COROUTINES
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
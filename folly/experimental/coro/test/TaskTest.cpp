@@ -0,0 +1,203 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/coro/Task.h>
+
+#if FOLLY_HAS_COROUTINES
+
+#include <thread>
+#include <vector>
+
+#include <folly/futures/ManualExecutor.h>
+#include <gtest/gtest.h>
+
+using namespace folly;
+using namespace folly::coro;
+
+namespace {
+
+Task<int> answer() {
+  co_return 42;
+}
+
+Task<int> addOne(Task<int> task) {
+  co_return (co_await std::move(task)) + 1;
+}
+
+Task<void> throwing() {
+  throw std::runtime_error("oops");
+  co_return;
+}
+
+Task<int> fromFuture(Future<int> f) {
+  co_return (co_await std::move(f)) * 2;
+}
+
+Task<Executor*> currentExecutor() {
+  struct GetExecutor {
+    bool await_ready() {
+      return false;
+    }
+    bool await_suspend(
+        coroutine_handle<folly::coro::detail::TaskPromise<Executor*>> h) {
+      executor = h.promise().getExecutor();
+      return false;
+    }
+    Executor* await_resume() {
+      return executor;
+    }
+    Executor* executor{nullptr};
+  };
+  co_return co_await GetExecutor();
+}
+
+} // namespace
+
+TEST(Task, lazy) {
+  bool started = false;
+  // The frame refers to the lambda's captures, so the lambda must outlive
+  // the task
+  auto start = [&]() -> Task<int> {
+    started = true;
+    co_return 1;
+  };
+  auto task = start();
+  EXPECT_FALSE(started);
+  EXPECT_EQ(1, std::move(task).toFuture().get());
+  EXPECT_TRUE(started);
+}
+
+TEST(Task, chain) {
+  auto f = addOne(addOne(answer())).toFuture();
+  ASSERT_TRUE(f.isReady());
+  EXPECT_EQ(44, f.value());
+}
+
+TEST(Task, exception) {
+  auto f = throwing().toFuture();
+  ASSERT_TRUE(f.isReady());
+  EXPECT_THROW(f.value(), std::runtime_error);
+
+  auto rethrow = []() -> Task<int> {
+    co_await throwing();
+    co_return 1;
+  };
+  EXPECT_THROW(rethrow().toFuture().value(), std::runtime_error);
+
+  auto catching = []() -> Task<bool> {
+    auto t = co_await throwing().co_awaitTry();
+    co_return t.hasException();
+  };
+  EXPECT_TRUE(catching().toFuture().value());
+}
+
+TEST(Task, awaitFuture) {
+  Promise<int> p;
+  auto f = fromFuture(p.getFuture()).toFuture();
+  EXPECT_FALSE(f.isReady());
+  p.setValue(21);
+  ASSERT_TRUE(f.isReady());
+  EXPECT_EQ(42, f.value());
+
+  EXPECT_EQ(10, fromFuture(makeFuture(5)).toFuture().value());
+  EXPECT_THROW(
+      fromFuture(makeFuture<int>(std::logic_error("bad"))).toFuture().value(),
+      std::logic_error);
+}
+
+TEST(Task, scheduleOn) {
+  ManualExecutor x;
+  auto f = addOne(answer()).scheduleOn(&x).toFuture();
+  EXPECT_FALSE(f.isReady());
+  x.run();
+  ASSERT_TRUE(f.isReady());
+  EXPECT_EQ(43, f.value());
+}
+
+TEST(Task, inheritsExecutor) {
+  ManualExecutor x;
+  auto outer = []() -> Task<Executor*> {
+    co_return co_await currentExecutor();
+  };
+  auto f = outer().scheduleOn(&x).toFuture();
+  x.run();
+  EXPECT_EQ(&x, f.value());
+}
+
+TEST(Task, resumesOnExecutorAfterFuture) {
+  ManualExecutor x;
+  Promise<int> p;
+  auto f = fromFuture(p.getFuture()).scheduleOn(&x).toFuture();
+  x.run();
+  EXPECT_FALSE(f.isReady());
+
+  std::thread([&] { p.setValue(1); }).join();
+  EXPECT_FALSE(f.isReady());
+  x.run();
+  ASSERT_TRUE(f.isReady());
+  EXPECT_EQ(2, f.value());
+}
+
+TEST(Task, hopsBetweenExecutors) {
+  ManualExecutor outerX;
+  ManualExecutor innerX;
+  auto outer = [&]() -> Task<int> {
+    co_return co_await answer().scheduleOn(&innerX);
+  };
+  auto f = outer().scheduleOn(&outerX).toFuture();
+  EXPECT_EQ(1, outerX.run());
+  EXPECT_EQ(1, innerX.run());
+  EXPECT_FALSE(f.isReady());
+  EXPECT_EQ(1, outerX.run());
+  ASSERT_TRUE(f.isReady());
+  EXPECT_EQ(42, f.value());
+}
+
+TEST(Task, deepChain) {
+  struct Recurse {
+    static Task<int> run(int n) {
+      if (n == 0) {
+        co_return 0;
+      }
+      co_return (co_await run(n - 1)) + 1;
+    }
+  };
+  EXPECT_EQ(10000, Recurse::run(10000).toFuture().value());
+}
+
+TEST(Task, frameCacheReusesFrames) {
+  folly::coro::detail::FrameCache cache;
+  void* a = cache.allocate(100);
+  cache.deallocate(a, 100);
+  EXPECT_EQ(a, cache.allocate(120));
+  cache.deallocate(a, 120);
+  void* big = cache.allocate(1 << 20);
+  cache.deallocate(big, 1 << 20);
+}
+
+TEST(Task, frameFreedAfterThreadCache) {
+  // Constructed before the thread's frame cache, so destroyed after it;
+  // the frame it frees then must bypass the cache.
+  struct Holder {
+    std::vector<Task<int>> tasks;
+  };
+  std::thread([] {
+    static thread_local Holder holder;
+    holder.tasks.push_back(answer());
+  }).join();
+}
+
+#endif // FOLLY_HAS_COROUTINES
@@ -0,0 +1,248 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* override-include-guard */
+#ifndef HAZPTR_H
+#error "This should only be included by hazptr.h"
+#endif
+
+#include <folly/Likely.h>
+#include <folly/Portability.h>
+#include <folly/detail/CacheLocality.h>
+#include <folly/experimental/AsymmetricMemoryBarrier.h>
+
+namespace folly {
+namespace hazptr {
+
+/** hazptr_rec: Private class that contains hazard pointers. */
+class FOLLY_ALIGN_TO_AVOID_FALSE_SHARING hazptr_rec {
+  friend class hazptr_domain;
+  friend class hazptr_holder;
+  friend struct hazptr_tc;
+
+  std::atomic<const void*> hazptr_ = {nullptr};
+  hazptr_rec* next_ = {nullptr};
+  std::atomic<bool> active_ = {false};
+
+  void set(const void* p) noexcept {
+    hazptr_.store(p, std::memory_order_relaxed);
+  }
+
+  const void* get() const noexcept {
+    return hazptr_.load(std::memory_order_acquire);
+  }
+
+  void clear() noexcept {
+    hazptr_.store(nullptr, std::memory_order_release);
+  }
+
+  bool isActive() noexcept {
+    return active_.load(std::memory_order_acquire);
+  }
+
+  bool tryAcquire() noexcept {
+    bool active = isActive();
+    return !active &&
+        active_.compare_exchange_strong(
+            active, true, std::memory_order_release, std::memory_order_relaxed);
+  }
+
+  void release() noexcept {
+    active_.store(false, std::memory_order_release);
+  }
+};
+
+/**
+ * Per-thread cache of hazard pointers for the default domain, so that
+ * holders are constructed and destroyed without touching shared state.
+ * Trivial, so that it can live in FOLLY_TLS storage; hazptr.cpp returns
+ * cached records to the domain when the thread exits.
+ */
+struct hazptr_tc {
+  static constexpr int kCapacity = 4;
+
+  hazptr_rec* entries[kCapacity];
+  int count;
+  bool registered;
+
+  static hazptr_tc& instance() {
+    return tls_;
+  }
+
+  /// Installs the thread exit hook that flushes the cache.
+  static void registerThread();
+  /// Returns all cached records to the default domain.
+  static void flush();
+
+  static FOLLY_TLS hazptr_tc tls_;
+};
+
+/** hazptr_domain */
+
+inline void hazptr_domain::objRetire(hazptr_obj* p) {
+  pushRetired(p, p, 1);
+  tryBulkReclaim();
+}
+
+inline void hazptr_domain::pushRetired(
+    hazptr_obj* head,
+    hazptr_obj* tail,
+    int count) {
+  tail->next_ = retired_.load(std::memory_order_acquire);
+  while (!retired_.compare_exchange_weak(
+      tail->next_,
+      head,
+      std::memory_order_release,
+      std::memory_order_acquire)) {
+  }
+  rcount_.fetch_add(count, std::memory_order_release);
+}
+
+inline void hazptr_domain::tryBulkReclaim() {
+  int hcount = hcount_.load(std::memory_order_acquire);
+  int rcount = rcount_.load(std::memory_order_acquire);
+  if (rcount < kScanThreshold || rcount < kScanMultiplier * hcount) {
+    return;
+  }
+  // Only the thread that resets the count scans for this batch
+  if (!rcount_.compare_exchange_strong(
+          rcount, 0, std::memory_order_release, std::memory_order_relaxed)) {
+    return;
+  }
+  bulkReclaim();
+}
+
+/** hazptr_obj_base */
+
+template <typename T, typename D>
+inline void hazptr_obj_base<T, D>::retire(hazptr_domain& domain, D deleter) {
+  deleter_ = std::move(deleter);
+  reclaim_ = [](hazptr_obj* p) {
+    auto hobp = static_cast<hazptr_obj_base*>(p);
+    auto obj = static_cast<T*>(hobp);
+    hobp->deleter_(obj);
+  };
+  domain.objRetire(this);
+}
+
+/** hazptr_holder */
+
+namespace detail {
+
+// Hazard pointers hold the address of the hazptr_obj subobject, which is
+// what the domain sees on retirement; it differs from the object's address
+// when T has other bases laid out before it.
+template <typename T>
+inline const void* hazptrKey(const T* ptr, std::true_type) noexcept {
+  return static_cast<const hazptr_obj*>(ptr);
+}
+
+template <typename T>
+inline const void* hazptrKey(const T* ptr, std::false_type) noexcept {
+  return ptr;
+}
+
+template <typename T>
+inline const void* hazptrKey(const T* ptr) noexcept {
+  return hazptrKey(ptr, std::is_base_of<hazptr_obj, T>());
+}
+
+} // namespace detail
+
+inline hazptr_holder::hazptr_holder(hazptr_domain& domain)
+    : domain_(&domain) {
+  auto& tc = hazptr_tc::instance();
+  if (LIKELY(domain_ == &default_hazptr_domain() && tc.count > 0)) {
+    hazptr_ = tc.entries[--tc.count];
+  } else {
+    hazptr_ = domain_->hazptrAcquire();
+  }
+}
+
+inline hazptr_holder::~hazptr_holder() {
+  if (!hazptr_) {
+    return;
+  }
+  hazptr_->clear();
+  auto& tc = hazptr_tc::instance();
+  if (LIKELY(
+          domain_ == &default_hazptr_domain() &&
+          tc.count < hazptr_tc::kCapacity)) {
+    if (UNLIKELY(!tc.registered)) {
+      hazptr_tc::registerThread();
+    }
+    tc.entries[tc.count++] = hazptr_;
+  } else {
+    domain_->hazptrRelease(hazptr_);
+  }
+}
+
+inline hazptr_holder::hazptr_holder(hazptr_holder&& other) noexcept
+    : domain_(other.domain_), hazptr_(other.hazptr_) {
+  other.hazptr_ = nullptr;
+}
+
+inline hazptr_holder& hazptr_holder::operator=(hazptr_holder&& other) noexcept {
+  hazptr_holder tmp(std::move(other));
+  swap(tmp);
+  return *this;
+}
+
+template <typename T>
+inline bool hazptr_holder::try_protect(
+    T*& ptr,
+    const std::atomic<T*>& src) noexcept {
+  auto p = ptr;
+  reset(p);
+  // Pairs with the heavy barrier in bulkReclaim(): either the scan sees
+  // this hazard pointer, or the load below sees that p was unlinked.
+  asymmetricLightBarrier();
+  ptr = src.load(std::memory_order_acquire);
+  if (UNLIKELY(p != ptr)) {
+    reset();
+    return false;
+  }
+  return true;
+}
+
+template <typename T>
+inline T* hazptr_holder::get_protected(const std::atomic<T*>& src) noexcept {
+  T* p = src.load(std::memory_order_relaxed);
+  while (!try_protect(p, src)) {
+  }
+  return p;
+}
+
+template <typename T>
+inline void hazptr_holder::reset(const T* ptr) noexcept {
+  hazptr_->set(detail::hazptrKey(ptr));
+}
+
+inline void hazptr_holder::reset(std::nullptr_t) noexcept {
+  hazptr_->clear();
+}
+
+inline void hazptr_holder::swap(hazptr_holder& other) noexcept {
+  std::swap(domain_, other.domain_);
+  std::swap(hazptr_, other.hazptr_);
+}
+
+inline void swap(hazptr_holder& lhs, hazptr_holder& rhs) noexcept {
+  lhs.swap(rhs);
+}
+
+} // namespace hazptr
+} // namespace folly
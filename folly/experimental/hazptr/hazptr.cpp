@@ -0,0 +1,170 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/hazptr/hazptr.h>
+
+#include <new>
+#include <unordered_set>
+
+#include <folly/portability/Memory.h>
+
+namespace folly {
+namespace hazptr {
+
+constexpr int hazptr_domain::kScanThreshold;
+constexpr int hazptr_domain::kScanMultiplier;
+constexpr int hazptr_tc::kCapacity;
+
+namespace {
+
+// Constant-initialized, so that it is usable from other static
+// initializers; its records are never freed, since thread caches may still
+// refer to them during shutdown.
+hazptr_domain defaultDomain;
+
+} // namespace
+
+hazptr_domain& default_hazptr_domain() {
+  return defaultDomain;
+}
+
+FOLLY_TLS hazptr_tc hazptr_tc::tls_;
+
+namespace {
+
+struct HazptrThreadExit {
+  ~HazptrThreadExit() {
+    hazptr_tc::flush();
+  }
+};
+
+thread_local HazptrThreadExit threadExit;
+
+} // namespace
+
+void hazptr_tc::flush() {
+  for (int i = 0; i < tls_.count; ++i) {
+    default_hazptr_domain().hazptrRelease(tls_.entries[i]);
+  }
+  tls_.count = 0;
+  // Not re-registered: records cached by holders destroyed later in
+  // thread teardown stay in use, at most kCapacity of them
+  tls_.registered = true;
+}
+
+void hazptr_tc::registerThread() {
+  // Touching the thread_local registers its destructor
+  (void)&threadExit;
+  tls_.registered = true;
+}
+
+hazptr_domain::~hazptr_domain() {
+  auto retired = retired_.exchange(nullptr, std::memory_order_acquire);
+  while (retired) {
+    // Reclaiming an object may retire more
+    while (retired) {
+      auto next = retired->next_;
+      retired->reclaim_(retired);
+      retired = next;
+    }
+    retired = retired_.exchange(nullptr, std::memory_order_acquire);
+  }
+  rcount_.store(0, std::memory_order_relaxed);
+  if (this == &defaultDomain) {
+    return;
+  }
+  auto rec = hazptrs_.exchange(nullptr, std::memory_order_acquire);
+  while (rec) {
+    auto next = rec->next_;
+    rec->~hazptr_rec();
+    folly::detail::aligned_free(rec);
+    rec = next;
+  }
+}
+
+void hazptr_domain::try_reclaim() {
+  rcount_.store(0, std::memory_order_release);
+  bulkReclaim();
+}
+
+hazptr_rec* hazptr_domain::hazptrAcquire() {
+  hazptr_rec* p;
+  for (p = hazptrs_.load(std::memory_order_acquire); p; p = p->next_) {
+    if (p->tryAcquire()) {
+      return p;
+    }
+  }
+  // Over-aligned, so plain operator new won't do before C++17
+  auto mem =
+      folly::detail::aligned_malloc(sizeof(hazptr_rec), alignof(hazptr_rec));
+  if (!mem) {
+    throw std::bad_alloc();
+  }
+  p = new (mem) hazptr_rec;
+  p->active_.store(true, std::memory_order_relaxed);
+  p->next_ = hazptrs_.load(std::memory_order_acquire);
+  while (!hazptrs_.compare_exchange_weak(
+      p->next_, p, std::memory_order_release, std::memory_order_acquire)) {
+  }
+  hcount_.fetch_add(1, std::memory_order_relaxed);
+  return p;
+}
+
+void hazptr_domain::hazptrRelease(hazptr_rec* p) noexcept {
+  p->clear();
+  p->release();
+}
+
+void hazptr_domain::bulkReclaim() {
+  // Detach first: reclaiming an object may retire others.
+  auto p = retired_.exchange(nullptr, std::memory_order_acquire);
+  if (!p) {
+    return;
+  }
+  // Either a reader's hazard pointer is visible below, or its validating
+  // load observes that the object was unlinked before it was retired.
+  asymmetricHeavyBarrier();
+  std::unordered_set<const void*> hs;
+  for (auto h = hazptrs_.load(std::memory_order_acquire); h; h = h->next_) {
+    auto ptr = h->get();
+    if (ptr) {
+      hs.insert(ptr);
+    }
+  }
+  int rcount = 0;
+  hazptr_obj* retired = nullptr;
+  hazptr_obj* tail = nullptr;
+  while (p) {
+    auto next = p->next_;
+    if (hs.count(p) == 0) {
+      p->reclaim_(p);
+    } else {
+      p->next_ = retired;
+      retired = p;
+      if (!tail) {
+        tail = p;
+      }
+      ++rcount;
+    }
+    p = next;
+  }
+  if (tail) {
+    pushRetired(retired, tail, rcount);
+  }
+}
+
+} // namespace hazptr
+} // namespace folly
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#define HAZPTR_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+/**
+ * Hazard pointers: safe memory reclamation for lock-free data structures.
+ *
+ * A reader that wants to dereference a shared pointer first publishes it
+ * in a hazard pointer it owns (hazptr_holder) and then re-checks that the
+ * pointer is still current. A writer that unlinks an object retires it;
+ * the domain destroys retired objects once no hazard pointer refers to
+ * them.
+ *
+ * Unlike epoch or RCU schemes, a stalled reader pins at most the objects
+ * it protects, so the number of retired-but-unreclaimed objects stays
+ * bounded: O(number of hazard pointers) after each scan.
+ *
+ * Costs:
+ *   - Protecting a pointer is a store, asymmetricLightBarrier() (a compiler
+ *     barrier on Linux) and a load to validate it.
+ *   - Constructing and destroying a holder in the default domain reuses
+ *     hazard pointers cached per thread, so it never touches shared state
+ *     in the common case.
+ *   - Retiring is a push onto a lock-free list. Once enough objects have
+ *     been retired (at least kScanThreshold, and at least kScanMultiplier
+ *     times the number of hazard pointers), one retiring thread scans all
+ *     hazard pointers after an asymmetricHeavyBarrier() and reclaims every
+ *     unprotected object, so the scan cost is amortized over the batch.
+ *
+ * Usage:
+ *
+ *   struct Node : hazptr_obj_base<Node> {
+ *     int value;
+ *     std::atomic<Node*> next;
+ *   };
+ *
+ *   // Reader
+ *   hazptr_holder h;
+ *   Node* node = h.get_protected(head_);
+ *   if (node) {
+ *     use(node->value);  // node can't be reclaimed while h protects it
+ *   }
+ *
+ *   // Writer, after unlinking node
+ *   node->retire();
+ */
+
+namespace folly {
+namespace hazptr {
+
+class hazptr_domain;
+class hazptr_obj;
+template <typename T, typename Deleter>
+class hazptr_obj_base;
+class hazptr_holder;
+class hazptr_rec;
+
+/** Get the default hazptr_domain */
+hazptr_domain& default_hazptr_domain();
+
+/** Definition of hazptr_domain */
+class hazptr_domain {
+ public:
+  /// Retired objects a domain accumulates before it scans.
+  static constexpr int kScanThreshold = 1000;
+  /// A scan also waits for this many retired objects per hazard pointer,
+  /// so that each one reclaims a constant fraction of what it examines.
+  static constexpr int kScanMultiplier = 2;
+
+  constexpr explicit hazptr_domain() noexcept {}
+
+  /// Reclaims everything retired to the domain. No hazard pointer of this
+  /// domain may be in use.
+  ~hazptr_domain();
+
+  hazptr_domain(const hazptr_domain&) = delete;
+  hazptr_domain(hazptr_domain&&) = delete;
+  hazptr_domain& operator=(const hazptr_domain&) = delete;
+  hazptr_domain& operator=(hazptr_domain&&) = delete;
+
+  /// Scans now, reclaiming every retired object that isn't protected.
+  void try_reclaim();
+
+ private:
+  template <typename, typename>
+  friend class hazptr_obj_base;
+  friend class hazptr_holder;
+  friend struct hazptr_tc;
+
+  std::atomic<hazptr_rec*> hazptrs_ = {nullptr};
+  std::atomic<hazptr_obj*> retired_ = {nullptr};
+  std::atomic<int> hcount_ = {0};
+  std::atomic<int> rcount_ = {0};
+
+  void objRetire(hazptr_obj*);
+  hazptr_rec* hazptrAcquire();
+  void hazptrRelease(hazptr_rec*) noexcept;
+  void pushRetired(hazptr_obj* head, hazptr_obj* tail, int count);
+  void tryBulkReclaim();
+  void bulkReclaim();
+};
+
+/** Definition of hazptr_obj */
+class hazptr_obj {
+  friend class hazptr_domain;
+  template <typename, typename>
+  friend class hazptr_obj_base;
+
+  void (*reclaim_)(hazptr_obj*);
+  hazptr_obj* next_;
+};
+
+/** Definition of hazptr_obj_base */
+template <typename T, typename D = std::default_delete<T>>
+class hazptr_obj_base : public hazptr_obj {
+ public:
+  /// Hands the object over to domain, which calls deleter(this) once no
+  /// hazard pointer protects it. The object must already be unreachable
+  /// for new readers.
+  void retire(hazptr_domain& domain = default_hazptr_domain(), D deleter = {});
+
+ private:
+  D deleter_;
+};
+
+/** hazptr_holder: Class for automatic acquisition and release of
+ *  hazard pointers, and interface for hazard pointer operations.
+ *  A holder owns one hazard pointer for its whole lifetime. */
+class hazptr_holder {
+ public:
+  explicit hazptr_holder(hazptr_domain& domain = default_hazptr_domain());
+  ~hazptr_holder();
+
+  hazptr_holder(const hazptr_holder&) = delete;
+  hazptr_holder& operator=(const hazptr_holder&) = delete;
+  hazptr_holder(hazptr_holder&&) noexcept;
+  hazptr_holder& operator=(hazptr_holder&&) noexcept;
+
+  /// Protects ptr, then checks that src still holds it. On failure, ptr
+  /// is updated to the current value of src and nothing is protected.
+  template <typename T>
+  bool try_protect(T*& ptr, const std::atomic<T*>& src) noexcept;
+
+  /// Loops on try_protect() until it succeeds; returns the protected value.
+  template <typename T>
+  T* get_protected(const std::atomic<T*>& src) noexcept;
+
+  /// Protects ptr without validation; the caller must know it is still
+  /// reachable (e.g. because another hazard pointer protects its owner).
+  template <typename T>
+  void reset(const T* ptr) noexcept;
+
+  /// Protects nothing.
+  void reset(std::nullptr_t = nullptr) noexcept;
+
+  void swap(hazptr_holder&) noexcept;
+
+ private:
+  hazptr_domain* domain_;
+  hazptr_rec* hazptr_;
+};
+
+void swap(hazptr_holder&, hazptr_holder&) noexcept;
+
+} // namespace hazptr
+} // namespace folly
+
+#include <folly/experimental/hazptr/hazptr-impl.h>
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/hazptr/hazptr.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include <folly/Benchmark.h>
+#include <folly/detail/EpochReclamation.h>
+#include <folly/portability/GFlags.h>
+
+using namespace folly::hazptr;
+
+namespace {
+
+struct Obj : hazptr_obj_base<Obj> {
+  int value = 1;
+};
+
+std::atomic<Obj*> current{new Obj};
+std::shared_ptr<Obj> currentShared = std::make_shared<Obj>();
+std::mutex mutex;
+
+} // namespace
+
+// Read-side cost of each way to safely dereference a shared object.
+
+BENCHMARK(hazptr_holder_and_protect, iters) {
+  int sum = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    hazptr_holder h;
+    sum += h.get_protected(current)->value;
+  }
+  folly::doNotOptimizeAway(sum);
+}
+
+BENCHMARK_RELATIVE(epoch_guard, iters) {
+  int sum = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    folly::detail::EpochGuard g;
+    sum += current.load(std::memory_order_acquire)->value;
+  }
+  folly::doNotOptimizeAway(sum);
+}
+
+BENCHMARK_RELATIVE(shared_ptr_atomic_load, iters) {
+  int sum = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    auto p = std::atomic_load(&currentShared);
+    sum += p->value;
+  }
+  folly::doNotOptimizeAway(sum);
+}
+
+BENCHMARK_RELATIVE(mutex_lock, iters) {
+  int sum = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    std::lock_guard<std::mutex> g(mutex);
+    sum += current.load(std::memory_order_relaxed)->value;
+  }
+  folly::doNotOptimizeAway(sum);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(hazptr_retire, iters) {
+  hazptr_domain domain;
+  for (size_t i = 0; i < iters; ++i) {
+    (new Obj)->retire(domain);
+  }
+}
+
+BENCHMARK_RELATIVE(delete_directly, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    auto p = new Obj;
+    folly::doNotOptimizeAway(p);
+    delete p;
+  }
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
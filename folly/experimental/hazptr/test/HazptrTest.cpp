@@ -0,0 +1,234 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/hazptr/hazptr.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace folly::hazptr;
+
+namespace {
+
+std::atomic<int> liveNodes{0};
+
+struct Node : hazptr_obj_base<Node> {
+  explicit Node(int v, Node* n = nullptr) : value(v), next(n) {
+    ++liveNodes;
+  }
+  ~Node() {
+    --liveNodes;
+  }
+
+  int value;
+  Node* next;
+};
+
+struct CountingDeleter {
+  template <typename T>
+  void operator()(T* node) {
+    ++calls();
+    delete node;
+  }
+
+  static std::atomic<int>& calls() {
+    static std::atomic<int> n{0};
+    return n;
+  }
+};
+
+struct CountedNode : hazptr_obj_base<CountedNode, CountingDeleter> {};
+
+// Classic Treiber stack, with hazard pointers guarding pop()
+class LockFreeStack {
+ public:
+  explicit LockFreeStack(hazptr_domain& domain) : domain_(domain) {}
+
+  ~LockFreeStack() {
+    auto node = head_.load();
+    while (node) {
+      auto next = node->next;
+      delete node;
+      node = next;
+    }
+  }
+
+  void push(int v) {
+    auto node = new Node(v, head_.load());
+    while (!head_.compare_exchange_weak(node->next, node)) {
+    }
+  }
+
+  bool pop(int& v) {
+    hazptr_holder h(domain_);
+    for (;;) {
+      auto node = h.get_protected(head_);
+      if (!node) {
+        return false;
+      }
+      // node->next can be read safely because h protects node
+      if (head_.compare_exchange_weak(node, node->next)) {
+        h.reset();
+        v = node->value;
+        node->retire(domain_);
+        return true;
+      }
+    }
+  }
+
+ private:
+  hazptr_domain& domain_;
+  std::atomic<Node*> head_{nullptr};
+};
+
+} // namespace
+
+TEST(Hazptr, ProtectedNotReclaimed) {
+  hazptr_domain domain;
+  std::atomic<Node*> src{new Node(7)};
+  {
+    hazptr_holder h(domain);
+    auto node = h.get_protected(src);
+    EXPECT_EQ(7, node->value);
+    src.store(nullptr);
+    node->retire(domain);
+    domain.try_reclaim();
+    EXPECT_EQ(1, liveNodes.load());
+    EXPECT_EQ(7, node->value);
+  }
+  domain.try_reclaim();
+  EXPECT_EQ(0, liveNodes.load());
+}
+
+TEST(Hazptr, TryProtectFailure) {
+  hazptr_domain domain;
+  Node a(1), b(2);
+  std::atomic<Node*> src{&a};
+  hazptr_holder h(domain);
+  Node* p = &b;
+  EXPECT_FALSE(h.try_protect(p, src));
+  EXPECT_EQ(&a, p);
+  EXPECT_TRUE(h.try_protect(p, src));
+  EXPECT_EQ(&a, p);
+}
+
+TEST(Hazptr, CustomDeleter) {
+  CountingDeleter::calls() = 0;
+  hazptr_domain domain;
+  for (int i = 0; i < 10; ++i) {
+    (new CountedNode)->retire(domain);
+  }
+  domain.try_reclaim();
+  EXPECT_EQ(10, CountingDeleter::calls().load());
+}
+
+TEST(Hazptr, DomainDestructorReclaims) {
+  {
+    hazptr_domain domain;
+    for (int i = 0; i < 10; ++i) {
+      (new Node(i))->retire(domain);
+    }
+    EXPECT_EQ(10, liveNodes.load());
+  }
+  EXPECT_EQ(0, liveNodes.load());
+}
+
+TEST(Hazptr, HolderMoveAndSwap) {
+  hazptr_domain domain;
+  std::atomic<Node*> src1{new Node(1)};
+  std::atomic<Node*> src2{new Node(2)};
+  hazptr_holder h1(domain);
+  hazptr_holder h2(domain);
+  auto n1 = h1.get_protected(src1);
+  auto n2 = h2.get_protected(src2);
+  swap(h1, h2);
+  hazptr_holder h3(std::move(h1));
+  h1 = std::move(h2);
+
+  src1.store(nullptr);
+  src2.store(nullptr);
+  n1->retire(domain);
+  n2->retire(domain);
+  domain.try_reclaim();
+  EXPECT_EQ(2, liveNodes.load());
+
+  h3.reset();
+  domain.try_reclaim();
+  EXPECT_EQ(1, liveNodes.load());
+  EXPECT_EQ(1, n1->value);
+  h1.reset();
+  domain.try_reclaim();
+  EXPECT_EQ(0, liveNodes.load());
+}
+
+TEST(Hazptr, BoundedRetiredList) {
+  // Retired objects never pile up beyond the scan threshold, even though
+  // nothing calls try_reclaim().
+  hazptr_domain domain;
+  for (int i = 0; i < 100 * hazptr_domain::kScanThreshold; ++i) {
+    (new Node(i))->retire(domain);
+    ASSERT_LE(liveNodes.load(), hazptr_domain::kScanThreshold);
+  }
+}
+
+TEST(Hazptr, DefaultDomainHolderCache) {
+  std::atomic<Node*> src{new Node(3)};
+  for (int i = 0; i < 100; ++i) {
+    hazptr_holder h1;
+    hazptr_holder h2;
+    EXPECT_EQ(3, h1.get_protected(src)->value);
+    EXPECT_EQ(3, h2.get_protected(src)->value);
+  }
+  src.load()->retire();
+  default_hazptr_domain().try_reclaim();
+  EXPECT_EQ(0, liveNodes.load());
+}
+
+TEST(Hazptr, ConcurrentStack) {
+  constexpr int kThreads = 4;
+  constexpr int kOps = 20000;
+  {
+    hazptr_domain domain;
+    LockFreeStack stack(domain);
+    std::atomic<long> pushed{0};
+    std::atomic<long> popped{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t] {
+        for (int i = 0; i < kOps; ++i) {
+          int v = t * kOps + i;
+          stack.push(v);
+          pushed += v;
+          if (stack.pop(v)) {
+            popped += v;
+          }
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    int v;
+    while (stack.pop(v)) {
+      popped += v;
+    }
+    EXPECT_EQ(pushed.load(), popped.load());
+  }
+  EXPECT_EQ(0, liveNodes.load());
+}
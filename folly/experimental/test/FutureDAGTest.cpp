@@ -272,3 +272,51 @@ TEST_F(FutureDAGTest, DestroyBeforeComplete) {
   barrier->wait();
   ASSERT_NO_THROW(f.get());
 }
+
+struct PriorityRecordingExecutor : public Executor {
+  void add(Func f) override {
+    f();
+  }
+
+  void addWithPriority(Func f, int8_t priority) override {
+    priorities.push_back(priority);
+    f();
+  }
+
+  uint8_t getNumPriorities() const override {
+    return 3;
+  }
+
+  std::vector<int8_t> priorities;
+};
+
+TEST_F(FutureDAGTest, CriticalPathPriority) {
+  PriorityRecordingExecutor executor;
+  auto h1 = dag->add(makeFutureFunc, &executor, 10);
+  auto h2 = dag->add(makeFutureFunc, &executor, 10);
+  auto h3 = dag->add(makeFutureFunc, &executor, 1);
+  dag->dependency(h1, h2);
+  ASSERT_NO_THROW(dag->go().get());
+
+  EXPECT_EQ(1, dag->priority(h1));
+  EXPECT_EQ(0, dag->priority(h2));
+  EXPECT_EQ(-1, dag->priority(h3));
+  auto& priorities = executor.priorities;
+  EXPECT_EQ(1, std::count(priorities.begin(), priorities.end(), 1));
+  EXPECT_EQ(1, std::count(priorities.begin(), priorities.end(), -1));
+}
+
+TEST_F(FutureDAGTest, CriticalPathLatency) {
+  auto sleepFunc = [] { return futures::sleep(std::chrono::milliseconds(10)); };
+  auto A = dag->add(sleepFunc);
+  auto B = dag->add(makeFutureFunc);
+  auto C = dag->add(makeFutureFunc);
+  auto D = dag->add(makeFutureFunc);
+  dag->dependency(A, B);
+  dag->dependency(B, C);
+  ASSERT_NO_THROW(dag->go().get());
+
+  EXPECT_GE(dag->latency(A), std::chrono::milliseconds(10));
+  EXPECT_LT(dag->latency(D), std::chrono::milliseconds(10));
+  EXPECT_EQ(std::vector<FutureDAG::Handle>({A, B, C}), dag->criticalPath());
+}
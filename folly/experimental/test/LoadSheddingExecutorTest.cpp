@@ -0,0 +1,145 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/LoadSheddingExecutor.h>
+
+#include <atomic>
+#include <thread>
+
+#include <folly/futures/Future.h>
+#include <folly/futures/InlineExecutor.h>
+#include <folly/futures/ManualExecutor.h>
+#include <gtest/gtest.h>
+
+using namespace folly;
+using namespace std::chrono;
+
+TEST(LoadSheddingExecutor, runsTasks) {
+  ManualExecutor x;
+  LoadSheddingExecutor executor(&x);
+  int ran = 0;
+  executor.add([&] { ran++; });
+  executor.addWithDeadline(
+      [&] { ran++; }, LoadSheddingExecutor::Clock::now() + seconds(60), [] {
+        FAIL();
+      });
+  EXPECT_EQ(0, ran);
+  x.run();
+  EXPECT_EQ(2, ran);
+  EXPECT_EQ(0, executor.getNumShed());
+  EXPECT_EQ(2, executor.getSojournTimes().count(3));
+}
+
+TEST(LoadSheddingExecutor, expiredDeadline) {
+  ManualExecutor x;
+  LoadSheddingExecutor executor(&x);
+  bool ran = false;
+  bool shed = false;
+  executor.addWithDeadline(
+      [&] { ran = true; },
+      LoadSheddingExecutor::Clock::now() - milliseconds(1),
+      [&] { shed = true; });
+  x.run();
+  EXPECT_FALSE(ran);
+  EXPECT_TRUE(shed);
+  EXPECT_EQ(1, executor.getNumShed());
+}
+
+TEST(LoadSheddingExecutor, shedsWhenBehind) {
+  ManualExecutor x;
+  LoadSheddingExecutor::Options options;
+  options.targetDelay = milliseconds(1);
+  options.interval = milliseconds(50);
+  LoadSheddingExecutor executor(&x, options);
+
+  auto deadline = LoadSheddingExecutor::Clock::now() + seconds(60);
+  std::vector<int> ran;
+  std::vector<int> shed;
+  for (int i = 0; i < 3; i++) {
+    executor.addWithDeadline(
+        [&, i] {
+          ran.push_back(i);
+          if (i == 0) {
+            // Fall behind for longer than the interval.
+            /* sleep override */
+            std::this_thread::sleep_for(milliseconds(60));
+          }
+        },
+        deadline,
+        [&, i] { shed.push_back(i); });
+  }
+  /* sleep override */
+  std::this_thread::sleep_for(milliseconds(2));
+  x.run();
+
+  // The first late task starts the interval, the next one after it is shed,
+  // and then shedding backs off until the following interval.
+  EXPECT_EQ(std::vector<int>({0, 2}), ran);
+  EXPECT_EQ(std::vector<int>({1}), shed);
+  EXPECT_EQ(1, executor.getNumShed());
+}
+
+TEST(LoadSheddingExecutor, plainTasksNeverShed) {
+  ManualExecutor x;
+  LoadSheddingExecutor::Options options;
+  options.targetDelay = milliseconds(1);
+  options.interval = milliseconds(1);
+  LoadSheddingExecutor executor(&x, options);
+
+  int ran = 0;
+  for (int i = 0; i < 3; i++) {
+    executor.add([&] {
+      ran++;
+      /* sleep override */
+      std::this_thread::sleep_for(milliseconds(2));
+    });
+  }
+  x.run();
+  EXPECT_EQ(3, ran);
+  EXPECT_EQ(0, executor.getNumShed());
+}
+
+TEST(LoadSheddingExecutor, futures) {
+  ManualExecutor x;
+  LoadSheddingExecutor executor(&x);
+  auto f = via(&executor).then([] { return 42; });
+  x.run();
+  EXPECT_EQ(42, f.value());
+}
+
+TEST(LoadSheddingExecutor, concurrentRuns) {
+  InlineExecutor x;
+  LoadSheddingExecutor executor(&x);
+  std::atomic<int> ran{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 1000; i++) {
+        executor.addWithDeadline(
+            [&] { ran++; },
+            LoadSheddingExecutor::Clock::now() + seconds(60),
+            [] { FAIL(); });
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(4000, ran.load());
+  EXPECT_EQ(0, executor.getNumShed());
+  // Samples still sitting in the stripes are included
+  EXPECT_EQ(4000, executor.getSojournTimes().count(3));
+}
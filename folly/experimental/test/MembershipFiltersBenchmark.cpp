@@ -0,0 +1,152 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/MembershipFilters.h>
+
+#include <memory>
+#include <unordered_set>
+
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+
+DEFINE_int32(keys, 950000, "Number of keys in each filter");
+
+using folly::BlockedBloomFilter;
+using folly::CuckooFilter;
+
+namespace {
+
+// Keys [0, keys) are present, [keys, 2 * keys) are not
+std::unordered_set<uint64_t> set;
+std::unique_ptr<BlockedBloomFilter> bloom8;
+std::unique_ptr<BlockedBloomFilter> bloom10;
+std::unique_ptr<BlockedBloomFilter> bloom16;
+std::unique_ptr<CuckooFilter> cuckoo;
+
+void initBenchmarks() {
+  uint64_t n = FLAGS_keys;
+  bloom8.reset(new BlockedBloomFilter(n, 8));
+  bloom10.reset(new BlockedBloomFilter(n, 10));
+  bloom16.reset(new BlockedBloomFilter(n, 16));
+  cuckoo.reset(new CuckooFilter(n));
+  for (uint64_t i = 0; i < n; ++i) {
+    set.insert(i);
+    bloom8->add(i);
+    bloom10->add(i);
+    bloom16->add(i);
+    cuckoo->add(i);
+  }
+}
+
+// Half of the lookups are for present keys, in a random-looking order
+template <class Container>
+size_t lookups(const Container& c, size_t iters) {
+  size_t found = 0;
+  uint64_t n = FLAGS_keys;
+  for (size_t i = 0; i < iters; ++i) {
+    uint64_t key = (i * 0x9e3779b97f4a7c15ULL) % (2 * n);
+    found += c.count(key);
+  }
+  return found;
+}
+
+template <class Filter>
+struct AsCount {
+  const Filter& filter;
+  size_t count(uint64_t key) const {
+    return filter.mayContain(key);
+  }
+};
+
+template <class Filter>
+size_t filterLookups(const Filter& filter, size_t iters) {
+  return lookups(AsCount<Filter>{filter}, iters);
+}
+
+template <class Filter>
+double falsePositiveRate(const Filter& filter) {
+  size_t falsePositives = 0;
+  uint64_t n = FLAGS_keys;
+  for (uint64_t key = n; key < 2 * n; ++key) {
+    falsePositives += filter.mayContain(key);
+  }
+  return double(falsePositives) / n;
+}
+
+} // namespace
+
+BENCHMARK(unordered_set_lookup, iters) {
+  folly::doNotOptimizeAway(lookups(set, iters));
+}
+
+BENCHMARK_RELATIVE(bloom_8_lookup, iters) {
+  folly::doNotOptimizeAway(filterLookups(*bloom8, iters));
+}
+
+BENCHMARK_RELATIVE(bloom_10_lookup, iters) {
+  folly::doNotOptimizeAway(filterLookups(*bloom10, iters));
+}
+
+BENCHMARK_RELATIVE(bloom_16_lookup, iters) {
+  folly::doNotOptimizeAway(filterLookups(*bloom16, iters));
+}
+
+BENCHMARK_RELATIVE(cuckoo_lookup, iters) {
+  folly::doNotOptimizeAway(filterLookups(*cuckoo, iters));
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(bloom_10_add, iters) {
+  BlockedBloomFilter filter(iters);
+  for (uint64_t i = 0; i < iters; ++i) {
+    filter.add(i);
+  }
+}
+
+BENCHMARK_RELATIVE(bloom_10_addConcurrent, iters) {
+  BlockedBloomFilter filter(iters);
+  for (uint64_t i = 0; i < iters; ++i) {
+    filter.addConcurrent(i);
+  }
+}
+
+BENCHMARK_RELATIVE(cuckoo_add, iters) {
+  CuckooFilter filter(iters);
+  for (uint64_t i = 0; i < iters; ++i) {
+    filter.add(i);
+  }
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  initBenchmarks();
+  folly::runBenchmarks();
+
+  printf("%d keys: false positive rate by size\n", FLAGS_keys);
+  for (double bitsPerKey : {8, 10, 12, 16}) {
+    BlockedBloomFilter bloom(FLAGS_keys, bitsPerKey);
+    for (uint64_t i = 0; i < uint64_t(FLAGS_keys); ++i) {
+      bloom.add(i);
+    }
+    printf("  BlockedBloomFilter %4.1f bits/key  %.4f%%\n",
+           8.0 * bloom.sizeInBytes() / FLAGS_keys,
+           100 * falsePositiveRate(bloom));
+  }
+  printf("  CuckooFilter       %4.1f bits/key  %.4f%%\n",
+         8.0 * cuckoo->sizeInBytes() / FLAGS_keys,
+         100 * falsePositiveRate(*cuckoo));
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/MembershipFilters.h>
+
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <folly/Conv.h>
+
+using folly::BlockedBloomFilter;
+using folly::ByteRange;
+using folly::CuckooFilter;
+using folly::IOBuf;
+
+namespace {
+
+template <class Filter>
+size_t countFalsePositives(const Filter& filter, uint64_t from, size_t n) {
+  size_t count = 0;
+  for (uint64_t i = from; i < from + n; ++i) {
+    count += filter.mayContain(i);
+  }
+  return count;
+}
+
+} // namespace
+
+TEST(BlockedBloomFilter, Basic) {
+  BlockedBloomFilter filter(1000);
+  EXPECT_FALSE(filter.mayContain("foo"));
+  filter.add("foo");
+  filter.add(std::string("bar"));
+  EXPECT_TRUE(filter.mayContain("foo"));
+  EXPECT_TRUE(filter.mayContain(folly::StringPiece("bar")));
+  EXPECT_FALSE(filter.mayContain("baz"));
+  EXPECT_EQ(0, filter.sizeInBytes() % 64);
+}
+
+TEST(BlockedBloomFilter, FalsePositiveRate) {
+  constexpr size_t kKeys = 100000;
+  BlockedBloomFilter filter(kKeys, 10);
+  for (uint64_t i = 0; i < kKeys; ++i) {
+    filter.add(i);
+  }
+  for (uint64_t i = 0; i < kKeys; ++i) {
+    ASSERT_TRUE(filter.mayContain(i)) << i;
+  }
+  // About 1.2% at 10 bits per key
+  EXPECT_LT(countFalsePositives(filter, kKeys, kKeys), kKeys * 2 / 100);
+}
+
+TEST(BlockedBloomFilter, Avx2MatchesScalar) {
+  if (!folly::detail::bloomAvx2Supported()) {
+    return;
+  }
+  using namespace folly::detail;
+  uint32_t scalar[kBloomBlockWords] = {};
+  uint32_t avx2[kBloomBlockWords] = {};
+  for (uint32_t i = 0; i < 1000; ++i) {
+    uint32_t hash = i * 0x9e3779b9;
+    if (i % 3 == 0) {
+      bloomAddScalar(scalar, hash);
+      bloomAddAvx2(avx2, hash);
+      ASSERT_EQ(0, memcmp(scalar, avx2, sizeof(scalar))) << i;
+    }
+    ASSERT_EQ(bloomMayContainScalar(scalar, hash),
+              bloomMayContainAvx2(avx2, hash)) << i;
+  }
+}
+
+TEST(BlockedBloomFilter, Concurrent) {
+  constexpr size_t kThreads = 4;
+  constexpr size_t kKeysPerThread = 10000;
+  BlockedBloomFilter filter(kThreads * kKeysPerThread);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&filter, t] {
+      for (uint64_t i = t; i < kThreads * kKeysPerThread; i += kThreads) {
+        filter.addConcurrent(i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (uint64_t i = 0; i < kThreads * kKeysPerThread; ++i) {
+    ASSERT_TRUE(filter.mayContain(i)) << i;
+  }
+}
+
+TEST(BlockedBloomFilter, ConcurrentReaders) {
+  // Every key below the watermark has been added, so readers racing with
+  // the writer must find it.
+  constexpr uint64_t kKeys = 100000;
+  BlockedBloomFilter filter(kKeys);
+  std::atomic<uint64_t> watermark{0};
+  std::atomic<size_t> misses{0};
+  std::vector<std::thread> readers;
+  for (size_t t = 0; t < 4; ++t) {
+    readers.emplace_back([&] {
+      uint64_t limit;
+      do {
+        limit = watermark.load(std::memory_order_acquire);
+        for (uint64_t i = limit > 100 ? limit - 100 : 0; i < limit; ++i) {
+          if (!filter.mayContainConcurrent(i)) {
+            ++misses;
+          }
+        }
+      } while (limit < kKeys);
+    });
+  }
+  for (uint64_t i = 0; i < kKeys; ++i) {
+    filter.addConcurrent(i);
+    watermark.store(i + 1, std::memory_order_release);
+  }
+  for (auto& thread : readers) {
+    thread.join();
+  }
+  EXPECT_EQ(0, misses.load());
+  for (uint64_t i = 0; i < kKeys; ++i) {
+    ASSERT_TRUE(filter.mayContain(i)) << i;
+  }
+}
+
+TEST(BlockedBloomFilter, Serialize) {
+  BlockedBloomFilter filter(1000);
+  for (int i = 0; i < 1000; ++i) {
+    filter.add(folly::to<std::string>("key", i));
+  }
+  auto buf = filter.serialize();
+  ByteRange data(buf->data(), buf->length());
+
+  auto copy = BlockedBloomFilter::deserialize(data);
+  auto view = BlockedBloomFilter::view(data);
+  EXPECT_EQ(filter.sizeInBytes(), copy.sizeInBytes());
+  for (uint64_t i = 0; i < 2000; ++i) {
+    auto key = folly::to<std::string>("key", i);
+    EXPECT_EQ(filter.mayContain(key), copy.mayContain(key));
+    EXPECT_EQ(filter.mayContain(key), view.mayContain(key));
+  }
+  copy.add("extra");
+  EXPECT_TRUE(copy.mayContain("extra"));
+  EXPECT_THROW(view.add("extra"), std::logic_error);
+  EXPECT_THROW(view.addConcurrent("extra"), std::logic_error);
+
+  EXPECT_THROW(BlockedBloomFilter::deserialize(data.subpiece(0, 16)),
+               std::invalid_argument);
+  EXPECT_THROW(BlockedBloomFilter::deserialize(data.subpiece(0, 100)),
+               std::invalid_argument);
+  EXPECT_THROW(CuckooFilter::deserialize(data), std::invalid_argument);
+}
+
+TEST(CuckooFilter, Basic) {
+  CuckooFilter filter(1000);
+  EXPECT_FALSE(filter.mayContain("foo"));
+  EXPECT_TRUE(filter.add("foo"));
+  EXPECT_TRUE(filter.add("bar"));
+  EXPECT_EQ(2, filter.size());
+  EXPECT_TRUE(filter.mayContain("foo"));
+  EXPECT_TRUE(filter.mayContain("bar"));
+  EXPECT_FALSE(filter.mayContain("baz"));
+
+  EXPECT_TRUE(filter.remove("foo"));
+  EXPECT_FALSE(filter.mayContain("foo"));
+  EXPECT_TRUE(filter.mayContain("bar"));
+  EXPECT_FALSE(filter.remove("foo"));
+  EXPECT_EQ(1, filter.size());
+
+  // Duplicates are counted, and removed one at a time
+  EXPECT_TRUE(filter.add("bar"));
+  EXPECT_TRUE(filter.remove("bar"));
+  EXPECT_TRUE(filter.mayContain("bar"));
+  EXPECT_TRUE(filter.remove("bar"));
+  EXPECT_FALSE(filter.mayContain("bar"));
+  EXPECT_EQ(0, filter.size());
+}
+
+TEST(CuckooFilter, Full) {
+  constexpr size_t kKeys = 100000;
+  CuckooFilter filter(kKeys);
+  for (uint64_t i = 0; i < kKeys; ++i) {
+    ASSERT_TRUE(filter.add(i)) << i;
+  }
+  for (uint64_t i = 0; i < kKeys; ++i) {
+    ASSERT_TRUE(filter.mayContain(i)) << i;
+  }
+  EXPECT_LT(countFalsePositives(filter, kKeys, kKeys), kKeys / 1000);
+
+  // Fill it up; every key that was accepted must still be found
+  uint64_t n = kKeys;
+  while (filter.add(n)) {
+    ++n;
+  }
+  EXPECT_GT(filter.loadFactor(), 0.95);
+  for (uint64_t i = 0; i < n; ++i) {
+    ASSERT_TRUE(filter.mayContain(i)) << i;
+  }
+
+  // Removing keys makes room again
+  for (uint64_t i = 0; i < kKeys / 2; ++i) {
+    ASSERT_TRUE(filter.remove(i)) << i;
+  }
+  EXPECT_EQ(n - kKeys / 2, filter.size());
+  for (uint64_t i = kKeys / 2; i < n; ++i) {
+    ASSERT_TRUE(filter.mayContain(i)) << i;
+  }
+  EXPECT_TRUE(filter.add(n));
+}
+
+TEST(CuckooFilter, Serialize) {
+  CuckooFilter filter(1000);
+  for (uint64_t i = 0; i < 1000; ++i) {
+    filter.add(i);
+  }
+  auto buf = filter.serialize();
+  ByteRange data(buf->data(), buf->length());
+
+  auto copy = CuckooFilter::deserialize(data);
+  auto view = CuckooFilter::view(data);
+  EXPECT_EQ(filter.size(), copy.size());
+  EXPECT_EQ(filter.size(), view.size());
+  for (uint64_t i = 0; i < 2000; ++i) {
+    EXPECT_EQ(filter.mayContain(i), copy.mayContain(i));
+    EXPECT_EQ(filter.mayContain(i), view.mayContain(i));
+  }
+  EXPECT_TRUE(copy.remove(0));
+  EXPECT_TRUE(view.mayContain(0));
+  EXPECT_THROW(view.add(5000), std::logic_error);
+  EXPECT_THROW(view.remove(0), std::logic_error);
+  EXPECT_TRUE(view.mayContain(0));
+
+  EXPECT_THROW(CuckooFilter::view(data.subpiece(1)), std::invalid_argument);
+  EXPECT_THROW(BlockedBloomFilter::view(data), std::invalid_argument);
+}
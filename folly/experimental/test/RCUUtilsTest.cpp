@@ -0,0 +1,164 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <folly/experimental/RCUUtils.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <folly/Baton.h>
+#include <folly/ConcurrentHashMap.h>
+
+using namespace folly;
+
+namespace {
+
+struct Tracked {
+  explicit Tracked(int v) : value(v) {
+    ++live;
+  }
+  ~Tracked() {
+    --live;
+  }
+
+  int value;
+  static std::atomic<int> live;
+};
+
+std::atomic<int> Tracked::live{0};
+
+} // namespace
+
+TEST(RCUUtils, RegisterThread) {
+  std::thread([] {
+    EXPECT_TRUE(RCURegisterThread());
+    EXPECT_FALSE(RCURegisterThread());
+  }).join();
+}
+
+TEST(RCUUtils, NestedReadLock) {
+  std::lock_guard<RCUReadLock> outer(RCUReadLock::instance());
+  std::lock_guard<RCUReadLock> inner(RCUReadLock::instance());
+}
+
+TEST(RCUUtils, SynchronizeWaitsForReaders) {
+  Baton<> entered;
+  Baton<> leave;
+  std::atomic<bool> left{false};
+  std::thread reader([&] {
+    RCUReadLock::lock();
+    entered.post();
+    leave.wait();
+    left = true;
+    RCUReadLock::unlock();
+  });
+  entered.wait();
+
+  std::atomic<bool> synchronized{false};
+  std::thread writer([&] {
+    RCUSynchronize();
+    EXPECT_TRUE(left.load());
+    synchronized = true;
+  });
+  /* sleep override */ std::this_thread::sleep_for(
+      std::chrono::milliseconds(50));
+  EXPECT_FALSE(synchronized.load());
+  leave.post();
+  reader.join();
+  writer.join();
+  EXPECT_TRUE(synchronized.load());
+}
+
+TEST(RCUUtils, RetireDefersToReaders) {
+  std::atomic<Tracked*> current{new Tracked(1)};
+  Baton<> entered;
+  Baton<> leave;
+  std::thread reader([&] {
+    std::lock_guard<RCUReadLock> g(RCUReadLock::instance());
+    auto p = current.load(std::memory_order_acquire);
+    entered.post();
+    leave.wait();
+    EXPECT_EQ(1, p->value);
+  });
+  entered.wait();
+
+  RCURetire(current.exchange(new Tracked(2)));
+  // A full batch of retirements forces collection attempts, but the object
+  // the reader may still hold has to survive them.
+  for (size_t i = 0; i < 4 * detail::EpochDomain::kRetireBatch; ++i) {
+    RCURetire(new Tracked(0));
+  }
+  EXPECT_GE(Tracked::live.load(), 2);
+
+  leave.post();
+  reader.join();
+  RCUSynchronize();
+  EXPECT_EQ(1, Tracked::live.load());
+  delete current.load();
+}
+
+TEST(RCUUtils, CustomDeleter) {
+  int deleted = 0;
+  int x = 0;
+  RCURetire(&x, [&](int* p) {
+    EXPECT_EQ(&x, p);
+    ++deleted;
+  });
+  RCUSynchronize();
+  EXPECT_EQ(1, deleted);
+}
+
+TEST(RCUUtils, ConcurrentReadersAndWriter) {
+  constexpr int kReaders = 4;
+  std::atomic<Tracked*> current{new Tracked(0)};
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < kReaders; ++i) {
+    readers.emplace_back([&] {
+      int last = 0;
+      while (!done.load()) {
+        std::lock_guard<RCUReadLock> g(RCUReadLock::instance());
+        auto value = current.load(std::memory_order_acquire)->value;
+        EXPECT_LE(last, value);
+        last = value;
+      }
+    });
+  }
+  for (int v = 1; v <= 20000; ++v) {
+    RCURetire(current.exchange(new Tracked(v), std::memory_order_acq_rel));
+  }
+  done = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+  RCUSynchronize();
+  EXPECT_EQ(1, Tracked::live.load());
+  delete current.load();
+}
+
+TEST(RCUUtils, IndependentOfConcurrentHashMap) {
+  // Map iterators hold epoch guards of their own domain, which must not
+  // delay RCU grace periods.
+  folly::ConcurrentHashMap<int, int> map;
+  map.insert(1, 1);
+  auto it = map.cbegin();
+  std::thread([] { RCUSynchronize(); }).join();
+  RCUSynchronize();
+  EXPECT_EQ(1, it->first);
+}
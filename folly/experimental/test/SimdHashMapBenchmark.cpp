@@ -0,0 +1,165 @@
+/*
+ * Copyright 2017 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Range.h>
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/experimental/SimdHashMap.h>
+#include <folly/experimental/StringKeyedUnorderedMap.h>
+
+using folly::SimdNodeMap;
+using folly::SimdValueMap;
+using folly::StringKeyedUnorderedMap;
+using folly::StringPiece;
+using std::string;
+using std::to_string;
+using std::unordered_map;
+
+static const size_t kKeys = 100000;
+
+static unordered_map<uint64_t, uint64_t> um;
+static SimdValueMap<uint64_t, uint64_t> svm;
+static SimdNodeMap<uint64_t, uint64_t> snm;
+static unordered_map<string, int> sum;
+static StringKeyedUnorderedMap<int> skum;
+static SimdValueMap<string, int> ssvm;
+static std::vector<uint64_t> hits;
+static std::vector<uint64_t> misses;
+static std::vector<string> strings;
+
+static void initBenchmarks() {
+  std::mt19937_64 rng(1234);
+  for (size_t i = 0; i < kKeys; ++i) {
+    auto k = rng();
+    hits.push_back(k);
+    misses.push_back(rng());
+    um[k] = i;
+    svm[k] = i;
+    snm[k] = i;
+
+    strings.push_back("some/longer/key/" + to_string(k));
+    sum[strings.back()] = i;
+    skum.insert(make_pair(strings.back(), int(i)));
+    ssvm[strings.back()] = i;
+  }
+}
+
+template <class Map>
+static void findHits(Map& map, size_t iters) {
+  uint64_t total = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    total += map.find(hits[i % kKeys])->second;
+  }
+  folly::doNotOptimizeAway(total);
+}
+
+template <class Map>
+static void findMisses(Map& map, size_t iters) {
+  size_t found = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    found += map.count(misses[i % kKeys]);
+  }
+  folly::doNotOptimizeAway(found);
+}
+
+template <class Map>
+static void insertAll(size_t iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    Map map;
+    for (size_t j = 0; j < 1000; ++j) {
+      map[hits[j]] = j;
+    }
+    folly::doNotOptimizeAway(map.size());
+  }
+}
+
+template <class Map>
+static void findStrings(Map& map, size_t iters) {
+  int total = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    total += map.find(StringPiece(strings[i % kKeys]))->second;
+  }
+  folly::doNotOptimizeAway(total);
+}
+
+BENCHMARK(std_unordered_map_find_hit, iters) {
+  findHits(um, iters);
+}
+
+BENCHMARK_RELATIVE(simd_value_map_find_hit, iters) {
+  findHits(svm, iters);
+}
+
+BENCHMARK_RELATIVE(simd_node_map_find_hit, iters) {
+  findHits(snm, iters);
+}
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(std_unordered_map_find_miss, iters) {
+  findMisses(um, iters);
+}
+
+BENCHMARK_RELATIVE(simd_value_map_find_miss, iters) {
+  findMisses(svm, iters);
+}
+
+BENCHMARK_RELATIVE(simd_node_map_find_miss, iters) {
+  findMisses(snm, iters);
+}
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(std_unordered_map_insert_1000, iters) {
+  insertAll<unordered_map<uint64_t, uint64_t>>(iters);
+}
+
+BENCHMARK_RELATIVE(simd_value_map_insert_1000, iters) {
+  insertAll<SimdValueMap<uint64_t, uint64_t>>(iters);
+}
+
+BENCHMARK_RELATIVE(simd_node_map_insert_1000, iters) {
+  insertAll<SimdNodeMap<uint64_t, uint64_t>>(iters);
+}
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(std_unordered_map_find_string, iters) {
+  int total = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    total += sum.find(strings[i % kKeys])->second;
+  }
+  folly::doNotOptimizeAway(total);
+}
+
+BENCHMARK_RELATIVE(sk_unordered_map_find_string, iters) {
+  findStrings(skum, iters);
+}
+
+BENCHMARK_RELATIVE(simd_value_map_find_string, iters) {
+  findStrings(ssvm, iters);
+}
+
+int main(int argc, char **argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  initBenchmarks();
+  folly::runBenchmarks();
+}
@@ -0,0 +1,332 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/experimental/SimdHashMap.h>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <folly/Range.h>
+
+using folly::SimdNodeMap;
+using folly::SimdNodeSet;
+using folly::SimdValueMap;
+using folly::SimdValueSet;
+using folly::StringPiece;
+using std::string;
+
+namespace {
+
+// Counts live instances, to check that every value is destroyed once.
+struct Tracked {
+  static int live;
+
+  explicit Tracked(int v = 0) : value(v) { ++live; }
+  Tracked(const Tracked& other) : value(other.value) { ++live; }
+  Tracked(Tracked&& other) noexcept : value(other.value) { ++live; }
+  Tracked& operator=(const Tracked&) = default;
+  ~Tracked() { --live; }
+
+  bool operator==(const Tracked& other) const {
+    return value == other.value;
+  }
+
+  int value;
+};
+
+int Tracked::live = 0;
+
+// Sends every key to the same chunk, to exercise overflow
+struct BadHash {
+  size_t operator()(int) const { return 0; }
+};
+
+template <class Map>
+class SimdHashMapTest : public ::testing::Test {};
+
+typedef ::testing::Types<SimdValueMap<int, Tracked>,
+                         SimdNodeMap<int, Tracked>,
+                         SimdValueMap<int, Tracked, BadHash>,
+                         SimdNodeMap<int, Tracked, BadHash>>
+    MapTypes;
+TYPED_TEST_CASE(SimdHashMapTest, MapTypes);
+
+}  // namespace
+
+TYPED_TEST(SimdHashMapTest, Basic) {
+  {
+    TypeParam m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.end(), m.find(1));
+    EXPECT_EQ(m.begin(), m.end());
+
+    EXPECT_TRUE(m.emplace(1, Tracked(10)).second);
+    EXPECT_FALSE(m.emplace(1, Tracked(11)).second);
+    EXPECT_TRUE(m.insert(std::make_pair(2, Tracked(20))).second);
+    EXPECT_TRUE(m.try_emplace(3, 30).second);
+    EXPECT_FALSE(m.try_emplace(3, 31).second);
+    m[4].value = 40;
+    EXPECT_EQ(4, m.size());
+
+    EXPECT_EQ(10, m.at(1).value);
+    EXPECT_EQ(20, m.find(2)->second.value);
+    EXPECT_EQ(30, m[3].value);
+    EXPECT_EQ(1, m.count(4));
+    EXPECT_EQ(0, m.count(5));
+    EXPECT_THROW(m.at(5), std::out_of_range);
+
+    EXPECT_FALSE(m.insert_or_assign(1, Tracked(12)).second);
+    EXPECT_EQ(12, m[1].value);
+
+    EXPECT_EQ(1, m.erase(2));
+    EXPECT_EQ(0, m.erase(2));
+    EXPECT_EQ(m.end(), m.find(2));
+    EXPECT_EQ(3, m.size());
+
+    int sum = 0;
+    for (auto& kv : m) {
+      sum += kv.first;
+    }
+    EXPECT_EQ(1 + 3 + 4, sum);
+
+    m.clear();
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.begin(), m.end());
+    EXPECT_EQ(0, Tracked::live);
+    m[7].value = 70;
+    EXPECT_EQ(70, m.at(7).value);
+  }
+  EXPECT_EQ(0, Tracked::live);
+}
+
+TYPED_TEST(SimdHashMapTest, Random) {
+  {
+    std::mt19937 rng(1234);
+    TypeParam m;
+    std::unordered_map<int, int> expected;
+    // fewer keys with BadHash, which makes every operation linear
+    int keys = std::is_same<typename TypeParam::hasher, BadHash>::value
+        ? 300 : 20000;
+    for (int i = 0; i < 10 * keys; ++i) {
+      int key = rng() % keys;
+      switch (rng() % 3) {
+        case 0:
+          m[key].value = i;
+          expected[key] = i;
+          break;
+        case 1:
+          EXPECT_EQ(expected.erase(key), m.erase(key));
+          break;
+        case 2: {
+          auto it = m.find(key);
+          auto eit = expected.find(key);
+          ASSERT_EQ(eit == expected.end(), it == m.end());
+          if (it != m.end()) {
+            EXPECT_EQ(eit->second, it->second.value);
+          }
+          break;
+        }
+      }
+      ASSERT_EQ(expected.size(), m.size());
+    }
+    size_t n = 0;
+    for (auto& kv : m) {
+      EXPECT_EQ(expected.at(kv.first), kv.second.value);
+      ++n;
+    }
+    EXPECT_EQ(expected.size(), n);
+    EXPECT_EQ(expected.size(), Tracked::live);
+  }
+  EXPECT_EQ(0, Tracked::live);
+}
+
+TYPED_TEST(SimdHashMapTest, EraseWhileIterating) {
+  TypeParam m;
+  for (int i = 0; i < 1000; ++i) {
+    m[i].value = i;
+  }
+  for (auto it = m.begin(); it != m.end();) {
+    if (it->first % 3 == 0) {
+      it = m.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  EXPECT_EQ(666, m.size());
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(i % 3 == 0 ? 0 : 1, m.count(i));
+  }
+}
+
+TYPED_TEST(SimdHashMapTest, CopyMoveSwap) {
+  {
+    TypeParam a{{1, Tracked(1)}, {2, Tracked(2)}};
+    TypeParam b(a);
+    EXPECT_EQ(a, b);
+    b[3];
+    EXPECT_NE(a, b);
+    TypeParam c(std::move(b));
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ(3, c.size());
+    b = c;
+    EXPECT_EQ(c, b);
+    a = std::move(c);
+    EXPECT_EQ(3, a.size());
+    a.swap(b);
+    b.erase(3);
+    swap(a, b);
+    EXPECT_EQ(2, a.size());
+    EXPECT_EQ(3, b.size());
+    a.reserve(1000);
+    EXPECT_EQ(2, a.size());
+    EXPECT_EQ(2, a.at(2).value);
+  }
+  EXPECT_EQ(0, Tracked::live);
+}
+
+TEST(SimdHashMap, NodeStability) {
+  SimdNodeMap<int, int> m;
+  m[0] = 42;
+  int* p = &m[0];
+  for (int i = 1; i < 10000; ++i) {
+    m[i] = i;
+  }
+  EXPECT_EQ(p, &m[0]);
+  EXPECT_EQ(42, *p);
+}
+
+TEST(SimdHashMap, MoveOnly) {
+  SimdValueMap<string, std::unique_ptr<int>> m;
+  for (int i = 0; i < 100; ++i) {
+    m.emplace(std::to_string(i), std::make_unique<int>(i));
+  }
+  EXPECT_EQ(42, *m.at("42"));
+}
+
+TEST(SimdHashMap, StringPieceLookup) {
+  SimdValueMap<string, int> m;
+  m["abc"] = 1;
+  string key("abcdef");
+  StringPiece piece(key);
+  EXPECT_EQ(1, m.at(piece.subpiece(0, 3)));
+  EXPECT_EQ(1, m.count(piece.subpiece(0, 3)));
+  EXPECT_EQ(m.end(), m.find(piece));
+  EXPECT_TRUE(m.try_emplace(piece, 2).second);
+  EXPECT_EQ(2, m.at("abcdef"));
+  EXPECT_EQ(1, m.erase(piece));
+  EXPECT_EQ(1, m.size());
+
+  SimdNodeSet<string> s{"x", "y"};
+  EXPECT_EQ(1, s.count(StringPiece("x")));
+  EXPECT_EQ(0, s.count(StringPiece("z")));
+}
+
+namespace {
+
+// A string key that counts how often it is built from a StringPiece
+struct CountedKey : string {
+  static int built;
+
+  CountedKey(const char* data, size_t size) : string(data, size) {
+    ++built;
+  }
+};
+
+int CountedKey::built = 0;
+
+} // namespace
+
+TEST(SimdHashMap, StringPieceKeyBuiltOnlyIfNew) {
+  SimdValueMap<CountedKey, int, folly::SimdHash<StringPiece>,
+               folly::SimdEqualTo<StringPiece>> m;
+  string key(100, 'k');
+  m[StringPiece(key)] = 1;
+  EXPECT_EQ(1, CountedKey::built);
+  for (int i = 0; i < 10; ++i) {
+    ++m[StringPiece(key)];
+    EXPECT_FALSE(m.try_emplace(StringPiece(key), 0).second);
+  }
+  EXPECT_EQ(1, CountedKey::built);
+  EXPECT_EQ(11, m.at(StringPiece(key)));
+}
+
+TEST(SimdHashMap, InsertReferenceToElementWhileGrowing) {
+  SimdValueMap<int, string> m;
+  SimdNodeMap<int, string> n;
+  const string value(64, 'v');
+  m[0] = value;
+  n[0] = value;
+  for (int i = 1; i < 1000; ++i) {
+    // Some of these grow the table, relocating the element passed in
+    m.try_emplace(i, m.at(0));
+    n.try_emplace(i, n.at(i - 1));
+  }
+  for (int i = 1; i < 1000; ++i) {
+    ASSERT_EQ(value, m.at(i)) << i;
+    ASSERT_EQ(value, n.at(i)) << i;
+  }
+}
+
+TEST(SimdHashSet, Basic) {
+  SimdValueSet<int> s;
+  std::unordered_set<int> expected;
+  std::mt19937 rng(1234);
+  for (int i = 0; i < 10000; ++i) {
+    int v = rng() % 1000;
+    EXPECT_EQ(expected.insert(v).second, s.insert(v).second);
+  }
+  EXPECT_EQ(expected.size(), s.size());
+  for (int v : s) {
+    EXPECT_EQ(1, expected.count(v));
+  }
+  EXPECT_EQ(1, s.erase(*expected.begin()));
+  EXPECT_EQ(expected.size() - 1, s.size());
+  EXPECT_LE(s.load_factor(), s.max_load_factor());
+}
+
+TEST(SimdHashSet, ConstIterators) {
+  // Keys can't be changed in place through a set's iterators
+  static_assert(
+      std::is_same<const int&, decltype(*SimdValueSet<int>::iterator())>::value,
+      "set iterators must be const");
+  static_assert(
+      std::is_same<const int&, decltype(*SimdNodeSet<int>::iterator())>::value,
+      "set iterators must be const");
+  static_assert(
+      std::is_same<std::pair<const int, int>&,
+                   decltype(*SimdValueMap<int, int>::iterator())>::value,
+      "map iterators give mutable values");
+
+  SimdNodeSet<std::string> s{"a", "b", "c"};
+  SimdNodeSet<std::string>::iterator it = s.find("b");
+  ASSERT_TRUE(it != s.end());
+  it = s.erase(it);
+  EXPECT_EQ(2, s.size());
+  EXPECT_EQ(0, s.count("b"));
+
+  SimdValueMap<int, int> m{{1, 1}, {2, 2}};
+  SimdValueMap<int, int>::iterator mit = m.find(1);
+  mit->second = 10;
+  m.erase(mit);
+  EXPECT_EQ(1, m.size());
+}
@@ -17,6 +17,7 @@
 
 #include <folly/Benchmark.h>
 #include <folly/Range.h>
+#include <folly/portability/GFlags.h>
 
 #include <map>
 #include <set>
@@ -24,11 +25,13 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include <folly/experimental/StringKeyedArenaMap.h>
 #include <folly/experimental/StringKeyedMap.h>
 #include <folly/experimental/StringKeyedSet.h>
 #include <folly/experimental/StringKeyedUnorderedMap.h>
 #include <folly/experimental/StringKeyedUnorderedSet.h>
 
+using folly::StringKeyedArenaMap;
 using folly::StringKeyedMap;
 using folly::StringKeyedSet;
 using folly::StringKeyedUnorderedMap;
@@ -47,6 +50,7 @@ static set<string> s;
 static StringKeyedSet sks;
 static unordered_map<string, int> um;
 static StringKeyedUnorderedMap<int> skum;
+static StringKeyedArenaMap<int> skam;
 static unordered_set<string> us;
 static StringKeyedUnorderedSet skus;
 static const string lookup("123");
@@ -59,6 +63,7 @@ static void initBenchmarks() {
     skm.insert(make_pair(iStr, i));
     um[iStr] = i;
     skum.insert(make_pair(iStr, i));
+    skam.insert(make_pair(iStr, i));
     s.insert(iStr);
     sks.insert(iStr);
     us.insert(iStr);
@@ -92,6 +97,10 @@ BENCHMARK_RELATIVE(sk_unordered_map_benchmark_find) {
   folly::doNotOptimizeAway(skum.find(lookupPiece)->second);
 }
 
+BENCHMARK_RELATIVE(sk_arena_map_benchmark_find) {
+  folly::doNotOptimizeAway(skam.find(lookupPiece)->second);
+}
+
 BENCHMARK(std_unordered_map_benchmark_erase_emplace) {
   um.erase(lookup);
   um.emplace(lookup, 123);
@@ -102,6 +111,11 @@ BENCHMARK_RELATIVE(sk_unordered_map_benchmark_erase_emplace) {
   skum.emplace(lookup, 123);
 }
 
+BENCHMARK_RELATIVE(sk_arena_map_benchmark_erase_emplace) {
+  skam.erase(lookup);
+  skam.emplace(lookup, 123);
+}
+
 BENCHMARK(std_set_benchmark_find) {
   folly::doNotOptimizeAway(s.find(lookupPiece.str()));
 }
@@ -138,8 +152,64 @@ BENCHMARK_RELATIVE(sk_unordered_set_benchmark_erase_emplace) {
   skus.emplace(lookup);
 }
 
+DEFINE_int32(footprint_keys, 1000000, "Keys in the memory footprint test");
+DEFINE_int32(footprint_key_length, 12, "Average key length, in bytes");
+
+namespace {
+
+size_t footprintBytes = 0;
+size_t footprintAllocations = 0;
+
+// Tallies what StringKeyedUnorderedMap allocates, keys included
+template <class T>
+struct CountingAllocator : std::allocator<T> {
+  template <class U>
+  struct rebind {
+    typedef CountingAllocator<U> other;
+  };
+
+  CountingAllocator() = default;
+  template <class U>
+  /* implicit */ CountingAllocator(const CountingAllocator<U>&) {}
+
+  T* allocate(size_t n, const void* = nullptr) {
+    footprintBytes += n * sizeof(T);
+    ++footprintAllocations;
+    return std::allocator<T>::allocate(n);
+  }
+};
+
+// Keys of length 1 to 2 * FLAGS_footprint_key_length
+string footprintKey(int i) {
+  auto key = to_string(i);
+  key.resize(1 + i % (2 * FLAGS_footprint_key_length), 'k');
+  return key + to_string(i);
+}
+
+void printFootprint() {
+  typedef CountingAllocator<std::pair<const StringPiece, int>> Alloc;
+  StringKeyedUnorderedMap<int, folly::StringPieceHash,
+                          std::equal_to<StringPiece>, Alloc> counted;
+  StringKeyedArenaMap<int> arena;
+  for (int i = 0; i < FLAGS_footprint_keys; ++i) {
+    auto key = footprintKey(i);
+    counted.emplace(key, i);
+    arena.emplace(key, i);
+  }
+  // Requested bytes only: malloc adds its own overhead to each allocation
+  printf("%d keys: StringKeyedUnorderedMap %.1f bytes/key in %zu "
+         "allocations, StringKeyedArenaMap %.1f bytes/key\n",
+         FLAGS_footprint_keys,
+         double(footprintBytes) / FLAGS_footprint_keys,
+         footprintAllocations,
+         double(arena.memoryUsage()) / FLAGS_footprint_keys);
+}
+
+}
+
 int main(int argc, char **argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   initBenchmarks();
   folly::runBenchmarks();
+  printFootprint();
 }
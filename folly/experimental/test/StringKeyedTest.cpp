@@ -15,6 +15,7 @@
  */
 // Copyright 2013-present Facebook. All Rights Reserved.
 
+#include <folly/experimental/StringKeyedArenaMap.h>
 #include <folly/experimental/StringKeyedMap.h>
 #include <folly/experimental/StringKeyedSet.h>
 #include <folly/experimental/StringKeyedUnorderedMap.h>
@@ -22,6 +23,7 @@
 
 #include <list>
 #include <string>
+#include <unordered_map>
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
@@ -29,6 +31,7 @@
 #include <folly/Range.h>
 #include <folly/portability/GFlags.h>
 
+using folly::StringKeyedArenaMap;
 using folly::StringKeyedMap;
 using folly::StringKeyedSetBase;
 using folly::StringKeyedUnorderedMap;
@@ -500,6 +503,127 @@ TEST(StringKeyedMapTest, constructors) {
   EXPECT_EQ(map4.at("key1"), 1);
 }
 
+TEST(StringKeyedArenaMapTest, sanity) {
+  StringKeyedArenaMap<int> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.find("hello") == map.end());
+
+  {
+    string s("hello");
+    string long1("a key that is too long to be stored inline");
+    StringPiece piece(s, 3);
+    EXPECT_TRUE(map.insert(std::make_pair(s, 1)).second);
+    EXPECT_FALSE(map.emplace(s, 2).second);
+    EXPECT_TRUE(map.emplace(piece, 3).second);
+    EXPECT_TRUE(map.emplace(long1, 4).second);
+    EXPECT_TRUE(map.emplace("", 5).second);
+  }
+
+  EXPECT_EQ(4, map.size());
+  EXPECT_EQ(1, map.find("hello")->second);
+  EXPECT_EQ(3, map.at("lo"));
+  EXPECT_EQ(4, map.at("a key that is too long to be stored inline"));
+  EXPECT_EQ(5, map.at(""));
+  EXPECT_THROW(map.at("a key that is too long"), std::out_of_range);
+  EXPECT_EQ(0, map.count("hell"));
+
+  map["lo"] = 30;
+  EXPECT_EQ(30, map.at("lo"));
+  EXPECT_EQ(0, map["new"]);
+
+  EXPECT_EQ(1, map.erase("hello"));
+  EXPECT_EQ(0, map.erase("hello"));
+  EXPECT_EQ(4, map.size());
+
+  int sum = 0;
+  for (auto it = map.cbegin(); it != map.cend(); ++it) {
+    EXPECT_EQ(it->second, map.at(it->first));
+    sum += (*it).second;
+  }
+  EXPECT_EQ(39, sum);
+}
+
+TEST(StringKeyedArenaMapTest, againstUnorderedMap) {
+  StringKeyedArenaMap<string> map;
+  std::unordered_map<string, string> expected;
+  // Keys of all lengths around the inline limit, some erased again
+  for (int i = 0; i < 20000; ++i) {
+    auto key = string(i % 40, 'x') + std::to_string(i % 7919);
+    if (i % 3 == 2) {
+      EXPECT_EQ(expected.erase(key), map.erase(key));
+    } else {
+      auto value = std::to_string(i);
+      EXPECT_EQ(expected.emplace(key, value).second,
+                map.emplace(key, value).second);
+    }
+  }
+  EXPECT_EQ(expected.size(), map.size());
+  for (auto& entry : expected) {
+    auto it = map.find(entry.first);
+    ASSERT_TRUE(it != map.end()) << entry.first;
+    EXPECT_EQ(entry.second, it->second);
+  }
+  size_t n = 0;
+  for (auto entry : map) {
+    EXPECT_EQ(1, expected.count(entry.first.str()));
+    ++n;
+  }
+  EXPECT_EQ(expected.size(), n);
+}
+
+TEST(StringKeyedArenaMapTest, emplaceFromElement) {
+  // Each emplace grows the table, which moves the element the key and the
+  // value are read from.
+  StringKeyedArenaMap<string> map;
+  map.emplace("0", "a value too long for the small string buffer");
+  for (int i = 1; i < 100; ++i) {
+    map.emplace(std::to_string(i), map.at(std::to_string(i - 1)));
+  }
+  EXPECT_EQ("a value too long for the small string buffer", map.at("99"));
+
+  // Keys of up to 15 bytes are stored inline; emplace prefixes of one
+  StringKeyedArenaMap<size_t> keys;
+  const string full = "abcdefghijklmn";
+  keys.emplace(full, full.size());
+  for (size_t len = full.size() - 1; len > 0; --len) {
+    auto key = keys.find(full)->first;
+    EXPECT_TRUE(keys.emplace(key.subpiece(0, len), len).second);
+  }
+  for (size_t len = 1; len <= full.size(); ++len) {
+    EXPECT_EQ(len, keys.at(full.substr(0, len)));
+  }
+}
+
+TEST(StringKeyedArenaMapTest, constructors) {
+  StringKeyedArenaMap<std::unique_ptr<int>> map(100);
+  auto buckets = map.bucket_count();
+  EXPECT_GE(buckets, 100);
+  for (int i = 0; i < 100; ++i) {
+    map.emplace(std::to_string(i) + "-a-rather-long-suffix",
+                std::unique_ptr<int>(new int(i)));
+  }
+  EXPECT_EQ(buckets, map.bucket_count());
+
+  auto map2 = std::move(map);
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(100, map2.size());
+  EXPECT_EQ(42, *map2.at("42-a-rather-long-suffix"));
+  map.emplace("reused", nullptr);
+  EXPECT_EQ(1, map.size());
+
+  StringKeyedArenaMap<int> map3;
+  map3["key1"] = 1;
+  map3["key2 that is not short"] = 2;
+  auto map4 = map3;
+  map3.clear();
+  EXPECT_TRUE(map3.empty());
+  EXPECT_EQ(2, map4.size());
+  EXPECT_EQ(2, map4.at("key2 that is not short"));
+  map3 = map4;
+  EXPECT_EQ(1, map3.at("key1"));
+  EXPECT_LT(map3.memoryUsage(), 1024 * 1024);
+}
+
 int main(int argc, char **argv) {
   FLAGS_logtostderr = true;
   google::InitGoogleLogging(argv[0]);
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <folly/fibers/BoostContextCompatibility.h>
+
+#if FOLLY_FIBERS_USE_ASM_CONTEXT
+
+#include <algorithm>
+
+namespace folly {
+namespace fibers {
+namespace detail {
+
+#if defined(__x86_64__)
+
+/*
+ * System V AMD64: rbx, rbp and r12-r15 are callee-saved. The saved context
+ * is laid out (from the saved stack pointer up) as
+ *   r12 r13 r14 r15 rbx rbp <return address>
+ */
+asm(R"(
+  .text
+  .globl folly_fibers_jump_context
+  .type folly_fibers_jump_context, @function
+  .align 16
+folly_fibers_jump_context:
+  pushq %rbp
+  pushq %rbx
+  pushq %r15
+  pushq %r14
+  pushq %r13
+  pushq %r12
+  movq %rsp, (%rdi)
+  movq %rsi, %rsp
+  popq %r12
+  popq %r13
+  popq %r14
+  popq %r15
+  popq %rbx
+  popq %rbp
+  popq %r8
+  movq %rdx, %rax
+  movq %rdx, %rdi
+  jmp *%r8
+  .size folly_fibers_jump_context, .-folly_fibers_jump_context
+  .section .note.GNU-stack,"",%progbits
+  .text
+)");
+
+void* makeAsmContext(void* stackBase, void (*fn)(intptr_t)) {
+  auto top = reinterpret_cast<uintptr_t*>(
+      reinterpret_cast<uintptr_t>(stackBase) & ~uintptr_t(15));
+  // 6 registers, the entry point and a null return address for fn, which
+  // leaves the stack aligned as if fn had been called.
+  auto context = top - 8;
+  std::fill(context, top, 0);
+  context[6] = reinterpret_cast<uintptr_t>(fn);
+  return context;
+}
+
+#elif defined(__aarch64__)
+
+/*
+ * AAPCS64: x19-x28, the frame pointer x29, the link register x30 and the low
+ * halves of v8-v15 are callee-saved. The saved context is laid out (from the
+ * saved stack pointer up) as
+ *   d8-d15 x19-x28 x29 x30
+ */
+asm(R"(
+  .text
+  .globl folly_fibers_jump_context
+  .type folly_fibers_jump_context, %function
+  .align 4
+folly_fibers_jump_context:
+  sub sp, sp, #160
+  stp d8, d9, [sp, #0]
+  stp d10, d11, [sp, #16]
+  stp d12, d13, [sp, #32]
+  stp d14, d15, [sp, #48]
+  stp x19, x20, [sp, #64]
+  stp x21, x22, [sp, #80]
+  stp x23, x24, [sp, #96]
+  stp x25, x26, [sp, #112]
+  stp x27, x28, [sp, #128]
+  stp x29, x30, [sp, #144]
+  mov x9, sp
+  str x9, [x0]
+  mov sp, x1
+  ldp d8, d9, [sp, #0]
+  ldp d10, d11, [sp, #16]
+  ldp d12, d13, [sp, #32]
+  ldp d14, d15, [sp, #48]
+  ldp x19, x20, [sp, #64]
+  ldp x21, x22, [sp, #80]
+  ldp x23, x24, [sp, #96]
+  ldp x25, x26, [sp, #112]
+  ldp x27, x28, [sp, #128]
+  ldp x29, x30, [sp, #144]
+  add sp, sp, #160
+  mov x0, x2
+  ret
+  .size folly_fibers_jump_context, .-folly_fibers_jump_context
+  .section .note.GNU-stack,"",%progbits
+  .text
+)");
+
+void* makeAsmContext(void* stackBase, void (*fn)(intptr_t)) {
+  auto top = reinterpret_cast<uintptr_t*>(
+      reinterpret_cast<uintptr_t>(stackBase) & ~uintptr_t(15));
+  // 8 floating point and 12 general purpose registers; x30 is the entry point.
+  auto context = top - 20;
+  std::fill(context, top, 0);
+  context[19] = reinterpret_cast<uintptr_t>(fn);
+  return context;
+}
+
+#endif
+}
+}
+} // folly::fibers::detail
+
+#endif // FOLLY_FIBERS_USE_ASM_CONTEXT
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cassert>
+
+namespace folly {
+namespace fibers {
+
+template <typename BatonType>
+void BatchBaton<BatonType>::post(size_t index) {
+  assert(index < size_);
+  pthread_spin_lock(&lock_);
+  assert(posted_.size() < size_);
+  posted_.push_back(index);
+  if (target_ != 0 && posted_.size() >= target_) {
+    target_ = 0;
+    baton_.post();
+  }
+  pthread_spin_unlock(&lock_);
+}
+
+template <typename BatonType>
+void BatchBaton<BatonType>::waitPosted(size_t target) {
+  if (posted_.size() >= target) {
+    return;
+  }
+  target_ = target;
+  pthread_spin_unlock(&lock_);
+  baton_.wait();
+  // Nobody posts baton_ again until target_ is set, so it's safe to reset.
+  baton_.reset();
+  pthread_spin_lock(&lock_);
+  assert(posted_.size() >= target);
+}
+
+template <typename BatonType>
+size_t BatchBaton<BatonType>::waitAny() {
+  pthread_spin_lock(&lock_);
+  assert(consumed_ < size_);
+  waitPosted(consumed_ + 1);
+  auto index = posted_[consumed_++];
+  pthread_spin_unlock(&lock_);
+  return index;
+}
+
+template <typename BatonType>
+void BatchBaton<BatonType>::waitAll() {
+  pthread_spin_lock(&lock_);
+  waitPosted(size_);
+  pthread_spin_unlock(&lock_);
+}
+}
+}
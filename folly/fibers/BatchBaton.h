@@ -0,0 +1,84 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <pthread.h>
+
+#include <vector>
+
+#include <folly/fibers/GenericBaton.h>
+
+namespace folly {
+namespace fibers {
+
+/**
+ * @class BatchBaton
+ *
+ * A set of batons which a single fiber (or thread, when not on a fiber) waits
+ * on together, e.g. to handle the results of N concurrent operations as they
+ * complete. The waiter is only woken up once what it waits for is available,
+ * not on every post.
+ **/
+template <typename BatonType>
+class BatchBaton {
+ public:
+  explicit BatchBaton(size_t size) : size_(size) {
+    pthread_spin_init(&lock_, PTHREAD_PROCESS_PRIVATE);
+    posted_.reserve(size_);
+  }
+
+  ~BatchBaton() {
+    pthread_spin_destroy(&lock_);
+  }
+
+  BatchBaton(const BatchBaton& rhs) = delete;
+  BatchBaton& operator=(const BatchBaton& rhs) = delete;
+  BatchBaton(BatchBaton&& rhs) = delete;
+  BatchBaton& operator=(BatchBaton&& rhs) = delete;
+
+  // @return        number of batons in the set
+  size_t size() const {
+    return size_;
+  }
+
+  // Post the baton with the given index. Each baton may only be posted once.
+  // Safe to call from any thread.
+  void post(size_t index);
+
+  // Block the thread / fiber until some baton was posted which wasn't returned
+  // by waitAny() before. May be called at most size() times.
+  //
+  // @return        index of the posted baton
+  size_t waitAny();
+
+  // Block the thread / fiber until all the batons were posted.
+  void waitAll();
+
+ private:
+  // Blocks until at least target batons were posted. Called with lock_ held.
+  void waitPosted(size_t target);
+
+  const size_t size_;
+  pthread_spinlock_t lock_; //< lock to protect the state below
+  std::vector<size_t> posted_; //< indices of the posted batons, in order
+  size_t consumed_{0}; //< prefix of posted_ already returned by waitAny()
+  size_t target_{0}; //< number of posts the waiter waits for, 0 if none
+  BatonType baton_; //< baton the waiter is blocked on
+};
+}
+}
+
+#include "BatchBaton-inl.h"
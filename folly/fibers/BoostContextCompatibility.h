@@ -15,8 +15,27 @@
  */
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
+#include <folly/portability/Config.h>
+
+/**
+ * FOLLY_FIBERS_ASM_CONTEXT (configure --enable-fibers-asm-context) replaces
+ * boost::context with the minimal context switch from AsmContext.cpp on the
+ * platforms it supports.
+ */
+#if FOLLY_FIBERS_ASM_CONTEXT && defined(__ELF__) && \
+    (defined(__x86_64__) || defined(__aarch64__))
+#define FOLLY_FIBERS_USE_ASM_CONTEXT 1
+#else
+#define FOLLY_FIBERS_USE_ASM_CONTEXT 0
+#endif
+
+#if !FOLLY_FIBERS_USE_ASM_CONTEXT
 #include <boost/context/fcontext.hpp>
 #include <boost/version.hpp>
+#endif
 
 /**
  * Wrappers for different versions of boost::context library
@@ -32,6 +51,76 @@
 namespace folly {
 namespace fibers {
 
+#if FOLLY_FIBERS_USE_ASM_CONTEXT
+
+namespace detail {
+/**
+ * Saves the callee-saved registers on the current stack, stores the stack
+ * pointer in *from, switches to the stack pointer to and restores the
+ * registers saved there. Returns p on the new stack; a context created with
+ * makeAsmContext() gets p as the argument of its entry function instead.
+ *
+ * Unlike boost::context, the floating point control words are not saved:
+ * fibers must leave the rounding mode and exception masks as they found them.
+ */
+extern "C" intptr_t
+folly_fibers_jump_context(void** from, void* to, intptr_t p);
+
+/**
+ * Prepares a context on the stack ending at stackBase which, when jumped to,
+ * calls fn (which must never return).
+ *
+ * @return the context, to be passed to folly_fibers_jump_context().
+ */
+void* makeAsmContext(void* stackBase, void (*fn)(intptr_t));
+} // detail
+
+struct FContext {
+ public:
+  using ContextStruct = void*;
+
+  void* stackLimit() const {
+    return stackLimit_;
+  }
+
+  void* stackBase() const {
+    return stackBase_;
+  }
+
+ private:
+  void* stackLimit_;
+  void* stackBase_;
+  ContextStruct context_;
+
+  friend intptr_t
+  jumpContext(FContext* oldC, FContext::ContextStruct* newC, intptr_t p);
+  friend intptr_t
+  jumpContext(FContext::ContextStruct* oldC, FContext* newC, intptr_t p);
+  friend FContext
+  makeContext(void* stackLimit, size_t stackSize, void (*fn)(intptr_t));
+};
+
+inline intptr_t
+jumpContext(FContext* oldC, FContext::ContextStruct* newC, intptr_t p) {
+  return detail::folly_fibers_jump_context(&oldC->context_, *newC, p);
+}
+
+inline intptr_t
+jumpContext(FContext::ContextStruct* oldC, FContext* newC, intptr_t p) {
+  return detail::folly_fibers_jump_context(oldC, newC->context_, p);
+}
+
+inline FContext
+makeContext(void* stackLimit, size_t stackSize, void (*fn)(intptr_t)) {
+  FContext res;
+  res.stackLimit_ = stackLimit;
+  res.stackBase_ = static_cast<unsigned char*>(stackLimit) + stackSize;
+  res.context_ = detail::makeAsmContext(res.stackBase_, fn);
+  return res;
+}
+
+#else
+
 struct FContext {
  public:
 #if BOOST_VERSION >= 105200
@@ -104,5 +193,7 @@ makeContext(void* stackLimit, size_t stackSize, void (*fn)(intptr_t)) {
 
   return res;
 }
+
+#endif // FOLLY_FIBERS_USE_ASM_CONTEXT
 }
 } // folly::fibers
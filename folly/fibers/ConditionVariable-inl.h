@@ -0,0 +1,95 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+namespace folly {
+namespace fibers {
+
+template <typename BatonType>
+template <typename Mutex>
+void TimedConditionVariable<BatonType>::wait(std::unique_lock<Mutex>& lock) {
+  Waiter waiter;
+  pthread_spin_lock(&lock_);
+  waiters_.push_back(waiter);
+  pthread_spin_unlock(&lock_);
+
+  // We're in the waiter list before the mutex is released, so notifications
+  // sent after it is can't be missed.
+  lock.unlock();
+  waiter.baton.wait();
+  lock.lock();
+}
+
+template <typename BatonType>
+template <typename Mutex, typename Predicate>
+void TimedConditionVariable<BatonType>::wait(
+    std::unique_lock<Mutex>& lock,
+    Predicate pred) {
+  while (!pred()) {
+    wait(lock);
+  }
+}
+
+template <typename BatonType>
+template <typename Mutex, typename Rep, typename Period>
+bool TimedConditionVariable<BatonType>::timed_wait(
+    std::unique_lock<Mutex>& lock,
+    const std::chrono::duration<Rep, Period>& duration) {
+  Waiter waiter;
+  pthread_spin_lock(&lock_);
+  waiters_.push_back(waiter);
+  pthread_spin_unlock(&lock_);
+
+  lock.unlock();
+  bool notified = waiter.baton.timed_wait(duration);
+  if (!notified) {
+    // If we're no longer in the waiter list, we were notified just as we
+    // timed out.
+    pthread_spin_lock(&lock_);
+    if (waiter.hook.is_linked()) {
+      waiters_.erase(waiters_.iterator_to(waiter));
+    } else {
+      notified = true;
+    }
+    pthread_spin_unlock(&lock_);
+  }
+  lock.lock();
+  return notified;
+}
+
+template <typename BatonType>
+void TimedConditionVariable<BatonType>::notify_one() {
+  pthread_spin_lock(&lock_);
+  if (!waiters_.empty()) {
+    Waiter& to_wake = waiters_.front();
+    waiters_.pop_front();
+    to_wake.baton.post();
+  }
+  pthread_spin_unlock(&lock_);
+}
+
+template <typename BatonType>
+void TimedConditionVariable<BatonType>::notify_all() {
+  pthread_spin_lock(&lock_);
+  while (!waiters_.empty()) {
+    Waiter& to_wake = waiters_.front();
+    waiters_.pop_front();
+    to_wake.baton.post();
+  }
+  pthread_spin_unlock(&lock_);
+}
+}
+}
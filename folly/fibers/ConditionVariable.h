@@ -0,0 +1,98 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <pthread.h>
+
+#include <mutex>
+
+#include <boost/intrusive/list.hpp>
+
+#include <folly/fibers/GenericBaton.h>
+
+namespace folly {
+namespace fibers {
+
+/**
+ * @class TimedConditionVariable
+ *
+ * Condition variable which blocks the calling fiber (or thread, when not on a
+ * fiber) instead of the thread. Works with any mutex, though one which
+ * doesn't block the thread either (e.g. TimedMutex) should be used from
+ * fibers. Unlike std::condition_variable, there are no spurious wakeups.
+ **/
+template <typename BatonType>
+class TimedConditionVariable {
+ public:
+  TimedConditionVariable() {
+    pthread_spin_init(&lock_, PTHREAD_PROCESS_PRIVATE);
+  }
+
+  ~TimedConditionVariable() {
+    pthread_spin_destroy(&lock_);
+  }
+
+  TimedConditionVariable(const TimedConditionVariable& rhs) = delete;
+  TimedConditionVariable& operator=(const TimedConditionVariable& rhs) =
+      delete;
+  TimedConditionVariable(TimedConditionVariable&& rhs) = delete;
+  TimedConditionVariable& operator=(TimedConditionVariable&& rhs) = delete;
+
+  // Unlock the mutex and block the thread / fiber until notified, then lock
+  // the mutex again.
+  template <typename Mutex>
+  void wait(std::unique_lock<Mutex>& lock);
+
+  // Wait until pred() returns true.
+  template <typename Mutex, typename Predicate>
+  void wait(std::unique_lock<Mutex>& lock, Predicate pred);
+
+  // Like wait, but the thread / fiber will be blocked for a time duration.
+  //
+  // @return        false if the wait timed out, true otherwise
+  template <typename Mutex, typename Rep, typename Period>
+  bool timed_wait(
+      std::unique_lock<Mutex>& lock,
+      const std::chrono::duration<Rep, Period>& duration);
+
+  // Wake up one waiter, if there is one
+  void notify_one();
+
+  // Wake up all the waiters
+  void notify_all();
+
+ private:
+  typedef boost::intrusive::list_member_hook<> WaiterHookType;
+
+  struct Waiter {
+    BatonType baton;
+    WaiterHookType hook;
+  };
+
+  typedef boost::intrusive::member_hook<Waiter, WaiterHookType, &Waiter::hook>
+      WaiterHook;
+
+  typedef boost::intrusive::
+      list<Waiter, WaiterHook, boost::intrusive::constant_time_size<true>>
+          WaiterList;
+
+  pthread_spinlock_t lock_; //< lock to protect waiter list
+  WaiterList waiters_; //< list of waiters
+};
+}
+}
+
+#include "ConditionVariable-inl.h"
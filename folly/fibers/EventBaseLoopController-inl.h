@@ -62,11 +62,13 @@ inline void EventBaseLoopController::cancel() {
 }
 
 inline void EventBaseLoopController::runLoop() {
+  idle_ = false;
   if (loopRunner_) {
     loopRunner_->run([&] { fm_->loopUntilNoReady(); });
   } else {
     fm_->loopUntilNoReady();
   }
+  idle_ = true;
 }
 
 inline void EventBaseLoopController::scheduleThreadSafe(
@@ -90,6 +92,10 @@ inline void EventBaseLoopController::scheduleThreadSafe(
   }
 }
 
+inline bool EventBaseLoopController::isIdle() const {
+  return idle_;
+}
+
 inline void EventBaseLoopController::timedSchedule(
     std::function<void()> func,
     TimePoint time) {
@@ -95,6 +95,7 @@ class EventBaseLoopController : public LoopController {
   DestructionCallback destructionCallback_;
   FiberManager* fm_{nullptr};
   std::atomic<bool> eventBaseAttached_{false};
+  std::atomic<bool> idle_{true};
   std::weak_ptr<void> aliveWeak_;
   InlineFunctionRunner* loopRunner_{nullptr};
 
@@ -106,6 +107,7 @@ class EventBaseLoopController : public LoopController {
   void runLoop();
   void scheduleThreadSafe(std::function<bool()> func) override;
   void timedSchedule(std::function<void()> func, TimePoint time) override;
+  bool isIdle() const override;
 
   friend class FiberManager;
 };
@@ -67,11 +67,11 @@ void Fiber::setData(intptr_t data) {
   }
 }
 
-Fiber::Fiber(FiberManager& fiberManager) : fiberManager_(fiberManager) {
-  auto size = fiberManager_.options_.stackSize;
-  auto limit = fiberManager_.stackAllocator_.allocate(size);
+Fiber::Fiber(FiberManager& fiberManager, size_t stackSize)
+    : fiberManager_(fiberManager), stackSize_(stackSize) {
+  auto limit = fiberManager_.stackAllocator_.allocate(stackSize_);
 
-  fcontext_ = makeContext(limit, size, &Fiber::fiberFuncHelper);
+  fcontext_ = makeContext(limit, stackSize_, &Fiber::fiberFuncHelper);
 
   fiberManager_.allFibers_.push_back(*this);
 }
@@ -81,21 +81,29 @@ void Fiber::init(bool recordStackUsed) {
 // the fiber's stack.
 #ifndef FOLLY_SANITIZE_ADDRESS
   recordStackUsed_ = recordStackUsed;
-  if (UNLIKELY(recordStackUsed_ && !stackFilledWithMagic_)) {
+  if (!recordStackUsed_) {
+    // This run will overwrite the magic values without measuring them.
+    stackFilledWithMagic_ = false;
+  } else if (UNLIKELY(!stackFilledWithMagic_ || stackUsed_ > 0)) {
     auto limit = fcontext_.stackLimit();
     auto base = fcontext_.stackBase();
 
+    // If the previous task was recorded, only the part of the stack it used
+    // has to be refilled.
+    auto begin = stackFilledWithMagic_
+        ? static_cast<unsigned char*>(base) - stackUsed_
+        : static_cast<unsigned char*>(limit);
     std::fill(
-        static_cast<uint64_t*>(limit),
+        reinterpret_cast<uint64_t*>(begin),
         static_cast<uint64_t*>(base),
         kMagic8Bytes);
 
     // newer versions of boost allocate context on fiber stack,
     // need to create a new one
-    auto size = fiberManager_.options_.stackSize;
-    fcontext_ = makeContext(limit, size, &Fiber::fiberFuncHelper);
+    fcontext_ = makeContext(limit, stackSize_, &Fiber::fiberFuncHelper);
 
     stackFilledWithMagic_ = true;
+    stackUsed_ = 0;
   }
 #else
   (void)recordStackUsed;
@@ -107,8 +115,7 @@ Fiber::~Fiber() {
   fiberManager_.unpoisonFiberStack(this);
 #endif
   fiberManager_.stackAllocator_.deallocate(
-      static_cast<unsigned char*>(fcontext_.stackLimit()),
-      fiberManager_.options_.stackSize);
+      static_cast<unsigned char*>(fcontext_.stackLimit()), stackSize_);
 }
 
 void Fiber::recordStackPosition() {
@@ -148,14 +155,21 @@ void Fiber::fiberFunc() {
     }
 
     if (UNLIKELY(recordStackUsed_)) {
-      fiberManager_.stackHighWatermark_ = std::max(
-          fiberManager_.stackHighWatermark_, nonMagicInBytes(fcontext_));
+      stackUsed_ = nonMagicInBytes(fcontext_);
+      fiberManager_.stackHighWatermark_ =
+          std::max(fiberManager_.stackHighWatermark_, stackUsed_);
       VLOG(3) << "Max stack usage: " << fiberManager_.stackHighWatermark_;
-      CHECK(
-          fiberManager_.stackHighWatermark_ <
-          fiberManager_.options_.stackSize - 64)
-          << "Fiber stack overflow";
+      CHECK(stackUsed_ < stackSize_ - 64) << "Fiber stack overflow";
+
+      if (taskStackWatermark_) {
+        auto watermark = taskStackWatermark_->load(std::memory_order_relaxed);
+        while (watermark < stackUsed_ &&
+               !taskStackWatermark_->compare_exchange_weak(
+                   watermark, stackUsed_, std::memory_order_relaxed)) {
+        }
+      }
     }
+    taskStackWatermark_ = nullptr;
 
     state_ = INVALID;
 
@@ -15,6 +15,7 @@
  */
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <thread>
 #include <typeinfo>
@@ -87,7 +88,7 @@ class Fiber {
   friend class Baton;
   friend class FiberManager;
 
-  explicit Fiber(FiberManager& fiberManager);
+  Fiber(FiberManager& fiberManager, size_t stackSize);
 
   void init(bool recordStackUsed);
 
@@ -117,12 +118,19 @@ class Fiber {
   void recordStackPosition();
 
   FiberManager& fiberManager_; /**< Associated FiberManager */
+  const size_t stackSize_; /**< size of this fiber's stack */
   FContext fcontext_; /**< current task execution context */
   intptr_t data_; /**< Used to keep some data with the Fiber */
   std::shared_ptr<RequestContext> rcontext_; /**< current RequestContext */
   folly::Function<void()> func_; /**< task function */
   bool recordStackUsed_{false};
   bool stackFilledWithMagic_{false};
+  size_t stackUsed_{0}; /**< stack used by the last recorded task */
+  /**
+   * If set, the recorded stack usage of the current task is also folded into
+   * this (per call site) high watermark.
+   */
+  std::atomic<size_t>* taskStackWatermark_{nullptr};
 
   /**
    * Points to next fiber in remote ready list
@@ -15,6 +15,7 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 
 #include <folly/CPortability.h>
@@ -44,10 +45,21 @@ inline FiberManager::Options preprocessOptions(FiberManager::Options opts) {
      where it mattered.  Note that overallocating here does not necessarily
      increase RSS, since unused memory is pretty much free. */
   opts.stackSize *= 16;
+  opts.minStackSize *= 16;
 #endif
   return opts;
 }
 
+inline std::vector<size_t> makeStackSizeClasses(
+    const FiberManager::Options& opts) {
+  std::vector<size_t> sizes;
+  for (auto size = opts.minStackSize; size > 0 && size < opts.stackSize;
+       size *= 2) {
+    sizes.push_back(size);
+  }
+  return sizes;
+}
+
 } // anonymous
 
 inline void FiberManager::ensureLoopScheduled() {
@@ -145,7 +157,7 @@ inline void FiberManager::runReadyFiber(Fiber* fiber) {
 
     if (fibersPoolSize_ < options_.maxFibersPoolSize ||
         options_.fibersPoolResizePeriodMs > 0) {
-      fibersPool_.push_front(*fiber);
+      fibersPoolFor(*fiber).push_front(*fiber);
       ++fibersPoolSize_;
     } else {
       delete fiber;
@@ -163,6 +175,32 @@ inline void FiberManager::runReadyFiber(Fiber* fiber) {
   }
 }
 
+inline FiberManager::FiberTailQueue& FiberManager::fibersPoolFor(
+    const Fiber& fiber) {
+  if (LIKELY(fiber.stackSize_ == options_.stackSize)) {
+    return fibersPool_;
+  }
+  auto it = std::lower_bound(
+      stackSizeClasses_.begin(), stackSizeClasses_.end(), fiber.stackSize_);
+  assert(it != stackSizeClasses_.end() && *it == fiber.stackSize_);
+  return sizedFibersPools_[it - stackSizeClasses_.begin()];
+}
+
+inline void FiberManager::runRemoteTask(std::unique_ptr<RemoteTask> task) {
+  auto fiber = getFiber();
+  if (task->localData) {
+    fiber->localData_ = *task->localData;
+  }
+  fiber->rcontext_ = std::move(task->rcontext);
+
+  fiber->setFunction(std::move(task->func));
+  fiber->data_ = reinterpret_cast<intptr_t>(fiber);
+  if (observer_) {
+    observer_->runnable(reinterpret_cast<uintptr_t>(fiber));
+  }
+  runReadyFiber(fiber);
+}
+
 inline bool FiberManager::loopUntilNoReady() {
 #ifndef _WIN32
   if (UNLIKELY(!alternateSignalStackRegistered_)) {
@@ -199,21 +237,13 @@ inline bool FiberManager::loopUntilNoReady() {
     });
 
     remoteTaskQueue_.sweep([this, &hadRemoteFiber](RemoteTask* taskPtr) {
-      std::unique_ptr<RemoteTask> task(taskPtr);
-      auto fiber = getFiber();
-      if (task->localData) {
-        fiber->localData_ = *task->localData;
-      }
-      fiber->rcontext_ = std::move(task->rcontext);
-
-      fiber->setFunction(std::move(task->func));
-      fiber->data_ = reinterpret_cast<intptr_t>(fiber);
-      if (observer_) {
-        observer_->runnable(reinterpret_cast<uintptr_t>(fiber));
-      }
-      runReadyFiber(fiber);
+      runRemoteTask(std::unique_ptr<RemoteTask>(taskPtr));
       hadRemoteFiber = true;
     });
+
+    if (!hadRemoteFiber && readyFibers_.empty()) {
+      hadRemoteFiber = runStealableTask();
+    }
   }
 
   if (observer_) {
@@ -261,9 +291,27 @@ struct FiberManager::AddTaskHelper {
 
 template <typename F>
 void FiberManager::addTask(F&& func) {
+  addTaskToFiber(getFiber(), std::forward<F>(func));
+}
+
+template <typename F>
+std::atomic<size_t>& FiberManager::taskStackWatermark() {
+  static std::atomic<size_t> watermark{0};
+  return watermark;
+}
+
+template <typename F>
+void FiberManager::addTaskSized(F&& func) {
+  auto& watermark = taskStackWatermark<typename std::decay<F>::type>();
+  auto fiber = getSizedFiber(watermark.load(std::memory_order_relaxed));
+  fiber->taskStackWatermark_ = &watermark;
+  addTaskToFiber(fiber, std::forward<F>(func));
+}
+
+template <typename F>
+void FiberManager::addTaskToFiber(Fiber* fiber, F&& func) {
   typedef AddTaskHelper<F> Helper;
 
-  auto fiber = getFiber();
   initLocalData(*fiber);
 
   if (Helper::allocateInBuffer) {
@@ -302,23 +350,60 @@ auto FiberManager::addTaskFuture(F&& func) -> folly::Future<
   return f;
 }
 
+template <typename F>
+auto FiberManager::addTaskFuture(F&& func, CancellationToken token)
+    -> folly::Future<
+        typename folly::Unit::Lift<typename std::result_of<F()>::type>::type> {
+  // The task gets its own copy: capturing token here while also moving it
+  // into withCancellation() would be unsequenced.
+  auto taskToken = token;
+  return addTaskFuture([ func = std::forward<F>(func),
+                         token = std::move(taskToken) ]() mutable {
+           if (token.isCancellationRequested()) {
+             throw FutureCancellation();
+           }
+           return func();
+         })
+      .withCancellation(std::move(token));
+}
+
+template <typename F>
+std::unique_ptr<FiberManager::RemoteTask> FiberManager::makeRemoteTask(
+    F&& func) {
+  auto currentFm = getFiberManagerUnsafe();
+  if (currentFm && currentFm->currentFiber_ &&
+      currentFm->localType_ == localType_) {
+    return folly::make_unique<RemoteTask>(
+        std::forward<F>(func), currentFm->currentFiber_->localData_);
+  }
+  return folly::make_unique<RemoteTask>(std::forward<F>(func));
+}
+
 template <typename F>
 void FiberManager::addTaskRemote(F&& func) {
-  auto task = [&]() {
-    auto currentFm = getFiberManagerUnsafe();
-    if (currentFm && currentFm->currentFiber_ &&
-        currentFm->localType_ == localType_) {
-      return folly::make_unique<RemoteTask>(
-          std::forward<F>(func), currentFm->currentFiber_->localData_);
-    }
-    return folly::make_unique<RemoteTask>(std::forward<F>(func));
-  }();
+  auto task = makeRemoteTask(std::forward<F>(func));
   auto insertHead = [&]() {
     return remoteTaskQueue_.insertHead(task.release());
   };
   loopController_->scheduleThreadSafe(std::ref(insertHead));
 }
 
+template <typename F>
+void FiberManager::addTaskStealable(F&& func) {
+  auto task = makeRemoteTask(std::forward<F>(func));
+  size_t queueSize = 0;
+  auto insert = [&]() {
+    std::lock_guard<std::mutex> lg(stealableTasksMutex_);
+    stealableTasks_.push_back(std::move(task));
+    queueSize = ++numStealableTasks_;
+    // The loop keeps going until the queue is empty, so it only has to be
+    // scheduled for the first task.
+    return queueSize == 1;
+  };
+  loopController_->scheduleThreadSafe(std::ref(insert));
+  stealableTaskAdded(queueSize);
+}
+
 template <typename F>
 auto FiberManager::addTaskRemoteFuture(F&& func) -> folly::Future<
     typename folly::Unit::Lift<typename std::result_of<F()>::type>::type> {
@@ -524,8 +609,13 @@ FiberManager::FiberManager(
     std::unique_ptr<LoopController> loopController__,
     Options options)
     : loopController_(std::move(loopController__)),
-      stackAllocator_(options.useGuardPages),
+      stackAllocator_(
+          options.useGuardPages,
+          options.useNodeLocalStacks,
+          options.useHugePageStacks),
       options_(preprocessOptions(std::move(options))),
+      stackSizeClasses_(makeStackSizeClasses(options_)),
+      sizedFibersPools_(stackSizeClasses_.size()),
       exceptionCallback_([](std::exception_ptr eptr, std::string context) {
         try {
           std::rethrow_exception(eptr);
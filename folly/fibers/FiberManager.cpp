@@ -23,6 +23,7 @@
 #include <glog/logging.h>
 
 #include <folly/fibers/Fiber.h>
+#include <folly/fibers/FiberManagerGroup.h>
 #include <folly/fibers/LoopController.h>
 
 #include <folly/SingletonThreadLocal.h>
@@ -74,6 +75,10 @@ FiberManager::FiberManager(
           std::move(options)) {}
 
 FiberManager::~FiberManager() {
+  if (auto group = group_.load()) {
+    group->remove(*this);
+  }
+
   if (isLoopScheduled_) {
     loopController_->cancel();
   }
@@ -81,6 +86,11 @@ FiberManager::~FiberManager() {
   while (!fibersPool_.empty()) {
     fibersPool_.pop_front_and_dispose([](Fiber* fiber) { delete fiber; });
   }
+  for (auto& pool : sizedFibersPools_) {
+    while (!pool.empty()) {
+      pool.pop_front_and_dispose([](Fiber* fiber) { delete fiber; });
+    }
+  }
   assert(readyFibers_.empty());
   assert(fibersActive_ == 0);
 }
@@ -95,10 +105,35 @@ const LoopController& FiberManager::loopController() const {
 
 bool FiberManager::hasTasks() const {
   return fibersActive_ > 0 || !remoteReadyQueue_.empty() ||
-      !remoteTaskQueue_.empty();
+      !remoteTaskQueue_.empty() || stealableQueueSize() > 0;
 }
 
 Fiber* FiberManager::getFiber() {
+  auto fiber = getFiberFromPool(fibersPool_, options_.stackSize);
+  fiber->init(
+      options_.recordStackEvery != 0 &&
+      fiberId_ % options_.recordStackEvery == 0);
+  return fiber;
+}
+
+Fiber* FiberManager::getSizedFiber(size_t stackWatermark) {
+  // Call sites start on the full-size stack until their usage is known.
+  if (stackWatermark > 0) {
+    for (size_t i = 0; i < stackSizeClasses_.size(); ++i) {
+      if (2 * stackWatermark <= stackSizeClasses_[i]) {
+        auto fiber =
+            getFiberFromPool(sizedFibersPools_[i], stackSizeClasses_[i]);
+        fiber->init(true);
+        return fiber;
+      }
+    }
+  }
+  auto fiber = getFiberFromPool(fibersPool_, options_.stackSize);
+  fiber->init(true);
+  return fiber;
+}
+
+Fiber* FiberManager::getFiberFromPool(FiberTailQueue& pool, size_t stackSize) {
   Fiber* fiber = nullptr;
 
   if (options_.fibersPoolResizePeriodMs > 0 && !fibersPoolResizerScheduled_) {
@@ -106,12 +141,12 @@ Fiber* FiberManager::getFiber() {
     fibersPoolResizerScheduled_ = true;
   }
 
-  if (fibersPool_.empty()) {
-    fiber = new Fiber(*this);
+  if (pool.empty()) {
+    fiber = new Fiber(*this, stackSize);
     ++fibersAllocated_;
   } else {
-    fiber = &fibersPool_.front();
-    fibersPool_.pop_front();
+    fiber = &pool.front();
+    pool.pop_front();
     assert(fibersPoolSize_ > 0);
     --fibersPoolSize_;
   }
@@ -148,6 +183,66 @@ void FiberManager::remoteReadyInsert(Fiber* fiber) {
   loopController_->scheduleThreadSafe(std::ref(insertHead));
 }
 
+bool FiberManager::runStealableTask() {
+  auto task = popStealableTask();
+  if (!task) {
+    auto group = group_.load(std::memory_order_acquire);
+    if (!group || !group->steal(*this)) {
+      return false;
+    }
+    task = popStealableTask();
+    if (!task) {
+      return false;
+    }
+  }
+  runRemoteTask(std::move(task));
+  return true;
+}
+
+void FiberManager::stealableTaskAdded(size_t queueSize) {
+  auto group = group_.load(std::memory_order_acquire);
+  if (group && queueSize == group->options_.wakeThreshold) {
+    group->wakeIdle(*this);
+  }
+}
+
+std::unique_ptr<FiberManager::RemoteTask> FiberManager::popStealableTask() {
+  if (stealableQueueSize() == 0) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lg(stealableTasksMutex_);
+  if (stealableTasks_.empty()) {
+    return nullptr;
+  }
+  auto task = std::move(stealableTasks_.front());
+  stealableTasks_.pop_front();
+  --numStealableTasks_;
+  return task;
+}
+
+void FiberManager::pushStealableTasks(
+    std::vector<std::unique_ptr<RemoteTask>> tasks) {
+  std::lock_guard<std::mutex> lg(stealableTasksMutex_);
+  for (auto& task : tasks) {
+    stealableTasks_.push_back(std::move(task));
+  }
+  numStealableTasks_ += tasks.size();
+}
+
+void FiberManager::takeStealableTasks(
+    std::vector<std::unique_ptr<RemoteTask>>& tasks,
+    size_t maxTasks) {
+  std::lock_guard<std::mutex> lg(stealableTasksMutex_);
+  auto n = std::min(maxTasks, stealableTasks_.size());
+  auto first = stealableTasks_.end() - n;
+  tasks.insert(
+      tasks.end(),
+      std::make_move_iterator(first),
+      std::make_move_iterator(stealableTasks_.end()));
+  stealableTasks_.erase(first, stealableTasks_.end());
+  numStealableTasks_ -= n;
+}
+
 void FiberManager::setObserver(ExecutionObserver* observer) {
   observer_ = observer;
 }
@@ -163,9 +258,16 @@ void FiberManager::setPreemptRunner(InlineFunctionRunner* preemptRunner) {
 void FiberManager::doFibersPoolResizing() {
   while (fibersAllocated_ > maxFibersActiveLastPeriod_ &&
          fibersPoolSize_ > options_.maxFibersPoolSize) {
-    auto fiber = &fibersPool_.front();
+    auto pool = &fibersPool_;
+    for (auto& sizedPool : sizedFibersPools_) {
+      if (!sizedPool.empty()) {
+        pool = &sizedPool;
+        break;
+      }
+    }
+    auto fiber = &pool->front();
     assert(fiber != nullptr);
-    fibersPool_.pop_front();
+    pool->pop_front();
     delete fiber;
     --fibersPoolSize_;
     --fibersAllocated_;
@@ -15,8 +15,11 @@
  */
 #pragma once
 
+#include <atomic>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <thread>
 #include <type_traits>
@@ -25,6 +28,7 @@
 #include <vector>
 
 #include <folly/AtomicIntrusiveLinkedList.h>
+#include <folly/CancellationToken.h>
 #include <folly/Executor.h>
 #include <folly/IntrusiveList.h>
 #include <folly/Likely.h>
@@ -47,6 +51,7 @@ namespace fibers {
 
 class Baton;
 class Fiber;
+class FiberManagerGroup;
 class LoopController;
 class TimeoutController;
 
@@ -83,6 +88,16 @@ class FiberManager : public ::folly::Executor {
      */
     size_t stackSize{kDefaultStackSize};
 
+    /**
+     * Smallest stack size for tasks added with addTaskSized(). If non-zero and
+     * less than stackSize, such tasks run on stacks of minStackSize,
+     * 2 * minStackSize, ... up to stackSize bytes, picking the smallest size
+     * which fits twice the most stack their call site has been seen to use.
+     * Should be a multiple of the page size. Stacks of all sizes share the
+     * manager's budget of stacks with guard pages.
+     */
+    size_t minStackSize{0};
+
     /**
      * Record exact amount of stack used.
      *
@@ -105,6 +120,18 @@ class FiberManager : public ::folly::Executor {
      */
     bool useGuardPages{true};
 
+    /**
+     * Allocate guarded fiber stacks from the memory of the NUMA node the
+     * FiberManager's thread runs on.
+     */
+    bool useNodeLocalStacks{true};
+
+    /**
+     * Ask for transparent huge pages to back guarded fiber stacks. Helps
+     * TLB misses with large stacks, wastes memory with small ones.
+     */
+    bool useHugePageStacks{false};
+
     /**
      * Free unnecessary fibers in the fibers pool every fibersPoolResizePeriodMs
      * milliseconds. If value is 0, periodic resizing of the fibers pool is
@@ -182,6 +209,23 @@ class FiberManager : public ::folly::Executor {
   template <typename F>
   void addTask(F&& func);
 
+  /**
+   * Like addTask(), but the task runs on a stack sized for its call site (see
+   * Options::minStackSize). The stack usage of every such task is recorded;
+   * call sites whose usage grows are moved to a larger stack on their next
+   * run. Call sites are told apart by the type of func, so pass a lambda
+   * rather than a type-erased function. Must be called from FiberManager's
+   * thread.
+   *
+   * Only suitable for tasks whose stack usage doesn't vary too much from run
+   * to run: a task using more than its stack still overflows it.
+   *
+   * @param func Task functor; must have a signature of `void func()`.
+   *             The object will be destroyed once task execution is complete.
+   */
+  template <typename F>
+  void addTaskSized(F&& func);
+
   /**
    * Add a new task to be executed and return a future that will be set on
    * return from func. Must be called from FiberManager's thread.
@@ -192,6 +236,17 @@ class FiberManager : public ::folly::Executor {
   template <typename F>
   auto addTaskFuture(F&& func) -> folly::Future<
       typename folly::Unit::Lift<typename std::result_of<F()>::type>::type>;
+
+  /**
+   * Like addTaskFuture(func), but tied to a CancellationToken. If
+   * cancellation is requested before the task starts, func is never run. The
+   * returned future completes with FutureCancellation as soon as cancellation
+   * is requested; func may capture the token to stop early once it has
+   * started.
+   */
+  template <typename F>
+  auto addTaskFuture(F&& func, CancellationToken token) -> folly::Future<
+      typename folly::Unit::Lift<typename std::result_of<F()>::type>::type>;
   /**
    * Add a new task to be executed. Safe to call from other threads.
    *
@@ -212,6 +267,20 @@ class FiberManager : public ::folly::Executor {
   auto addTaskRemoteFuture(F&& func) -> folly::Future<
       typename folly::Unit::Lift<typename std::result_of<F()>::type>::type>;
 
+  /**
+   * Add a new task to be executed. Safe to call from other threads.
+   * If this FiberManager belongs to a FiberManagerGroup, the task may be run by
+   * another member of the group which is idle by the time the task would be
+   * started. Without a group this works just like addTaskRemote().
+   *
+   * Stealable tasks are started only when there is nothing else to run.
+   *
+   * @param func Task function; must have a signature of `void func()`.
+   *             The object will be destroyed once task execution is complete.
+   */
+  template <typename F>
+  void addTaskStealable(F&& func);
+
   // Executor interface calls addTaskRemote
   void add(folly::Func f) override {
     addTaskRemote(std::move(f));
@@ -315,12 +384,21 @@ class FiberManager : public ::folly::Executor {
     return readyFibers_.size() + yieldedFibers_.size();
   }
 
+  /**
+   * Returns the number of tasks added via addTaskStealable() which are queued
+   * on this FiberManager and haven't started yet. Safe to call from any thread.
+   */
+  size_t stealableQueueSize() const {
+    return numStealableTasks_.load(std::memory_order_relaxed);
+  }
+
   static FiberManager& getFiberManager();
   static FiberManager* getFiberManagerUnsafe();
 
  private:
   friend class Baton;
   friend class Fiber;
+  friend class FiberManagerGroup;
   template <typename F>
   struct AddTaskHelper;
   template <typename F, typename G>
@@ -341,6 +419,9 @@ class FiberManager : public ::folly::Executor {
     AtomicIntrusiveLinkedListHook<RemoteTask> nextRemoteTask;
   };
 
+  template <typename F>
+  std::unique_ptr<RemoteTask> makeRemoteTask(F&& func);
+
   intptr_t activateFiber(Fiber* fiber);
   intptr_t deactivateFiber(Fiber* fiber);
 
@@ -392,6 +473,14 @@ class FiberManager : public ::folly::Executor {
 
   const Options options_; /**< FiberManager options */
 
+  /**
+   * Stack sizes smaller than options_.stackSize available to addTaskSized(),
+   * in increasing order, and the pools of free fibers for each of them.
+   * fibersPool_ holds fibers with options_.stackSize stacks.
+   */
+  const std::vector<size_t> stackSizeClasses_;
+  std::vector<FiberTailQueue> sizedFibersPools_;
+
   /**
    * Largest observed individual Fiber stack usage in bytes.
    */
@@ -407,6 +496,25 @@ class FiberManager : public ::folly::Executor {
    */
   Fiber* getFiber();
 
+  /**
+   * @return An initialized Fiber object with the smallest stack that fits a
+   * task which used at most stackWatermark bytes of stack before (0 if
+   * unknown). The fiber records its stack usage.
+   */
+  Fiber* getSizedFiber(size_t stackWatermark);
+
+  Fiber* getFiberFromPool(FiberTailQueue& pool, size_t stackSize);
+  FiberTailQueue& fibersPoolFor(const Fiber& fiber);
+
+  /**
+   * Stack high watermark of the addTaskSized() call site with functor type F.
+   */
+  template <typename F>
+  static std::atomic<size_t>& taskStackWatermark();
+
+  template <typename F>
+  void addTaskToFiber(Fiber* fiber, F&& func);
+
   /**
    * Sets local data for given fiber if all conditions are met.
    */
@@ -440,6 +548,20 @@ class FiberManager : public ::folly::Executor {
   folly::AtomicIntrusiveLinkedList<RemoteTask, &RemoteTask::nextRemoteTask>
       remoteTaskQueue_;
 
+  /**
+   * Tasks added via addTaskStealable() which haven't started yet. This
+   * FiberManager runs them from the front, FiberManagerGroup peers take them
+   * from the back.
+   */
+  std::deque<std::unique_ptr<RemoteTask>> stealableTasks_;
+  std::mutex stealableTasksMutex_;
+  std::atomic<size_t> numStealableTasks_{0};
+
+  /**
+   * Group this FiberManager belongs to, if any.
+   */
+  std::atomic<FiberManagerGroup*> group_{nullptr};
+
   std::shared_ptr<TimeoutController> timeoutManager_;
 
   struct FibersPoolResizer {
@@ -461,8 +583,23 @@ class FiberManager : public ::folly::Executor {
   std::type_index localType_;
 
   void runReadyFiber(Fiber* fiber);
+  void runRemoteTask(std::unique_ptr<RemoteTask> task);
   void remoteReadyInsert(Fiber* fiber);
 
+  /**
+   * Starts the first queued stealable task, stealing some from the group
+   * first if there are none. Must be called from the loop.
+   *
+   * @return true if a task was started.
+   */
+  bool runStealableTask();
+  void stealableTaskAdded(size_t queueSize);
+  std::unique_ptr<RemoteTask> popStealableTask();
+  void pushStealableTasks(std::vector<std::unique_ptr<RemoteTask>> tasks);
+  void takeStealableTasks(
+      std::vector<std::unique_ptr<RemoteTask>>& tasks,
+      size_t maxTasks);
+
 #ifdef FOLLY_SANITIZE_ADDRESS
 
   // These methods notify ASAN when a fiber is entered/exited so that ASAN can
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "FiberManagerGroup.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include <folly/fibers/FiberManager.h>
+#include <folly/fibers/LoopController.h>
+
+namespace folly {
+namespace fibers {
+
+FiberManagerGroup::FiberManagerGroup(Options options) : options_(options) {}
+
+FiberManagerGroup::~FiberManagerGroup() {
+  SharedMutex::WriteHolder wh(mutex_);
+  for (auto fm : members_) {
+    fm->group_ = nullptr;
+  }
+}
+
+void FiberManagerGroup::add(FiberManager& fm) {
+  SharedMutex::WriteHolder wh(mutex_);
+  CHECK(fm.group_.load() == nullptr)
+      << "FiberManager already belongs to a group";
+  if (!members_.empty()) {
+    CHECK(members_.front()->localType_ == fm.localType_)
+        << "All FiberManagers in a group must use the same local type";
+  }
+  members_.push_back(&fm);
+  fm.group_ = this;
+}
+
+void FiberManagerGroup::remove(FiberManager& fm) {
+  SharedMutex::WriteHolder wh(mutex_);
+  auto it = std::find(members_.begin(), members_.end(), &fm);
+  if (it == members_.end()) {
+    return;
+  }
+  members_.erase(it);
+  fm.group_ = nullptr;
+}
+
+size_t FiberManagerGroup::size() const {
+  SharedMutex::ReadHolder rh(mutex_);
+  return members_.size();
+}
+
+bool FiberManagerGroup::steal(FiberManager& thief) {
+  std::vector<std::unique_ptr<FiberManager::RemoteTask>> tasks;
+  {
+    SharedMutex::ReadHolder rh(mutex_);
+
+    FiberManager* victim = nullptr;
+    size_t backlog = 0;
+    for (auto fm : members_) {
+      auto queueSize = fm->stealableQueueSize();
+      if (fm != &thief && queueSize > backlog) {
+        victim = fm;
+        backlog = queueSize;
+      }
+    }
+    if (!victim) {
+      return false;
+    }
+
+    // Take half, so that the victim keeps some of the work and other idle
+    // members have something left to steal.
+    victim->takeStealableTasks(
+        tasks, std::min(options_.maxStealBatch, (backlog + 1) / 2));
+  }
+
+  if (tasks.empty()) {
+    return false;
+  }
+  thief.pushStealableTasks(std::move(tasks));
+  return true;
+}
+
+void FiberManagerGroup::wakeIdle(FiberManager& victim) {
+  SharedMutex::ReadHolder rh(mutex_);
+  for (auto fm : members_) {
+    if (fm != &victim && fm->loopController_->isIdle()) {
+      fm->loopController_->scheduleThreadSafe([] { return true; });
+    }
+  }
+}
+}
+} // folly::fibers
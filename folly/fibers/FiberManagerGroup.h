@@ -0,0 +1,106 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <vector>
+
+#include <folly/SharedMutex.h>
+
+namespace folly {
+namespace fibers {
+
+class FiberManager;
+
+/**
+ * An opt-in set of FiberManagers, each running on its own thread, that
+ * balance work between each other.
+ *
+ * Tasks added to a member with FiberManager::addTaskStealable() are queued on
+ * that member, and run by it like remote tasks, unless some other member runs
+ * out of work first: an idle member takes up to half of the busiest member's
+ * queued tasks and runs them itself. Only tasks which haven't started yet are
+ * moved - once a task got a fiber, it is bound to that fiber's stack and to
+ * the thread of the FiberManager which owns it.
+ *
+ * Idleness is reported by LoopController::isIdle(). Members whose controller
+ * doesn't report it still share their work, but never receive any.
+ *
+ * All members must use the same fiber-local type. A FiberManager may belong to
+ * at most one group, and must be removed from it (or the group destroyed)
+ * before it is destroyed.
+ */
+class FiberManagerGroup {
+ public:
+  struct Options {
+    /**
+     * Idle members are woken up once some member has this many stealable tasks
+     * queued.
+     */
+    size_t wakeThreshold{4};
+
+    /**
+     * Maximum number of tasks moved by a single steal.
+     */
+    size_t maxStealBatch{64};
+
+    constexpr Options() {}
+  };
+
+  explicit FiberManagerGroup(Options options = Options());
+  ~FiberManagerGroup();
+
+  FiberManagerGroup(const FiberManagerGroup&) = delete;
+  FiberManagerGroup& operator=(const FiberManagerGroup&) = delete;
+
+  /**
+   * Adds fm to this group. Safe to call from any thread.
+   */
+  void add(FiberManager& fm);
+
+  /**
+   * Removes fm from this group. Tasks already queued on fm stay there. Safe to
+   * call from any thread.
+   */
+  void remove(FiberManager& fm);
+
+  /**
+   * @return number of FiberManagers in this group.
+   */
+  size_t size() const;
+
+ private:
+  friend class FiberManager;
+
+  /**
+   * Called by thief from its own thread when it ran out of work. Moves a batch
+   * of queued tasks from the member with the largest backlog into thief.
+   *
+   * @return true if any tasks were moved.
+   */
+  bool steal(FiberManager& thief);
+
+  /**
+   * Called by victim once its backlog reached Options::wakeThreshold. Wakes
+   * up all idle members, so that they come and steal.
+   */
+  void wakeIdle(FiberManager& victim);
+
+  const Options options_;
+  mutable folly::SharedMutex mutex_;
+  std::vector<FiberManager*> members_;
+};
+}
+} // folly::fibers
@@ -20,6 +20,8 @@
 #endif
 #include <signal.h>
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <mutex>
 
@@ -27,6 +29,7 @@
 #include <folly/SpinLock.h>
 #include <folly/Synchronized.h>
 #include <folly/portability/SysMman.h>
+#include <folly/portability/SysSyscall.h>
 #include <folly/portability/Unistd.h>
 
 #include <glog/logging.h>
@@ -38,12 +41,15 @@ namespace fibers {
  * Each stack with a guard page creates two memory mappings.
  * Since this is a limited resource, we don't want to create too many of these.
  *
- * The upper bound on total number of mappings created
- * is kNumGuarded * kMaxInUse.
+ * An allocator maps one StackCache per stack size it is asked for, but all
+ * of them share the allocator's kNumGuarded guarded stacks and count as one
+ * of the kMaxInUse allocators. So the upper bound on total number of mappings
+ * created is about 2 * kNumGuarded * kMaxInUse, plus one per distinct stack
+ * size of each allocator, however many stack sizes a FiberManager uses.
  */
 
 /**
- * Number of guarded stacks per allocator instance
+ * Number of guarded stacks per allocator instance, across all stack sizes
  */
 constexpr size_t kNumGuarded = 100;
 
@@ -52,14 +58,67 @@ constexpr size_t kNumGuarded = 100;
  */
 constexpr size_t kMaxInUse = 100;
 
+namespace {
+
+/**
+ * @return NUMA node the calling thread is running on, or -1 if unknown.
+ */
+int currentNumaNode() {
+#if defined(__linux__) && defined(SYS_getcpu)
+  unsigned cpu = 0;
+  unsigned node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+    return static_cast<int>(node);
+  }
+#endif
+  return -1;
+}
+
 /**
- * A cache for kNumGuarded stacks of a given size
+ * Asks the kernel to back [p, p + size) with memory from the given NUMA node,
+ * if it has any left. Must be called before the memory is first touched.
+ */
+void preferNumaNode(void* p, size_t size, int node) {
+#if defined(__linux__) && defined(SYS_mbind)
+  constexpr int kMpolPreferred = 1;
+  constexpr size_t kBitsPerWord = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> nodeMask(node / kBitsPerWord + 1);
+  nodeMask[node / kBitsPerWord] |= 1UL << (node % kBitsPerWord);
+  // Best effort: not having the memory local is no reason to fail.
+  syscall(
+      SYS_mbind,
+      p,
+      size,
+      kMpolPreferred,
+      nodeMask.data(),
+      nodeMask.size() * kBitsPerWord + 1,
+      0);
+#else
+  (void)p;
+  (void)size;
+  (void)node;
+#endif
+}
+}
+
+/**
+ * A cache for up to kNumGuarded stacks of a given size, allocated from the
+ * memory of the NUMA node of the thread which created it. The caches of one
+ * allocator draw on a shared count of guarded stacks, so that they protect
+ * no more than kNumGuarded stacks between them.
  *
  * Thread safe.
  */
 class StackCache {
  public:
-  explicit StackCache(size_t stackSize) : allocSize_(allocSize(stackSize)) {
+  StackCache(
+      size_t stackSize,
+      bool nodeLocal,
+      bool useHugePages,
+      std::atomic<size_t>& numGuarded)
+      : allocSize_(allocSize(stackSize)),
+        numaNode_(nodeLocal ? currentNumaNode() : -1),
+        numGuarded_(numGuarded) {
     auto p = ::mmap(
         nullptr,
         allocSize_ * kNumGuarded,
@@ -70,11 +129,18 @@ class StackCache {
     PCHECK(p != (void*)(-1));
     storage_ = reinterpret_cast<unsigned char*>(p);
 
-    /* Protect the bottommost page of every stack allocation */
-    for (size_t i = 0; i < kNumGuarded; ++i) {
-      auto allocBegin = storage_ + allocSize_ * i;
-      freeList_.emplace_back(allocBegin, /* protected= */ false);
+    if (numaNode_ >= 0) {
+      preferNumaNode(storage_, allocSize_ * kNumGuarded, numaNode_);
     }
+#ifdef MADV_HUGEPAGE
+    if (useHugePages) {
+      // Guard pages split huge pages, so this mostly pays off for large
+      // stacks. Failure (e.g. THP disabled) is harmless.
+      ::madvise(storage_, allocSize_ * kNumGuarded, MADV_HUGEPAGE);
+    }
+#else
+    (void)useHugePages;
+#endif
   }
 
   unsigned char* borrow(size_t size) {
@@ -83,18 +149,26 @@ class StackCache {
     assert(storage_);
 
     auto as = allocSize(size);
-    if (as != allocSize_ || freeList_.empty()) {
+    if (as != allocSize_) {
       return nullptr;
     }
 
-    auto p = freeList_.back().first;
-    if (!freeList_.back().second) {
+    unsigned char* p;
+    if (!freeList_.empty()) {
+      p = freeList_.back();
+      freeList_.pop_back();
+    } else if (numUsed_ < kNumGuarded && reserveGuarded()) {
+      /* Each guard page sits right below its own stack, so no two are
+         adjacent and they can't share an mprotect. Protect them on first
+         use instead, so that a mostly idle cache costs no syscalls. */
+      p = storage_ + allocSize_ * numUsed_++;
       PCHECK(0 == ::mprotect(p, pagesize(), PROT_NONE));
       SYNCHRONIZED(pages, protectedPages()) {
         pages.insert(reinterpret_cast<intptr_t>(p));
       }
+    } else {
+      return nullptr;
     }
-    freeList_.pop_back();
 
     /* We allocate minimum number of pages required, plus a guard page.
        Since we use this for stack storage, requested allocation is aligned
@@ -112,6 +186,13 @@ class StackCache {
     return limit;
   }
 
+  /**
+   * @return true if stacks of `size' bytes are borrowed from this cache.
+   */
+  bool servesSize(size_t size) const {
+    return allocSize(size) == allocSize_;
+  }
+
   bool giveBack(unsigned char* limit, size_t size) {
     std::lock_guard<folly::SpinLock> lg(lock_);
 
@@ -126,20 +207,32 @@ class StackCache {
 
     assert(as == allocSize_);
     assert((p - storage_) % allocSize_ == 0);
-    freeList_.emplace_back(p, /* protected= */ true);
+    freeList_.push_back(p);
     return true;
   }
 
   ~StackCache() {
     assert(storage_);
     SYNCHRONIZED(pages, protectedPages()) {
-      for (const auto& item : freeList_) {
-        pages.erase(reinterpret_cast<intptr_t>(item.first));
+      for (size_t i = 0; i < numUsed_; ++i) {
+        pages.erase(reinterpret_cast<intptr_t>(storage_ + allocSize_ * i));
       }
     }
     PCHECK(0 == ::munmap(storage_, allocSize_ * kNumGuarded));
   }
 
+  void addStats(GuardPageAllocator::StackPoolStats& stats) {
+    std::lock_guard<folly::SpinLock> lg(lock_);
+    stats.pools += 1;
+    stats.stacks += kNumGuarded;
+    stats.stacksInUse += numUsed_ - freeList_.size();
+    stats.bytesMapped += allocSize_ * kNumGuarded;
+  }
+
+  int numaNode() const {
+    return numaNode_;
+  }
+
   static bool isProtected(intptr_t addr) {
     // Use a read lock for reading.
     SYNCHRONIZED_CONST(pages, protectedPages()) {
@@ -157,11 +250,28 @@ class StackCache {
   folly::SpinLock lock_;
   unsigned char* storage_{nullptr};
   size_t allocSize_{0};
+  int numaNode_{-1};
 
   /**
-   * LIFO free list. Each pair contains stack pointer and protected flag.
+   * LIFO free list of stack allocations (guard page first). Only the first
+   * numUsed_ allocations have ever been handed out, and have their guard
+   * page protected.
    */
-  std::vector<std::pair<unsigned char*, bool>> freeList_;
+  std::vector<unsigned char*> freeList_;
+  size_t numUsed_{0};
+
+  /**
+   * Guarded stacks handed out by all the caches of the owning allocator.
+   */
+  std::atomic<size_t>& numGuarded_;
+
+  bool reserveGuarded() {
+    if (numGuarded_.fetch_add(1) < kNumGuarded) {
+      return true;
+    }
+    numGuarded_.fetch_sub(1);
+    return false;
+  }
 
   static size_t pagesize() {
     static const size_t pagesize = sysconf(_SC_PAGESIZE);
@@ -241,23 +351,48 @@ class CacheManager {
     return *inst;
   }
 
-  std::unique_ptr<StackCacheEntry> getStackCache(size_t stackSize) {
+  std::unique_ptr<StackCacheEntry> getStackCache(
+      bool nodeLocal,
+      bool useHugePages);
+
+  std::vector<GuardPageAllocator::StackPoolStats> getStats() {
+    std::vector<GuardPageAllocator::StackPoolStats> result;
     std::lock_guard<folly::SpinLock> lg(lock_);
-    if (inUse_ < kMaxInUse) {
-      ++inUse_;
-      return folly::make_unique<StackCacheEntry>(stackSize);
+    for (auto cache : caches_) {
+      auto it = std::find_if(
+          result.begin(),
+          result.end(),
+          [&](const GuardPageAllocator::StackPoolStats& stats) {
+            return stats.numaNode == cache->numaNode();
+          });
+      if (it == result.end()) {
+        result.emplace_back();
+        it = result.end() - 1;
+        it->numaNode = cache->numaNode();
+      }
+      cache->addStats(*it);
     }
-
-    return nullptr;
+    return result;
   }
 
  private:
   folly::SpinLock lock_;
   size_t inUse_{0};
+  std::vector<StackCache*> caches_;
 
   friend class StackCacheEntry;
 
-  void giveBack(std::unique_ptr<StackCache> /* stackCache_ */) {
+  void addCache(StackCache* cache) {
+    std::lock_guard<folly::SpinLock> lg(lock_);
+    caches_.push_back(cache);
+  }
+
+  void giveBack(std::vector<std::unique_ptr<StackCache>> stackCaches) {
+    std::lock_guard<folly::SpinLock> lg(lock_);
+    for (auto& stackCache : stackCaches) {
+      caches_.erase(
+          std::find(caches_.begin(), caches_.end(), stackCache.get()));
+    }
     assert(inUse_ > 0);
     --inUse_;
     /* Note: we can add a free list for each size bucket
@@ -271,28 +406,73 @@ class CacheManager {
 };
 
 /*
- * RAII Wrapper around a StackCache that calls
+ * The guarded stacks of one allocator: a StackCache for each stack size it
+ * has been asked for. Takes one of the kMaxInUse slots, and calls
  * CacheManager::giveBack() on destruction.
  */
 class StackCacheEntry {
  public:
-  explicit StackCacheEntry(size_t stackSize)
-      : stackCache_(folly::make_unique<StackCache>(stackSize)) {}
+  StackCacheEntry(bool nodeLocal, bool useHugePages)
+      : nodeLocal_(nodeLocal), useHugePages_(useHugePages) {}
 
-  StackCache& cache() const noexcept {
-    return *stackCache_;
+  unsigned char* borrow(size_t size) {
+    return cache(size).borrow(size);
+  }
+
+  bool giveBack(unsigned char* limit, size_t size) {
+    for (auto& stackCache : stackCaches_) {
+      if (stackCache->giveBack(limit, size)) {
+        return true;
+      }
+    }
+    return false;
   }
 
   ~StackCacheEntry() {
-    CacheManager::instance().giveBack(std::move(stackCache_));
+    CacheManager::instance().giveBack(std::move(stackCaches_));
   }
 
  private:
-  std::unique_ptr<StackCache> stackCache_;
+  /**
+   * Only a few sizes are expected to be used by a single allocator.
+   */
+  std::vector<std::unique_ptr<StackCache>> stackCaches_;
+  std::atomic<size_t> numGuarded_{0};
+  bool nodeLocal_;
+  bool useHugePages_;
+
+  StackCache& cache(size_t size) {
+    for (auto& stackCache : stackCaches_) {
+      if (stackCache->servesSize(size)) {
+        return *stackCache;
+      }
+    }
+    // Setting up the cache takes a while, don't hold the manager's lock.
+    stackCaches_.push_back(folly::make_unique<StackCache>(
+        size, nodeLocal_, useHugePages_, numGuarded_));
+    CacheManager::instance().addCache(stackCaches_.back().get());
+    return *stackCaches_.back();
+  }
 };
 
-GuardPageAllocator::GuardPageAllocator(bool useGuardPages)
-    : useGuardPages_(useGuardPages) {
+std::unique_ptr<StackCacheEntry> CacheManager::getStackCache(
+    bool nodeLocal,
+    bool useHugePages) {
+  std::lock_guard<folly::SpinLock> lg(lock_);
+  if (inUse_ == kMaxInUse) {
+    return nullptr;
+  }
+  ++inUse_;
+  return folly::make_unique<StackCacheEntry>(nodeLocal, useHugePages);
+}
+
+GuardPageAllocator::GuardPageAllocator(
+    bool useGuardPages,
+    bool nodeLocal,
+    bool useHugePages)
+    : useGuardPages_(useGuardPages),
+      nodeLocal_(nodeLocal),
+      useHugePages_(useHugePages) {
 #ifndef _WIN32
   installSignalHandler();
 #endif
@@ -302,11 +482,12 @@ GuardPageAllocator::~GuardPageAllocator() = default;
 
 unsigned char* GuardPageAllocator::allocate(size_t size) {
   if (useGuardPages_ && !stackCache_) {
-    stackCache_ = CacheManager::instance().getStackCache(size);
+    stackCache_ =
+        CacheManager::instance().getStackCache(nodeLocal_, useHugePages_);
   }
 
   if (stackCache_) {
-    auto p = stackCache_->cache().borrow(size);
+    auto p = stackCache_->borrow(size);
     if (p != nullptr) {
       return p;
     }
@@ -314,10 +495,16 @@ unsigned char* GuardPageAllocator::allocate(size_t size) {
   return fallbackAllocator_.allocate(size);
 }
 
+std::vector<GuardPageAllocator::StackPoolStats>
+GuardPageAllocator::getStackPoolStats() {
+  return CacheManager::instance().getStats();
+}
+
 void GuardPageAllocator::deallocate(unsigned char* limit, size_t size) {
-  if (!(stackCache_ && stackCache_->cache().giveBack(limit, size))) {
-    fallbackAllocator_.deallocate(limit, size);
+  if (stackCache_ && stackCache_->giveBack(limit, size)) {
+    return;
   }
+  fallbackAllocator_.deallocate(limit, size);
 }
 }
 } // folly::fibers
@@ -16,6 +16,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 namespace folly {
 namespace fibers {
@@ -27,16 +28,42 @@ class StackCacheEntry;
  * the end of the stack.
  * Will only add extra memory pages up to a certain number of allocations
  * to avoid creating too many memory maps for the process.
+ * Stacks of all sizes share the allocator's guarded stacks and its slot in
+ * the process-wide limit on allocators with guarded stacks.
  */
 class GuardPageAllocator {
  public:
+  /**
+   * Occupancy of the guarded stack pools on one NUMA node.
+   */
+  struct StackPoolStats {
+    int numaNode{-1}; /**< -1 for pools not bound to a node */
+    size_t pools{0}; /**< number of pools */
+    size_t stacks{0}; /**< stacks in these pools */
+    size_t stacksInUse{0}; /**< of which currently handed out */
+    size_t bytesMapped{0}; /**< memory reserved by these pools */
+  };
+
   /**
    * @param useGuardPages if true, protect limited amount of stacks with guard
    *                      pages, otherwise acts as std::allocator.
+   * @param nodeLocal     if true, guarded stacks come from the memory of the
+   *                      NUMA node of the thread which first allocates them.
+   * @param useHugePages  if true, ask for transparent huge pages to back the
+   *                      guarded stacks.
    */
-  explicit GuardPageAllocator(bool useGuardPages);
+  explicit GuardPageAllocator(
+      bool useGuardPages,
+      bool nodeLocal = true,
+      bool useHugePages = false);
   ~GuardPageAllocator();
 
+  /**
+   * @return occupancy of the guarded stack pools of all the allocators in
+   *         the process, one entry per NUMA node.
+   */
+  static std::vector<StackPoolStats> getStackPoolStats();
+
   /**
    * @return pointer to the bottom of the allocated stack of `size' bytes.
    */
@@ -48,9 +75,14 @@ class GuardPageAllocator {
   void deallocate(unsigned char* limit, size_t size);
 
  private:
+  /**
+   * Guarded stacks of all sizes, set up on the first allocation.
+   */
   std::unique_ptr<StackCacheEntry> stackCache_;
   std::allocator<unsigned char> fallbackAllocator_;
   bool useGuardPages_{true};
+  bool nodeLocal_{true};
+  bool useHugePages_{false};
 };
 }
 } // folly::fibers
@@ -57,6 +57,16 @@ class LoopController {
    * Called by FiberManager to schedule some function to be run at some time.
    */
   virtual void timedSchedule(std::function<void()> func, TimePoint time) = 0;
+
+  /**
+   * Whether the loop has run out of work and is waiting for more. Used by
+   * FiberManagerGroup to find FiberManagers that can take over queued tasks;
+   * controllers which can't tell should return false. Safe to call from any
+   * thread.
+   */
+  virtual bool isIdle() const {
+    return false;
+  }
 };
 }
 } // folly::fibers
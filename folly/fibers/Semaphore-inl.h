@@ -0,0 +1,99 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+namespace folly {
+namespace fibers {
+
+template <typename BatonType>
+void TimedSemaphore<BatonType>::wait() {
+  pthread_spin_lock(&lock_);
+  if (tokens_ > 0) {
+    --tokens_;
+    pthread_spin_unlock(&lock_);
+    return;
+  }
+
+  Waiter waiter;
+  waiters_.push_back(waiter);
+  pthread_spin_unlock(&lock_);
+  // signal() hands its token straight to us.
+  waiter.baton.wait();
+}
+
+template <typename BatonType>
+template <typename Rep, typename Period>
+bool TimedSemaphore<BatonType>::timed_wait(
+    const std::chrono::duration<Rep, Period>& duration) {
+  pthread_spin_lock(&lock_);
+  if (tokens_ > 0) {
+    --tokens_;
+    pthread_spin_unlock(&lock_);
+    return true;
+  }
+
+  Waiter waiter;
+  waiters_.push_back(waiter);
+  pthread_spin_unlock(&lock_);
+
+  if (!waiter.baton.timed_wait(duration)) {
+    // If we're no longer in the waiter list, a token was handed to us just
+    // as we timed out; keep it.
+    pthread_spin_lock(&lock_);
+    if (waiter.hook.is_linked()) {
+      waiters_.erase(waiters_.iterator_to(waiter));
+      pthread_spin_unlock(&lock_);
+      return false;
+    }
+    pthread_spin_unlock(&lock_);
+  }
+  return true;
+}
+
+template <typename BatonType>
+bool TimedSemaphore<BatonType>::try_wait() {
+  pthread_spin_lock(&lock_);
+  if (tokens_ == 0) {
+    pthread_spin_unlock(&lock_);
+    return false;
+  }
+  --tokens_;
+  pthread_spin_unlock(&lock_);
+  return true;
+}
+
+template <typename BatonType>
+void TimedSemaphore<BatonType>::signal(size_t n) {
+  pthread_spin_lock(&lock_);
+  while (n > 0 && !waiters_.empty()) {
+    Waiter& to_wake = waiters_.front();
+    waiters_.pop_front();
+    to_wake.baton.post();
+    --n;
+  }
+  tokens_ += n;
+  pthread_spin_unlock(&lock_);
+}
+
+template <typename BatonType>
+size_t TimedSemaphore<BatonType>::getAvailableTokens() {
+  pthread_spin_lock(&lock_);
+  auto tokens = tokens_;
+  pthread_spin_unlock(&lock_);
+  return tokens;
+}
+}
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <pthread.h>
+
+#include <boost/intrusive/list.hpp>
+
+#include <folly/fibers/GenericBaton.h>
+
+namespace folly {
+namespace fibers {
+
+/**
+ * @class TimedSemaphore
+ *
+ * A counting semaphore, e.g. for bounding the number of requests in flight.
+ * Blocks the calling fiber (or thread, when not on a fiber) while no tokens
+ * are available. Tokens are handed to waiters in FIFO order.
+ **/
+template <typename BatonType>
+class TimedSemaphore {
+ public:
+  explicit TimedSemaphore(size_t tokens) : tokens_(tokens) {
+    pthread_spin_init(&lock_, PTHREAD_PROCESS_PRIVATE);
+  }
+
+  ~TimedSemaphore() {
+    pthread_spin_destroy(&lock_);
+  }
+
+  TimedSemaphore(const TimedSemaphore& rhs) = delete;
+  TimedSemaphore& operator=(const TimedSemaphore& rhs) = delete;
+  TimedSemaphore(TimedSemaphore&& rhs) = delete;
+  TimedSemaphore& operator=(TimedSemaphore&& rhs) = delete;
+
+  // Take a token. The thread / fiber is blocked until one is available.
+  void wait();
+
+  // Take a token. The thread / fiber will be blocked for a time duration.
+  //
+  // @return        true if a token was taken, false otherwise
+  template <typename Rep, typename Period>
+  bool timed_wait(const std::chrono::duration<Rep, Period>& duration);
+
+  // Try to take a token without blocking the thread or fiber
+  bool try_wait();
+
+  // Return n tokens, handing them to up to n waiters
+  void signal(size_t n = 1);
+
+  // @return        number of tokens which can be taken without blocking
+  size_t getAvailableTokens();
+
+ private:
+  typedef boost::intrusive::list_member_hook<> WaiterHookType;
+
+  struct Waiter {
+    BatonType baton;
+    WaiterHookType hook;
+  };
+
+  typedef boost::intrusive::member_hook<Waiter, WaiterHookType, &Waiter::hook>
+      WaiterHook;
+
+  typedef boost::intrusive::
+      list<Waiter, WaiterHook, boost::intrusive::constant_time_size<true>>
+          WaiterList;
+
+  pthread_spinlock_t lock_; //< lock to protect tokens_ and waiters_
+  size_t tokens_; //< tokens available (always 0 if there are waiters)
+  WaiterList waiters_; //< list of waiters
+};
+}
+}
+
+#include "Semaphore-inl.h"
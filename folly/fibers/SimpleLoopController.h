@@ -54,7 +54,9 @@ class SimpleLoopController : public LoopController {
 
       if (scheduled_) {
         scheduled_ = false;
+        idle_ = false;
         waiting = fm_->loopUntilNoReady();
+        idle_ = true;
       }
     }
   }
@@ -81,6 +83,7 @@ class SimpleLoopController : public LoopController {
  private:
   FiberManager* fm_;
   std::atomic<bool> scheduled_{false};
+  std::atomic<bool> idle_{true};
   bool stopRequested_;
   std::atomic<int> remoteScheduleCalled_{0};
   std::vector<std::pair<TimePoint, std::function<void()>>> scheduledFuncs_;
@@ -102,6 +105,10 @@ class SimpleLoopController : public LoopController {
     }
   }
 
+  bool isIdle() const override {
+    return idle_ && !scheduled_;
+  }
+
   friend class FiberManager;
 };
 }
@@ -20,9 +20,14 @@
 #include <queue>
 
 #include <folly/Benchmark.h>
+#include <folly/fibers/BatchBaton.h>
+#include <folly/fibers/FiberManagerGroup.h>
+#include <folly/fibers/Semaphore.h>
 #include <folly/fibers/SimpleLoopController.h>
+#include <folly/fibers/TimedMutex.h>
 #include <folly/init/Init.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
 
 using namespace folly::fibers;
 
@@ -72,6 +77,33 @@ BENCHMARK(FiberManagerBasicFiveAwaits, iters) {
   runBenchmark(5, iters);
 }
 
+static FContext::ContextStruct sMainContext;
+static FContext sFiberContext;
+
+static void switchBackForever(intptr_t) {
+  while (true) {
+    jumpContext(&sFiberContext, &sMainContext, 0);
+  }
+}
+
+/**
+ * A single context switch, without any FiberManager bookkeeping. Every
+ * iteration switches to a fiber and back, so this reports the time of two
+ * switches.
+ */
+BENCHMARK(FiberContextSwitchRoundTrip, iters) {
+  static const size_t kStackSize = 16 * 1024;
+
+  folly::BenchmarkSuspender suspender;
+  std::vector<unsigned char> stack(kStackSize);
+  sFiberContext = makeContext(stack.data(), kStackSize, &switchBackForever);
+  suspender.dismiss();
+
+  for (size_t i = 0; i < iters; ++i) {
+    jumpContext(&sMainContext, &sFiberContext, 0);
+  }
+}
+
 BENCHMARK(FiberManagerCreateDestroy, iters) {
   for (size_t i = 0; i < iters; ++i) {
     folly::EventBase evb;
@@ -128,6 +160,144 @@ BENCHMARK(FiberManagerAllocateLargeChunk, iters) {
   }
 }
 
+/**
+ * All the work is submitted to one of kNumThreads FiberManagers, each on its
+ * own thread. Without a FiberManagerGroup that one thread runs everything.
+ */
+void runSkewedBenchmark(size_t iters, bool useGroup) {
+  static const size_t kNumThreads = 4;
+  static const size_t kNumTasks = 1000;
+  static const size_t kTaskSpins = 10000;
+
+  folly::BenchmarkSuspender suspender;
+
+  std::vector<std::unique_ptr<folly::ScopedEventBaseThread>> threads;
+  std::vector<FiberManager*> fms;
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    threads.push_back(folly::make_unique<folly::ScopedEventBaseThread>());
+    auto evb = threads.back()->getEventBase();
+    evb->runInEventBaseThreadAndWait(
+        [&] { fms.push_back(&getFiberManager(*evb)); });
+  }
+
+  FiberManagerGroup group;
+  if (useGroup) {
+    for (auto fm : fms) {
+      group.add(*fm);
+    }
+  }
+
+  suspender.dismiss();
+
+  for (size_t iter = 0; iter < iters; ++iter) {
+    std::atomic<size_t> done{0};
+    for (size_t i = 0; i < kNumTasks; ++i) {
+      fms[0]->addTaskStealable([&done] {
+        for (size_t spin = 0; spin < kTaskSpins; ++spin) {
+          folly::doNotOptimizeAway(spin);
+        }
+        ++done;
+      });
+    }
+    while (done < kNumTasks) {
+      std::this_thread::yield();
+    }
+  }
+
+  suspender.rehire();
+}
+
+BENCHMARK(FiberManagerSkewedNoStealing, iters) {
+  runSkewedBenchmark(iters, false);
+}
+
+BENCHMARK_RELATIVE(FiberManagerSkewedStealing, iters) {
+  runSkewedBenchmark(iters, true);
+}
+
+/**
+ * kNumFibers fibers take turns holding a lock, yielding while holding it, so
+ * that the others queue up behind it. Reports the time per acquisition.
+ */
+template <typename Lock, typename Unlock>
+void runContentionBenchmark(size_t iters, Lock&& lock, Unlock&& unlock) {
+  static const size_t kNumFibers = 100;
+
+  folly::BenchmarkSuspender suspender;
+
+  FiberManager fiberManager(folly::make_unique<SimpleLoopController>());
+  auto& loopController =
+      dynamic_cast<SimpleLoopController&>(fiberManager.loopController());
+
+  for (size_t i = 0; i < kNumFibers; ++i) {
+    fiberManager.addTask([&, i]() {
+      for (size_t j = i; j < iters; j += kNumFibers) {
+        lock();
+        yield();
+        unlock();
+      }
+    });
+  }
+
+  suspender.dismiss();
+  loopController.loop([&]() { loopController.stop(); });
+  suspender.rehire();
+}
+
+BENCHMARK(FiberTimedMutexContention, iters) {
+  TimedMutex<Baton> mutex;
+  runContentionBenchmark(
+      iters, [&] { mutex.lock(); }, [&] { mutex.unlock(); });
+}
+
+BENCHMARK_RELATIVE(FiberTimedRWMutexReadContention, iters) {
+  TimedRWMutex<Baton> mutex;
+  runContentionBenchmark(
+      iters, [&] { mutex.read_lock(); }, [&] { mutex.unlock(); });
+}
+
+BENCHMARK_RELATIVE(FiberSemaphoreContention, iters) {
+  TimedSemaphore<Baton> sem(10);
+  runContentionBenchmark(iters, [&] { sem.wait(); }, [&] { sem.signal(); });
+}
+
+/**
+ * One fiber waits for kNumPosts batons, posted from the main context.
+ */
+BENCHMARK(FiberBatonsWaitEach, iters) {
+  static const size_t kNumPosts = 100;
+
+  FiberManager fiberManager(folly::make_unique<SimpleLoopController>());
+  for (size_t iter = 0; iter < iters; ++iter) {
+    std::vector<Baton> batons(kNumPosts);
+    fiberManager.addTask([&]() {
+      for (auto& baton : batons) {
+        baton.wait();
+      }
+    });
+    fiberManager.loopUntilNoReady();
+    for (auto& baton : batons) {
+      baton.post();
+    }
+    fiberManager.loopUntilNoReady();
+  }
+}
+
+BENCHMARK_RELATIVE(FiberBatchBatonWaitAll, iters) {
+  static const size_t kNumPosts = 100;
+
+  FiberManager fiberManager(folly::make_unique<SimpleLoopController>());
+  for (size_t iter = 0; iter < iters; ++iter) {
+    BatchBaton<Baton> batch(kNumPosts);
+    fiberManager.addTask([&]() { batch.waitAll(); });
+    fiberManager.loopUntilNoReady();
+    for (size_t i = 0; i < kNumPosts; ++i) {
+      batch.post(i);
+    }
+    fiberManager.loopUntilNoReady();
+  }
+}
+
 int main(int argc, char** argv) {
   folly::init(&argc, &argv, true);
 
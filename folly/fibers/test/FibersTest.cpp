@@ -23,11 +23,17 @@
 #include <folly/futures/Future.h>
 
 #include <folly/fibers/AddTasks.h>
+#include <folly/fibers/BatchBaton.h>
+#include <folly/fibers/ConditionVariable.h>
 #include <folly/fibers/EventBaseLoopController.h>
 #include <folly/fibers/FiberManager.h>
+#include <folly/fibers/FiberManagerGroup.h>
 #include <folly/fibers/FiberManagerMap.h>
 #include <folly/fibers/GenericBaton.h>
+#include <folly/fibers/GuardPageAllocator.h>
+#include <folly/fibers/Semaphore.h>
 #include <folly/fibers/SimpleLoopController.h>
+#include <folly/fibers/TimedMutex.h>
 #include <folly/fibers/WhenN.h>
 
 using namespace folly::fibers;
@@ -274,6 +280,178 @@ TEST(FiberManager, genericBatonThreadWait) {
   thr.join();
 }
 
+TEST(FiberManager, semaphore) {
+  FiberManager manager(folly::make_unique<SimpleLoopController>());
+  auto& loopController =
+      dynamic_cast<SimpleLoopController&>(manager.loopController());
+
+  TimedSemaphore<Baton> sem(2);
+  size_t running = 0;
+  size_t maxRunning = 0;
+  size_t done = 0;
+  for (size_t i = 0; i < 10; ++i) {
+    manager.addTask([&]() {
+      sem.wait();
+      maxRunning = std::max(maxRunning, ++running);
+      yield();
+      --running;
+      sem.signal();
+      ++done;
+    });
+  }
+
+  loopController.loop([&]() { loopController.stop(); });
+
+  EXPECT_EQ(10, done);
+  EXPECT_EQ(2, maxRunning);
+  EXPECT_EQ(2, sem.getAvailableTokens());
+}
+
+TEST(FiberManager, semaphoreSignalMany) {
+  FiberManager manager(folly::make_unique<SimpleLoopController>());
+
+  TimedSemaphore<Baton> sem(0);
+  size_t done = 0;
+  for (size_t i = 0; i < 5; ++i) {
+    manager.addTask([&]() {
+      sem.wait();
+      ++done;
+    });
+  }
+  manager.loopUntilNoReady();
+  EXPECT_EQ(0, done);
+  EXPECT_FALSE(sem.try_wait());
+
+  std::thread remote([&]() { sem.signal(3); });
+  remote.join();
+  manager.loopUntilNoReady();
+  EXPECT_EQ(3, done);
+
+  sem.signal(4);
+  manager.loopUntilNoReady();
+  EXPECT_EQ(5, done);
+  EXPECT_EQ(2, sem.getAvailableTokens());
+  EXPECT_TRUE(sem.try_wait());
+  EXPECT_EQ(1, sem.getAvailableTokens());
+}
+
+TEST(FiberManager, semaphoreThreads) {
+  TimedSemaphore<Baton> sem(0);
+  EXPECT_FALSE(sem.timed_wait(std::chrono::milliseconds(10)));
+
+  std::atomic<bool> taken{false};
+  std::thread waiter([&]() {
+    sem.wait();
+    taken = true;
+  });
+  sem.signal();
+  waiter.join();
+  EXPECT_TRUE(taken);
+  EXPECT_EQ(0, sem.getAvailableTokens());
+}
+
+TEST(FiberManager, conditionVariable) {
+  FiberManager manager(folly::make_unique<SimpleLoopController>());
+  auto& loopController =
+      dynamic_cast<SimpleLoopController&>(manager.loopController());
+
+  TimedMutex<Baton> mutex;
+  TimedConditionVariable<Baton> cv;
+  bool ready = false;
+  size_t woken = 0;
+  for (size_t i = 0; i < 5; ++i) {
+    manager.addTask([&]() {
+      std::unique_lock<TimedMutex<Baton>> lock(mutex);
+      cv.wait(lock, [&]() { return ready; });
+      ++woken;
+    });
+  }
+  manager.addTask([&]() {
+    {
+      std::unique_lock<TimedMutex<Baton>> lock(mutex);
+      ready = true;
+    }
+    cv.notify_all();
+  });
+
+  loopController.loop([&]() { loopController.stop(); });
+  EXPECT_EQ(5, woken);
+}
+
+TEST(FiberManager, conditionVariableTimedWait) {
+  FiberManager manager(folly::make_unique<SimpleLoopController>());
+  auto& loopController =
+      dynamic_cast<SimpleLoopController&>(manager.loopController());
+
+  TimedMutex<Baton> mutex;
+  TimedConditionVariable<Baton> cv;
+  bool timedOut = false;
+  bool notified = false;
+  manager.addTask([&]() {
+    std::unique_lock<TimedMutex<Baton>> lock(mutex);
+    timedOut = !cv.timed_wait(lock, std::chrono::milliseconds(10));
+    EXPECT_TRUE(lock.owns_lock());
+  });
+  manager.addTask([&]() {
+    std::unique_lock<TimedMutex<Baton>> lock(mutex);
+    notified = cv.timed_wait(lock, std::chrono::seconds(10));
+    loopController.stop();
+  });
+
+  loopController.loop([&]() {
+    if (timedOut) {
+      cv.notify_one();
+    }
+  });
+  EXPECT_TRUE(timedOut);
+  EXPECT_TRUE(notified);
+}
+
+TEST(FiberManager, batchBaton) {
+  FiberManager manager(folly::make_unique<SimpleLoopController>());
+
+  BatchBaton<Baton> batch(3);
+  std::vector<size_t> order;
+  bool allPosted = false;
+  manager.addTask([&]() {
+    for (size_t i = 0; i < batch.size(); ++i) {
+      order.push_back(batch.waitAny());
+    }
+    batch.waitAll();
+    allPosted = true;
+  });
+  manager.loopUntilNoReady();
+  EXPECT_TRUE(order.empty());
+
+  std::thread remote([&]() { batch.post(2); });
+  remote.join();
+  manager.loopUntilNoReady();
+  EXPECT_EQ((std::vector<size_t>{2}), order);
+
+  batch.post(0);
+  batch.post(1);
+  manager.loopUntilNoReady();
+  EXPECT_EQ((std::vector<size_t>{2, 0, 1}), order);
+  EXPECT_TRUE(allPosted);
+}
+
+TEST(FiberManager, batchBatonThreads) {
+  BatchBaton<Baton> batch(10);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < batch.size(); ++i) {
+    threads.emplace_back([&batch, i]() { batch.post(i); });
+  }
+  batch.waitAll();
+  std::vector<bool> seen(batch.size());
+  for (size_t i = 0; i < batch.size(); ++i) {
+    seen[batch.waitAny()] = true;
+  }
+  EXPECT_EQ(std::vector<bool>(batch.size(), true), seen);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
 TEST(FiberManager, addTasksNoncopyable) {
   std::vector<Promise<int>> pendingFibers;
   bool taskAdded = false;
@@ -1026,6 +1204,141 @@ TEST(FiberManager, fibersPoolOverLimit) {
   EXPECT_EQ(5, manager.fibersPoolSize());
 }
 
+TEST(FiberManager, addTaskSizedSmallStack) {
+  FiberManager::Options opts;
+  opts.stackSize = 64 * 1024;
+  opts.minStackSize = 4096;
+
+  FiberManager manager(folly::make_unique<SimpleLoopController>(), opts);
+
+  std::vector<size_t> stackSizes;
+  for (size_t i = 0; i < 3; ++i) {
+    manager.addTaskSized([&]() {
+      stackSizes.push_back(manager.currentFiber()->getStack().second);
+    });
+    manager.loopUntilNoReady();
+  }
+
+  // The first run measures the stack usage on a full-size stack.
+  EXPECT_EQ((std::vector<size_t>{64 * 1024, 4096, 4096}), stackSizes);
+  EXPECT_GT(manager.stackHighWatermark(), 0);
+  EXPECT_LE(manager.stackHighWatermark(), 2048);
+  EXPECT_EQ(2, manager.fibersAllocated());
+  EXPECT_EQ(2, manager.fibersPoolSize());
+}
+
+namespace {
+FOLLY_NOINLINE void useStack(size_t bytes) {
+  volatile char buffer[2048];
+  for (size_t i = 0; i < bytes && i < sizeof(buffer); ++i) {
+    buffer[i] = 0;
+  }
+}
+}
+
+TEST(FiberManager, addTaskSizedPromotion) {
+  FiberManager::Options opts;
+  opts.stackSize = 64 * 1024;
+  opts.minStackSize = 4096;
+
+  FiberManager manager(folly::make_unique<SimpleLoopController>(), opts);
+
+  std::vector<size_t> stackSizes;
+  auto run = [&](bool deep) {
+    manager.addTaskSized([&manager, &stackSizes, deep]() {
+      stackSizes.push_back(manager.currentFiber()->getStack().second);
+      if (deep) {
+        useStack(2048);
+      }
+    });
+    manager.loopUntilNoReady();
+  };
+
+  run(false);
+  run(false);
+  // Still fits the small stack, but leaves less than half of it unused...
+  run(true);
+  // ...so the call site is moved to the next size class.
+  run(false);
+  run(false);
+
+  EXPECT_EQ(
+      (std::vector<size_t>{64 * 1024, 4096, 4096, 8192, 8192}), stackSizes);
+}
+
+namespace {
+size_t guardedStacksInUse() {
+  size_t result = 0;
+  for (const auto& stats : GuardPageAllocator::getStackPoolStats()) {
+    EXPECT_LE(stats.stacksInUse, stats.stacks);
+    EXPECT_LE(stats.stacks * 4096, stats.bytesMapped);
+    result += stats.stacksInUse;
+  }
+  return result;
+}
+}
+
+TEST(FiberManager, stackPoolStats) {
+  auto inUseBefore = guardedStacksInUse();
+  {
+    FiberManager manager(folly::make_unique<SimpleLoopController>());
+
+    std::vector<Baton> batons(3);
+    for (auto& baton : batons) {
+      manager.addTask([&baton]() { baton.wait(); });
+    }
+    manager.loopUntilNoReady();
+    EXPECT_EQ(inUseBefore + 3, guardedStacksInUse());
+
+    for (auto& baton : batons) {
+      baton.post();
+    }
+    manager.loopUntilNoReady();
+  }
+  EXPECT_EQ(inUseBefore, guardedStacksInUse());
+}
+
+TEST(FiberManager, stackSizeClassesShareGuardedStacks) {
+  // Each manager uses two stack sizes; together that is more size classes
+  // than there are allocator slots, but every manager takes only one slot.
+  FiberManager::Options opts;
+  opts.stackSize = 64 * 1024;
+  opts.minStackSize = 4096;
+
+  // All the tasks waiting on a baton share one call site; run it once so
+  // that its stack usage is known and it moves to a small stack.
+  auto waitOn = [](Baton& baton) { return [&baton]() { baton.wait(); }; };
+  {
+    FiberManager manager(folly::make_unique<SimpleLoopController>(), opts);
+    Baton baton;
+    baton.post();
+    manager.addTaskSized(waitOn(baton));
+    manager.loopUntilNoReady();
+  }
+
+  auto inUseBefore = guardedStacksInUse();
+  std::vector<std::unique_ptr<FiberManager>> managers;
+  std::vector<Baton> batons(2 * 60);
+  for (size_t i = 0; i < 60; ++i) {
+    managers.push_back(folly::make_unique<FiberManager>(
+        folly::make_unique<SimpleLoopController>(), opts));
+    auto& manager = *managers.back();
+    auto& small = batons[2 * i];
+    auto& large = batons[2 * i + 1];
+    manager.addTaskSized(waitOn(small));
+    manager.addTask(waitOn(large));
+    manager.loopUntilNoReady();
+  }
+  EXPECT_EQ(inUseBefore + batons.size(), guardedStacksInUse());
+
+  for (auto& baton : batons) {
+    baton.post();
+  }
+  for (auto& manager : managers) {
+    manager->loopUntilNoReady();
+  }
+}
+
 TEST(FiberManager, remoteFiberBasic) {
   FiberManager manager(folly::make_unique<SimpleLoopController>());
   auto& loopController =
@@ -1512,6 +1825,111 @@ TEST(FiberManager, remoteFutureVoidUnitTest) {
   ASSERT_TRUE(ranRemote);
 }
 
+TEST(FiberManager, addTaskStealableNoGroup) {
+  FiberManager fm(folly::make_unique<SimpleLoopController>());
+  auto& loopController =
+      dynamic_cast<SimpleLoopController&>(fm.loopController());
+
+  std::vector<int> ran;
+  std::thread remote([&]() {
+    for (int i = 0; i < 3; ++i) {
+      fm.addTaskStealable([&ran, i]() { ran.push_back(i); });
+    }
+  });
+  remote.join();
+
+  EXPECT_EQ(3, fm.stealableQueueSize());
+  EXPECT_TRUE(fm.hasTasks());
+  /* Should only have scheduled once */
+  EXPECT_EQ(1, loopController.remoteScheduleCalled());
+
+  fm.loopUntilNoReady();
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), ran);
+  EXPECT_EQ(0, fm.stealableQueueSize());
+  EXPECT_FALSE(fm.hasTasks());
+}
+
+TEST(FiberManager, stealableTasksMoveToIdlePeer) {
+  FiberManager busy(folly::make_unique<SimpleLoopController>());
+  FiberManager idle(folly::make_unique<SimpleLoopController>());
+  auto& idleController =
+      dynamic_cast<SimpleLoopController&>(idle.loopController());
+
+  FiberManagerGroup::Options options;
+  options.wakeThreshold = 4;
+  FiberManagerGroup group(options);
+  group.add(busy);
+  group.add(idle);
+  EXPECT_EQ(2, group.size());
+
+  size_t ranOnIdle = 0;
+  for (int i = 0; i < 10; ++i) {
+    busy.addTaskStealable([&]() {
+      if (FiberManager::getFiberManagerUnsafe() == &idle) {
+        ++ranOnIdle;
+      }
+    });
+  }
+  // Reaching the threshold woke up the idle peer.
+  EXPECT_EQ(1, idleController.remoteScheduleCalled());
+
+  idle.loopUntilNoReady();
+  EXPECT_EQ(10, ranOnIdle);
+  EXPECT_EQ(0, busy.stealableQueueSize());
+
+  busy.loopUntilNoReady();
+  EXPECT_FALSE(busy.hasTasks());
+
+  group.remove(idle);
+  EXPECT_EQ(1, group.size());
+  busy.addTaskStealable([]() {});
+  idle.loopUntilNoReady();
+  EXPECT_EQ(1, busy.stealableQueueSize());
+  busy.loopUntilNoReady();
+  EXPECT_EQ(0, busy.stealableQueueSize());
+}
+
+TEST(FiberManager, stealableTasksBlockedThread) {
+  folly::EventBase evb1;
+  folly::EventBase evb2;
+  auto& fm1 = getFiberManager(evb1);
+  auto& fm2 = getFiberManager(evb2);
+
+  FiberManagerGroup group;
+  group.add(fm1);
+  group.add(fm2);
+
+  std::thread t1([&]() { evb1.loopForever(); });
+  std::thread t2([&]() { evb2.loopForever(); });
+
+  constexpr size_t kTasks = 20;
+  std::atomic<size_t> done{0};
+  std::atomic<bool> unblocked{false};
+  // Whichever thread runs the first task is stuck until all the other tasks
+  // are done, so they can only complete on the other thread.
+  fm1.addTaskStealable([&]() {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (done < kTasks - 1 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::yield();
+    }
+    unblocked = done == kTasks - 1;
+    ++done;
+  });
+  for (size_t i = 1; i < kTasks; ++i) {
+    fm1.addTaskStealable([&]() { ++done; });
+  }
+
+  while (done < kTasks) {
+    std::this_thread::yield();
+  }
+  EXPECT_TRUE(unblocked);
+
+  evb1.terminateLoopSoon();
+  evb2.terminateLoopSoon();
+  t1.join();
+  t2.join();
+}
+
 TEST(FiberManager, nestedFiberManagers) {
   folly::EventBase outerEvb;
   folly::EventBase innerEvb;
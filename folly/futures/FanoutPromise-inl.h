@@ -0,0 +1,159 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace folly {
+
+template <class T>
+FanoutPromise<T>::~FanoutPromise() {
+  // Destroying the Promises of any remaining waiters breaks them.
+  auto waiter = head_.exchange(fulfilled(), std::memory_order_acquire);
+  while (waiter != nullptr && waiter != fulfilled()) {
+    auto next = waiter->next;
+    delete waiter;
+    waiter = next;
+  }
+}
+
+template <class T>
+Future<typename FanoutPromise<T>::Result> FanoutPromise<T>::getFuture() {
+  return getFuture(nullptr);
+}
+
+template <class T>
+Future<typename FanoutPromise<T>::Result> FanoutPromise<T>::getFuture(
+    Executor* executor) {
+  size_.fetch_add(1, std::memory_order_relaxed);
+
+  auto head = head_.load(std::memory_order_acquire);
+  if (head != fulfilled()) {
+    auto waiter = new Waiter(executor);
+    auto f = waiter->promise.getFuture();
+    do {
+      waiter->next = head;
+      if (head_.compare_exchange_weak(
+              head,
+              waiter,
+              std::memory_order_release,
+              std::memory_order_acquire)) {
+        return f;
+      }
+    } while (head != fulfilled());
+    // Lost the race with setTry(); nobody else has seen this waiter.
+    delete waiter;
+  }
+
+  auto f = makeFuture<Result>(Try<Result>(result_));
+  return executor ? f.via(executor) : std::move(f);
+}
+
+template <class T>
+void FanoutPromise<T>::setException(exception_wrapper ew) {
+  setTry(Try<T>(std::move(ew)));
+}
+
+template <class T>
+template <class M>
+void FanoutPromise<T>::setValue(M&& v) {
+  setTry(Try<T>(std::forward<M>(v)));
+}
+
+template <class T>
+template <class F>
+void FanoutPromise<T>::setWith(F&& func) {
+  setTry(makeTryWith(std::forward<F>(func)));
+}
+
+template <class T>
+void FanoutPromise<T>::setTry(Try<T>&& t) {
+  if (hasValue_.exchange(true, std::memory_order_relaxed)) {
+    throw PromiseAlreadySatisfied();
+  }
+
+  if (t.hasValue()) {
+    result_ = Try<Result>(std::make_shared<const T>(std::move(t.value())));
+  } else {
+    result_ = Try<Result>(std::move(t.exception()));
+  }
+
+  auto waiter = head_.exchange(fulfilled(), std::memory_order_acq_rel);
+
+  // The list is LIFO; complete waiters in the order they called getFuture(),
+  // grouped by Executor, and the groups in the order their Executor was
+  // first asked for.
+  struct Group {
+    Executor* executor;
+    Waiter* head;
+    Waiter* tail;
+  };
+  std::vector<Group> groups;
+  std::unordered_map<Executor*, size_t> groupIndex;
+  Waiter* reversed = nullptr;
+  while (waiter != nullptr) {
+    auto next = waiter->next;
+    waiter->next = reversed;
+    reversed = waiter;
+    waiter = next;
+  }
+  while (reversed != nullptr) {
+    auto next = reversed->next;
+    reversed->next = nullptr;
+    auto inserted = groupIndex.emplace(reversed->executor, groups.size());
+    if (inserted.second) {
+      groups.push_back(Group{reversed->executor, reversed, reversed});
+    } else {
+      auto& group = groups[inserted.first->second];
+      group.tail->next = reversed;
+      group.tail = reversed;
+    }
+    reversed = next;
+  }
+
+  Waiter* inlineWaiters = nullptr;
+  for (auto& group : groups) {
+    if (group.executor == nullptr) {
+      inlineWaiters = group.head;
+      continue;
+    }
+    auto waiters = group.head;
+    auto result = result_;
+    try {
+      group.executor->add([waiters, result] { fulfil(waiters, result); });
+    } catch (...) {
+      // The task never made it onto the Executor; fail its waiters here
+      // rather than leaking them, as a Future's callback would be.
+      fulfil(waiters, Try<Result>(exception_wrapper(std::current_exception())));
+    }
+  }
+  fulfil(inlineWaiters, result_);
+}
+
+template <class T>
+void FanoutPromise<T>::fulfil(Waiter* waiter, const Try<Result>& result) {
+  while (waiter != nullptr) {
+    auto next = waiter->next;
+    waiter->promise.setTry(Try<Result>(result));
+    delete waiter;
+    waiter = next;
+  }
+}
+
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include <folly/Executor.h>
+#include <folly/futures/Promise.h>
+
+namespace folly {
+
+/*
+ * FanoutPromise is a SharedPromise for large numbers of waiters, e.g.
+ * coalescing a cache stampede onto a single backend fetch.
+ *
+ * SharedPromise fulfils every waiter by copying the result into its own
+ * Future, while holding a mutex that getFuture() also takes. FanoutPromise
+ * instead
+ *
+ *  - stores the result once, immutably, and hands every waiter a
+ *    std::shared_ptr<const T> to it, so completion costs a refcount bump per
+ *    waiter rather than a copy of T;
+ *  - registers waiters on a lock-free list, so concurrent getFuture() calls
+ *    never block each other or the thread fulfilling the promise;
+ *  - completes waiters that asked for an Executor in one Executor::add() per
+ *    distinct executor, rather than one per waiter.
+ *
+ * Unlike SharedPromise, FanoutPromise is neither copyable nor movable, and
+ * does not support interrupts.
+ */
+template <class T>
+class FanoutPromise {
+ public:
+  using Result = std::shared_ptr<const T>;
+
+  FanoutPromise() = default;
+  ~FanoutPromise();
+
+  FanoutPromise(FanoutPromise const&) = delete;
+  FanoutPromise& operator=(FanoutPromise const&) = delete;
+  FanoutPromise(FanoutPromise&&) = delete;
+  FanoutPromise& operator=(FanoutPromise&&) = delete;
+
+  /**
+   * Return a Future that completes with the shared result. Can be called an
+   * unlimited number of times, concurrently, and after fulfilment (in which
+   * case the Future is already complete).
+   */
+  Future<Result> getFuture();
+
+  /**
+   * As above, but the Future is completed on the given Executor, so that
+   * continuations attached before fulfilment run there. All waiters that
+   * share an Executor are completed by a single task on it.
+   */
+  Future<Result> getFuture(Executor* executor);
+
+  /** Return the number of Futures handed out so far */
+  size_t size() const {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+  /** Fulfill the FanoutPromise with an exception_wrapper */
+  void setException(exception_wrapper ew);
+
+  /** Fulfill the FanoutPromise with an exception type E */
+  template <class E>
+  typename std::enable_if<std::is_base_of<std::exception, E>::value>::type
+  setException(E const& e) {
+    setException(make_exception_wrapper<E>(e));
+  }
+
+  /// Sugar to fulfill this FanoutPromise<Unit>
+  template <class B = T>
+  typename std::enable_if<std::is_same<Unit, B>::value, void>::type
+  setValue() {
+    setTry(Try<T>(T()));
+  }
+
+  /** Set the value (use perfect forwarding for both move and copy) */
+  template <class M>
+  void setValue(M&& value);
+
+  void setTry(Try<T>&& t);
+
+  /** Fulfill this FanoutPromise with the result of a function that takes no
+    arguments and returns something implicitly convertible to T.
+    Captures exceptions. */
+  template <class F>
+  void setWith(F&& func);
+
+  bool isFulfilled() const {
+    return head_.load(std::memory_order_acquire) == fulfilled();
+  }
+
+ private:
+  struct Waiter {
+    explicit Waiter(Executor* e) : executor(e) {}
+
+    Promise<Result> promise;
+    Executor* executor;
+    Waiter* next{nullptr};
+  };
+
+  // Marks head_ once the waiter list has been taken for completion.
+  static Waiter* fulfilled() {
+    return reinterpret_cast<Waiter*>(uintptr_t(1));
+  }
+
+  static void fulfil(Waiter* waiters, const Try<Result>& result);
+
+  std::atomic<Waiter*> head_{nullptr};
+  std::atomic<size_t> size_{0};
+  std::atomic<bool> hasValue_{false};
+  // Written once, before head_ becomes fulfilled(); immutable afterwards.
+  Try<Result> result_;
+};
+
+}
+
+#include <folly/futures/Future.h>
+#include <folly/futures/FanoutPromise-inl.h>
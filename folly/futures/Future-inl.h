@@ -553,6 +553,55 @@ void mapSetCallback(InputIterator first, InputIterator last, F func) {
   }
 }
 
+namespace detail {
+
+// Interrupting the result of a collect* raises the interrupt on each input,
+// the same way then() forwards interrupts to its upstream Future.
+
+typedef std::vector<std::function<void(exception_wrapper const&)>>
+    InterruptHandlers;
+
+template <class FutureT>
+void addInterruptHandler(InterruptHandlers& handlers, FutureT& f) {
+  if (auto handler = f.getInterruptHandler_()) {
+    handlers.push_back(std::move(handler));
+  }
+}
+
+template <class T>
+void setForwardingInterruptHandler(
+    Promise<T>& p,
+    InterruptHandlers&& handlers) {
+  if (handlers.empty()) {
+    return;
+  }
+  p.setInterruptHandler(
+      [handlers = std::move(handlers)](exception_wrapper const& e) {
+        for (auto& handler : handlers) {
+          handler(e);
+        }
+      });
+}
+
+template <class T, class InputIterator>
+void forwardInterrupts(Promise<T>& p, InputIterator first, InputIterator last) {
+  InterruptHandlers handlers;
+  for (; first != last; ++first) {
+    addInterruptHandler(handlers, *first);
+  }
+  setForwardingInterruptHandler(p, std::move(handlers));
+}
+
+template <class T, class... Fs>
+void forwardInterruptsVariadic(Promise<T>& p, Fs&... fs) {
+  InterruptHandlers handlers;
+  using expand = int[];
+  (void)expand{0, (addInterruptHandler(handlers, fs), 0)...};
+  setForwardingInterruptHandler(p, std::move(handlers));
+}
+
+} // detail
+
 // collectAll (variadic)
 
 template <typename... Fs>
@@ -561,6 +610,7 @@ typename detail::CollectAllVariadicContext<
 collectAll(Fs&&... fs) {
   auto ctx = std::make_shared<detail::CollectAllVariadicContext<
     typename std::decay<Fs>::type::value_type...>>();
+  detail::forwardInterruptsVariadic(ctx->p, fs...);
   detail::collectVariadicHelper<detail::CollectAllVariadicContext>(
     ctx, std::forward<typename std::decay<Fs>::type>(fs)...);
   return ctx->p.getFuture();
@@ -586,6 +636,7 @@ collectAll(InputIterator first, InputIterator last) {
   };
 
   auto ctx = std::make_shared<CollectAllContext>(std::distance(first, last));
+  detail::forwardInterrupts(ctx->p, first, last);
   mapSetCallback<T>(first, last, [ctx](size_t i, Try<T>&& t) {
     ctx->results[i] = std::move(t);
   });
@@ -643,6 +694,7 @@ collect(InputIterator first, InputIterator last) {
 
   auto ctx = std::make_shared<detail::CollectContext<T>>(
     std::distance(first, last));
+  detail::forwardInterrupts(ctx->p, first, last);
   mapSetCallback<T>(first, last, [ctx](size_t i, Try<T>&& t) {
     if (t.hasException()) {
        if (!ctx->threw.exchange(true)) {
@@ -663,6 +715,7 @@ typename detail::CollectVariadicContext<
 collect(Fs&&... fs) {
   auto ctx = std::make_shared<detail::CollectVariadicContext<
     typename std::decay<Fs>::type::value_type...>>();
+  detail::forwardInterruptsVariadic(ctx->p, fs...);
   detail::collectVariadicHelper<detail::CollectVariadicContext>(
     ctx, std::forward<typename std::decay<Fs>::type>(fs)...);
   return ctx->p.getFuture();
@@ -687,6 +740,7 @@ collectAny(InputIterator first, InputIterator last) {
   };
 
   auto ctx = std::make_shared<CollectAnyContext>();
+  detail::forwardInterrupts(ctx->p, first, last);
   mapSetCallback<T>(first, last, [ctx](size_t i, Try<T>&& t) {
     if (!ctx->done.exchange(true)) {
       ctx->p.setValue(std::make_pair(i, std::move(t)));
@@ -718,6 +772,7 @@ collectN(InputIterator first, InputIterator last, size_t n) {
     // for each completed Future, increase count and add to vector, until we
     // have n completed futures at which point we fulfil our Promise with the
     // vector
+    detail::forwardInterrupts(ctx->p, first, last);
     mapSetCallback<T>(first, last, [ctx, n](size_t i, Try<T>&& t) {
       auto c = ++ctx->completed;
       if (c <= n) {
@@ -936,6 +991,45 @@ Future<T> Future<T>::within(Duration dur, E e, Timekeeper* tk) {
   return ctx->promise.getFuture().via(getExecutor());
 }
 
+// withCancellation
+
+template <class T>
+Future<T> Future<T>::withCancellation(CancellationToken token) {
+  if (!token.canBeCancelled()) {
+    return std::move(*this);
+  }
+
+  struct Context {
+    Future<Unit> thisFuture;
+    Promise<T> promise;
+    std::atomic<bool> done {false};
+    // Destroyed first, which waits out a concurrently running callback
+    // before the members it touches go away.
+    std::unique_ptr<CancellationCallback> callback;
+  };
+
+  auto ctx = std::make_shared<Context>();
+  ctx->promise.core_->setInterruptHandlerNoLock(core_->getInterruptHandler());
+  auto f = ctx->promise.getFuture().via(getExecutor());
+
+  ctx->thisFuture = this->then([ctx](Try<T>&& t) mutable {
+    if (ctx->done.exchange(true) == false) {
+      ctx->promise.setTry(std::move(t));
+    }
+  });
+
+  // The callback lives inside the Context, so a raw pointer can't dangle.
+  auto rawCtx = ctx.get();
+  ctx->callback = folly::make_unique<CancellationCallback>(token, [rawCtx] {
+    rawCtx->thisFuture.raise(FutureCancellation());
+    if (rawCtx->done.exchange(true) == false) {
+      rawCtx->promise.setException(FutureCancellation());
+    }
+  });
+
+  return f;
+}
+
 // delayed
 
 template <class T>
@@ -23,6 +23,7 @@
 #include <type_traits>
 #include <vector>
 
+#include <folly/CancellationToken.h>
 #include <folly/Optional.h>
 #include <folly/Portability.h>
 #include <folly/futures/DrivableExecutor.h>
@@ -301,6 +302,15 @@ class Future {
   template <class F>
   void setCallback_(F&& func);
 
+  /// This is not the method you're looking for.
+  ///
+  /// Returns a copy of the interrupt handler installed by the Promise, if
+  /// any. collect* use it to forward interrupts to their inputs.
+  std::function<void(exception_wrapper const&)> getInterruptHandler_() {
+    throwIfInvalid();
+    return core_->getInterruptHandler();
+  }
+
   /// A Future's callback is executed when all three of these conditions have
   /// become true: it has a value (set by the Promise), it has a callback (set
   /// by then), and it is active (active by default).
@@ -357,6 +367,12 @@ class Future {
   template <class E>
   Future<T> within(Duration, E exception, Timekeeper* = nullptr);
 
+  /// Complete with FutureCancellation as soon as cancellation is requested on
+  /// the token, and raise FutureCancellation on this Future so the producer
+  /// can stop working on it (see Promise::getCancellationToken()). If this
+  /// Future completes first the token is ignored.
+  Future<T> withCancellation(CancellationToken token);
+
   /// Delay the completion of this Future for at least this duration from
   /// now. The optional Timekeeper is as with futures::sleep().
   Future<T> delayed(Duration, Timekeeper* = nullptr);
@@ -111,6 +111,17 @@ void Promise<T>::setInterruptHandler(
   core_->setInterruptHandler(std::move(fn));
 }
 
+template <class T>
+CancellationToken Promise<T>::getCancellationToken() {
+  CancellationSource source;
+  auto token = source.getToken();
+  core_->setInterruptHandler(
+      [source = std::move(source)](exception_wrapper const&) {
+        source.requestCancellation();
+      });
+  return token;
+}
+
 template <class T>
 void Promise<T>::setTry(Try<T>&& t) {
   throwIfFulfilled();
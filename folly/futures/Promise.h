@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <folly/CancellationToken.h>
 #include <folly/Portability.h>
 #include <folly/Try.h>
 #include <functional>
@@ -71,6 +72,14 @@ public:
   /// handled.
   void setInterruptHandler(std::function<void(exception_wrapper const&)>);
 
+  /// Return a token that is cancelled when the Future side raises an
+  /// interrupt, so long-running producers can poll
+  /// token.isCancellationRequested() or register a CancellationCallback
+  /// instead of writing an interrupt handler. This installs the interrupt
+  /// handler, replacing any set by setInterruptHandler(); call it at most
+  /// once.
+  CancellationToken getCancellationToken();
+
   /// Sugar to fulfill this Promise<Unit>
   template <class B = T>
   typename std::enable_if<std::is_same<Unit, B>::value, void>::type
@@ -16,12 +16,15 @@
 
 #include <folly/Benchmark.h>
 #include <folly/Baton.h>
+#include <folly/futures/FanoutPromise.h>
 #include <folly/futures/Future.h>
 #include <folly/futures/InlineExecutor.h>
 #include <folly/futures/Promise.h>
+#include <folly/futures/SharedPromise.h>
 #include <folly/portability/GFlags.h>
 
 #include <semaphore.h>
+#include <thread>
 #include <vector>
 
 using namespace folly;
@@ -382,6 +385,41 @@ BENCHMARK_RELATIVE(complexBlob4096) {
   complexBenchmark<Blob<4096>>();
 }
 
+BENCHMARK_DRAW_LINE();
+
+// Cache-stampede coalescing: 10k callers ask for the same result from many
+// threads while it is being produced.
+template <class SharedPromiseT>
+void fanout(size_t iters) {
+  const size_t kThreads = 16;
+  const size_t kWaiters = 10000;
+  for (size_t i = 0; i < iters; i++) {
+    SharedPromiseT p;
+    std::atomic<size_t> completed{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kThreads; t++) {
+      threads.emplace_back([&] {
+        for (size_t j = 0; j < kWaiters / kThreads; j++) {
+          p.getFuture().then([&] { ++completed; });
+        }
+      });
+    }
+    p.setValue(Blob<1024>());
+    for (auto& t : threads) {
+      t.join();
+    }
+    CHECK_EQ(kWaiters, completed.load());
+  }
+}
+
+BENCHMARK(sharedPromiseFanout10k, iters) {
+  fanout<SharedPromise<Blob<1024>>>(iters);
+}
+
+BENCHMARK_RELATIVE(fanoutPromiseFanout10k, iters) {
+  fanout<FanoutPromise<Blob<1024>>>(iters);
+}
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include <folly/Memory.h>
+#include <folly/futures/FanoutPromise.h>
+#include <folly/futures/ManualExecutor.h>
+
+using namespace folly;
+
+TEST(FanoutPromise, setGet) {
+  FanoutPromise<int> p;
+  p.setValue(1);
+  auto f1 = p.getFuture();
+  auto f2 = p.getFuture();
+  EXPECT_EQ(1, *f1.value());
+  EXPECT_EQ(1, *f2.value());
+  EXPECT_EQ(2, p.size());
+}
+
+TEST(FanoutPromise, getSet) {
+  FanoutPromise<int> p;
+  auto f1 = p.getFuture();
+  auto f2 = p.getFuture();
+  EXPECT_FALSE(p.isFulfilled());
+  p.setValue(1);
+  EXPECT_TRUE(p.isFulfilled());
+  EXPECT_EQ(1, *f1.value());
+  EXPECT_EQ(1, *f2.value());
+}
+
+TEST(FanoutPromise, resultIsShared) {
+  FanoutPromise<std::string> p;
+  auto f1 = p.getFuture();
+  p.setValue("hello");
+  auto f2 = p.getFuture();
+  EXPECT_EQ("hello", *f1.value());
+  EXPECT_EQ(f1.value().get(), f2.value().get());
+}
+
+TEST(FanoutPromise, setException) {
+  FanoutPromise<int> p;
+  auto f1 = p.getFuture();
+  p.setException(std::runtime_error("oh no"));
+  auto f2 = p.getFuture();
+  EXPECT_THROW(f1.value(), std::runtime_error);
+  EXPECT_THROW(f2.value(), std::runtime_error);
+}
+
+TEST(FanoutPromise, alreadySatisfied) {
+  FanoutPromise<int> p;
+  p.setValue(1);
+  EXPECT_THROW(p.setValue(2), PromiseAlreadySatisfied);
+}
+
+TEST(FanoutPromise, brokenPromise) {
+  auto p = folly::make_unique<FanoutPromise<int>>();
+  auto f = p->getFuture();
+  p.reset();
+  EXPECT_THROW(f.value(), BrokenPromise);
+}
+
+TEST(FanoutPromise, batchedPerExecutor) {
+  ManualExecutor x1;
+  ManualExecutor x2;
+  FanoutPromise<int> p;
+  std::vector<Future<FanoutPromise<int>::Result>> fs;
+  for (int i = 0; i < 10; i++) {
+    fs.push_back(p.getFuture(&x1));
+    fs.push_back(p.getFuture(&x2));
+  }
+  auto inlineFuture = p.getFuture();
+  p.setValue(42);
+  EXPECT_TRUE(inlineFuture.isReady());
+  for (auto& f : fs) {
+    EXPECT_FALSE(f.isReady());
+  }
+  // One task per executor, however many waiters it has.
+  EXPECT_EQ(1, x1.run());
+  EXPECT_EQ(1, x2.run());
+  for (auto& f : fs) {
+    EXPECT_EQ(42, *f.value());
+  }
+}
+
+TEST(FanoutPromise, executorRejects) {
+  struct RejectingExecutor : Executor {
+    void add(Func) override {
+      throw std::runtime_error("rejected");
+    }
+  } rejecting;
+  ManualExecutor x;
+  FanoutPromise<int> p;
+  auto rejected = p.getFuture(&rejecting);
+  auto accepted = p.getFuture(&x);
+  auto inlineFuture = p.getFuture();
+  p.setValue(42);
+  // Waiters whose Executor won't take the task get its exception, and the
+  // other waiters still get the value.
+  ASSERT_TRUE(rejected.isReady());
+  EXPECT_THROW(rejected.value(), std::runtime_error);
+  EXPECT_EQ(42, *inlineFuture.value());
+  EXPECT_EQ(1, x.run());
+  EXPECT_EQ(42, *accepted.value());
+}
+
+TEST(FanoutPromise, concurrentGetFuture) {
+  FanoutPromise<int> p;
+  const size_t kThreads = 8;
+  const size_t kPerThread = 1000;
+  std::atomic<size_t> completed{0};
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kThreads; i++) {
+    threads.emplace_back([&] {
+      for (size_t j = 0; j < kPerThread; j++) {
+        p.getFuture().then([&](FanoutPromise<int>::Result r) {
+          EXPECT_EQ(7, *r);
+          ++completed;
+        });
+      }
+    });
+  }
+  p.setValue(7);
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(kThreads * kPerThread, completed.load());
+  EXPECT_EQ(kThreads * kPerThread, p.size());
+}
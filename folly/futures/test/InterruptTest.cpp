@@ -83,3 +83,77 @@ TEST(Interrupt, withinTimedOut) {
   auto t = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
   EXPECT_TRUE(done.timed_wait(t));
 }
+
+TEST(Interrupt, cancellationToken) {
+  Promise<int> p;
+  auto token = p.getCancellationToken();
+  EXPECT_TRUE(token.canBeCancelled());
+  EXPECT_FALSE(token.isCancellationRequested());
+  auto f = p.getFuture();
+  f.cancel();
+  EXPECT_TRUE(token.isCancellationRequested());
+}
+
+TEST(Interrupt, cancellationTokenThroughThen) {
+  Promise<int> p;
+  auto token = p.getCancellationToken();
+  auto f = p.getFuture().then([](int i) { return i + 1; });
+  f.cancel();
+  EXPECT_TRUE(token.isCancellationRequested());
+}
+
+TEST(Interrupt, collectForwardsInterrupts) {
+  std::vector<Promise<int>> ps(3);
+  std::vector<CancellationToken> tokens;
+  std::vector<Future<int>> fs;
+  for (auto& p : ps) {
+    tokens.push_back(p.getCancellationToken());
+    fs.push_back(p.getFuture());
+  }
+  collect(fs).cancel();
+  for (auto& token : tokens) {
+    EXPECT_TRUE(token.isCancellationRequested());
+  }
+}
+
+TEST(Interrupt, collectAllVariadicForwardsInterrupts) {
+  Promise<int> p1;
+  Promise<Unit> p2;
+  auto t1 = p1.getCancellationToken();
+  auto t2 = p2.getCancellationToken();
+  collectAll(p1.getFuture(), p2.getFuture()).cancel();
+  EXPECT_TRUE(t1.isCancellationRequested());
+  EXPECT_TRUE(t2.isCancellationRequested());
+}
+
+TEST(Interrupt, withCancellation) {
+  Promise<int> p;
+  bool interrupted = false;
+  p.setInterruptHandler(
+      [&](const exception_wrapper& /* e */) { interrupted = true; });
+  CancellationSource source;
+  auto f = p.getFuture().withCancellation(source.getToken());
+  EXPECT_FALSE(f.isReady());
+  source.requestCancellation();
+  EXPECT_TRUE(interrupted);
+  ASSERT_TRUE(f.isReady());
+  EXPECT_THROW(f.value(), FutureCancellation);
+}
+
+TEST(Interrupt, withCancellationAlreadyCancelled) {
+  Promise<int> p;
+  CancellationSource source;
+  source.requestCancellation();
+  auto f = p.getFuture().withCancellation(source.getToken());
+  ASSERT_TRUE(f.isReady());
+  EXPECT_THROW(f.value(), FutureCancellation);
+}
+
+TEST(Interrupt, withCancellationCompletesFirst) {
+  Promise<int> p;
+  CancellationSource source;
+  auto f = p.getFuture().withCancellation(source.getToken());
+  p.setValue(42);
+  source.requestCancellation();
+  EXPECT_EQ(42, f.value());
+}
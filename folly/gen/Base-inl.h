@@ -95,6 +95,121 @@ class Group : public GenImpl<Value&&, Group<Key, Value>> {
 
 namespace detail {
 
+/**
+ * Block protocol - Generators of arithmetic values may, besides apply() and
+ * foreach(), provide
+ *
+ *   template <class Handler>
+ *   bool applyBlocks(Handler&& handler) const;
+ *
+ * which passes all values to 'handler' as a series of blocks, until it
+ * returns false. A block is a view of a number of values:
+ *
+ *   typedef ... ValueType;                      // arithmetic
+ *   size_t size() const;
+ *   bool get(size_t i, ValueType& value) const; // false if filtered out
+ *
+ * Sources with their values in an array, or computed from their index,
+ * provide blocks. 'map' and 'filter' wrap the blocks of their source into
+ * views which apply their predicate in get(), and 'sum', 'count', 'min' and
+ * 'max' use blocks when their source has them. The whole pipeline then runs
+ * as one counted loop per block, with the sink's state in registers, which
+ * the compiler can unroll and vectorize. Predicates are called on the same
+ * values, in the same order, as they are one value at a time.
+ */
+template <class T>
+class ArrayBlock {
+  const T* data_;
+  size_t size_;
+
+ public:
+  typedef T ValueType;
+
+  ArrayBlock(const T* data, size_t size) : data_(data), size_(size) {}
+
+  size_t size() const { return size_; }
+
+  bool get(size_t i, T& value) const {
+    value = data_[i];
+    return true;
+  }
+};
+
+template <class T>
+class SequenceBlock {
+  T start_;
+  size_t size_;
+
+ public:
+  typedef T ValueType;
+
+  SequenceBlock(T start, size_t size) : start_(start), size_(size) {}
+
+  size_t size() const { return size_; }
+
+  bool get(size_t i, T& value) const {
+    value = static_cast<T>(start_ + i);
+    return true;
+  }
+};
+
+struct BlockProbe {
+  template <class Block>
+  bool operator()(const Block&) const {
+    return true;
+  }
+};
+
+template <class Gen, class = void>
+struct HasBlocks : std::false_type {};
+
+template <class Gen>
+struct HasBlocks<
+    Gen,
+    decltype(void(std::declval<const Gen&>().applyBlocks(BlockProbe())))>
+    : std::true_type {};
+
+/**
+ * BlockCallable - Whether 'Predicate' can be applied to the values of the
+ * blocks of 'Gen', giving a result convertible to 'Result'.
+ */
+template <class Gen, class Predicate, class Result, class = void>
+struct BlockCallable : std::false_type {};
+
+template <class Gen, class Predicate, class Result>
+struct BlockCallable<
+    Gen,
+    Predicate,
+    Result,
+    typename std::enable_if<
+        HasBlocks<Gen>::value &&
+        std::is_convertible<
+            typename std::result_of<const Predicate&(
+                const typename Gen::StorageType&)>::type,
+            Result>::value>::type> : std::true_type {};
+
+/**
+ * ArrayOf - Whether 'Container' keeps its values, of arithmetic type
+ * 'Value', in an array accessible through data().
+ */
+template <class Container, class Value, class = void>
+struct ArrayOf : std::false_type {};
+
+template <class Container, class Value>
+struct ArrayOf<
+    Container,
+    Value,
+    typename std::enable_if<std::is_pointer<
+        decltype(std::declval<Container&>().data())>::value>::type>
+    : std::integral_constant<
+          bool,
+          std::is_arithmetic<Value>::value &&
+              std::is_same<
+                  Value,
+                  typename std::remove_cv<typename std::remove_pointer<
+                      decltype(std::declval<Container&>().data())>::type>::
+                      type>::value> {};
+
 // Classes used for the implementation of Sources, Operators, and Sinks
 
 /*
@@ -138,6 +253,15 @@ class ReferencedSource
     return true;
   }
 
+  template <class Handler,
+            class StorageType = typename std::decay<Value>::type>
+  auto applyBlocks(Handler&& handler) const -> typename std::enable_if<
+      ArrayOf<Container, StorageType>::value,
+      bool>::type {
+    return handler(
+        ArrayBlock<StorageType>(container_->data(), container_->size()));
+  }
+
   // from takes in a normal stl structure, which are all finite
   static constexpr bool infinite = false;
 };
@@ -204,6 +328,13 @@ class CopiedSource
     return true;
   }
 
+  template <class Handler, class C = const Container>
+  auto applyBlocks(Handler&& handler) const -> typename std::enable_if<
+      ArrayOf<C, StorageType>::value,
+      bool>::type {
+    return handler(ArrayBlock<StorageType>(copy_->data(), copy_->size()));
+  }
+
   // from takes in a normal stl structure, which are all finite
   static constexpr bool infinite = false;
 };
@@ -245,6 +376,16 @@ class RangeSource : public GenImpl<typename Range<Iterator>::reference,
     }
   }
 
+  template <class Handler,
+            class I = Iterator,
+            class StorageType = typename std::remove_cv<
+                typename std::remove_pointer<I>::type>::type>
+  auto applyBlocks(Handler&& handler) const -> typename std::enable_if<
+      std::is_pointer<I>::value && std::is_arithmetic<StorageType>::value,
+      bool>::type {
+    return handler(ArrayBlock<StorageType>(range_.data(), range_.size()));
+  }
+
   // folly::Range only supports finite ranges
   static constexpr bool infinite = false;
 };
@@ -289,6 +430,13 @@ class Sequence : public GenImpl<const Value&, Sequence<Value, SequenceImpl>> {
     }
   }
 
+  template <class Handler, class Impl = SequenceImpl>
+  auto applyBlocks(Handler&& handler) const -> typename std::enable_if<
+      std::is_integral<Value>::value && !std::is_same<Value, bool>::value,
+      decltype(std::declval<const Impl&>().count(start_), bool())>::type {
+    return handler(SequenceBlock<Value>(start_, impl_.count(start_)));
+  }
+
   // Let the implementation say if we are infinite or not
   static constexpr bool infinite = SequenceImpl::infinite;
 };
@@ -304,6 +452,11 @@ class RangeImpl {
   explicit RangeImpl(Value end) : end_(std::move(end)) {}
   bool test(const Value& current) const { return current < end_; }
   void step(Value& current) const { ++current; }
+  // Number of values from current on, for integral types only.
+  size_t count(const Value& current) const {
+    typedef typename std::make_unsigned<Value>::type Unsigned;
+    return test(current) ? Unsigned(Unsigned(end_) - Unsigned(current)) : 0;
+  }
   static constexpr bool infinite = false;
 };
 
@@ -328,6 +481,13 @@ class SeqImpl {
   explicit SeqImpl(Value end) : end_(std::move(end)) {}
   bool test(const Value& current) const { return current <= end_; }
   void step(Value& current) const { ++current; }
+  // Number of values from current on, for integral types only.
+  size_t count(const Value& current) const {
+    typedef typename std::make_unsigned<Value>::type Unsigned;
+    return test(current)
+        ? size_t(Unsigned(Unsigned(end_) - Unsigned(current))) + 1
+        : 0;
+  }
   static constexpr bool infinite = false;
 };
 
@@ -504,6 +664,41 @@ class Map : public Operator<Map<Predicate>> {
       });
     }
 
+    template <class Block>
+    class MappedBlock {
+      const Block& block_;
+      const Predicate& pred_;
+
+     public:
+      typedef typename std::decay<Result>::type ValueType;
+
+      MappedBlock(const Block& block, const Predicate& pred)
+          : block_(block), pred_(pred) {}
+
+      size_t size() const { return block_.size(); }
+
+      bool get(size_t i, ValueType& value) const {
+        typename Block::ValueType input;
+        if (!block_.get(i, input)) {
+          return false;
+        }
+        value = pred_(static_cast<const typename Block::ValueType&>(input));
+        return true;
+      }
+    };
+
+    template <class Handler,
+              class S = Source,
+              class StorageType = typename std::decay<Result>::type>
+    auto applyBlocks(Handler&& handler) const -> typename std::enable_if<
+        std::is_arithmetic<StorageType>::value &&
+            BlockCallable<S, Predicate, StorageType>::value,
+        bool>::type {
+      return source_.applyBlocks([&](const auto& block) {
+        return handler(MappedBlock<std::decay_t<decltype(block)>>(block, pred_));
+      });
+    }
+
     static constexpr bool infinite = Source::infinite;
   };
 
@@ -577,6 +772,35 @@ class Filter : public Operator<Filter<Predicate>> {
       });
     }
 
+    template <class Block>
+    class FilteredBlock {
+      const Block& block_;
+      const Predicate& pred_;
+
+     public:
+      typedef typename Block::ValueType ValueType;
+
+      FilteredBlock(const Block& block, const Predicate& pred)
+          : block_(block), pred_(pred) {}
+
+      size_t size() const { return block_.size(); }
+
+      bool get(size_t i, ValueType& value) const {
+        return block_.get(i, value) &&
+            pred_(static_cast<const ValueType&>(value));
+      }
+    };
+
+    template <class Handler, class S = Source>
+    auto applyBlocks(Handler&& handler) const -> typename std::enable_if<
+        BlockCallable<S, Predicate, bool>::value,
+        bool>::type {
+      return source_.applyBlocks([&](const auto& block) {
+        return handler(
+            FilteredBlock<std::decay_t<decltype(block)>>(block, pred_));
+      });
+    }
+
     static constexpr bool infinite = Source::infinite;
   };
 
@@ -1053,6 +1277,123 @@ class Order : public Operator<Order<Selector, Comparer>> {
   }
 };
 
+/**
+ * TopK - For selecting the first 'n' values of a sequence in the order given
+ * by a key selector and comparator, equivalent to 'orderBy(...) | take(n)'.
+ * Only a bounded heap of 'n' values is held while the source is consumed, so
+ * memory is O(n) and time O(N log n) instead of sorting all N values.
+ *
+ * This type is usually used through the 'topK' helper function, like:
+ *
+ *   auto closest = from(places)
+ *                | topK(10, [](const Place& p) {
+ *                    return distance(p.location, here);
+ *                  });
+ */
+template <class Selector, class Comparer>
+class TopK : public Operator<TopK<Selector, Comparer>> {
+  size_t count_;
+  Selector selector_;
+  Comparer comparer_;
+
+ public:
+  TopK() = default;
+
+  explicit TopK(size_t count, Selector selector = Selector())
+      : count_(count), selector_(std::move(selector)) {}
+
+  TopK(size_t count, Selector selector, Comparer comparer)
+      : count_(count),
+        selector_(std::move(selector)),
+        comparer_(std::move(comparer)) {}
+
+  template <class Value,
+            class Source,
+            class StorageType = typename std::decay<Value>::type>
+  class Generator
+      : public GenImpl<StorageType&&, Generator<Value, Source, StorageType>> {
+    static_assert(!Source::infinite, "Cannot sort infinite source!");
+    Source source_;
+    size_t count_;
+    Selector selector_;
+    Comparer comparer_;
+
+    typedef std::vector<StorageType> VectorType;
+
+    VectorType asVector() const {
+      // max-heap of the best 'count_' values; the front is the one to evict
+      auto comparer = [&](const StorageType& a, const StorageType& b) {
+        return comparer_(selector_(a), selector_(b));
+      };
+      VectorType heap;
+      if (count_ == 0) {
+        return heap;
+      }
+      source_.foreach([&](Value v) {
+        if (heap.size() < count_) {
+          heap.emplace_back(std::forward<Value>(v));
+          std::push_heap(heap.begin(), heap.end(), comparer);
+        } else if (comparer_(selector_(v), selector_(heap.front()))) {
+          std::pop_heap(heap.begin(), heap.end(), comparer);
+          heap.back() = std::forward<Value>(v);
+          std::push_heap(heap.begin(), heap.end(), comparer);
+        }
+      });
+      std::sort_heap(heap.begin(), heap.end(), comparer);
+      return heap;
+    }
+
+   public:
+    Generator(Source source, size_t count, Selector selector, Comparer comparer)
+        : source_(std::move(source)),
+          count_(count),
+          selector_(std::move(selector)),
+          comparer_(std::move(comparer)) {}
+
+    VectorType operator|(const Collect<VectorType>&) const {
+      return asVector();
+    }
+
+    VectorType operator|(const CollectTemplate<std::vector>&) const {
+      return asVector();
+    }
+
+    template <class Body>
+    void foreach(Body&& body) const {
+      for (auto& value : asVector()) {
+        body(std::move(value));
+      }
+    }
+
+    template <class Handler>
+    bool apply(Handler&& handler) const {
+      for (auto& value : asVector()) {
+        if (!handler(std::move(value))) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // Can only be run on and produce finite generators
+    static constexpr bool infinite = false;
+  };
+
+  template <class Source,
+            class Value,
+            class Gen = Generator<Value, Source>>
+  Gen compose(GenImpl<Value, Source>&& source) const {
+    return Gen(std::move(source.self()), count_, selector_, comparer_);
+  }
+
+  template <class Source,
+            class Value,
+            class Gen = Generator<Value, Source>>
+  Gen compose(const GenImpl<Value, Source>& source) const {
+    return Gen(source.self(), count_, selector_, comparer_);
+  }
+};
+
 /**
  * GroupBy - Group values by a given key selector, producing a sequence of
  * groups.
@@ -1133,6 +1474,241 @@ class GroupBy : public Operator<GroupBy<Selector>> {
   }
 };
 
+/**
+ * AggregateTable - Insertion-ordered hash table from keys to accumulators
+ * for AggregateBy and MergeAggregates. Entries live densely in a vector;
+ * lookups linearly probe a power-of-two array of 8-byte slots, each holding
+ * 32 bits of the key's hash and the entry's index, so a probe only touches
+ * an entry when the hash bits match.
+ */
+template <class Key, class Acc>
+class AggregateTable {
+  struct Slot {
+    uint32_t tag;
+    uint32_t index; // 1-based; 0 means empty
+  };
+
+  std::vector<std::pair<Key, Acc>> entries_;
+  std::vector<Slot> slots_;
+
+  static uint32_t hashOf(const Key& key) {
+    return static_cast<uint32_t>(hash::twang_mix64(std::hash<Key>()(key)));
+  }
+
+  void grow() {
+    std::vector<Slot> slots(std::max<size_t>(16, slots_.size() * 2));
+    size_t mask = slots.size() - 1;
+    for (auto& slot : slots_) {
+      if (slot.index) {
+        size_t i = slot.tag & mask;
+        while (slots[i].index) {
+          i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+      }
+    }
+    slots_ = std::move(slots);
+  }
+
+ public:
+  /**
+   * Returns the accumulator for 'key', constructing it from 'init' (which is
+   * left untouched otherwise) if the key is new, and whether it was new.
+   */
+  template <class K, class Init>
+  std::pair<Acc*, bool> insert(K&& key, Init&& init) {
+    // keep the load factor at or below 1/2
+    if (2 * (entries_.size() + 1) > slots_.size()) {
+      grow();
+    }
+    uint32_t tag = hashOf(key);
+    size_t mask = slots_.size() - 1;
+    size_t i = tag & mask;
+    for (; slots_[i].index; i = (i + 1) & mask) {
+      if (slots_[i].tag == tag) {
+        auto& entry = entries_[slots_[i].index - 1];
+        if (entry.first == key) {
+          return std::make_pair(&entry.second, false);
+        }
+      }
+    }
+    entries_.emplace_back(std::forward<K>(key), std::forward<Init>(init));
+    slots_[i] = Slot{tag, static_cast<uint32_t>(entries_.size())};
+    return std::make_pair(&entries_.back().second, true);
+  }
+
+  std::vector<std::pair<Key, Acc>>& entries() {
+    return entries_;
+  }
+};
+
+/**
+ * AggregateBy - For folding the values of each group of a sequence into an
+ * accumulator, without storing the values themselves. Produces one
+ * std::pair<Key, Acc> per distinct key, in order of first appearance.
+ *
+ * This type is usually used through the 'aggregateBy' helper function, like:
+ *
+ *   auto countsByCity = from(people)
+ *                     | aggregateBy([](const Person& p) { return p.city; },
+ *                                   size_t(0),
+ *                                   [](size_t n, const Person&) {
+ *                                     return n + 1;
+ *                                   })
+ *                     | as<std::map>();
+ */
+template <class Selector, class Seed, class Fold>
+class AggregateBy : public Operator<AggregateBy<Selector, Seed, Fold>> {
+  Selector selector_;
+  Seed seed_;
+  Fold fold_;
+
+ public:
+  AggregateBy() = default;
+
+  AggregateBy(Selector selector, Seed seed, Fold fold)
+      : selector_(std::move(selector)),
+        seed_(std::move(seed)),
+        fold_(std::move(fold)) {}
+
+  template <class Value,
+            class Source,
+            class Key = typename std::result_of<Selector(const Value&)>::type,
+            class KeyDecayed = typename std::decay<Key>::type>
+  class Generator
+      : public GenImpl<std::pair<KeyDecayed, Seed>&&,
+                       Generator<Value, Source, Key, KeyDecayed>> {
+    static_assert(!Source::infinite, "Cannot aggregate infinite source!");
+    Source source_;
+    Selector selector_;
+    Seed seed_;
+    Fold fold_;
+
+   public:
+    Generator(Source source, Selector selector, Seed seed, Fold fold)
+        : source_(std::move(source)),
+          selector_(std::move(selector)),
+          seed_(std::move(seed)),
+          fold_(std::move(fold)) {}
+
+    template <class Handler>
+    bool apply(Handler&& handler) const {
+      AggregateTable<KeyDecayed, Seed> table;
+      source_ | [&](Value value) {
+        const Value& cv = value;
+        auto& accum = *table.insert(selector_(cv), seed_).first;
+        accum = fold_(std::move(accum), std::forward<Value>(value));
+      };
+      for (auto& entry : table.entries()) {
+        if (!handler(std::move(entry))) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // Can only be run on and produce finite generators
+    static constexpr bool infinite = false;
+  };
+
+  template <class Source,
+            class Value,
+            class Gen = Generator<Value, Source>>
+  Gen compose(GenImpl<Value, Source>&& source) const {
+    return Gen(std::move(source.self()), selector_, seed_, fold_);
+  }
+
+  template <class Source,
+            class Value,
+            class Gen = Generator<Value, Source>>
+  Gen compose(const GenImpl<Value, Source>& source) const {
+    return Gen(source.self(), selector_, seed_, fold_);
+  }
+};
+
+/**
+ * MergeAggregates - For combining partial aggregates, such as those produced
+ * by aggregateBy() on each worker of a parallel() pipeline, into one
+ * std::pair<Key, Acc> per distinct key.
+ *
+ * This type is usually used through the 'mergeAggregates' helper function,
+ * like:
+ *
+ *   auto wordCounts = from(lines)
+ *                   | parallel(split(' ')
+ *                            | aggregateBy(To<std::string>(),
+ *                                          size_t(0),
+ *                                          [](size_t n, StringPiece) {
+ *                                            return n + 1;
+ *                                          }))
+ *                   | mergeAggregates(std::plus<size_t>())
+ *                   | as<std::map>();
+ */
+template <class Merge>
+class MergeAggregates : public Operator<MergeAggregates<Merge>> {
+  Merge merge_;
+
+ public:
+  MergeAggregates() = default;
+
+  explicit MergeAggregates(Merge merge) : merge_(std::move(merge)) {}
+
+  template <class Value,
+            class Source,
+            class ValueDecayed = typename std::decay<Value>::type,
+            class Key = typename ValueDecayed::first_type,
+            class Acc = typename ValueDecayed::second_type>
+  class Generator
+      : public GenImpl<std::pair<Key, Acc>&&,
+                       Generator<Value, Source, ValueDecayed, Key, Acc>> {
+    static_assert(!Source::infinite, "Cannot aggregate infinite source!");
+    Source source_;
+    Merge merge_;
+
+   public:
+    Generator(Source source, Merge merge)
+        : source_(std::move(source)), merge_(std::move(merge)) {}
+
+    template <class Handler>
+    bool apply(Handler&& handler) const {
+      AggregateTable<Key, Acc> table;
+      source_ | [&](Value value) {
+        // only moves from the partial if it's an rvalue, and its value only
+        // if the key is new
+        auto inserted = table.insert(std::forward<Value>(value).first,
+                                     std::forward<Value>(value).second);
+        if (!inserted.second) {
+          *inserted.first = merge_(std::move(*inserted.first),
+                                   std::forward<Value>(value).second);
+        }
+      };
+      for (auto& entry : table.entries()) {
+        if (!handler(std::move(entry))) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // Can only be run on and produce finite generators
+    static constexpr bool infinite = false;
+  };
+
+  template <class Source,
+            class Value,
+            class Gen = Generator<Value, Source>>
+  Gen compose(GenImpl<Value, Source>&& source) const {
+    return Gen(std::move(source.self()), merge_);
+  }
+
+  template <class Source,
+            class Value,
+            class Gen = Generator<Value, Source>>
+  Gen compose(const GenImpl<Value, Source>& source) const {
+    return Gen(source.self(), merge_);
+  }
+};
+
 /*
  * TypeAssertion - For verifying the exact type of the value produced by a
  * generator. Useful for testing and debugging, and acts as a no-op at runtime.
@@ -1887,13 +2463,33 @@ class Count : public Operator<Count> {
  public:
   Count() = default;
 
-  template <class Source, class Value>
+  template <class Source,
+            class Value,
+            typename std::enable_if<!HasBlocks<Source>::value, int>::type = 0>
   size_t compose(const GenImpl<Value, Source>& source) const {
     static_assert(!Source::infinite, "Cannot count infinite source");
     return foldl(size_t(0),
                  [](size_t accum, Value /* v */) { return accum + 1; })
         .compose(source);
   }
+
+  template <class Source,
+            class Value,
+            typename std::enable_if<HasBlocks<Source>::value, int>::type = 0>
+  size_t compose(const GenImpl<Value, Source>& source) const {
+    static_assert(!Source::infinite, "Cannot count infinite source");
+    size_t count = 0;
+    source.self().applyBlocks([&](const auto& block) {
+      size_t blockCount = 0;
+      typename std::decay_t<decltype(block)>::ValueType value;
+      for (size_t i = 0; i < block.size(); ++i) {
+        blockCount += block.get(i, value) ? 1 : 0;
+      }
+      count += blockCount;
+      return true;
+    });
+    return count;
+  }
 };
 
 /**
@@ -1909,7 +2505,8 @@ class Sum : public Operator<Sum> {
 
   template <class Source,
             class Value,
-            class StorageType = typename std::decay<Value>::type>
+            class StorageType = typename std::decay<Value>::type,
+            typename std::enable_if<!HasBlocks<Source>::value, int>::type = 0>
   StorageType compose(const GenImpl<Value, Source>& source) const {
     static_assert(!Source::infinite, "Cannot sum infinite source");
     return foldl(StorageType(0),
@@ -1917,6 +2514,29 @@ class Sum : public Operator<Sum> {
                    return std::move(accum) + std::forward<Value>(v);
                  }).compose(source);
   }
+
+  template <class Source,
+            class Value,
+            class StorageType = typename std::decay<Value>::type,
+            typename std::enable_if<HasBlocks<Source>::value, int>::type = 0>
+  StorageType compose(const GenImpl<Value, Source>& source) const {
+    static_assert(!Source::infinite, "Cannot sum infinite source");
+    StorageType sum(0);
+    source.self().applyBlocks([&](const auto& block) {
+      // Same additions in the same order as above, so floating point sums
+      // don't change.
+      StorageType blockSum = sum;
+      StorageType value;
+      for (size_t i = 0; i < block.size(); ++i) {
+        if (block.get(i, value)) {
+          blockSum = blockSum + value;
+        }
+      }
+      sum = blockSum;
+      return true;
+    });
+    return sum;
+  }
 };
 
 /**
@@ -1976,7 +2596,11 @@ class Min : public Operator<Min<Selector, Comparer>> {
             class Source,
             class StorageType = typename std::decay<Value>::type,
             class Key = typename std::decay<
-                typename std::result_of<Selector(Value)>::type>::type>
+                typename std::result_of<Selector(Value)>::type>::type,
+            typename std::enable_if<
+                !(HasBlocks<Source>::value &&
+                  std::is_same<Selector, Identity>::value),
+                int>::type = 0>
   Optional<StorageType> compose(const GenImpl<Value, Source>& source) const {
     static_assert(!Source::infinite,
                   "Calling min or max on an infinite source will cause "
@@ -1992,6 +2616,41 @@ class Min : public Operator<Min<Selector, Comparer>> {
     };
     return min;
   }
+
+  template <class Value,
+            class Source,
+            class StorageType = typename std::decay<Value>::type,
+            typename std::enable_if<
+                HasBlocks<Source>::value &&
+                    std::is_same<Selector, Identity>::value,
+                int>::type = 0>
+  Optional<StorageType> compose(const GenImpl<Value, Source>& source) const {
+    static_assert(!Source::infinite,
+                  "Calling min or max on an infinite source will cause "
+                  "an infinite loop.");
+    bool any = false;
+    StorageType min = StorageType();
+    source.self().applyBlocks([&](const auto& block) {
+      StorageType value;
+      size_t i = 0;
+      // Find the first value, then compare without checking for it.
+      for (; !any && i < block.size(); ++i) {
+        if (block.get(i, value)) {
+          min = value;
+          any = true;
+        }
+      }
+      StorageType blockMin = min;
+      for (; i < block.size(); ++i) {
+        if (block.get(i, value) && comparer_(value, blockMin)) {
+          blockMin = value;
+        }
+      }
+      min = blockMin;
+      return true;
+    });
+    return any ? Optional<StorageType>(min) : Optional<StorageType>();
+  }
 };
 
 /**
@@ -28,6 +28,7 @@
 #include <vector>
 
 #include <folly/Conv.h>
+#include <folly/Hash.h>
 #include <folly/Optional.h>
 #include <folly/Range.h>
 #include <folly/gen/Core.h>
@@ -343,9 +344,18 @@ class Skip;
 template<class Selector, class Comparer = Less>
 class Order;
 
+template<class Selector, class Comparer = Less>
+class TopK;
+
 template<class Selector>
 class GroupBy;
 
+template<class Selector, class Seed, class Fold>
+class AggregateBy;
+
+template<class Merge>
+class MergeAggregates;
+
 template<class Selector>
 class Distinct;
 
@@ -658,12 +668,65 @@ Order orderByDescending(Selector selector = Selector()) {
   return Order(std::move(selector));
 }
 
+/*
+ * topK() - Like 'orderBy(selector, comparer) | take(n)', but keeps only 'n'
+ * values in memory while consuming the source.
+ *
+ *   auto youngest = from(people)
+ *                 | topK(3, [](const Person& p) { return p.age; })
+ *                 | as<vector>();
+ */
+template<class Selector = Identity,
+         class Comparer = Less,
+         class TopK = detail::TopK<Selector, Comparer>>
+TopK topK(size_t n,
+          Selector selector = Selector(),
+          Comparer comparer = Comparer()) {
+  return TopK(n, std::move(selector), std::move(comparer));
+}
+
+template<class Selector = Identity,
+         class TopK = detail::TopK<Selector, Greater>>
+TopK topKDescending(size_t n, Selector selector = Selector()) {
+  return TopK(n, std::move(selector));
+}
+
 template <class Selector = Identity,
           class GroupBy = detail::GroupBy<Selector>>
 GroupBy groupBy(Selector selector = Selector()) {
   return GroupBy(std::move(selector));
 }
 
+/*
+ * aggregateBy() - Like groupBy(), but folds each group's values into an
+ * accumulator as they arrive, 'accum = fold(std::move(accum), value)'
+ * starting from 'seed', instead of storing them. Yields
+ * std::pair<Key, Seed> values in order of each key's first appearance.
+ *
+ * Inside parallel(), each worker aggregates the values it sees; combine the
+ * partial results with mergeAggregates():
+ *
+ *   auto totals = from(orders)
+ *               | parallel(aggregateBy([](const Order& o) { return o.customer; },
+ *                                      0.0,
+ *                                      addPrice))
+ *               | mergeAggregates(std::plus<double>())
+ *               | as<std::map>();
+ */
+template <class Selector,
+          class Seed,
+          class Fold,
+          class AggregateBy = detail::AggregateBy<Selector, Seed, Fold>>
+AggregateBy aggregateBy(Selector selector, Seed seed, Fold fold) {
+  return AggregateBy(std::move(selector), std::move(seed), std::move(fold));
+}
+
+template <class Merge,
+          class MergeAggregates = detail::MergeAggregates<Merge>>
+MergeAggregates mergeAggregates(Merge merge) {
+  return MergeAggregates(std::move(merge));
+}
+
 template<class Selector = Identity,
          class Distinct = detail::Distinct<Selector>>
 Distinct distinctBy(Selector selector = Selector()) {
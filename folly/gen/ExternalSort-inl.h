@@ -0,0 +1,299 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FOLLY_GEN_EXTERNALSORT_H_
+#error This file may only be included from folly/gen/ExternalSort.h
+#endif
+
+#include <algorithm>
+#include <vector>
+
+#include <folly/Exception.h>
+#include <folly/Varint.h>
+#include <folly/io/RecordIO.h>
+#include <folly/portability/Stdlib.h>
+#include <folly/portability/Unistd.h>
+
+namespace folly {
+namespace gen {
+namespace detail {
+
+/**
+ * Anonymous temporary file in the given directory; the name is unlinked
+ * as soon as the file is created, so the run disappears with its last fd.
+ */
+inline File makeSpillFile(StringPiece dir) {
+  std::string path = dir.str();
+  path += "/folly_gen_sort.XXXXXX";
+  int fd = ::mkstemp(&path[0]);
+  checkUnixError(fd, "mkstemp failed for ", path);
+  File file(fd, /* ownsFd */ true);
+  checkUnixError(::unlink(path.c_str()), "unlink failed for ", path);
+  return file;
+}
+
+/**
+ * Writes a sorted range of values as a run of RecordIO records, packing
+ * varint-length-prefixed encoded values into records of about
+ * kSpillRecordSize bytes.
+ */
+constexpr size_t kSpillRecordSize = 64 << 10;
+
+template <class Codec, class Iterator>
+File writeSpillRun(StringPiece dir, Iterator begin, Iterator end) {
+  File file = makeSpillFile(dir);
+  RecordIOWriter writer(file.dup());
+  std::string record;
+  std::string scratch;
+  auto flush = [&] {
+    auto headroom = recordio_helpers::headerSize();
+    auto buf = IOBuf::create(headroom + record.size());
+    buf->advance(headroom);
+    std::memcpy(buf->writableTail(), record.data(), record.size());
+    buf->append(record.size());
+    writer.write(std::move(buf));
+    record.clear();
+  };
+  record.reserve(kSpillRecordSize + kMaxVarintLength64);
+  for (; begin != end; ++begin) {
+    scratch.clear();
+    Codec::encode(*begin, scratch);
+    uint8_t len[kMaxVarintLength64];
+    record.append(reinterpret_cast<const char*>(len),
+                  encodeVarint(scratch.size(), len));
+    record += scratch;
+    if (record.size() >= kSpillRecordSize) {
+      flush();
+    }
+  }
+  if (!record.empty()) {
+    flush();
+  }
+  return file;
+}
+
+/**
+ * Reads back the values of a run written by writeSpillRun(), in order.
+ */
+template <class T, class Codec>
+class SpillRunReader {
+ public:
+  explicit SpillRunReader(File file)
+      : reader_(std::move(file)), it_(reader_.begin()), end_(reader_.end()) {}
+
+  bool hasNext() {
+    while (record_.empty()) {
+      if (it_ == end_) {
+        return false;
+      }
+      record_ = it_->first;
+      ++it_;
+    }
+    return true;
+  }
+
+  T next() {
+    auto len = decodeVarint(record_);
+    auto value = Codec::decode(record_.subpiece(0, len));
+    record_.advance(len);
+    return value;
+  }
+
+ private:
+  RecordIOReader reader_;
+  RecordIOReader::Iterator it_;
+  RecordIOReader::Iterator end_;
+  ByteRange record_;
+};
+
+/**
+ * ExternalSort - For ordering sequences larger than memory, see
+ * sortExternal().
+ */
+template <class Selector, class Comparer>
+class ExternalSort : public Operator<ExternalSort<Selector, Comparer>> {
+  size_t memoryBudget_;
+  std::string tmpDir_;
+  Selector selector_;
+  Comparer comparer_;
+
+ public:
+  ExternalSort(size_t memoryBudget,
+               StringPiece tmpDir,
+               Selector selector,
+               Comparer comparer)
+      : memoryBudget_(memoryBudget),
+        tmpDir_(tmpDir.str()),
+        selector_(std::move(selector)),
+        comparer_(std::move(comparer)) {}
+
+  template <class Value,
+            class Source,
+            class StorageType = typename std::decay<Value>::type>
+  class Generator
+      : public GenImpl<StorageType&&, Generator<Value, Source, StorageType>> {
+    static_assert(!Source::infinite, "Cannot sort infinite source!");
+    typedef SpillCodec<StorageType> Codec;
+    typedef SpillRunReader<StorageType, Codec> RunReader;
+
+    Source source_;
+    size_t memoryBudget_;
+    std::string tmpDir_;
+    Selector selector_;
+    Comparer comparer_;
+
+    struct Head {
+      StorageType value;
+      size_t run;
+    };
+
+   public:
+    Generator(Source source,
+              size_t memoryBudget,
+              std::string tmpDir,
+              Selector selector,
+              Comparer comparer)
+        : source_(std::move(source)),
+          memoryBudget_(memoryBudget),
+          tmpDir_(std::move(tmpDir)),
+          selector_(std::move(selector)),
+          comparer_(std::move(comparer)) {}
+
+    template <class Body>
+    void foreach(Body&& body) const {
+      apply([&](StorageType&& value) {
+        body(std::move(value));
+        return true;
+      });
+    }
+
+    template <class Handler>
+    bool apply(Handler&& handler) const {
+      auto less = [&](const StorageType& a, const StorageType& b) {
+        return comparer_(selector_(a), selector_(b));
+      };
+
+      std::vector<File> runs;
+      std::vector<StorageType> buffer;
+      size_t used = 0;
+      source_.foreach([&](Value v) {
+        used += Codec::memoryUsage(v);
+        buffer.emplace_back(std::forward<Value>(v));
+        if (used > memoryBudget_) {
+          std::stable_sort(buffer.begin(), buffer.end(), less);
+          runs.push_back(
+              writeSpillRun<Codec>(tmpDir_, buffer.begin(), buffer.end()));
+          buffer.clear();
+          used = 0;
+        }
+      });
+      std::stable_sort(buffer.begin(), buffer.end(), less);
+
+      if (runs.empty()) {
+        for (auto& value : buffer) {
+          if (!handler(std::move(value))) {
+            return false;
+          }
+        }
+        return true;
+      }
+
+      // k-way merge of the spilled runs plus the in-memory tail, which is
+      // treated as the last run. Ties go to the earlier run, so the merge
+      // preserves the input order of equal keys.
+      std::vector<RunReader> readers;
+      readers.reserve(runs.size());
+      for (auto& run : runs) {
+        readers.emplace_back(std::move(run));
+      }
+      const size_t tailRun = readers.size();
+      auto tail = buffer.begin();
+
+      auto advance = [&](size_t run, StorageType& out) {
+        if (run == tailRun) {
+          if (tail == buffer.end()) {
+            return false;
+          }
+          out = std::move(*tail++);
+          return true;
+        }
+        if (!readers[run].hasNext()) {
+          return false;
+        }
+        out = readers[run].next();
+        return true;
+      };
+      // max-heap order is reversed so the front is the next value to emit
+      auto after = [&](const Head& a, const Head& b) {
+        if (less(b.value, a.value)) {
+          return true;
+        }
+        return !less(a.value, b.value) && b.run < a.run;
+      };
+
+      std::vector<Head> heap;
+      heap.reserve(readers.size() + 1);
+      for (size_t run = 0; run < tailRun; ++run) {
+        if (readers[run].hasNext()) {
+          heap.push_back(Head{readers[run].next(), run});
+        }
+      }
+      if (tail != buffer.end()) {
+        heap.push_back(Head{std::move(*tail++), tailRun});
+      }
+      std::make_heap(heap.begin(), heap.end(), after);
+
+      while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), after);
+        auto& head = heap.back();
+        if (!handler(std::move(head.value))) {
+          return false;
+        }
+        if (advance(head.run, head.value)) {
+          std::push_heap(heap.begin(), heap.end(), after);
+        } else {
+          heap.pop_back();
+        }
+      }
+      return true;
+    }
+
+    // Can only be run on and produce finite generators
+    static constexpr bool infinite = false;
+  };
+
+  template <class Source,
+            class Value,
+            class Gen = Generator<Value, Source>>
+  Gen compose(GenImpl<Value, Source>&& source) const {
+    return Gen(std::move(source.self()),
+               memoryBudget_,
+               tmpDir_,
+               selector_,
+               comparer_);
+  }
+
+  template <class Source,
+            class Value,
+            class Gen = Generator<Value, Source>>
+  Gen compose(const GenImpl<Value, Source>& source) const {
+    return Gen(source.self(), memoryBudget_, tmpDir_, selector_, comparer_);
+  }
+};
+
+}  // namespace detail
+}  // namespace gen
+}  // namespace folly
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#define FOLLY_GEN_EXTERNALSORT_H_
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include <folly/FBString.h>
+#include <folly/File.h>
+#include <folly/Range.h>
+#include <folly/Traits.h>
+#include <folly/gen/Base.h>
+
+namespace folly {
+namespace gen {
+
+/**
+ * SpillCodec<T> describes how values of type T are written to and read back
+ * from the sorted runs spilled by sortExternal(), and how much memory a
+ * buffered value is charged against the memory budget. Specialize it for
+ * your own types; it must provide:
+ *
+ *   static size_t memoryUsage(const T& value);
+ *   static void encode(const T& value, std::string& out);  // append to out
+ *   static T decode(ByteRange in);  // 'in' is exactly what encode() wrote
+ *
+ * Specializations are provided for trivially copyable types and for
+ * std::string / fbstring.
+ */
+template <class T, class Enable = void>
+struct SpillCodec;
+
+template <class T>
+struct SpillCodec<T,
+                  typename std::enable_if<IsTriviallyCopyable<T>::value>::type> {
+  static size_t memoryUsage(const T&) {
+    return sizeof(T);
+  }
+  static void encode(const T& value, std::string& out) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+  static T decode(ByteRange in) {
+    T value;
+    std::memcpy(&value, in.data(), sizeof(T));
+    return value;
+  }
+};
+
+template <class T>
+struct SpillCodec<
+    T,
+    typename std::enable_if<std::is_same<T, std::string>::value ||
+                            std::is_same<T, fbstring>::value>::type> {
+  static size_t memoryUsage(const T& value) {
+    return sizeof(T) + value.capacity();
+  }
+  static void encode(const T& value, std::string& out) {
+    out.append(value.data(), value.size());
+  }
+  static T decode(ByteRange in) {
+    return T(reinterpret_cast<const char*>(in.data()), in.size());
+  }
+};
+
+namespace detail {
+template <class Selector, class Comparer = Less>
+class ExternalSort;
+}  // namespace detail
+
+/**
+ * sortExternal() - Like orderBy(), but for sequences that do not fit in
+ * memory. Values are buffered until their SpillCodec::memoryUsage() exceeds
+ * 'memoryBudget' bytes; each full buffer is then sorted and written as a run
+ * of RecordIO records to an unlinked temporary file in 'tmpDir'. The runs
+ * are merged lazily as values are pulled, so '| take(n)' only reads as far
+ * into each run as it needs. Inputs that fit in the budget never touch disk.
+ *
+ * Unlike orderBy(), the sort is stable.
+ *
+ *   from(huge)
+ *     | sortExternal(256 << 20, "/var/tmp", [](const Row& r) { return r.id; })
+ *     | [&](Row&& r) { out.write(r); };
+ */
+template <class Selector = Identity,
+          class Comparer = Less,
+          class ExternalSort = detail::ExternalSort<Selector, Comparer>>
+ExternalSort sortExternal(size_t memoryBudget,
+                          StringPiece tmpDir,
+                          Selector selector = Selector(),
+                          Comparer comparer = Comparer()) {
+  return ExternalSort(
+      memoryBudget, tmpDir, std::move(selector), std::move(comparer));
+}
+
+}  // namespace gen
+}  // namespace folly
+
+#include <folly/gen/ExternalSort-inl.h>
@@ -18,9 +18,13 @@
 #error This file may only be included from folly/gen/File.h
 #endif
 
+#include <cstring>
+#include <limits>
+#include <memory>
 #include <system_error>
 
 #include <folly/gen/String.h>
+#include <folly/portability/SysMman.h>
 
 namespace folly {
 namespace gen {
@@ -62,6 +66,124 @@ class FileReader : public GenImpl<ByteRange, FileReader> {
   std::unique_ptr<IOBuf> buffer_;
 };
 
+/**
+ * Read-only mapping of a whole file, shared by the copies of a generator.
+ */
+inline std::shared_ptr<MemoryMapping> mapForScan(File file) {
+  auto mapping = std::make_shared<MemoryMapping>(std::move(file));
+  mapping->hintLinearScan();
+  return mapping;
+}
+
+class MappedFileReader : public GenImpl<ByteRange, MappedFileReader> {
+ public:
+  MappedFileReader(File file, size_t chunkSize)
+    : mapping_(mapForScan(std::move(file))),
+      chunkSize_(chunkSize) {
+    CHECK_GT(chunkSize_, 0);
+  }
+
+  template <class Body>
+  bool apply(Body&& body) const {
+    auto remaining = mapping_->range();
+    while (!remaining.empty()) {
+      auto chunk = remaining.subpiece(0, chunkSize_);
+      remaining.advance(chunk.size());
+      if (!body(chunk)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static constexpr bool infinite = false;
+
+ private:
+  std::shared_ptr<MemoryMapping> mapping_;
+  size_t chunkSize_;
+};
+
+/**
+ * Yields the lines of a string without copying, with the same results as
+ * 'resplit(delim)': the delimiters are dropped, and so is the empty line
+ * after a trailing delimiter.
+ */
+class LineSource : public GenImpl<StringPiece, LineSource> {
+ public:
+  LineSource() = default;
+  LineSource(StringPiece source, char delim)
+    : source_(source), delim_(delim) {}
+
+  template <class Body>
+  bool apply(Body&& body) const {
+    auto remaining = source_;
+    while (!remaining.empty()) {
+      auto end = static_cast<const char*>(
+          memchr(remaining.begin(), delim_, remaining.size()));
+      if (!end) {
+        return body(remaining);
+      }
+      if (!body(StringPiece(remaining.begin(), end))) {
+        return false;
+      }
+      remaining.assign(end + 1, remaining.end());
+    }
+    return true;
+  }
+
+  static constexpr bool infinite = false;
+
+ private:
+  StringPiece source_;
+  char delim_{'\n'};
+};
+
+class MappedLineChunkSource
+    : public GenImpl<LineSource&&, MappedLineChunkSource> {
+ public:
+  MappedLineChunkSource(File file, char delim, size_t chunkSize)
+    : mapping_(mapForScan(std::move(file))),
+      delim_(delim),
+      chunkSize_(chunkSize) {
+    CHECK_GT(chunkSize_, 0);
+  }
+
+  template <class Handler>
+  bool apply(Handler&& handler) const {
+    auto all = mapping_->range();
+    auto remaining = StringPiece(all);
+    while (!remaining.empty()) {
+      auto size = std::min(chunkSize_, remaining.size());
+      // Extend the chunk up to and including the next delimiter.
+      auto end = static_cast<const char*>(memchr(
+          remaining.begin() + size - 1,
+          delim_,
+          remaining.size() - size + 1));
+      auto chunk =
+          StringPiece(remaining.begin(), end ? end + 1 : remaining.end());
+      if (chunk.size() != all.size()) {
+        // Start reading the chunk in while it is waiting for a worker.
+        mapping_->advise(
+            MADV_WILLNEED,
+            chunk.begin() - reinterpret_cast<const char*>(all.begin()),
+            chunk.size());
+      }
+      remaining.advance(chunk.size());
+      if (!handler(LineSource(chunk, delim_))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static constexpr bool infinite = false;
+
+ private:
+  std::shared_ptr<MemoryMapping> mapping_;
+  char delim_;
+  size_t chunkSize_;
+};
+
 class FileWriter : public Operator<FileWriter> {
  public:
   FileWriter(File file, std::unique_ptr<IOBuf> buffer)
@@ -142,4 +264,34 @@ inline auto byLine(int fd, char delim = '\n')
 inline auto byLine(const char* f, char delim = '\n')
   -> decltype(byLine(File(f), delim)) { return byLine(File(f), delim); }
 
+/**
+ * Generator which yields the lines of a memory-mapped file, in the same way
+ * as byLine() but without reading or copying the data.
+ * Note: The StringPieces reference the mapping and are only valid during
+ * iteration.
+ */
+inline auto byMappedLine(File file, char delim = '\n')
+    -> decltype(byMappedLineChunks(std::move(file), delim) | concat) {
+  // A single chunk, which is never split.
+  return byMappedLineChunks(
+             std::move(file), delim, std::numeric_limits<size_t>::max())
+       | concat;
+}
+
+inline auto byMappedLine(int fd, char delim = '\n')
+  -> decltype(byMappedLine(File(fd), delim)) {
+  return byMappedLine(File(fd), delim);
+}
+
+inline auto byMappedLine(const char* f, char delim = '\n')
+  -> decltype(byMappedLine(File(f), delim)) {
+  return byMappedLine(File(f), delim);
+}
+
+inline auto byMappedLineChunks(const char* f, char delim = '\n',
+                               size_t chunkSize = 1 << 20)
+  -> decltype(byMappedLineChunks(File(f), delim, chunkSize)) {
+  return byMappedLineChunks(File(f), delim, chunkSize);
+}
+
 }}  // !folly::gen
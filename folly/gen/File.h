@@ -18,6 +18,7 @@
 #define FOLLY_GEN_FILE_H_
 
 #include <folly/File.h>
+#include <folly/MemoryMapping.h>
 #include <folly/gen/Base.h>
 #include <folly/io/IOBuf.h>
 
@@ -27,6 +28,8 @@ namespace gen {
 namespace detail {
 class FileReader;
 class FileWriter;
+class MappedFileReader;
+class MappedLineChunkSource;
 }  // namespace detail
 
 /**
@@ -47,6 +50,37 @@ S fromFile(File file, std::unique_ptr<IOBuf> buffer) {
   return S(std::move(file), std::move(buffer));
 }
 
+/**
+ * Generator that maps a file into memory and yields it in pieces of at most
+ * chunkSize bytes. Unlike fromFile(), no data is copied and no read() calls
+ * are made; the pieces reference the mapping and are only valid during
+ * iteration.
+ */
+template <class S = detail::MappedFileReader>
+S fromMappedFile(File file, size_t chunkSize = 1 << 20) {
+  return S(std::move(file), chunkSize);
+}
+
+/**
+ * Generator that maps a file into memory and yields generators of the lines
+ * in consecutive pieces of roughly chunkSize bytes. Pieces always end at a
+ * delimiter, so no line is split between them. Intended for processing a
+ * file with 'parallel()', which then splits lines on the worker threads:
+ *
+ *   auto errors = byMappedLineChunks("/var/log/messages")
+ *               | parallel(concat | filter(isError) | sub(count))
+ *               | sum;
+ *
+ * The lines reference the mapping and are only valid during iteration.
+ */
+template <class S = detail::MappedLineChunkSource>
+S byMappedLineChunks(
+    File file,
+    char delim = '\n',
+    size_t chunkSize = 1 << 20) {
+  return S(std::move(file), delim, chunkSize);
+}
+
 /**
  * Sink that writes to a file with a buffer of the given size.
  * If bufferSize is 0, writes will be unbuffered.
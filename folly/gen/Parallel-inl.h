@@ -19,10 +19,13 @@
 #endif
 
 #include <folly/MPMCQueue.h>
+#include <folly/Optional.h>
 #include <folly/ScopeGuard.h>
 #include <folly/experimental/EventCount.h>
 #include <atomic>
+#include <memory>
 #include <thread>
+#include <utility>
 #include <vector>
 
 namespace folly {
@@ -142,14 +145,96 @@ class Sub : public Operator<Sub<Sink>> {
   }
 };
 
+/**
+ * Runs the workers of a parallel() pipeline, either on threads of their own
+ * or as tasks on a folly::Executor. Workers which haven't started by the time
+ * cancelUnstarted() is called never run their work, so that an executor which
+ * is busy can't hold up the pipeline.
+ */
+class ParallelWorkers {
+  struct State {
+    explicit State(size_t workers) : unstarted(workers) {}
+
+    std::atomic<size_t> unstarted;
+    std::atomic<size_t> running{0};
+    folly::EventCount stopped;
+  };
+
+  std::shared_ptr<State> state_;
+  std::vector<std::thread> threads_;
+
+ public:
+  template <class Work>
+  void start(size_t workers, folly::Executor* executor, Work work) {
+    state_ = std::make_shared<State>(workers);
+    auto state = state_;
+    auto task = [state, work]() mutable {
+      ++state->running;
+      size_t unstarted = state->unstarted.load();
+      while (unstarted &&
+             !state->unstarted.compare_exchange_weak(unstarted, unstarted - 1)) {
+      }
+      if (unstarted) {
+        work();
+      }
+      if (--state->running == 0) {
+        state->stopped.notifyAll();
+      }
+    };
+    for (size_t w = 0; w < workers; ++w) {
+      if (executor) {
+        executor->add(task);
+      } else {
+        threads_.emplace_back(task);
+      }
+    }
+  }
+
+  /**
+   * @return number of workers which will now never run.
+   */
+  size_t cancelUnstarted() {
+    return state_->unstarted.exchange(0);
+  }
+
+  /**
+   * Waits for the workers which did start to finish.
+   */
+  void join() {
+    cancelUnstarted();
+    state_->stopped.await([&] { return state_->running.load() == 0; });
+    while (!threads_.empty()) {
+      threads_.back().join();
+      threads_.pop_back();
+    }
+  }
+};
+
 template <class Ops>
 class Parallel : public Operator<Parallel<Ops>> {
   Ops ops_;
   size_t threads_;
+  folly::Executor* executor_{nullptr};
+  bool ordered_{false};
+  size_t window_{0};
 
  public:
   Parallel(Ops ops, size_t threads) : ops_(std::move(ops)), threads_(threads) {}
 
+  Parallel(Ops ops, folly::Executor* executor, size_t workers)
+      : ops_(std::move(ops)), threads_(workers), executor_(executor) {}
+
+  /**
+   * @return this operator, producing the values in input order.
+   * @param window maximum number of values in flight, 0 for 4 per thread.
+   */
+  Parallel ordered(size_t window = 0) const {
+    auto result = *this;
+    result.ordered_ = true;
+    result.window_ = window;
+    return result;
+  }
+
   template <class Input,
             class Source,
             class InputDecayed = typename std::decay<Input>::type,
@@ -167,8 +252,13 @@ class Parallel : public Operator<Parallel<Ops>> {
     const Source source_;
     const Ops ops_;
     const size_t threads_;
+    folly::Executor* const executor_;
+    const bool ordered_;
+    const size_t window_;
     typedef ClosableMPMCQueue<InputDecayed> InQueue;
     typedef ClosableMPMCQueue<OutputDecayed> OutQueue;
+    typedef std::pair<size_t, InputDecayed> OrderedInput;
+    typedef std::pair<size_t, std::vector<OutputDecayed>> OrderedOutput;
 
     class Puller : public GenImpl<InputDecayed&&, Puller> {
       InQueue* queue_;
@@ -217,39 +307,53 @@ class Parallel : public Operator<Parallel<Ops>> {
       }
     };
 
-    template <bool all = false>
+    /**
+     * Yields a single input value, for processing it outside of a worker.
+     */
+    class Single : public GenImpl<InputDecayed&&, Single> {
+      InputDecayed* input_;
+
+     public:
+      explicit Single(InputDecayed* input) : input_(input) {}
+
+      template <class Handler>
+      bool apply(Handler&& handler) const {
+        return handler(std::move(*input_));
+      }
+
+      template <class Body>
+      void foreach(Body&& body) const {
+        body(std::move(*input_));
+      }
+    };
+
+    template <class InItem, class OutItem>
     class Executor {
-      InQueue inQueue_;
-      OutQueue outQueue_;
-      Puller puller_;
-      Pusher<all> pusher_;
-      std::vector<std::thread> workers_;
-      const Ops* ops_;
-
-      void work() {
-        puller_ | *ops_ | pusher_;
-      };
+      ClosableMPMCQueue<InItem> inQueue_;
+      ClosableMPMCQueue<OutItem> outQueue_;
+      ParallelWorkers workers_;
 
      public:
-      Executor(size_t threads, const Ops* ops)
-          : inQueue_(threads * 4),
-            outQueue_(threads * 4),
-            puller_(&inQueue_),
-            pusher_(&outQueue_),
-            ops_(ops) {
+      template <class Work>
+      Executor(
+          size_t threads,
+          size_t capacity,
+          folly::Executor* executor,
+          Work work)
+          : inQueue_(capacity), outQueue_(capacity) {
         inQueue_.openProducer();
         outQueue_.openConsumer();
         for (size_t t = 0; t < threads; ++t) {
           inQueue_.openConsumer();
           outQueue_.openProducer();
-          workers_.emplace_back([this] {
-            SCOPE_EXIT {
-              inQueue_.closeOutputConsumer();
-              outQueue_.closeInputProducer();
-            };
-            this->work();
-          });
         }
+        workers_.start(threads, executor, [this, work] {
+          SCOPE_EXIT {
+            inQueue_.closeOutputConsumer();
+            outQueue_.closeInputProducer();
+          };
+          work(inQueue_, outQueue_);
+        });
       }
 
       ~Executor() {
@@ -259,65 +363,228 @@ class Parallel : public Operator<Parallel<Ops>> {
         if (outQueue_.consumers()) {
           outQueue_.closeOutputConsumer();
         }
-        while (!workers_.empty()) {
-          workers_.back().join();
-          workers_.pop_back();
-        }
+        cancelUnstarted();
+        workers_.join();
         CHECK(!inQueue_.consumers());
         CHECK(!outQueue_.producers());
       }
 
+      /**
+       * Gives up on the workers which haven't started yet, so that reading
+       * the output only waits for the ones which did.
+       */
+      void cancelUnstarted() {
+        for (auto n = workers_.cancelUnstarted(); n > 0; --n) {
+          inQueue_.closeOutputConsumer();
+          outQueue_.closeInputProducer();
+        }
+      }
+
       void closeInputProducer() { inQueue_.closeInputProducer(); }
 
       void closeOutputConsumer() { outQueue_.closeOutputConsumer(); }
 
-      bool writeUnlessClosed(Input&& input) {
-        return inQueue_.writeUnlessClosed(std::forward<Input>(input));
+      template <class... Args>
+      bool writeUnlessClosed(Args&&... args) {
+        return inQueue_.writeUnlessClosed(std::forward<Args>(args)...);
       }
 
-      bool writeUnlessFull(Input&& input) {
-        return inQueue_.writeUnlessFull(std::forward<Input>(input));
+      template <class... Args>
+      bool writeUnlessFull(Args&&... args) {
+        return inQueue_.writeUnlessFull(std::forward<Args>(args)...);
       }
 
-      bool readUnlessClosed(OutputDecayed& output) {
+      /**
+       * Takes a queued input away from the workers.
+       */
+      bool steal(InItem& input) {
+        return inQueue_.readUnlessEmpty(input);
+      }
+
+      bool readUnlessClosed(OutItem& output) {
         return outQueue_.readUnlessClosed(output);
       }
 
-      bool readUnlessEmpty(OutputDecayed& output) {
+      bool readUnlessEmpty(OutItem& output) {
         return outQueue_.readUnlessEmpty(output);
       }
     };
 
+    template <bool all>
+    class UnorderedExecutor : public Executor<InputDecayed, OutputDecayed> {
+     public:
+      UnorderedExecutor(const Generator* self)
+          : Executor<InputDecayed, OutputDecayed>(
+                self->threads_,
+                self->threads_ * 4,
+                self->executor_,
+                [self](InQueue& inQueue, OutQueue& outQueue) {
+                  Puller(&inQueue) | self->ops_ | Pusher<all>(&outQueue);
+                }) {}
+    };
+
+    std::vector<OutputDecayed> processOrdered(InputDecayed& input) const {
+      std::vector<OutputDecayed> outputs;
+      Single(&input) | ops_ | [&](Output value) {
+        outputs.push_back(std::forward<Output>(value));
+      };
+      return outputs;
+    }
+
+    template <class Handler>
+    bool applyOrdered(Handler&& handler) const {
+      const size_t window = window_ ? window_ : threads_ * 4;
+      const Generator* self = this;
+      Executor<OrderedInput, OrderedOutput> executor(
+          threads_,
+          window,
+          executor_,
+          [self](
+              ClosableMPMCQueue<OrderedInput>& inQueue,
+              ClosableMPMCQueue<OrderedOutput>& outQueue) {
+            OrderedInput input;
+            while (inQueue.readUnlessClosed(input)) {
+              if (!outQueue.writeUnlessClosed(OrderedOutput(
+                      input.first, self->processOrdered(input.second)))) {
+                return;
+              }
+            }
+          });
+
+      // Outputs of input values [next, next + window), by sequence number.
+      std::vector<folly::Optional<std::vector<OutputDecayed>>> reorder(window);
+      size_t next = 0;
+      size_t submitted = 0;
+
+      auto emitReady = [&] {
+        while (reorder[next % window].hasValue()) {
+          auto& slot = reorder[next % window];
+          auto outputs = std::move(*slot);
+          slot.clear();
+          ++next;
+          for (auto& output : outputs) {
+            if (!handler(std::move(output))) {
+              return false;
+            }
+          }
+        }
+        return true;
+      };
+
+      // Makes progress towards emitting the oldest input value, doing its
+      // work here if no worker has taken it yet.
+      auto advance = [&] {
+        OrderedOutput output;
+        OrderedInput input;
+        if (executor.readUnlessEmpty(output)) {
+          reorder[output.first % window] = std::move(output.second);
+        } else if (executor_ && executor.steal(input)) {
+          reorder[input.first % window] = processOrdered(input.second);
+        } else if (executor.readUnlessClosed(output)) {
+          reorder[output.first % window] = std::move(output.second);
+        }
+        return emitReady();
+      };
+
+      bool more = true;
+      source_.apply([&](Input input) {
+        while (submitted - next == window) {
+          if (!advance()) {
+            more = false;
+            return false;
+          }
+        }
+        // The queue holds up to window values, so this doesn't block.
+        CHECK(executor.writeUnlessClosed(
+            OrderedInput(submitted++, std::forward<Input>(input))));
+        OrderedOutput output;
+        while (executor.readUnlessEmpty(output)) {
+          reorder[output.first % window] = std::move(output.second);
+        }
+        if (!emitReady()) {
+          more = false;
+          return false;
+        }
+        return true;
+      });
+      executor.closeInputProducer();
+
+      while (more && next != submitted) {
+        more = advance();
+      }
+      executor.closeOutputConsumer();
+
+      return more;
+    }
+
    public:
-    Generator(Source source, Ops ops, size_t threads)
+    Generator(
+        Source source,
+        Ops ops,
+        size_t threads,
+        folly::Executor* executor,
+        bool ordered,
+        size_t window)
         : source_(std::move(source)),
           ops_(std::move(ops)),
           threads_(
               threads ? threads
-                      : std::max<size_t>(1, sysconf(_SC_NPROCESSORS_CONF))) {}
+                      : std::max<size_t>(1, sysconf(_SC_NPROCESSORS_CONF))),
+          executor_(executor),
+          ordered_(ordered),
+          window_(window) {}
 
     template <class Handler>
     bool apply(Handler&& handler) const {
-      Executor<false> executor(threads_, &ops_);
+      if (ordered_) {
+        return applyOrdered(std::forward<Handler>(handler));
+      }
+
+      UnorderedExecutor<false> executor(this);
       bool more = true;
-      source_.apply([&](Input input) {
-        if (executor.writeUnlessFull(std::forward<Input>(input))) {
-          return true;
-        }
+      // Reads the outputs available so far.
+      auto drain = [&] {
         OutputDecayed output;
         while (executor.readUnlessEmpty(output)) {
           if (!handler(std::move(output))) {
-            more = false;
             return false;
           }
         }
-        if (!executor.writeUnlessClosed(std::forward<Input>(input))) {
-          return false;
+        return true;
+      };
+      // Processes a queued input value here instead of waiting for a worker.
+      // Only done on an executor, so that threads of our own run all of ops.
+      auto help = [&](bool& helped) {
+        InputDecayed input;
+        helped = executor_ && executor.steal(input);
+        return !helped ||
+            (Single(&input) | ops_).apply([&](Output value) {
+              return handler(OutputDecayed(std::forward<Output>(value)));
+            });
+      };
+
+      source_.apply([&](Input input) {
+        while (!executor.writeUnlessFull(std::forward<Input>(input))) {
+          bool helped;
+          if (!drain() || !help(helped)) {
+            more = false;
+            return false;
+          }
+          if (!helped) {
+            return executor.writeUnlessClosed(std::forward<Input>(input));
+          }
         }
         return true;
       });
       executor.closeInputProducer();
 
+      if (executor_) {
+        for (bool helped = true; more && helped;) {
+          more = drain() && help(helped);
+        }
+        executor.cancelUnstarted();
+      }
+
       if (more) {
         OutputDecayed output;
         while (executor.readUnlessClosed(output)) {
@@ -334,19 +601,50 @@ class Parallel : public Operator<Parallel<Ops>> {
 
     template <class Body>
     void foreach(Body&& body) const {
-      Executor<true> executor(threads_, &ops_);
-      source_.foreach([&](Input input) {
-        if (executor.writeUnlessFull(std::forward<Input>(input))) {
-          return;
-        }
+      if (ordered_) {
+        applyOrdered([&](OutputDecayed&& output) {
+          body(std::move(output));
+          return true;
+        });
+        return;
+      }
+
+      UnorderedExecutor<true> executor(this);
+      auto drain = [&] {
         OutputDecayed output;
         while (executor.readUnlessEmpty(output)) {
           body(std::move(output));
         }
-        CHECK(executor.writeUnlessClosed(std::forward<Input>(input)));
+      };
+      auto help = [&] {
+        InputDecayed input;
+        if (!executor_ || !executor.steal(input)) {
+          return false;
+        }
+        (Single(&input) | ops_).foreach([&](Output value) {
+          body(OutputDecayed(std::forward<Output>(value)));
+        });
+        return true;
+      };
+
+      source_.foreach([&](Input input) {
+        while (!executor.writeUnlessFull(std::forward<Input>(input))) {
+          drain();
+          if (!help()) {
+            CHECK(executor.writeUnlessClosed(std::forward<Input>(input)));
+            return;
+          }
+        }
       });
       executor.closeInputProducer();
 
+      if (executor_) {
+        do {
+          drain();
+        } while (help());
+        executor.cancelUnstarted();
+      }
+
       OutputDecayed output;
       while (executor.readUnlessClosed(output)) {
         body(std::move(output));
@@ -357,12 +655,14 @@ class Parallel : public Operator<Parallel<Ops>> {
 
   template <class Value, class Source>
   Generator<Value, Source> compose(const GenImpl<Value, Source>& source) const {
-    return Generator<Value, Source>(source.self(), ops_, threads_);
+    return Generator<Value, Source>(
+        source.self(), ops_, threads_, executor_, ordered_, window_);
   }
 
   template <class Value, class Source>
   Generator<Value, Source> compose(GenImpl<Value, Source>&& source) const {
-    return Generator<Value, Source>(std::move(source.self()), ops_, threads_);
+    return Generator<Value, Source>(
+        std::move(source.self()), ops_, threads_, executor_, ordered_, window_);
   }
 };
 
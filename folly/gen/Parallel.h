@@ -19,6 +19,7 @@
 
 #include <mutex>
 
+#include <folly/Executor.h>
 #include <folly/gen/Base.h>
 
 namespace folly { namespace gen {
@@ -81,12 +82,50 @@ Chunked chunked(Container& container, int chunkSize = 256) {
  *
  * Here, each thread counts its portion of the result, then the sub-counts are
  * summed up to produce the total count.
+ *
+ * Results are produced in the order they are completed. To get them in input
+ * order instead, use 'parallel(ops).ordered()':
+ *
+ *   auto scores
+ *     = from(ids)
+ *     | parallel(map(fetchObj) | map(scoreObj)).ordered()
+ *     | as<vector>();
+ *
+ * In ordered mode, 'ops' are applied to each input value on its own, and all
+ * of the values it yields are produced before those of the next input value.
+ * At most 'window' values (by default 4 per thread) are in flight at any
+ * time; if the oldest one is slow, the others wait in a reorder buffer.
  */
 template <class Ops, class Parallel = detail::Parallel<Ops>>
 Parallel parallel(Ops ops, size_t threads = 0) {
   return Parallel(std::move(ops), threads);
 }
 
+/**
+ * parallel(ops, executor) - Like 'parallel(ops)', but runs the workers as
+ * tasks on the given executor instead of on threads of its own.
+ *
+ * Workers pull values from a shared queue, so a slow value only holds up the
+ * worker processing it. When the queue fills up, or once the input has been
+ * exhausted, the calling thread takes queued values and processes them
+ * itself. Hence the pipeline completes even if the executor never gets to
+ * run some of the workers, e.g. because the caller is running on it.
+ * The executor must not run tasks inline in add().
+ *
+ * Unlike with 'parallel(ops)', where only its own threads run 'ops', 'ops'
+ * may thus also run on the calling thread, one value at a time: with
+ * 'sub(sink)', each value the caller processes yields a result of its own.
+ *
+ *   auto pages
+ *     = from(urls)
+ *     | parallel(map(fetch) | filter(isValid), cpuExecutor)
+ *     | as<vector>();
+ */
+template <class Ops, class Parallel = detail::Parallel<Ops>>
+Parallel parallel(Ops ops, folly::Executor& executor, size_t workers = 0) {
+  return Parallel(std::move(ops), &executor, workers);
+}
+
 /**
  * sub - For sub-summarization of a sequence.
  *
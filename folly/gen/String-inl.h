@@ -20,6 +20,7 @@
 
 #include <folly/Conv.h>
 #include <folly/String.h>
+#include <folly/detail/DelimiterScan.h>
 
 namespace folly {
 namespace gen {
@@ -91,6 +92,66 @@ inline size_t splitPrefix(StringPiece& in,
   return 0;
 }
 
+/**
+ * Calls fn(piece, delimiterLength) for each delimited piece at the front of
+ * "in", where each piece includes its trailing delimiter, advancing "in" past
+ * the pieces consumed. Stops early, returning false, if fn returns false.
+ * Afterwards "in" holds only the bytes after the last delimiter.
+ */
+template <class Delimiter, class Fn>
+bool splitPieces(StringPiece& in, Delimiter delimiter, Fn&& fn) {
+  StringPiece prefix;
+  while (size_t delim_len = splitPrefix(in, prefix, delimiter)) {
+    if (!fn(prefix, delim_len)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Delimiter offsets found per call to scanDelimiters()
+constexpr size_t kSplitBatchSize = 256;
+// Shorter inputs are split with a search per piece
+constexpr size_t kSplitScanMinSize = 2 * folly::detail::kDelimiterScanBlock;
+
+/**
+ * As above, but finds a batch of delimiters a block of bytes at a time with
+ * SIMD, rather than searching again for each piece.
+ */
+template <class Fn>
+bool splitPieces(StringPiece& in, char delimiter, Fn&& fn) {
+  if (in.size() < kSplitScanMinSize) {
+    // not worth setting up a scan
+    StringPiece prefix;
+    while (splitPrefix(in, prefix, delimiter)) {
+      if (!fn(prefix, 1)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  const folly::detail::DelimiterSet delimiters(StringPiece(&delimiter, 1));
+  uint32_t offsets[kSplitBatchSize];
+  const char* piece = in.begin();
+  const char* scan = in.begin();
+  while (scan != in.end()) {
+    size_t count;
+    size_t scanned = folly::detail::scanDelimiters(
+        scan, in.end(), delimiters, offsets, kSplitBatchSize, &count);
+    for (size_t i = 0; i < count; ++i) {
+      const char* next = scan + offsets[i] + 1;
+      if (!fn(StringPiece(piece, next), 1)) {
+        in.assign(next, in.end());
+        return false;
+      }
+      piece = next;
+    }
+    scan += scanned;
+  }
+  in.assign(piece, in.end());
+  return true;
+}
+
 inline const char* ch(const unsigned char* p) {
   return reinterpret_cast<const char*>(p);
 }
@@ -182,11 +243,16 @@ bool StreamSplitter<Callback>::operator()(StringPiece in) {
   // len(buffer + in) < maxLength_.
 
   // Send lines to callback directly from input (no buffer)
-  while (found) {  // Buffer guaranteed to be empty
+  if (found) {  // Buffer guaranteed to be empty
     if (!detail::consumeFixedSizeChunks(pieceCb_, prefix, maxLength_)) {
       return false;
     }
-    found = detail::splitPrefix(in, prefix, delimiter_);
+    auto consume = [this](StringPiece piece, size_t) {
+      return detail::consumeFixedSizeChunks(pieceCb_, piece, maxLength_);
+    };
+    if (!detail::splitPieces(in, delimiter_, consume)) {
+      return false;
+    }
   }
 
   // No more delimiters left; consume 'in' until it is shorter than maxLength_
@@ -277,12 +343,12 @@ class SplitStringSource
   template <class Body>
   bool apply(Body&& body) const {
     StringPiece rest(source_);
-    StringPiece prefix;
-    while (size_t delim_len = splitPrefix(rest, prefix, this->delimiter_)) {
+    auto emit = [&body](StringPiece prefix, size_t delim_len) {
       prefix.subtract(delim_len);  // Remove the delimiter
-      if (!body(prefix)) {
-        return false;
-      }
+      return body(prefix);
+    };
+    if (!splitPieces(rest, this->delimiter_, emit)) {
+      return false;
     }
     if (!rest.empty()) {
       if (!body(rest)) {
@@ -293,6 +359,102 @@ class SplitStringSource
   }
 };
 
+// Scanning behind tokenize() and tokenizeDelimited()
+class Tokenizer {
+  StringPiece source_;
+  char quote_;
+  folly::detail::DelimiterSet delimiters_;
+
+  static std::string delimitersAndQuote(StringPiece delimiters, char quote) {
+    std::string bytes = delimiters.str();
+    if (quote != '\0') {
+      bytes.push_back(quote);
+    }
+    return bytes;
+  }
+
+  StringPiece unquote(StringPiece token) const {
+    if (quote_ != '\0' && token.size() >= 2 && token.front() == quote_ &&
+        token.back() == quote_) {
+      token.pop_front();
+      token.pop_back();
+    }
+    return token;
+  }
+
+ public:
+  Tokenizer(StringPiece source, StringPiece delimiters, char quote)
+      : source_(source),
+        quote_(quote),
+        delimiters_(delimitersAndQuote(delimiters, quote)) {}
+
+  // Calls body(token, delimiter) for every token, with the delimiter byte
+  // that ended it, or '\0' for a last token that runs to the end.
+  template <class Body>
+  bool forEach(Body&& body) const {
+    uint32_t offsets[kSplitBatchSize];
+    const char* token = source_.begin();
+    const char* scan = source_.begin();
+    bool quoted = false;
+    while (scan != source_.end()) {
+      size_t count;
+      size_t scanned = folly::detail::scanDelimiters(
+          scan, source_.end(), delimiters_, offsets, kSplitBatchSize, &count);
+      for (size_t i = 0; i < count; ++i) {
+        const char* p = scan + offsets[i];
+        if (quote_ != '\0' && *p == quote_) {
+          quoted = !quoted;
+        } else if (!quoted) {
+          if (!body(unquote(StringPiece(token, p)), *p)) {
+            return false;
+          }
+          token = p + 1;
+        }
+      }
+      scan += scanned;
+    }
+    if (token != source_.end()) {
+      if (!body(unquote(StringPiece(token, source_.end())), '\0')) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+class TokenizeSource : public GenImpl<StringPiece, TokenizeSource> {
+  Tokenizer tokenizer_;
+
+ public:
+  TokenizeSource(StringPiece source, StringPiece delimiters, char quote)
+      : tokenizer_(source, delimiters, quote) {}
+
+  template <class Body>
+  bool apply(Body&& body) const {
+    return tokenizer_.forEach(
+        [&body](StringPiece token, char) { return body(token); });
+  }
+};
+
+class DelimitedTokenizeSource
+    : public GenImpl<DelimitedToken, DelimitedTokenizeSource> {
+  Tokenizer tokenizer_;
+
+ public:
+  DelimitedTokenizeSource(
+      StringPiece source,
+      StringPiece delimiters,
+      char quote)
+      : tokenizer_(source, delimiters, quote) {}
+
+  template <class Body>
+  bool apply(Body&& body) const {
+    return tokenizer_.forEach([&body](StringPiece token, char delimiter) {
+      return body(DelimitedToken{token, delimiter});
+    });
+  }
+};
+
 /**
  * Unsplit - For joining tokens from a generator into a string.  This is
  * the inverse of `split` above.
@@ -30,6 +30,10 @@ class StringResplitter;
 template<class Delimiter>
 class SplitStringSource;
 
+class TokenizeSource;
+
+class DelimitedTokenizeSource;
+
 template<class Delimiter, class Output>
 class Unsplit;
 
@@ -83,6 +87,47 @@ S lines(StringPiece source) {
   return S(source, MixedNewlines{});
 }
 
+/**
+ * Split on any of several delimiter bytes, ignoring delimiters inside
+ * quotes, as in CSV: a quote character toggles quoting wherever it appears,
+ * and a token that starts and ends with it has those two quotes removed.
+ * Doubled quotes inside a quoted token ("a ""b"" c") are left as they are.
+ * Passing '\0' as the quote disables quoting. At most 7 delimiters may be
+ * given with a quote, 8 without.
+ *
+ * E.G.
+ *   tokenize(R"(1,"Smith, John",,x)", ",")
+ *   yields "1", "Smith, John", "" and "x"
+ */
+template <class S = detail::TokenizeSource>
+S tokenize(StringPiece source, StringPiece delimiters, char quote = '"') {
+  return S(source, delimiters, quote);
+}
+
+/// A token from tokenizeDelimited(), with the delimiter byte that ended
+/// it, or '\0' if it ran to the end of the input.
+struct DelimitedToken {
+  StringPiece token;
+  char delimiter;
+};
+
+/**
+ * Like tokenize(), but yields DelimitedTokens, so that callers can tell
+ * which delimiter ended each token, e.g. to find the ends of the rows of
+ * tokenizeDelimited(csv, ",\n").
+ *
+ * E.G.
+ *   tokenizeDelimited("a,b\nc", ",\n")
+ *   yields {"a", ','}, {"b", '\n'} and {"c", '\0'}
+ */
+template <class S = detail::DelimitedTokenizeSource>
+S tokenizeDelimited(
+    StringPiece source,
+    StringPiece delimiters,
+    char quote = '"') {
+  return S(source, delimiters, quote);
+}
+
 /*
  * Joins a sequence of tokens into a string, with the chosen delimiter.
  *
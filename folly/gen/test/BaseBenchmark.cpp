@@ -89,6 +89,71 @@ BENCHMARK_RELATIVE(Sum_Vector_Gen, iters) {
 
 BENCHMARK_DRAW_LINE()
 
+// Taking values by non-const reference makes 'map' opt out of blocks, so this
+// keeps the rest of the pipeline on the value-at-a-time path.
+auto scalar = map([](int& x) -> int { return x; });
+
+BENCHMARK(Sum_Vector_Scalar, iters) {
+  int s = 0;
+  while (iters--) {
+    s += from(testVector) | scalar | sum;
+  }
+  folly::doNotOptimizeAway(s);
+}
+
+BENCHMARK_RELATIVE(Sum_Vector_Blocks, iters) {
+  int s = 0;
+  while (iters--) {
+    s += from(testVector) | map([](int x) { return x; }) | sum;
+  }
+  folly::doNotOptimizeAway(s);
+}
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(MapFilterSum_Scalar, iters) {
+  int s = 0;
+  while (iters--) {
+    s += from(testVector)
+       | scalar
+       | map([](int x) { return x >> 8; })
+       | filter([](int x) { return x & 1; })
+       | sum;
+  }
+  folly::doNotOptimizeAway(s);
+}
+
+BENCHMARK_RELATIVE(MapFilterSum_Blocks, iters) {
+  int s = 0;
+  while (iters--) {
+    s += from(testVector)
+       | map([](int x) { return x >> 8; })
+       | filter([](int x) { return x & 1; })
+       | sum;
+  }
+  folly::doNotOptimizeAway(s);
+}
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(Max_Vector_Scalar, iters) {
+  int s = 0;
+  while (iters--) {
+    s += from(testVector) | scalar | max | unwrap;
+  }
+  folly::doNotOptimizeAway(s);
+}
+
+BENCHMARK_RELATIVE(Max_Vector_Blocks, iters) {
+  int s = 0;
+  while (iters--) {
+    s += from(testVector) | max | unwrap;
+  }
+  folly::doNotOptimizeAway(s);
+}
+
+BENCHMARK_DRAW_LINE()
+
 BENCHMARK(Member, iters) {
   int s = 0;
   while(iters--) {
@@ -293,6 +358,50 @@ BENCHMARK_RELATIVE(Composed_GenRegular, iters) {
 
 BENCHMARK_DRAW_LINE()
 
+BENCHMARK(OrderTake, iters) {
+  int s = 0;
+  while (iters--) {
+    s += from(testVector) | orderBy() | take(10) | sum;
+  }
+  folly::doNotOptimizeAway(s);
+}
+
+BENCHMARK_RELATIVE(TopK, iters) {
+  int s = 0;
+  while (iters--) {
+    s += from(testVector) | topK(10) | sum;
+  }
+  folly::doNotOptimizeAway(s);
+}
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(GroupByCount, iters) {
+  size_t s = 0;
+  while (iters--) {
+    s += from(testVector)
+       | groupBy([](int i) { return i % 100; })
+       | mapOp(count)
+       | sum;
+  }
+  folly::doNotOptimizeAway(s);
+}
+
+BENCHMARK_RELATIVE(AggregateByCount, iters) {
+  size_t s = 0;
+  while (iters--) {
+    s += from(testVector)
+       | aggregateBy([](int i) { return i % 100; },
+                     size_t(0),
+                     [](size_t n, int) { return n + 1; })
+       | get<1>()
+       | sum;
+  }
+  folly::doNotOptimizeAway(s);
+}
+
+BENCHMARK_DRAW_LINE()
+
 BENCHMARK(Sample, iters) {
   size_t s = 0;
   while (iters--) {
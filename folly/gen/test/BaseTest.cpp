@@ -16,7 +16,9 @@
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <climits>
 #include <iosfwd>
+#include <numeric>
 #include <random>
 #include <set>
 #include <vector>
@@ -554,6 +556,34 @@ TEST(Gen, OrderTake) {
   EXPECT_EQ(expected, actual);
 }
 
+TEST(Gen, TopK) {
+  auto expected = vector<int>{9, 8, 7};
+  auto actual =
+      from({8, 6, 7, 5, 3, 0, 9})
+    | topKDescending(3, square)
+    | as<vector>();
+  EXPECT_EQ(expected, actual);
+
+  // same as orderBy(...) | take(n), for every n
+  auto input = seq(1, 50) | map([](int x) { return x * 37 % 101; })
+             | as<vector>();
+  for (size_t n : {0, 1, 10, 49, 50, 51}) {
+    auto key = [](int x) { return (50.5 - x) * (50.5 - x); };
+    EXPECT_EQ(from(input) | orderBy(key) | take(n) | as<vector>(),
+              from(input) | topK(n, key) | as<vector>());
+  }
+}
+
+TEST(Gen, TopKMoved) {
+  auto expected = vector<string>{"a", "bb", "ccc"};
+  auto actual =
+      from({"eeeee", "ccc", "a", "dddd", "bb"})
+    | eachTo<string>()
+    | topK(3, [](const string& s) { return s.size(); })
+    | as<vector>();
+  EXPECT_EQ(expected, actual);
+}
+
 TEST(Gen, Distinct) {
   auto expected = vector<int>{3, 1, 2};
   auto actual =
@@ -649,6 +679,85 @@ TEST(Gen, Max) {
   EXPECT_EQ(9, odds | max);
 }
 
+auto odd = [](int i) { return i % 2 != 0; };
+
+// Numeric pipelines over arrays and sequences run on blocks of values...
+static_assert(gen::detail::HasBlocks<decltype(seq(1, 10))>::value, "");
+static_assert(gen::detail::HasBlocks<decltype(gen::range(1, 10))>::value, "");
+static_assert(
+    gen::detail::HasBlocks<decltype(from(std::declval<vector<double>&>()))>::value,
+    "");
+static_assert(gen::detail::HasBlocks<decltype(fromCopy(vector<int>()))>::value, "");
+static_assert(
+    gen::detail::HasBlocks<decltype(seq(1, 10) | map(square) | filter(odd))>::value,
+    "");
+// ...but not when the values aren't in an array, aren't arithmetic, or the
+// operators need to see the original values.
+static_assert(!gen::detail::HasBlocks<decltype(seq(1))>::value, "");
+static_assert(!gen::detail::HasBlocks<decltype(seq(1, 10, 2))>::value, "");
+static_assert(
+    !gen::detail::HasBlocks<decltype(from(std::declval<std::set<int>&>()))>::value,
+    "");
+static_assert(
+    !gen::detail::HasBlocks<decltype(from(std::declval<vector<string>&>()))>::value,
+    "");
+auto increment = [](int& i) { return ++i; };
+static_assert(
+    !gen::detail::HasBlocks<decltype(
+        from(std::declval<vector<int>&>()) | map(increment))>::value,
+    "");
+
+TEST(Gen, Blocks) {
+  for (int size : {0, 1, 255, 256, 257, 1000}) {
+    vector<int> values;
+    for (int i = 0; i < size; ++i) {
+      values.push_back((i * 7919) % 1000 - 500);
+    }
+    std::set<int> scalar(values.begin(), values.end());
+    auto blocks = from(values);
+    vector<int> odds;
+    int oddSum = 0;
+    for (int i : values) {
+      if (odd(i)) {
+        odds.push_back(i);
+        oddSum += square(i);
+      }
+    }
+
+    // std::set has no blocks, so takes the scalar path.
+    EXPECT_EQ(size, blocks | count);
+    EXPECT_EQ(std::accumulate(values.begin(), values.end(), 0), blocks | sum);
+    EXPECT_EQ(odds.size(), blocks | filter(odd) | count);
+    EXPECT_EQ(oddSum, blocks | filter(odd) | map(square) | sum);
+    EXPECT_TRUE((from(scalar) | min) == (blocks | min));
+    EXPECT_TRUE((from(scalar) | max) == (blocks | max));
+    EXPECT_TRUE((from(odds) | max) == (blocks | filter(odd) | max));
+    EXPECT_EQ(size * (size + 1) / 2, seq(1, size) | sum);
+    EXPECT_EQ(size, gen::range(0, size) | count);
+  }
+}
+
+TEST(Gen, BlocksSequenceBounds) {
+  EXPECT_EQ(6, seq(INT_MAX - 5, INT_MAX) | count);
+  EXPECT_EQ(5, gen::range(INT_MAX - 5, INT_MAX) | count);
+  EXPECT_EQ(256, seq<int8_t>(-128, 127) | count);
+  EXPECT_EQ(0, seq(5, 1) | count);
+  EXPECT_EQ(0, gen::range(5, 5) | count);
+  EXPECT_EQ(-128 + 127, seq<int>(-128, 127) | filter([](int i) {
+                          return i == -128 || i == 127;
+                        }) | sum);
+}
+
+TEST(Gen, BlocksSideEffects) {
+  int calls = 0;
+  auto counted = map([&](int i) {
+    ++calls;
+    return i;
+  });
+  EXPECT_EQ(1000, seq(1, 1000) | counted | count);
+  EXPECT_EQ(1000, calls);
+}
+
 TEST(Gen, Append) {
   string expected = "facebook";
   string actual = "face";
@@ -1223,6 +1332,44 @@ TEST(Gen, GroupBy) {
                | as<vector>());
 }
 
+TEST(Gen, AggregateBy) {
+  vector<string> strs{"zero", "one", "two",   "three", "four",
+                      "five", "six", "seven", "eight", "nine"};
+  auto concatenate = [](string acc, const string& s) { return acc + s; };
+
+  // keys in order of first appearance
+  auto expected = vector<std::pair<size_t, string>>{
+      {4, "zerofourfivenine"}, {3, "onetwosix"}, {5, "threeseveneight"}};
+  auto actual = from(strs)
+              | aggregateBy([](const string& s) { return s.size(); },
+                            string(),
+                            concatenate)
+              | as<vector>();
+  EXPECT_EQ(expected, actual);
+
+  // many keys, forcing the table to grow
+  auto counts = seq(0, 99999)
+              | aggregateBy([](int i) { return i % 1000; },
+                            0,
+                            [](int n, int) { return n + 1; })
+              | as<vector>();
+  EXPECT_EQ(1000, counts.size());
+  EXPECT_EQ(0, counts.front().first);
+  EXPECT_EQ(999, counts.back().first);
+  EXPECT_EQ(100000, from(counts) | get<1>() | sum);
+  EXPECT_TRUE(from(counts) | get<1>() | all([](int n) { return n == 100; }));
+}
+
+TEST(Gen, MergeAggregates) {
+  using Partial = std::pair<string, int>;
+  vector<Partial> partials{{"a", 1}, {"b", 2}, {"a", 3}, {"c", 4}, {"b", 5}};
+  auto expected = vector<Partial>{{"a", 4}, {"b", 7}, {"c", 4}};
+  EXPECT_EQ(expected,
+            from(partials) | mergeAggregates(add) | as<vector>());
+  EXPECT_EQ(expected,
+            from(partials) | move | mergeAggregates(add) | as<vector>());
+}
+
 TEST(Gen, Unwrap) {
   Optional<int> o(4);
   Optional<int> e;
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <folly/experimental/TestUtil.h>
+#include <folly/gen/Base.h>
+#include <folly/gen/ExternalSort.h>
+
+using namespace folly::gen;
+using namespace folly;
+using std::string;
+using std::vector;
+
+namespace {
+
+struct Keyed {
+  int key;
+  int seq;
+};
+
+std::vector<int> randomInts(size_t n, int limit) {
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<int> dist(0, limit);
+  std::vector<int> v(n);
+  std::generate(v.begin(), v.end(), [&] { return dist(rng); });
+  return v;
+}
+
+}  // namespace
+
+TEST(ExternalSort, InMemory) {
+  test::TemporaryDirectory tmp;
+  auto input = randomInts(1000, 100000);
+  auto expected = input;
+  std::sort(expected.begin(), expected.end());
+  auto actual = from(input)
+              | sortExternal(1 << 20, tmp.path().string())
+              | as<vector>();
+  EXPECT_EQ(expected, actual);
+  // nothing spilled
+  EXPECT_TRUE(fs::is_empty(tmp.path()));
+}
+
+TEST(ExternalSort, Spilled) {
+  test::TemporaryDirectory tmp;
+  auto input = randomInts(100000, 1000000);
+  auto expected = input;
+  std::sort(expected.begin(), expected.end(), std::greater<int>());
+  // ~250 runs of 400 values, each spanning several RecordIO records
+  auto actual = from(input)
+              | sortExternal(1600, tmp.path().string(), Identity(), Greater())
+              | as<vector>();
+  EXPECT_EQ(expected, actual);
+  // runs are unlinked as soon as they are created
+  EXPECT_TRUE(fs::is_empty(tmp.path()));
+}
+
+TEST(ExternalSort, Stable) {
+  test::TemporaryDirectory tmp;
+  auto keys = randomInts(10000, 50);
+  vector<Keyed> input;
+  for (int i = 0; i < keys.size(); ++i) {
+    input.push_back(Keyed{keys[i], i});
+  }
+  auto expected = input;
+  std::stable_sort(
+      expected.begin(), expected.end(), [](const Keyed& a, const Keyed& b) {
+        return a.key < b.key;
+      });
+  auto actual = from(input)
+              | sortExternal(4096,
+                             tmp.path().string(),
+                             [](const Keyed& k) { return k.key; })
+              | as<vector>();
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i].key, actual[i].key);
+    EXPECT_EQ(expected[i].seq, actual[i].seq);
+  }
+}
+
+TEST(ExternalSort, Strings) {
+  test::TemporaryDirectory tmp;
+  vector<string> input;
+  for (auto i : randomInts(5000, 100000)) {
+    // includes empty strings, which RecordIO can't store as records
+    input.push_back(i % 7 == 0 ? "" : std::to_string(i));
+  }
+  auto expected = input;
+  std::sort(expected.begin(), expected.end());
+  auto actual = from(input)
+              | sortExternal(10000, tmp.path().string())
+              | as<vector>();
+  EXPECT_EQ(expected, actual);
+}
+
+TEST(ExternalSort, Take) {
+  test::TemporaryDirectory tmp;
+  auto input = randomInts(10000, 1000000);
+  auto expected = input;
+  std::sort(expected.begin(), expected.end());
+  expected.resize(10);
+  auto actual = from(input)
+              | sortExternal(1000, tmp.path().string())
+              | take(10)
+              | as<vector>();
+  EXPECT_EQ(expected, actual);
+}
+
+TEST(ExternalSort, BadDirectory) {
+  auto input = randomInts(1000, 100);
+  EXPECT_THROW(from(input)
+               | sortExternal(16, "/nonexistent/folly_gen_sort")
+               | count,
+               std::system_error);
+}
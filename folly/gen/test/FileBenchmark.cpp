@@ -19,7 +19,9 @@
 #include <folly/Benchmark.h>
 #include <folly/File.h>
 #include <folly/gen/Base.h>
+#include <folly/experimental/TestUtil.h>
 #include <folly/gen/File.h>
+#include <folly/gen/Parallel.h>
 
 using namespace folly::gen;
 
@@ -57,6 +59,53 @@ BENCHMARK(ByLine_Pipes, iters) {
   }
 }
 
+namespace {
+
+constexpr int64_t kFileLines = 1 << 20;
+
+const char* numbersFile() {
+  static folly::test::TemporaryFile file = [] {
+    folly::test::TemporaryFile f("FileBenchmark");
+    seq<int64_t>(1, kFileLines) |
+        map([](int64_t i) { return folly::to<std::string>(i, '\n'); }) |
+        eachAs<folly::StringPiece>() | toFile(folly::File(f.fd()));
+    return f;
+  }();
+  static std::string path = file.path().string();
+  return path.c_str();
+}
+
+template <class Gen>
+void sumFile(size_t iters, Gen gen) {
+  BENCHMARK_SUSPEND {
+    numbersFile();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    auto s = gen(numbersFile());
+    CHECK_EQ(s, kFileLines * (kFileLines + 1) / 2);
+  }
+}
+}
+
+BENCHMARK(ByLine_File, iters) {
+  sumFile(iters, [](const char* path) {
+    return byLine(path) | eachTo<int64_t>() | sum;
+  });
+}
+
+BENCHMARK_RELATIVE(ByMappedLine_File, iters) {
+  sumFile(iters, [](const char* path) {
+    return byMappedLine(path) | eachTo<int64_t>() | sum;
+  });
+}
+
+BENCHMARK_RELATIVE(ByMappedLineChunks_Parallel, iters) {
+  sumFile(iters, [](const char* path) {
+    return byMappedLineChunks(path) |
+        parallel(concat | eachTo<int64_t>() | sub(sum)) | sum;
+  });
+}
+
 // Results from an Intel(R) Xeon(R) CPU E5-2660 0 @ 2.20GHz
 // ============================================================================
 // folly/gen/test/FileBenchmark.cpp                relative  time/iter  iters/s
@@ -22,6 +22,7 @@
 #include <folly/experimental/TestUtil.h>
 #include <folly/gen/Base.h>
 #include <folly/gen/File.h>
+#include <folly/gen/Parallel.h>
 
 using namespace folly::gen;
 using namespace folly;
@@ -56,6 +57,59 @@ TEST(FileGen, ByLine) {
   }
 }
 
+TEST(FileGen, ByMappedLine) {
+  auto collect = eachTo<std::string>() | as<vector>();
+  const std::string cases[] = {
+      "Hello world\n"
+      "This is the second line\n"
+      "\n"
+      "\n"
+      "a few empty lines above\n"
+      "incomplete last line",
+
+      "complete last line\n",
+
+      "\n",
+
+      "",
+  };
+
+  for (auto& lines : cases) {
+    test::TemporaryFile file("ByMappedLine");
+    EXPECT_EQ(lines.size(), write(file.fd(), lines.data(), lines.size()));
+
+    auto path = file.path().string();
+    auto expected = byLine(path.c_str()) | collect;
+    EXPECT_EQ(expected, byMappedLine(path.c_str()) | collect)
+        << "For Input: '" << lines << "'";
+
+    for (size_t chunkSize : {1, 2, 7, 4096}) {
+      EXPECT_EQ(
+          expected,
+          byMappedLineChunks(path.c_str(), '\n', chunkSize) | concat | collect)
+          << "For Input: '" << lines << "', chunk size " << chunkSize;
+    }
+
+    std::string bytes;
+    fromMappedFile(File(path.c_str()), 3) |
+        [&](ByteRange chunk) { bytes += StringPiece(chunk).str(); };
+    EXPECT_EQ(lines, bytes);
+  }
+}
+
+TEST(FileGen, ByMappedLineChunksParallel) {
+  test::TemporaryFile file("ByMappedLineChunksParallel");
+  auto toLine = [](int v) { return to<std::string>(v, '\n'); };
+  auto squares = seq(1, 10000) | map([](int x) { return x * x; });
+  squares | map(toLine) | eachAs<StringPiece>() | toFile(File(file.fd()));
+
+  auto path = file.path().string();
+  EXPECT_EQ(
+      squares | sum,
+      byMappedLineChunks(path.c_str(), '\n', 1000) |
+          parallel(concat | eachTo<int>() | sub(sum)) | sum);
+}
+
 class FileGenBufferedTest : public ::testing::TestWithParam<int> { };
 
 TEST_P(FileGenBufferedTest, FileWriter) {
@@ -112,6 +112,7 @@ BENCHMARK_DRAW_LINE();
 
 BENCH_GEN(large | map(factors) | sum);
 BENCH_GEN_REL(large | parallel(map(factors)) | sum);
+BENCH_GEN_REL(large | parallel(map(factors)).ordered() | sum);
 BENCHMARK_DRAW_LINE();
 
 auto ch = chunks;
@@ -18,9 +18,12 @@
 #include <gtest/gtest.h>
 #include <iostream>
 #include <array>
+#include <map>
+#include <thread>
 #include <vector>
 #include <folly/gen/Base.h>
 #include <folly/gen/Parallel.h>
+#include <folly/futures/ManualExecutor.h>
 
 using namespace folly;
 using namespace folly::gen;
@@ -102,6 +105,119 @@ TEST(ParallelTest, PSum) {
             from(primes) | parallel(map(sleepyWork) | sub(sum)) | sum);
 }
 
+TEST(ParallelTest, OpsOnWorkerThreadsOnly) {
+  // Without an executor the caller never runs ops itself, so sub() yields
+  // exactly one result per thread, even when the queue fills up.
+  auto caller = std::this_thread::get_id();
+  auto onCaller = [caller](int) {
+    return std::this_thread::get_id() == caller ? 1 : 0;
+  };
+  EXPECT_EQ(0, seq(1, 10000) | parallel(map(onCaller) | sub(sum), 2) | sum);
+  EXPECT_EQ(2, seq(1, 10000) | parallel(map(onCaller) | sub(sum), 2) | count);
+  EXPECT_EQ(0,
+            seq(1, 10000) | parallel(map(onCaller), 2).ordered() | sum);
+  size_t results = 0;
+  seq(1, 10000) | parallel(map(sleepyWork) | sub(count), 3) |
+      [&](size_t) { ++results; };
+  EXPECT_EQ(3, results);
+}
+
+namespace {
+// Runs every task on a thread of its own.
+class ThreadExecutor : public folly::Executor {
+ public:
+  ~ThreadExecutor() {
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  void add(Func f) override {
+    threads_.emplace_back(std::move(f));
+  }
+
+ private:
+  std::vector<std::thread> threads_;
+};
+}
+
+TEST(ParallelTest, Executor) {
+  ThreadExecutor executor;
+  EXPECT_EQ(from(primes) | map(sleepyWork) | sum,
+            from(primes) | parallel(map(sleepyWork) | sub(sum), executor, 4) |
+                sum);
+  EXPECT_EQ(
+      primes.size(),
+      from(primes) | parallel(map(makeUnique), executor) | dereference | count);
+}
+
+TEST(ParallelTest, StarvedExecutor) {
+  // None of the workers get to run; the caller does all the work.
+  ManualExecutor executor;
+  EXPECT_EQ(seq(1, 1000) | map(square) | sum,
+            seq(1, 1000) | parallel(map(square), executor, 4) | sum);
+  EXPECT_EQ(seq(1, 1000) | map(square) | as<vector>(),
+            seq(1, 1000) | parallel(map(square), executor).ordered() |
+                as<vector>());
+  executor.run();
+}
+
+TEST(ParallelTest, Ordered) {
+  auto jitter = [](int i) {
+    std::this_thread::sleep_for(std::chrono::microseconds(i % 7 * 50));
+    return i;
+  };
+  auto expected = seq(1, 1000) | map(square) | as<vector>();
+  EXPECT_EQ(expected,
+            seq(1, 1000) | parallel(map(jitter) | map(square)).ordered() |
+                as<vector>());
+  EXPECT_EQ(expected,
+            seq(1, 1000) | parallel(map(jitter) | map(square), 3).ordered(5) |
+                as<vector>());
+
+  ThreadExecutor executor;
+  EXPECT_EQ(expected,
+            seq(1, 1000) |
+                parallel(map(jitter) | map(square), executor, 4).ordered() |
+                as<vector>());
+}
+
+TEST(ParallelTest, OrderedMultipleOutputs) {
+  auto expand = [](int i) { return seq(1, i % 5); };
+  EXPECT_EQ(seq(1, 200) | map(expand) | concat | as<vector>(),
+            seq(1, 200) | parallel(map(expand) | concat).ordered(4) |
+                as<vector>());
+}
+
+TEST(ParallelTest, OrderedTake) {
+  EXPECT_EQ(seq(1, 10) | as<vector>(),
+            seq(1) | parallel(map(sleepyWork)).ordered() | take(10) |
+                as<vector>());
+  EXPECT_EQ(2,
+            from(primes) | parallel(map(makeUnique)).ordered() |
+                dereference | take(2) | count);
+}
+
+TEST(ParallelTest, AggregateBy) {
+  // primes by last digit, with each worker aggregating its share
+  auto lastDigit = [](size_t p) { return p % 10; };
+  auto add = [](size_t a, size_t b) { return a + b; };
+  using Totals = std::map<size_t, size_t>;
+  auto expected = from(primes) | aggregateBy(lastDigit, size_t(0), add) |
+      as<Totals>();
+  EXPECT_EQ(expected,
+            from(primes) |
+                parallel(map(sleepyWork) |
+                         aggregateBy(lastDigit, size_t(0), add)) |
+                mergeAggregates(add) | as<Totals>());
+
+  ThreadExecutor executor;
+  EXPECT_EQ(expected,
+            from(primes) |
+                parallel(aggregateBy(lastDigit, size_t(0), add), executor, 4) |
+                mergeAggregates(add) | as<Totals>());
+}
+
 int main(int argc, char *argv[]) {
   testing::InitGoogleTest(&argc, argv);
   gflags::ParseCommandLineFlags(&argc, &argv, true);
@@ -148,6 +148,54 @@ BENCHMARK_RELATIVE(StringSplit_Gen_Take, iters) {
 
 BENCHMARK_DRAW_LINE()
 
+fbstring csv
+= seq<size_t>(1, 10000)
+  | mapped([](size_t i) {
+      return folly::to<fbstring>(i, ",item", i % 97, ",", i * i, ",x\n");
+    })
+  | unsplit("");
+
+BENCHMARK(StringSplit_Csv_SearchPerPiece, iters) {
+  // how split(..., char) used to find each piece
+  size_t s = 0;
+  while (iters--) {
+    StringPiece rest(csv);
+    StringPiece prefix;
+    while (gen::detail::splitPrefix(rest, prefix, ',')) {
+      ++s;
+    }
+  }
+  folly::doNotOptimizeAway(s);
+}
+
+BENCHMARK_RELATIVE(StringSplit_Csv_Gen, iters) {
+  size_t s = 0;
+  while (iters--) {
+    s += split(csv, ',') | count;
+  }
+  folly::doNotOptimizeAway(s);
+}
+
+BENCHMARK_RELATIVE(StringSplit_Csv_LinesThenFields, iters) {
+  size_t s = 0;
+  while (iters--) {
+    s += split(csv, '\n')
+       | map([](StringPiece line) { return split(line, ',') | count; })
+       | sum;
+  }
+  folly::doNotOptimizeAway(s);
+}
+
+BENCHMARK_RELATIVE(StringSplit_Csv_Tokenize, iters) {
+  size_t s = 0;
+  while (iters--) {
+    s += tokenize(csv, ",\n") | count;
+  }
+  folly::doNotOptimizeAway(s);
+}
+
+BENCHMARK_DRAW_LINE()
+
 BENCHMARK(StringUnsplit_Old, iters) {
   size_t s = 0;
   while (iters--) {
@@ -18,8 +18,10 @@
 #include <gtest/gtest.h>
 #include <iosfwd>
 #include <map>
+#include <random>
 #include <vector>
 
+#include <folly/detail/DelimiterScan.h>
 #include <folly/gen/String.h>
 
 using namespace folly::gen;
@@ -101,6 +103,139 @@ TEST(StringGen, Split) {
   }
 }
 
+TEST(StringGen, SplitLong) {
+  // The single-byte split scans blocks of bytes for a batch of delimiters;
+  // the multi-byte one searches for each delimiter in turn.
+  std::mt19937 rng(1234);
+  auto collect = eachTo<std::string>() | as<vector>();
+  for (size_t len : {0, 1, 63, 64, 65, 200, 1000, 5000}) {
+    for (int density : {1, 3, 50}) {
+      string str;
+      for (size_t i = 0; i < len; ++i) {
+        str.push_back(rng() % density == 0 ? ',' : 'a' + rng() % 26);
+      }
+      for (size_t offset = 0; offset < std::min<size_t>(len, 3); ++offset) {
+        StringPiece in = StringPiece(str).subpiece(offset);
+        EXPECT_EQ(split(in, StringPiece(",")) | collect,
+                  split(in, ',') | collect);
+      }
+    }
+  }
+  EXPECT_EQ(1000, split(string(1000, ','), ',') | count);
+  EXPECT_EQ(10, split(string(1000, ','), ',') | take(10) | count);
+}
+
+TEST(StringGen, ScanDelimiters) {
+  std::mt19937 rng(1234);
+  string str;
+  for (size_t i = 0; i < 1000; ++i) {
+    str.push_back(rng() % 8 == 0 ? "\t\n\"\0"[rng() % 4] : 'a' + rng() % 26);
+  }
+  auto scanAll = [&](decltype(folly::detail::scanDelimiters)* scan,
+                     const folly::detail::DelimiterSet& set,
+                     size_t capacity) {
+    vector<size_t> found;
+    vector<uint32_t> offsets(capacity);
+    const char* p = str.data();
+    while (p != str.data() + str.size()) {
+      size_t n;
+      size_t scanned =
+          scan(p, str.data() + str.size(), set, offsets.data(), capacity, &n);
+      for (size_t i = 0; i < n; ++i) {
+        found.push_back(p + offsets[i] - str.data());
+      }
+      p += scanned;
+    }
+    return found;
+  };
+  for (auto bytes : {StringPiece("\t"),
+                     StringPiece("\t\n\""),
+                     StringPiece("\0\t", 2),
+                     StringPiece("\"\"\"")}) {
+    folly::detail::DelimiterSet set(bytes);
+    vector<size_t> expected;
+    for (size_t i = 0; i < str.size(); ++i) {
+      if (bytes.find(str[i]) != StringPiece::npos) {
+        expected.push_back(i);
+      }
+    }
+    for (size_t capacity : {64, 100, 1024}) {
+      EXPECT_EQ(expected,
+                scanAll(folly::detail::scanDelimitersScalar, set, capacity));
+      EXPECT_EQ(expected,
+                scanAll(folly::detail::scanDelimiters, set, capacity));
+      if (folly::detail::scanDelimitersSse2Supported()) {
+        EXPECT_EQ(expected,
+                  scanAll(folly::detail::scanDelimitersSse2, set, capacity));
+      }
+      if (folly::detail::scanDelimitersAvx2Supported()) {
+        EXPECT_EQ(expected,
+                  scanAll(folly::detail::scanDelimitersAvx2, set, capacity));
+      }
+    }
+  }
+  EXPECT_THROW(folly::detail::DelimiterSet(""), std::invalid_argument);
+  EXPECT_THROW(folly::detail::DelimiterSet("123456789"), std::invalid_argument);
+}
+
+TEST(StringGen, Tokenize) {
+  auto collect = eachTo<std::string>() | as<vector>();
+  EXPECT_EQ((vector<string>{"1", "Smith, John", "", "x"}),
+            tokenize("1,\"Smith, John\",,x", ",") | collect);
+  // any of the delimiters; no trailing empty token, as with split()
+  EXPECT_EQ((vector<string>{"a", "b", "c", "", "d"}),
+            tokenize("a\tb,c\n\nd\n", ",\t\n") | collect);
+  // doubled quotes are left alone
+  EXPECT_EQ((vector<string>{"say \"\"hi\"\"", "x\"y\"z"}),
+            tokenize("\"say \"\"hi\"\"\",x\"y\"z", ",") | collect);
+  // no quoting
+  EXPECT_EQ((vector<string>{"\"a", "b\""}),
+            tokenize("\"a,b\"", ",", '\0') | collect);
+  EXPECT_EQ((vector<string>{"'a", "b'", "c"}),
+            tokenize("'a,b',c", ",") | collect);
+  EXPECT_EQ((vector<string>{"a,b", "c"}),
+            tokenize("'a,b',c", ",", '\'') | collect);
+  EXPECT_EQ(2, tokenize("a,b,c,d", ",") | take(2) | count);
+
+  // across many blocks
+  string csv;
+  for (int i = 0; i < 1000; ++i) {
+    csv += to<string>(i, ",\"", i, ",", i, "\"\n");
+  }
+  auto tokens = tokenize(csv, ",\n") | collect;
+  ASSERT_EQ(2000, tokens.size());
+  EXPECT_EQ("999", tokens[1998]);
+  EXPECT_EQ("999,999", tokens[1999]);
+}
+
+TEST(StringGen, TokenizeDelimited) {
+  auto toPair = [](DelimitedToken t) {
+    return std::make_pair(t.token.str(), t.delimiter);
+  };
+  auto delimited =
+      tokenizeDelimited("a,\"b\nc\"\nd,e", ",\n") | map(toPair) | as<vector>();
+  EXPECT_EQ(
+      (vector<std::pair<string, char>>{
+          {"a", ','}, {"b\nc", '\n'}, {"d", ','}, {"e", '\0'}}),
+      delimited);
+
+  // Rows survive the tokenizing
+  string csv;
+  for (int i = 0; i < 1000; ++i) {
+    csv += to<string>(i, ",\"", i, ",", i, "\"\n");
+  }
+  vector<vector<string>> rows(1);
+  tokenizeDelimited(csv, ",\n") | [&](DelimitedToken t) {
+    rows.back().push_back(t.token.str());
+    if (t.delimiter == '\n') {
+      rows.emplace_back();
+    }
+  };
+  rows.pop_back();
+  ASSERT_EQ(1000, rows.size());
+  EXPECT_EQ((vector<string>{"999", "999,999"}), rows[999]);
+}
+
 TEST(StringGen, SplitByNewLine) {
   auto collect = eachTo<std::string>() | as<vector>();
   {
@@ -258,6 +393,22 @@ TEST(StringGen, Resplit) {
     EXPECT_EQ(" goodbye", pieces[3]);
     EXPECT_EQ(" meow", pieces[4]);
   }
+  {
+    // many pieces per chunk, and pieces spanning chunks
+    string str;
+    for (int i = 0; i < 2000; ++i) {
+      str += to<string>(i, i % 10 == 0 ? "" : "abcdefghijk", ",");
+    }
+    vector<string> chunks;
+    std::mt19937 rng(1234);
+    for (size_t pos = 0; pos < str.size();) {
+      size_t len = std::min<size_t>(rng() % 300, str.size() - pos);
+      chunks.push_back(str.substr(pos, len));
+      pos += len;
+    }
+    EXPECT_EQ(split(str, ',') | collect,
+              from(chunks) | resplit(',') | collect);
+  }
 }
 
 void checkResplitMaxLength(vector<string> ins,
@@ -569,6 +569,8 @@ void AsyncSocket::setReadCB(ReadCallback *callback) {
     return;
   }
 
+  readCancellation_.reset();
+
   /* We are removing a read callback */
   if (callback == nullptr &&
       immediateReadHandler_.isLoopCallbackScheduled()) {
@@ -648,6 +650,58 @@ AsyncSocket::ReadCallback* AsyncSocket::getReadCallback() const {
   return readCallback_;
 }
 
+// Shared with the CancellationCallback, which only holds a weak_ptr to it, so
+// a cancellation posted to the EventBase after the read callback has changed
+// (or the socket has been destroyed) is a no-op.
+struct AsyncSocket::ReadCancellation {
+  ReadCancellation(AsyncSocket* s, ReadCallback* cb)
+      : socket(s), callback(cb) {}
+
+  AsyncSocket* socket;
+  ReadCallback* callback;
+  std::unique_ptr<CancellationCallback> cancellationCallback;
+};
+
+void AsyncSocket::setCancellableReadCB(
+    ReadCallback* callback,
+    CancellationToken token) {
+  setReadCB(callback);
+  if (callback == nullptr || !token.canBeCancelled()) {
+    return;
+  }
+
+  // Keep a reference until the end of this function, in case the callback
+  // runs inline and clears readCancellation_.
+  auto cancellation = std::make_shared<ReadCancellation>(this, callback);
+  readCancellation_ = cancellation;
+
+  std::weak_ptr<ReadCancellation> weak = cancellation;
+  auto evb = eventBase_;
+  cancellation->cancellationCallback =
+      folly::make_unique<CancellationCallback>(token, [weak, evb] {
+        auto cancel = [weak] {
+          if (auto c = weak.lock()) {
+            c->socket->cancelRead(c->callback);
+          }
+        };
+        if (evb->isInEventBaseThread()) {
+          cancel();
+        } else {
+          evb->runInEventBaseThread(cancel);
+        }
+      });
+}
+
+void AsyncSocket::cancelRead(ReadCallback* callback) {
+  if (readCallback_ != callback) {
+    return;
+  }
+  DestructorGuard dg(this);
+  setReadCB(nullptr);
+  callback->readErr(AsyncSocketException(
+      AsyncSocketException::INTERRUPTED, "read cancelled"));
+}
+
 void AsyncSocket::write(WriteCallback* callback,
                          const void* buf, size_t bytes, WriteFlags flags) {
   iovec op;
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <folly/CancellationToken.h>
 #include <folly/Optional.h>
 #include <folly/SocketAddress.h>
 #include <folly/detail/SocketFastOpen.h>
@@ -340,6 +341,14 @@ class AsyncSocket : virtual public AsyncTransportWrapper {
   void setReadCB(ReadCallback* callback) override;
   ReadCallback* getReadCallback() const override;
 
+  /**
+   * Install a read callback that is uninstalled when cancellation is
+   * requested on the token. The callback's readErr() is then invoked with an
+   * INTERRUPTED exception, in the EventBase thread. The token is dropped as
+   * soon as the read callback is changed.
+   */
+  void setCancellableReadCB(ReadCallback* callback, CancellationToken token);
+
   void write(WriteCallback* callback, const void* buf, size_t bytes,
              WriteFlags flags = WriteFlags::NONE) override;
   void writev(WriteCallback* callback, const iovec* vec, size_t count,
@@ -874,6 +883,7 @@ class AsyncSocket : virtual public AsyncTransportWrapper {
   virtual void invokeConnectSuccess();
   void invalidState(ConnectCallback* callback);
   void invalidState(ReadCallback* callback);
+  void cancelRead(ReadCallback* callback);
   void invalidState(WriteCallback* callback);
 
   std::string withAddr(const std::string& s);
@@ -894,6 +904,8 @@ class AsyncSocket : virtual public AsyncTransportWrapper {
 
   ConnectCallback* connectCallback_;    ///< ConnectCallback
   ReadCallback* readCallback_;          ///< ReadCallback
+  struct ReadCancellation;
+  std::shared_ptr<ReadCancellation> readCancellation_;
   WriteRequest* writeReqHead_;          ///< Chain of WriteRequests
   WriteRequest* writeReqTail_;          ///< End of WriteRequest chain
   ShutdownSocketSet* shutdownSocketSet_;
@@ -19,6 +19,7 @@
  * under the License.
  */
 #include <folly/io/async/AsyncTimeout.h>
+#include <folly/Memory.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/EventUtil.h>
 #include <folly/io/async/Request.h>
@@ -88,15 +89,53 @@ AsyncTimeout::~AsyncTimeout() {
 
 bool AsyncTimeout::scheduleTimeout(TimeoutManager::timeout_type timeout) {
   assert(timeoutManager_ != nullptr);
+  cancellationCallback_.reset();
+  cancellationToken_ = CancellationToken();
+  cancellableSelf_.reset();
   context_ = RequestContext::saveContext();
   return timeoutManager_->scheduleTimeout(this, timeout);
 }
 
+bool AsyncTimeout::scheduleTimeout(
+    TimeoutManager::timeout_type timeout,
+    CancellationToken token) {
+  if (!scheduleTimeout(timeout)) {
+    return false;
+  }
+  cancellationToken_ = std::move(token);
+  cancellableSelf_ = std::make_shared<AsyncTimeout*>(this);
+  std::weak_ptr<AsyncTimeout*> self = cancellableSelf_;
+  // Runs inline if cancellation was already requested.
+  cancellationCallback_ = folly::make_unique<CancellationCallback>(
+      cancellationToken_, [this, self] {
+        if (timeoutManager_->isInTimeoutManagerThread()) {
+          if (isScheduled()) {
+            timeoutManager_->cancelTimeout(this);
+          }
+          return;
+        }
+        // Unschedule from the manager's thread, unless the timeout has
+        // been rescheduled, cancelled or destroyed there by then.
+        timeoutManager_->runInTimeoutManagerThread([self] {
+          if (auto p = self.lock()) {
+            AsyncTimeout* timeout = *p;
+            if (timeout->isScheduled()) {
+              timeout->timeoutManager_->cancelTimeout(timeout);
+            }
+          }
+        });
+      });
+  return true;
+}
+
 bool AsyncTimeout::scheduleTimeout(uint32_t milliseconds) {
   return scheduleTimeout(TimeoutManager::timeout_type(milliseconds));
 }
 
 void AsyncTimeout::cancelTimeout() {
+  cancellationCallback_.reset();
+  cancellationToken_ = CancellationToken();
+  cancellableSelf_.reset();
   if (isScheduled()) {
     timeoutManager_->cancelTimeout(this);
   }
@@ -157,6 +196,11 @@ void AsyncTimeout::libeventCallback(libevent_fd_t fd, short events, void* arg) {
   // this can't possibly fire if timeout->eventBase_ is nullptr
   timeout->timeoutManager_->bumpHandlingTime();
 
+  // cancelled from another thread after the timeout was scheduled
+  if (timeout->cancellationToken_.isCancellationRequested()) {
+    return;
+  }
+
   RequestContextScopeGuard rctx(timeout->context_);
 
   timeout->timeoutExpired();
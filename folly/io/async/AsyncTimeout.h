@@ -20,6 +20,7 @@
  */
 #pragma once
 
+#include <folly/CancellationToken.h>
 #include <folly/io/async/TimeoutManager.h>
 
 #include <folly/portability/Event.h>
@@ -103,6 +104,21 @@ class AsyncTimeout : private boost::noncopyable {
   bool scheduleTimeout(uint32_t milliseconds);
   bool scheduleTimeout(TimeoutManager::timeout_type timeout);
 
+  /**
+   * Schedule the timeout, and cancel it if cancellation is requested on the
+   * token before it fires.
+   *
+   * If cancellation is requested in the TimeoutManager's thread the timeout
+   * is unscheduled right away. If it is requested from another thread, the
+   * cancellation is posted to the TimeoutManager's thread (when the manager
+   * supports that, as EventBase does), and timeoutExpired() is not invoked
+   * should the timeout fire before it runs. Rescheduling or cancelling the
+   * timeout drops the token.
+   */
+  bool scheduleTimeout(
+      TimeoutManager::timeout_type timeout,
+      CancellationToken token);
+
   /**
    * Cancel the timeout, if it is running.
    */
@@ -234,6 +250,14 @@ class AsyncTimeout : private boost::noncopyable {
 
   // Save the request context for when the timeout fires.
   std::shared_ptr<RequestContext> context_;
+
+  // Set by scheduleTimeout(timeout, token).
+  CancellationToken cancellationToken_;
+  std::unique_ptr<CancellationCallback> cancellationCallback_;
+  // Identifies the current token-cancellable schedule, so that a
+  // cancellation posted from another thread can tell whether the timeout
+  // was rescheduled, cancelled or destroyed in the meantime.
+  std::shared_ptr<AsyncTimeout*> cancellableSelf_;
 };
 
 namespace detail {
@@ -627,6 +627,10 @@ class EventBase : private boost::noncopyable,
     return isInEventBaseThread();
   }
 
+  bool runInTimeoutManagerThread(Func func) override final {
+    return runInEventBaseThread(std::move(func));
+  }
+
   void applyLoopKeepAlive();
 
   /*
@@ -23,6 +23,8 @@
 #include <chrono>
 #include <stdint.h>
 
+#include <folly/Function.h>
+
 namespace folly {
 
 class AsyncTimeout;
@@ -72,6 +74,14 @@ class TimeoutManager {
    * thread
    */
   virtual bool isInTimeoutManagerThread() = 0;
+
+  /**
+   * Runs func in the timeout manager thread, if this manager supports
+   * being called from other threads. Returns false if it doesn't.
+   */
+  virtual bool runInTimeoutManagerThread(folly::Function<void()> /* func */) {
+    return false;
+  }
 };
 
 } // folly
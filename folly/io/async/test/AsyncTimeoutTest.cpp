@@ -17,6 +17,9 @@
 #include <folly/io/async/AsyncTimeout.h>
 #include <folly/io/async/EventBase.h>
 
+#include <chrono>
+#include <thread>
+
 #include <gtest/gtest.h>
 
 namespace folly {
@@ -90,4 +93,27 @@ TEST(AsyncTimeout, cancel_schedule) {
   EXPECT_NE(expected, value);
 }
 
+TEST(AsyncTimeout, cancel_token_from_other_thread) {
+  bool fired = false;
+  EventBase manager;
+  CancellationSource source;
+
+  auto observer = AsyncTimeout::make(
+    manager,
+    [&]() noexcept { fired = true; }
+  );
+
+  observer->scheduleTimeout(std::chrono::seconds(10), source.getToken());
+  std::thread([&] { source.requestCancellation(); }).join();
+
+  // The cancellation unschedules the timeout, so the loop has nothing left
+  // to wait for.
+  auto start = std::chrono::steady_clock::now();
+  manager.loop();
+
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  EXPECT_FALSE(observer->isScheduled());
+  EXPECT_FALSE(fired);
+}
+
 } // namespace folly {
@@ -55,6 +55,10 @@
  *   - sorted_vector_map::value_type is pair<K,V>, not pair<const K,V>.
  *     (This is basically because we want to store the value_type in
  *     std::vector<>, which requires it to be Assignable.)
+ *
+ * Large containers that are built once and then only searched can be
+ * moved into a frozen_sorted_vector_set or frozen_sorted_vector_map,
+ * which store their elements in a cache-friendlier order.
  */
 
 #pragma once
@@ -67,8 +71,11 @@
 #include <utility>
 #include <vector>
 
+#include <boost/iterator/iterator_facade.hpp>
 #include <boost/operators.hpp>
 
+#include <folly/Bits.h>
+
 namespace folly {
 
 //////////////////////////////////////////////////////////////////////
@@ -144,6 +151,95 @@ namespace detail {
     return hint;
   }
 
+  /*
+   * Appends [first, last) to cont and merges it into the sorted prefix,
+   * which takes O(N + M log M) for M new elements rather than the
+   * O(N * M) of inserting them one at a time (and O(N + M) if they are
+   * already sorted).  As with insert(), an element equal to one already
+   * present, or to an earlier one in the range, is dropped.
+   *
+   * All comparisons are made before any of the old elements move, so if
+   * one throws, cont is left as it was.
+   */
+  template<class OurContainer, class Vector, class InputIterator,
+           class GrowthPolicy>
+  void bulk_insert(OurContainer& sorted,
+                   Vector& cont,
+                   InputIterator first,
+                   InputIterator last,
+                   GrowthPolicy& po)
+  {
+    typedef typename Vector::size_type size_type;
+    const typename OurContainer::value_compare& cmp(sorted.value_comp());
+    size_type prev_size = cont.size();
+    int d = distance_if_multipass(first, last);
+    if (d != -1) {
+      cont.reserve(prev_size + d);
+    }
+    try {
+      for (; first != last; ++first) {
+        po.increase_capacity(cont, cont.end());
+        cont.emplace_back(*first);
+      }
+    } catch (...) {
+      cont.erase(cont.begin() + prev_size, cont.end());
+      throw;
+    }
+
+    // For each new element, how many old ones go before it, or npos if it
+    // is dropped. Sorting is stable, and equal old elements go first, so
+    // the element kept from a run of equal ones is the one insert() would
+    // have kept.
+    const size_type npos = size_type(-1);
+    std::vector<size_type> before;
+    auto middle = cont.begin() + prev_size;
+    try {
+      if (!std::is_sorted(middle, cont.end(), cmp)) {
+        std::stable_sort(middle, cont.end(), cmp);
+      }
+      before.reserve(cont.size() - prev_size);
+      size_type j = 0;
+      for (auto it = middle; it != cont.end(); ++it) {
+        while (j < prev_size && !cmp(*it, cont[j])) {
+          ++j;
+        }
+        bool duplicate = (j > 0 && !cmp(cont[j - 1], *it)) ||
+            (it != middle && !cmp(*(it - 1), *it));
+        before.push_back(duplicate ? npos : j);
+      }
+    } catch (...) {
+      cont.erase(middle, cont.end());
+      throw;
+    }
+
+    size_type added = 0;
+    for (size_type i = 0; i < before.size(); ++i) {
+      if (before[i] != npos) {
+        if (added != i) {
+          middle[added] = std::move(middle[i]);
+        }
+        before[added++] = before[i];
+      }
+    }
+    cont.erase(middle + added, cont.end());
+    if (added == 0 || before[0] == prev_size) {
+      return;
+    }
+
+    // Merge from the back, moving each run of old elements up past the
+    // new ones that go after it.
+    Vector moved(std::make_move_iterator(cont.begin() + prev_size),
+                 std::make_move_iterator(cont.end()));
+    size_type end = prev_size;
+    for (size_type i = added; i-- > 0;) {
+      std::move_backward(cont.begin() + before[i],
+                         cont.begin() + end,
+                         cont.begin() + end + i + 1);
+      end = before[i];
+      cont[end + i] = std::move(moved[i]);
+    }
+  }
+
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -270,13 +366,7 @@ public:
 
   template<class InputIterator>
   void insert(InputIterator first, InputIterator last) {
-    int d = detail::distance_if_multipass(first, last);
-    if (d != -1) {
-      m_.cont_.reserve(m_.cont_.size() + d);
-    }
-    for (; first != last; ++first) {
-      insert(end(), *first);
-    }
+    detail::bulk_insert(*this, m_.cont_, first, last, get_growth_policy());
   }
 
   size_type erase(const key_type& key) {
@@ -513,13 +603,7 @@ public:
 
   template<class InputIterator>
   void insert(InputIterator first, InputIterator last) {
-    int d = detail::distance_if_multipass(first, last);
-    if (d != -1) {
-      m_.cont_.reserve(m_.cont_.size() + d);
-    }
-    for (; first != last; ++first) {
-      insert(end(), *first);
-    }
+    detail::bulk_insert(*this, m_.cont_, first, last, get_growth_policy());
   }
 
   size_type erase(const key_type& key) {
@@ -669,4 +753,388 @@ inline void swap(sorted_vector_map<K,V,C,A,G>& a,
 
 //////////////////////////////////////////////////////////////////////
 
+/*
+ * Layout policies for frozen_sorted_vector_set and
+ * frozen_sorted_vector_map, which decide the order elements are stored
+ * in and how they are searched.  A layout is a class with static
+ * members, where positions are indices into the storage and n (the
+ * size) stands for end():
+ *
+ *   arrange(vector)                 permute sorted elements into layout
+ *   lower_bound(data, n, before)    first element, in sorted order, for
+ *                                   which before(element) is false
+ *   first(n), next(i, n), prev(i, n)
+ *                                   sorted-order traversal; prev(n, n)
+ *                                   is the last element
+ */
+
+// Plain sorted order, searched with a binary search.  Each step of the
+// search halves the range, so for large containers every step past the
+// first few is a cache miss.
+struct sorted_layout {
+  template<class Vector>
+  static void arrange(Vector&) {}
+
+  template<class T, class Pred>
+  static std::size_t lower_bound(const T* data, std::size_t n, Pred before) {
+    return std::partition_point(data, data + n, before) - data;
+  }
+
+  static std::size_t first(std::size_t) { return 0; }
+  static std::size_t next(std::size_t i, std::size_t) { return i + 1; }
+  static std::size_t prev(std::size_t i, std::size_t) { return i - 1; }
+};
+
+// Eytzinger (BFS) order: the nodes of the implicit balanced search tree
+// level by level, so node k (counting from 1) is at index k - 1 and its
+// children are nodes 2k and 2k + 1.  A search walks down without
+// branches, and the 16 descendants four levels below a node are
+// adjacent, so they can be prefetched well before they are needed.
+struct eytzinger_layout {
+  template<class Vector>
+  static void arrange(Vector& v) {
+    std::size_t n = v.size();
+    std::vector<std::size_t> order(n);
+    std::size_t rank = 0;
+    for (std::size_t i = first(n); i != n; i = next(i, n)) {
+      order[i] = rank++;
+    }
+    Vector arranged(v.get_allocator());
+    arranged.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      arranged.push_back(std::move(v[order[i]]));
+    }
+    v.swap(arranged);
+  }
+
+  template<class T, class Pred>
+  static std::size_t lower_bound(const T* data, std::size_t n, Pred before) {
+    std::size_t k = 1;
+    while (k <= n) {
+#ifdef __GNUC__
+      if (16 * k <= n) {
+        __builtin_prefetch(data + 16 * k - 1);
+      }
+#endif
+      k = 2 * k + before(data[k - 1]);
+    }
+    // Every step right after the answer appended a 1 bit to k, and the
+    // step down to the answer's left subtree appended a 0: drop them all.
+    k >>= findFirstSet(~k);
+    return k == 0 ? n : k - 1;
+  }
+
+  static std::size_t first(std::size_t n) {
+    return leftmost(1, n);
+  }
+
+  static std::size_t next(std::size_t i, std::size_t n) {
+    std::size_t k = i + 1;
+    if (2 * k + 1 <= n) {
+      return leftmost(2 * k + 1, n);
+    }
+    // Up past the ancestors whose right subtree we are in
+    while (k & 1) {
+      k >>= 1;
+    }
+    k >>= 1;
+    return k == 0 ? n : k - 1;
+  }
+
+  static std::size_t prev(std::size_t i, std::size_t n) {
+    if (i == n) {
+      return rightmost(1, n);
+    }
+    std::size_t k = i + 1;
+    if (2 * k <= n) {
+      return rightmost(2 * k, n);
+    }
+    while (k != 0 && !(k & 1)) {
+      k >>= 1;
+    }
+    k >>= 1;
+    return k == 0 ? n : k - 1;
+  }
+
+ private:
+  static std::size_t leftmost(std::size_t k, std::size_t n) {
+    if (k > n) {
+      return n;
+    }
+    while (2 * k <= n) {
+      k = 2 * k;
+    }
+    return k - 1;
+  }
+
+  static std::size_t rightmost(std::size_t k, std::size_t n) {
+    while (2 * k + 1 <= n) {
+      k = 2 * k + 1;
+    }
+    return k - 1;
+  }
+};
+
+namespace detail {
+
+  // Visits the elements of a frozen container in sorted order.
+  template<class T, class Layout>
+  class frozen_sorted_vector_iterator
+    : public boost::iterator_facade<frozen_sorted_vector_iterator<T,Layout>,
+                                    const T,
+                                    boost::bidirectional_traversal_tag> {
+  public:
+    frozen_sorted_vector_iterator() : data_(nullptr), n_(0), i_(0) {}
+
+    frozen_sorted_vector_iterator(const T* data, std::size_t n, std::size_t i)
+      : data_(data), n_(n), i_(i) {}
+
+  private:
+    friend class boost::iterator_core_access;
+
+    void increment() { i_ = Layout::next(i_, n_); }
+    void decrement() { i_ = Layout::prev(i_, n_); }
+    bool equal(const frozen_sorted_vector_iterator& o) const {
+      return i_ == o.i_ && data_ == o.data_;
+    }
+    const T& dereference() const { return data_[i_]; }
+
+    const T* data_;
+    std::size_t n_;
+    std::size_t i_;
+  };
+
+  struct frozen_set_key {
+    template<class T>
+    const T& operator()(const T& value) const { return value; }
+  };
+
+  struct frozen_map_key {
+    template<class Pair>
+    const typename Pair::first_type& operator()(const Pair& value) const {
+      return value.first;
+    }
+  };
+
+  template<class Key, class Value, class KeyOfValue, class Compare,
+           class Allocator, class Layout>
+  class frozen_sorted_vector_base {
+    typedef std::vector<Value,Allocator> ContainerT;
+
+  public:
+    typedef Value       value_type;
+    typedef Key         key_type;
+    typedef Compare     key_compare;
+    typedef Layout      layout_type;
+    typedef std::size_t size_type;
+
+    typedef frozen_sorted_vector_iterator<Value,Layout> const_iterator;
+    typedef const_iterator                              iterator;
+
+    key_compare key_comp() const { return m_; }
+
+    const_iterator begin() const  { return at_index(Layout::first(size())); }
+    const_iterator end() const    { return at_index(size()); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const   { return end(); }
+
+    size_type size() const { return m_.cont_.size();  }
+    bool empty() const     { return m_.cont_.empty(); }
+
+    const_iterator find(const key_type& key) const {
+      const_iterator it = lower_bound(key);
+      if (it == end() || key_comp()(key, KeyOfValue()(*it))) {
+        return end();
+      }
+      return it;
+    }
+
+    size_type count(const key_type& key) const {
+      return find(key) == end() ? 0 : 1;
+    }
+
+    const_iterator lower_bound(const key_type& key) const {
+      const Compare& c = m_;
+      return at_index(Layout::lower_bound(
+          m_.cont_.data(), size(),
+          [&](const value_type& v) { return c(KeyOfValue()(v), key); }));
+    }
+
+    const_iterator upper_bound(const key_type& key) const {
+      const Compare& c = m_;
+      return at_index(Layout::lower_bound(
+          m_.cont_.data(), size(),
+          [&](const value_type& v) { return !c(key, KeyOfValue()(v)); }));
+    }
+
+    std::pair<const_iterator,const_iterator>
+    equal_range(const key_type& key) const {
+      const_iterator low = find(key);
+      if (low == end()) {
+        low = lower_bound(key);
+        return std::make_pair(low, low);
+      }
+      return std::make_pair(low, std::next(low));
+    }
+
+  protected:
+    // [first, last) must be sorted and free of duplicates.
+    template<class InputIterator>
+    frozen_sorted_vector_base(InputIterator first,
+                              InputIterator last,
+                              const Compare& comp,
+                              const Allocator& alloc)
+      : m_(comp, alloc)
+    {
+      m_.cont_.assign(first, last);
+      Layout::arrange(m_.cont_);
+    }
+
+  private:
+    const_iterator at_index(std::size_t i) const {
+      return const_iterator(m_.cont_.data(), size(), i);
+    }
+
+    // See the comment in sorted_vector_set.
+    struct EBO : Compare {
+      explicit EBO(const Compare& c, const Allocator& alloc)
+        : Compare(c)
+        , cont_(alloc)
+      {}
+      ContainerT cont_;
+    } m_;
+  };
+
+}
+
+/**
+ * A frozen_sorted_vector_set holds the same elements a sorted_vector_set
+ * would, but cannot be modified after construction, which lets it store
+ * them in a layout (see above) that is faster to search.  The default,
+ * eytzinger_layout, makes lookups in large sets several times faster
+ * than the binary search of sorted_vector_set.
+ *
+ * Iteration is in sorted order, but iterators are only bidirectional
+ * and somewhat slower to advance.
+ *
+ * @param class T               Data type to store
+ * @param class Compare         Comparison function that imposes a
+ *                              strict weak ordering over instances of T
+ * @param class Allocator       allocation policy
+ * @param class Layout          layout policy
+ */
+template<class T,
+         class Compare   = std::less<T>,
+         class Allocator = std::allocator<T>,
+         class Layout    = eytzinger_layout>
+class frozen_sorted_vector_set
+  : public detail::frozen_sorted_vector_base<
+      T, T, detail::frozen_set_key, Compare, Allocator, Layout>
+{
+  typedef detail::frozen_sorted_vector_base<
+    T, T, detail::frozen_set_key, Compare, Allocator, Layout> Base;
+
+public:
+  typedef Compare                                value_compare;
+  typedef sorted_vector_set<T,Compare,Allocator> sorted_type;
+
+  template<class GrowthPolicy>
+  explicit frozen_sorted_vector_set(
+      sorted_vector_set<T,Compare,Allocator,GrowthPolicy>&& sorted,
+      const Allocator& alloc = Allocator())
+    : Base(std::make_move_iterator(sorted.begin()),
+           std::make_move_iterator(sorted.end()),
+           sorted.key_comp(),
+           alloc)
+  {
+    sorted.clear();
+  }
+
+  template<class InputIterator>
+  frozen_sorted_vector_set(
+      InputIterator first,
+      InputIterator last,
+      const Compare& comp = Compare(),
+      const Allocator& alloc = Allocator())
+    : frozen_sorted_vector_set(sorted_type(first, last, comp, alloc), alloc)
+  {}
+
+  explicit frozen_sorted_vector_set(
+      std::initializer_list<T> list,
+      const Compare& comp = Compare(),
+      const Allocator& alloc = Allocator())
+    : frozen_sorted_vector_set(list.begin(), list.end(), comp, alloc)
+  {}
+
+  value_compare value_comp() const { return this->key_comp(); }
+};
+
+/**
+ * The map counterpart of frozen_sorted_vector_set.  Both keys and
+ * values are immutable.
+ *
+ * @param class Key           Key type
+ * @param class Value         Value type
+ * @param class Compare       Function that can compare key types and impose
+ *                            a strict weak ordering over them.
+ * @param class Allocator     allocation policy
+ * @param class Layout        layout policy
+ */
+template<class Key,
+         class Value,
+         class Compare   = std::less<Key>,
+         class Allocator = std::allocator<std::pair<Key,Value> >,
+         class Layout    = eytzinger_layout>
+class frozen_sorted_vector_map
+  : public detail::frozen_sorted_vector_base<
+      Key, std::pair<Key,Value>, detail::frozen_map_key, Compare, Allocator,
+      Layout>
+{
+  typedef detail::frozen_sorted_vector_base<
+    Key, std::pair<Key,Value>, detail::frozen_map_key, Compare, Allocator,
+    Layout> Base;
+
+public:
+  typedef Value                                          mapped_type;
+  typedef sorted_vector_map<Key,Value,Compare,Allocator> sorted_type;
+
+  template<class GrowthPolicy>
+  explicit frozen_sorted_vector_map(
+      sorted_vector_map<Key,Value,Compare,Allocator,GrowthPolicy>&& sorted,
+      const Allocator& alloc = Allocator())
+    : Base(std::make_move_iterator(sorted.begin()),
+           std::make_move_iterator(sorted.end()),
+           sorted.key_comp(),
+           alloc)
+  {
+    sorted.clear();
+  }
+
+  template<class InputIterator>
+  frozen_sorted_vector_map(
+      InputIterator first,
+      InputIterator last,
+      const Compare& comp = Compare(),
+      const Allocator& alloc = Allocator())
+    : frozen_sorted_vector_map(sorted_type(first, last, comp, alloc), alloc)
+  {}
+
+  explicit frozen_sorted_vector_map(
+      std::initializer_list<std::pair<Key,Value>> list,
+      const Compare& comp = Compare(),
+      const Allocator& alloc = Allocator())
+    : frozen_sorted_vector_map(list.begin(), list.end(), comp, alloc)
+  {}
+
+  const mapped_type& at(const Key& key) const {
+    auto it = this->find(key);
+    if (it != this->end()) {
+      return it->second;
+    }
+    throw std::out_of_range("frozen_sorted_vector_map::at");
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+
 }
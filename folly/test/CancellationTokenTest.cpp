@@ -0,0 +1,248 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/CancellationToken.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <folly/Baton.h>
+#include <folly/Memory.h>
+#include <folly/fibers/FiberManagerMap.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/Sockets.h>
+#include <gtest/gtest.h>
+
+using namespace folly;
+
+TEST(CancellationToken, defaultTokenNeverCancelled) {
+  CancellationToken token;
+  EXPECT_FALSE(token.canBeCancelled());
+  EXPECT_FALSE(token.isCancellationRequested());
+
+  bool called = false;
+  CancellationCallback cb(token, [&] { called = true; });
+  EXPECT_FALSE(called);
+}
+
+TEST(CancellationToken, requestCancellation) {
+  CancellationSource source;
+  auto token = source.getToken();
+  EXPECT_TRUE(token.canBeCancelled());
+  EXPECT_FALSE(token.isCancellationRequested());
+  EXPECT_EQ(token, source.getToken());
+  EXPECT_NE(token, CancellationToken());
+
+  EXPECT_TRUE(source.requestCancellation());
+  EXPECT_FALSE(source.requestCancellation());
+  EXPECT_TRUE(token.isCancellationRequested());
+  EXPECT_TRUE(source.isCancellationRequested());
+}
+
+TEST(CancellationToken, callbacksRun) {
+  CancellationSource source;
+  int count = 0;
+  CancellationCallback cb1(source.getToken(), [&] { ++count; });
+  CancellationCallback cb2(source.getToken(), [&] { ++count; });
+  EXPECT_EQ(0, count);
+  source.requestCancellation();
+  EXPECT_EQ(2, count);
+  source.requestCancellation();
+  EXPECT_EQ(2, count);
+}
+
+TEST(CancellationToken, callbackRunsInlineIfAlreadyCancelled) {
+  CancellationSource source;
+  source.requestCancellation();
+  bool called = false;
+  CancellationCallback cb(source.getToken(), [&] { called = true; });
+  EXPECT_TRUE(called);
+}
+
+TEST(CancellationToken, destroyedCallbackDoesNotRun) {
+  CancellationSource source;
+  bool called = false;
+  {
+    CancellationCallback cb(source.getToken(), [&] { called = true; });
+  }
+  source.requestCancellation();
+  EXPECT_FALSE(called);
+}
+
+TEST(CancellationToken, callbackDestroysItself) {
+  CancellationSource source;
+  bool otherCalled = false;
+  CancellationCallback other(source.getToken(), [&] { otherCalled = true; });
+  std::unique_ptr<CancellationCallback> cb;
+  bool called = false;
+  cb = make_unique<CancellationCallback>(source.getToken(), [&] {
+    called = true;
+    cb.reset();
+  });
+  source.requestCancellation();
+  EXPECT_TRUE(called);
+  EXPECT_TRUE(otherCalled);
+  EXPECT_FALSE(cb);
+}
+
+TEST(CancellationToken, destructorWaitsForConcurrentCallback) {
+  CancellationSource source;
+  Baton<> started;
+  std::atomic<bool> finished{false};
+  auto cb = make_unique<CancellationCallback>(source.getToken(), [&] {
+    started.post();
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    finished = true;
+  });
+  std::thread t([&] { source.requestCancellation(); });
+  started.wait();
+  cb.reset();
+  EXPECT_TRUE(finished);
+  t.join();
+}
+
+TEST(CancellationToken, fiberTaskNotStartedIfCancelled) {
+  EventBase evb;
+  auto& fm = fibers::getFiberManager(evb);
+  CancellationSource source;
+  bool ran = false;
+  auto f = fm.addTaskFuture([&] { ran = true; }, source.getToken());
+  source.requestCancellation();
+  evb.loop();
+  EXPECT_FALSE(ran);
+  EXPECT_THROW(f.value(), FutureCancellation);
+}
+
+TEST(CancellationToken, fiberTaskCompletes) {
+  EventBase evb;
+  auto& fm = fibers::getFiberManager(evb);
+  CancellationSource source;
+  auto f = fm.addTaskFuture([] { return 42; }, source.getToken());
+  evb.loop();
+  EXPECT_EQ(42, f.value());
+}
+
+namespace {
+
+class TestTimeout : public AsyncTimeout {
+ public:
+  explicit TestTimeout(EventBase* evb) : AsyncTimeout(evb) {}
+
+  void timeoutExpired() noexcept override {
+    fired = true;
+  }
+
+  bool fired{false};
+};
+
+} // namespace
+
+TEST(CancellationToken, asyncTimeoutCancelledInEventBaseThread) {
+  EventBase evb;
+  TestTimeout timeout(&evb);
+  CancellationSource source;
+  timeout.scheduleTimeout(std::chrono::milliseconds(10), source.getToken());
+  EXPECT_TRUE(timeout.isScheduled());
+  source.requestCancellation();
+  EXPECT_FALSE(timeout.isScheduled());
+  evb.loop();
+  EXPECT_FALSE(timeout.fired);
+}
+
+TEST(CancellationToken, asyncTimeoutCancelledFromOtherThread) {
+  EventBase evb;
+  TestTimeout timeout(&evb);
+  CancellationSource source;
+  timeout.scheduleTimeout(std::chrono::milliseconds(10), source.getToken());
+  std::thread([&] { source.requestCancellation(); }).join();
+  evb.loop();
+  EXPECT_FALSE(timeout.fired);
+}
+
+TEST(CancellationToken, asyncTimeoutFiresIfNotCancelled) {
+  EventBase evb;
+  TestTimeout timeout(&evb);
+  CancellationSource source;
+  timeout.scheduleTimeout(std::chrono::milliseconds(1), source.getToken());
+  evb.loop();
+  EXPECT_TRUE(timeout.fired);
+}
+
+namespace {
+
+class TestReadCallback : public AsyncTransportWrapper::ReadCallback {
+ public:
+  void getReadBuffer(void** bufReturn, size_t* lenReturn) override {
+    *bufReturn = buf;
+    *lenReturn = sizeof(buf);
+  }
+
+  void readDataAvailable(size_t len) noexcept override {
+    bytesRead += len;
+  }
+
+  void readEOF() noexcept override {}
+
+  void readErr(const AsyncSocketException& ex) noexcept override {
+    errorType = ex.getType();
+  }
+
+  char buf[64];
+  size_t bytesRead{0};
+  AsyncSocketException::AsyncSocketExceptionType errorType{
+      AsyncSocketException::UNKNOWN};
+};
+
+} // namespace
+
+TEST(CancellationToken, asyncSocketReadCancelled) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  EventBase evb;
+  auto socket = AsyncSocket::newSocket(&evb, fds[0]);
+  CancellationSource source;
+  TestReadCallback rcb;
+  socket->setCancellableReadCB(&rcb, source.getToken());
+  EXPECT_EQ(&rcb, socket->getReadCallback());
+
+  std::thread([&] { source.requestCancellation(); }).join();
+  evb.loop();
+  EXPECT_EQ(nullptr, socket->getReadCallback());
+  EXPECT_EQ(AsyncSocketException::INTERRUPTED, rcb.errorType);
+  close(fds[1]);
+}
+
+TEST(CancellationToken, asyncSocketTokenDroppedWithCallback) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  EventBase evb;
+  auto socket = AsyncSocket::newSocket(&evb, fds[0]);
+  CancellationSource source;
+  TestReadCallback rcb1;
+  TestReadCallback rcb2;
+  socket->setCancellableReadCB(&rcb1, source.getToken());
+  socket->setReadCB(&rcb2);
+  source.requestCancellation();
+  EXPECT_EQ(&rcb2, socket->getReadCallback());
+  EXPECT_EQ(AsyncSocketException::UNKNOWN, rcb1.errorType);
+  EXPECT_EQ(AsyncSocketException::UNKNOWN, rcb2.errorType);
+  socket->setReadCB(nullptr);
+  close(fds[1]);
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/ConcurrentEvictingCacheMap.h>
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/EvictingCacheMap.h>
+#include <folly/portability/GFlags.h>
+
+DEFINE_int32(numThreads, 0, "Threads per benchmark, 0 for one per core");
+DEFINE_int64(numKeys, 1 << 20, "Distinct keys in the request trace");
+DEFINE_int64(cacheSize, 1 << 16, "Capacity of every cache");
+DEFINE_double(zipfSkew, 0.9, "Skew of the request distribution");
+
+using folly::ConcurrentEvictingCacheMap;
+using folly::EvictingCacheMap;
+
+typedef ConcurrentEvictingCacheMap<int64_t, int64_t> ConcurrentCache;
+
+namespace {
+
+// Serializes everything, as callers of EvictingCacheMap have to
+class LockedCache {
+ public:
+  explicit LockedCache(size_t size) : cache_(size) {}
+
+  bool get(int64_t key, int64_t& value) {
+    std::lock_guard<std::mutex> g(mutex_);
+    auto it = cache_.find(key);
+    if (it == cache_.end()) {
+      return false;
+    }
+    value = it->second;
+    return true;
+  }
+
+  void set(int64_t key, int64_t value) {
+    std::lock_guard<std::mutex> g(mutex_);
+    cache_.set(key, value);
+  }
+
+ private:
+  std::mutex mutex_;
+  EvictingCacheMap<int64_t, int64_t> cache_;
+};
+
+bool lookup(LockedCache& cache, int64_t key, int64_t& value) {
+  return cache.get(key, value);
+}
+
+bool lookup(ConcurrentCache& cache, int64_t key, int64_t& value) {
+  auto v = cache.get(key);
+  if (v) {
+    value = *v;
+  }
+  return v.hasValue();
+}
+
+size_t numThreads() {
+  return FLAGS_numThreads > 0 ? FLAGS_numThreads
+                              : std::thread::hardware_concurrency();
+}
+
+// A Zipf-distributed trace of 4M requests, shared by every benchmark so
+// that hit rates are comparable.
+const std::vector<int64_t>& zipfTrace() {
+  static const std::vector<int64_t> trace = [] {
+    std::vector<double> cdf(FLAGS_numKeys);
+    double sum = 0;
+    for (int64_t i = 0; i < FLAGS_numKeys; ++i) {
+      sum += 1.0 / std::pow(i + 1, FLAGS_zipfSkew);
+      cdf[i] = sum;
+    }
+    std::mt19937_64 rng(0);
+    std::uniform_real_distribution<double> dist(0, sum);
+    std::vector<int64_t> keys(1 << 22);
+    for (auto& key : keys) {
+      key = std::lower_bound(cdf.begin(), cdf.end(), dist(rng)) - cdf.begin();
+    }
+    return keys;
+  }();
+  return trace;
+}
+
+// Read-through: look up, and insert on a miss. Each thread starts at a
+// different offset into the trace. Returns the hit rate.
+template <typename Cache>
+double replay(Cache& cache, size_t iters) {
+  auto& trace = zipfTrace();
+  std::atomic<size_t> hits{0};
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < numThreads(); ++t) {
+    threads.emplace_back([&, t] {
+      size_t n = iters / numThreads();
+      size_t localHits = 0;
+      size_t pos = t * (trace.size() / numThreads());
+      for (size_t i = 0; i < n; ++i) {
+        auto key = trace[pos];
+        pos = pos + 1 == trace.size() ? 0 : pos + 1;
+        int64_t value;
+        if (lookup(cache, key, value)) {
+          ++localHits;
+        } else {
+          cache.set(key, key);
+        }
+      }
+      hits += localHits;
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return iters ? double(hits.load()) / iters : 0;
+}
+
+ConcurrentCache::Config config(bool admission) {
+  ConcurrentCache::Config c;
+  c.admission = admission;
+  return c;
+}
+
+} // namespace
+
+BENCHMARK(locked_lru, iters) {
+  folly::BenchmarkSuspender braces;
+  zipfTrace();
+  LockedCache cache(FLAGS_cacheSize);
+  braces.dismissing([&] { replay(cache, iters); });
+}
+
+BENCHMARK_RELATIVE(concurrent_clock, iters) {
+  folly::BenchmarkSuspender braces;
+  zipfTrace();
+  ConcurrentCache cache(FLAGS_cacheSize, config(false));
+  braces.dismissing([&] { replay(cache, iters); });
+}
+
+BENCHMARK_RELATIVE(concurrent_clock_tinylfu, iters) {
+  folly::BenchmarkSuspender braces;
+  zipfTrace();
+  ConcurrentCache cache(FLAGS_cacheSize, config(true));
+  braces.dismissing([&] { replay(cache, iters); });
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+
+  // Hit rates after warming up with one pass over the trace
+  size_t iters = 2 * zipfTrace().size();
+  LockedCache locked(FLAGS_cacheSize);
+  ConcurrentCache clock(FLAGS_cacheSize, config(false));
+  ConcurrentCache tinyLfu(FLAGS_cacheSize, config(true));
+  printf("hit rate: locked_lru %.3f, concurrent_clock %.3f, "
+         "concurrent_clock_tinylfu %.3f\n",
+         replay(locked, iters),
+         replay(clock, iters),
+         replay(tinyLfu, iters));
+  return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/ConcurrentEvictingCacheMap.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace folly;
+
+typedef ConcurrentEvictingCacheMap<int, int> Cache;
+
+namespace {
+
+Cache::Config shards(size_t n, bool admission = false) {
+  Cache::Config config;
+  config.numShards = n;
+  config.admission = admission;
+  return config;
+}
+
+} // namespace
+
+TEST(ConcurrentEvictingCacheMap, SanityTest) {
+  Cache map(10, shards(1));
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.get(1).hasValue());
+
+  EXPECT_TRUE(map.set(1, 10));
+  EXPECT_TRUE(map.exists(1));
+  EXPECT_EQ(10, *map.get(1));
+  EXPECT_TRUE(map.set(1, 11));
+  EXPECT_EQ(11, *map.get(1));
+  EXPECT_EQ(1, map.size());
+
+  EXPECT_TRUE(map.erase(1));
+  EXPECT_FALSE(map.erase(1));
+  EXPECT_FALSE(map.exists(1));
+  EXPECT_TRUE(map.empty());
+}
+
+TEST(ConcurrentEvictingCacheMap, Capacity) {
+  Cache map(100, shards(1));
+  for (int i = 0; i < 1000; ++i) {
+    map.set(i, i);
+    EXPECT_LE(map.size(), 100);
+  }
+  EXPECT_EQ(100, map.size());
+  EXPECT_EQ(900, map.stats().evictions);
+}
+
+TEST(ConcurrentEvictingCacheMap, ShardedCapacity) {
+  Cache map(1024, shards(8));
+  EXPECT_EQ(8, map.numShards());
+  for (int i = 0; i < 100000; ++i) {
+    map.set(i, i);
+  }
+  EXPECT_LE(map.size(), 1024);
+  EXPECT_GT(map.size(), 900);
+}
+
+TEST(ConcurrentEvictingCacheMap, DefaultShards) {
+  Cache small(10);
+  EXPECT_EQ(1, small.numShards());
+  Cache large(1 << 20);
+  EXPECT_GE(large.numShards(), 1);
+  EXPECT_LE(large.numShards() * Cache::kMinShardWeight, 1 << 20);
+}
+
+TEST(ConcurrentEvictingCacheMap, ClockSparesReferenced) {
+  Cache map(10, shards(1));
+  for (int i = 0; i < 10; ++i) {
+    map.set(i, i);
+  }
+  // Referenced entries get a second chance; the others go first
+  for (int i = 0; i < 5; ++i) {
+    map.get(i);
+  }
+  for (int i = 10; i < 15; ++i) {
+    map.set(i, i);
+  }
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(map.exists(i)) << i;
+  }
+  for (int i = 5; i < 10; ++i) {
+    EXPECT_FALSE(map.exists(i)) << i;
+  }
+}
+
+TEST(ConcurrentEvictingCacheMap, Weights) {
+  Cache map(100, shards(1));
+  EXPECT_TRUE(map.set(1, 1, 60));
+  EXPECT_TRUE(map.set(2, 2, 30));
+  EXPECT_EQ(90, map.weight());
+  EXPECT_TRUE(map.set(3, 3, 20));
+  EXPECT_LE(map.weight(), 100);
+  EXPECT_TRUE(map.exists(3));
+  EXPECT_FALSE(map.set(4, 4, 101));
+  EXPECT_FALSE(map.exists(4));
+
+  // Growing an entry in place evicts others, not the entry itself
+  map.clear();
+  map.set(1, 1, 10);
+  map.set(2, 2, 10);
+  EXPECT_TRUE(map.set(1, 1, 95));
+  EXPECT_TRUE(map.exists(1));
+  EXPECT_FALSE(map.exists(2));
+  EXPECT_EQ(95, map.weight());
+}
+
+TEST(ConcurrentEvictingCacheMap, PruneHook) {
+  std::vector<int> pruned;
+  Cache::Config config = shards(1);
+  config.pruneHook = [&](int key, int&& value) {
+    EXPECT_EQ(key * 2, value);
+    pruned.push_back(key);
+  };
+  Cache map(5, config);
+  for (int i = 0; i < 8; ++i) {
+    map.set(i, i * 2);
+  }
+  EXPECT_EQ(3, pruned.size());
+  map.erase(7);
+  map.clear();
+  EXPECT_EQ(3, pruned.size());
+}
+
+TEST(ConcurrentEvictingCacheMap, Stats) {
+  Cache map(10, shards(2));
+  map.set(1, 1);
+  map.get(1);
+  map.get(1);
+  map.get(2);
+  auto stats = map.stats();
+  EXPECT_EQ(2, stats.hits);
+  EXPECT_EQ(1, stats.misses);
+  EXPECT_EQ(0, stats.evictions);
+
+  Cache::Stats sum;
+  for (size_t i = 0; i < map.numShards(); ++i) {
+    sum += map.shardStats(i);
+  }
+  EXPECT_EQ(stats.hits, sum.hits);
+  EXPECT_EQ(stats.misses, sum.misses);
+}
+
+TEST(ConcurrentEvictingCacheMap, AdmissionResistsScans) {
+  Cache lru(100, shards(1));
+  Cache tinyLfu(100, shards(1, true));
+  for (auto map : {&lru, &tinyLfu}) {
+    for (int round = 0; round < 20; ++round) {
+      for (int i = 0; i < 50; ++i) {
+        if (!map->get(i)) {
+          map->set(i, i);
+        }
+      }
+    }
+    // A scan over many keys that are each requested once
+    for (int i = 1000; i < 1500; ++i) {
+      if (!map->get(i)) {
+        map->set(i, i);
+      }
+    }
+  }
+  size_t lruHot = 0;
+  size_t tinyLfuHot = 0;
+  for (int i = 0; i < 50; ++i) {
+    lruHot += lru.exists(i);
+    tinyLfuHot += tinyLfu.exists(i);
+  }
+  EXPECT_LT(lruHot, 10);
+  EXPECT_EQ(50, tinyLfuHot);
+  EXPECT_GT(tinyLfu.stats().rejections, 0);
+}
+
+TEST(ConcurrentEvictingCacheMap, StringKeys) {
+  ConcurrentEvictingCacheMap<std::string, std::string> map(2);
+  map.set("a", "1");
+  map.set("b", "2");
+  map.set("c", "3");
+  EXPECT_EQ(2, map.size());
+  EXPECT_EQ("3", map.get("c").value());
+}
+
+TEST(ConcurrentEvictingCacheMap, Concurrent) {
+  constexpr int kThreads = 8;
+  constexpr int kOps = 20000;
+  Cache map(512, shards(4, true));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kOps; ++i) {
+        int key = (i * 7 + t) % 2048;
+        auto v = map.get(key);
+        if (v) {
+          EXPECT_EQ(key, *v);
+        } else {
+          map.set(key, key);
+        }
+        if (i % 100 == 0) {
+          map.erase(key);
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_LE(map.weight(), 512);
+  auto stats = map.stats();
+  EXPECT_EQ(kThreads * kOps, stats.hits + stats.misses);
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <folly/ConcurrentHashMap.h>
+
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/AtomicHashMap.h>
+#include <folly/Benchmark.h>
+#include <folly/SharedMutex.h>
+#include <folly/Synchronized.h>
+#include <folly/portability/GFlags.h>
+
+DEFINE_int32(numThreads, 0, "Threads per benchmark, 0 for one per core");
+DEFINE_int64(numKeys, 1 << 20, "Keys preloaded into every map");
+
+using folly::AtomicHashMap;
+using folly::ConcurrentHashMap;
+
+typedef ConcurrentHashMap<int64_t, int64_t> CHM;
+typedef AtomicHashMap<int64_t, int64_t> AHM;
+typedef folly::Synchronized<
+    std::unordered_map<int64_t, int64_t>,
+    folly::SharedMutex>
+    LockedMap;
+
+static std::unique_ptr<CHM> chm;
+static std::unique_ptr<AHM> ahm;
+static std::unique_ptr<LockedMap> lockedMap;
+
+static size_t numThreads() {
+  return FLAGS_numThreads > 0 ? FLAGS_numThreads
+                              : std::thread::hardware_concurrency();
+}
+
+// Splits iters evenly across threads; fn(rng, n) runs n operations.
+template <typename Fn>
+static void runThreads(size_t iters, Fn fn) {
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < numThreads(); ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937_64 rng(t);
+      fn(rng, iters / numThreads());
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+// The key range is twice the preloaded size, so half the lookups miss.
+// Note that std::hash is the identity for integers, which gives
+// std::unordered_map unusually good locality on these dense keys;
+// ConcurrentHashMap always mixes the hash.
+static int64_t randomKey(std::mt19937_64& rng) {
+  return 1 + rng() % (2 * FLAGS_numKeys);
+}
+
+// writePercent of the operations replace a value, the rest are lookups.
+// AtomicHashMap can't replace values, so its writes are inserts that fail
+// for present keys.
+static void chmMix(size_t iters, uint32_t writePercent) {
+  runThreads(iters, [&](std::mt19937_64& rng, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      auto key = randomKey(rng);
+      if (rng() % 100 < writePercent) {
+        chm->insert_or_assign(key, key);
+      } else {
+        folly::doNotOptimizeAway(chm->find(key) == chm->cend());
+      }
+    }
+  });
+}
+
+static void ahmMix(size_t iters, uint32_t writePercent) {
+  runThreads(iters, [&](std::mt19937_64& rng, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      auto key = randomKey(rng);
+      if (rng() % 100 < writePercent) {
+        ahm->insert(key, key);
+      } else {
+        folly::doNotOptimizeAway(ahm->find(key) == ahm->end());
+      }
+    }
+  });
+}
+
+static void lockedMix(size_t iters, uint32_t writePercent) {
+  runThreads(iters, [&](std::mt19937_64& rng, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      auto key = randomKey(rng);
+      if (rng() % 100 < writePercent) {
+        (*lockedMap->wlock())[key] = key;
+      } else {
+        auto map = lockedMap->rlock();
+        folly::doNotOptimizeAway(map->find(key) == map->end());
+      }
+    }
+  });
+}
+
+BENCHMARK(locked_unordered_map_find, iters) {
+  lockedMix(iters, 0);
+}
+
+BENCHMARK_RELATIVE(atomic_hash_map_find, iters) {
+  ahmMix(iters, 0);
+}
+
+BENCHMARK_RELATIVE(concurrent_hash_map_find, iters) {
+  chmMix(iters, 0);
+}
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(locked_unordered_map_write_10_percent, iters) {
+  lockedMix(iters, 10);
+}
+
+BENCHMARK_RELATIVE(atomic_hash_map_write_10_percent, iters) {
+  ahmMix(iters, 10);
+}
+
+BENCHMARK_RELATIVE(concurrent_hash_map_write_10_percent, iters) {
+  chmMix(iters, 10);
+}
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(locked_unordered_map_write_50_percent, iters) {
+  lockedMix(iters, 50);
+}
+
+BENCHMARK_RELATIVE(concurrent_hash_map_write_50_percent, iters) {
+  chmMix(iters, 50);
+}
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(locked_unordered_map_erase_insert, iters) {
+  runThreads(iters, [](std::mt19937_64& rng, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      auto key = randomKey(rng);
+      auto map = lockedMap->wlock();
+      if (map->erase(key) == 0) {
+        map->emplace(key, key);
+      }
+    }
+  });
+}
+
+BENCHMARK_RELATIVE(concurrent_hash_map_erase_insert, iters) {
+  runThreads(iters, [](std::mt19937_64& rng, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      auto key = randomKey(rng);
+      if (chm->erase(key) == 0) {
+        chm->insert(key, key);
+      }
+    }
+  });
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  chm.reset(new CHM(FLAGS_numKeys));
+  // Sized for every key the benchmarks can insert
+  ahm.reset(new AHM(2 * FLAGS_numKeys));
+  lockedMap.reset(new LockedMap);
+  for (int64_t key = 1; key <= 2 * FLAGS_numKeys; key += 2) {
+    chm->insert(key, key);
+    ahm->insert(key, key);
+    lockedMap->wlock()->emplace(key, key);
+  }
+  folly::runBenchmarks();
+}
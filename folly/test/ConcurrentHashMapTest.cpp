@@ -0,0 +1,316 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <folly/ConcurrentHashMap.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using folly::ConcurrentHashMap;
+using folly::detail::EpochDomain;
+
+namespace {
+
+// Counts live instances, to check that erased values are reclaimed.
+struct Tracked {
+  static std::atomic<int> live;
+
+  explicit Tracked(int v = 0) : value(v) {
+    ++live;
+  }
+  Tracked(const Tracked& other) : value(other.value) {
+    ++live;
+  }
+  ~Tracked() {
+    --live;
+  }
+
+  bool operator==(const Tracked& other) const {
+    return value == other.value;
+  }
+
+  int value;
+};
+
+std::atomic<int> Tracked::live{0};
+
+} // namespace
+
+TEST(ConcurrentHashMap, Basic) {
+  ConcurrentHashMap<int, int> m;
+  EXPECT_TRUE(m.empty());
+  EXPECT_EQ(m.cend(), m.find(1));
+  EXPECT_EQ(m.cend(), m.cbegin());
+
+  EXPECT_TRUE(m.insert(1, 10).second);
+  EXPECT_FALSE(m.insert(1, 11).second);
+  EXPECT_TRUE(m.insert(std::make_pair(2, 20)).second);
+  EXPECT_TRUE(m.try_emplace(3, 30).second);
+  EXPECT_TRUE(m.emplace(4, 40).second);
+  EXPECT_FALSE(m.emplace(4, 41).second);
+  EXPECT_EQ(4, m.size());
+  EXPECT_FALSE(m.empty());
+
+  EXPECT_EQ(10, m.find(1)->second);
+  EXPECT_EQ(40, m.at(4));
+  EXPECT_THROW(m.at(5), std::out_of_range);
+  EXPECT_EQ(0, m[5]);
+  EXPECT_EQ(5, m.size());
+
+  EXPECT_EQ(1, m.erase(5));
+  EXPECT_EQ(0, m.erase(5));
+  EXPECT_EQ(m.cend(), m.find(5));
+
+  int sum = 0;
+  for (auto& kv : m) {
+    sum += kv.second;
+  }
+  EXPECT_EQ(100, sum);
+
+  m.clear();
+  EXPECT_TRUE(m.empty());
+  EXPECT_EQ(m.cend(), m.cbegin());
+}
+
+TEST(ConcurrentHashMap, Assign) {
+  ConcurrentHashMap<std::string, int> m;
+  EXPECT_FALSE(m.assign("a", 1));
+  EXPECT_TRUE(m.insert_or_assign("a", 1).second);
+  EXPECT_TRUE(m.insert_or_assign("a", 2).second);
+  EXPECT_EQ(2, m.at("a"));
+
+  auto res = m.assign("a", 3);
+  ASSERT_TRUE(res);
+  EXPECT_EQ(3, (*res)->second);
+
+  EXPECT_FALSE(m.assign_if_equal("a", 2, 4));
+  EXPECT_EQ(3, m.at("a"));
+  EXPECT_TRUE(m.assign_if_equal("a", 3, 4));
+  EXPECT_EQ(4, m.at("a"));
+  EXPECT_FALSE(m.assign_if_equal("b", 0, 1));
+  EXPECT_EQ(1, m.size());
+}
+
+TEST(ConcurrentHashMap, MoveOnly) {
+  ConcurrentHashMap<int, std::unique_ptr<int>> m;
+  EXPECT_TRUE(m.try_emplace(1, std::make_unique<int>(1)).second);
+  auto p = std::make_unique<int>(2);
+  EXPECT_FALSE(m.try_emplace(1, std::move(p)).second);
+  // try_emplace leaves its arguments alone if the key exists
+  EXPECT_TRUE(p);
+  EXPECT_EQ(1, *m.find(1)->second);
+  EXPECT_TRUE(m.insert_or_assign(1, std::move(p)).second);
+  EXPECT_EQ(2, *m.find(1)->second);
+}
+
+TEST(ConcurrentHashMap, Grow) {
+  ConcurrentHashMap<int, int> m;
+  const int kCount = 100000;
+  for (int i = 0; i < kCount; ++i) {
+    EXPECT_TRUE(m.insert(i, i * 2).second);
+  }
+  EXPECT_EQ(kCount, m.size());
+  for (int i = 0; i < kCount; ++i) {
+    ASSERT_EQ(i * 2, m.find(i)->second);
+  }
+  size_t n = 0;
+  for (auto it = m.cbegin(); it != m.cend(); ++it) {
+    EXPECT_EQ(it->first * 2, it->second);
+    ++n;
+  }
+  EXPECT_EQ(kCount, n);
+
+  ConcurrentHashMap<int, int> reserved;
+  reserved.reserve(kCount);
+  reserved.insert(1, 1);
+  EXPECT_EQ(1, reserved.at(1));
+}
+
+TEST(ConcurrentHashMap, EraseWhileIterating) {
+  ConcurrentHashMap<int, int> m;
+  for (int i = 0; i < 1000; ++i) {
+    m.insert(i, i);
+  }
+  for (auto it = m.cbegin(); it != m.cend();) {
+    if (it->first % 2 == 0) {
+      it = m.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  EXPECT_EQ(500, m.size());
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(i % 2 == 0, m.find(i) == m.cend());
+  }
+}
+
+TEST(ConcurrentHashMap, IterateAcrossRehash) {
+  ConcurrentHashMap<int, int> m;
+  for (int i = 0; i < 100; ++i) {
+    m.insert(i, i);
+  }
+  std::vector<int> seen(100);
+  auto it = m.cbegin();
+  for (int i = 0; i < 50; ++i, ++it) {
+    ++seen[it->first];
+  }
+  // Grows every segment while the iterator is parked mid-way; entries never
+  // move, so the rest of the walk still sees each old element once.
+  for (int i = 100; i < 100000; ++i) {
+    m.insert(i, i);
+  }
+  for (; it != m.cend(); ++it) {
+    EXPECT_EQ(it->first, it->second);
+    if (it->first < 100) {
+      ++seen[it->first];
+    }
+  }
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(1, seen[i]) << i;
+  }
+}
+
+TEST(ConcurrentHashMap, Reclamation) {
+  {
+    ConcurrentHashMap<int, Tracked> m;
+    for (int i = 0; i < 1000; ++i) {
+      m.insert(i, Tracked(i));
+    }
+    EXPECT_EQ(1000, Tracked::live.load());
+    {
+      auto it = m.find(1);
+      m.erase(1);
+      m.insert_or_assign(2, Tracked(-2));
+      // Still pinned by the iterator
+      EXPECT_EQ(1, it->second.value);
+      EXPECT_EQ(1001, Tracked::live.load());
+    }
+    EpochDomain::defaultDomain().synchronize();
+    EXPECT_EQ(999, Tracked::live.load());
+    EXPECT_EQ(-2, m.at(2).value);
+
+    m.clear();
+    EpochDomain::defaultDomain().synchronize();
+    EXPECT_EQ(0, Tracked::live.load());
+    m.insert(3, Tracked(3));
+  }
+  EXPECT_EQ(0, Tracked::live.load());
+}
+
+TEST(ConcurrentHashMap, ConcurrentReadWrite) {
+  // Keys map to 2 * key or 3 * key; readers must never see anything else.
+  ConcurrentHashMap<int, Tracked> m;
+  const int kKeys = 1000;
+  const int kWriters = 4;
+  const int kReaders = 4;
+  std::atomic<bool> done{false};
+  std::atomic<size_t> errors{0};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kWriters; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 100000; ++i) {
+        int key = (i * 7 + t) % kKeys;
+        switch (i % 3) {
+          case 0:
+            m.insert_or_assign(key, Tracked(key * 2));
+            break;
+          case 1:
+            m.assign(key, Tracked(key * 3));
+            break;
+          case 2:
+            m.erase(key);
+            break;
+        }
+      }
+    });
+  }
+  for (int t = 0; t < kReaders; ++t) {
+    threads.emplace_back([&, t] {
+      while (!done.load()) {
+        for (int key = 0; key < kKeys; ++key) {
+          auto it = m.find(key);
+          if (it != m.cend() && it->second.value != key * 2 &&
+              it->second.value != key * 3) {
+            ++errors;
+          }
+        }
+        for (auto& kv : m) {
+          if (kv.second.value != kv.first * 2 &&
+              kv.second.value != kv.first * 3) {
+            ++errors;
+          }
+        }
+      }
+    });
+  }
+  for (int t = 0; t < kWriters; ++t) {
+    threads[t].join();
+  }
+  done = true;
+  for (int t = kWriters; t < kWriters + kReaders; ++t) {
+    threads[t].join();
+  }
+  EXPECT_EQ(0, errors.load());
+
+  size_t n = 0;
+  for (auto& kv : m) {
+    (void)kv;
+    ++n;
+  }
+  EXPECT_EQ(n, m.size());
+}
+
+TEST(ConcurrentHashMap, FindDuringGrowth) {
+  // Every key below the watermark has been inserted, so lookups racing
+  // with segment growth must still find it.
+  ConcurrentHashMap<int, int> m;
+  const int kKeys = 200000;
+  std::atomic<int> watermark{0};
+  std::atomic<size_t> misses{0};
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&, t] {
+      unsigned seed = t;
+      int limit;
+      do {
+        limit = watermark.load(std::memory_order_acquire);
+        if (limit > 0) {
+          int key = rand_r(&seed) % limit;
+          if (m.find(key) == m.cend()) {
+            ++misses;
+          }
+        }
+      } while (limit < kKeys);
+    });
+  }
+  for (int i = 0; i < kKeys; ++i) {
+    m.insert(i, i);
+    watermark.store(i + 1, std::memory_order_release);
+  }
+  for (auto& t : readers) {
+    t.join();
+  }
+  EXPECT_EQ(0, misses.load());
+}
@@ -16,6 +16,7 @@
 
 // @author: Xin Liu <xliux@fb.com>
 
+#include <algorithm>
 #include <map>
 #include <random>
 #include <set>
@@ -296,6 +297,82 @@ void BM_AddSkipList(int iters, int size) {
   }
 }
 
+// Building a list of size elements from sorted input, one per iteration
+void BM_AddSortedSkipList(int iters, int size) {
+  BenchmarkSuspender susp;
+  std::vector<ValueType> sorted(gData.begin(), gData.begin() + size);
+  std::sort(sorted.begin(), sorted.end());
+  susp.dismiss();
+
+  for (int i = 0; i < iters; ++i) {
+    auto skipList = SkipListType::create(kInitHeadHeight);
+    for (auto v : sorted) {
+      skipList.add(v);
+    }
+    susp.rehire();
+    skipList = SkipListType::create(kInitHeadHeight);
+    susp.dismiss();
+  }
+}
+
+void BM_CreateSkipListFromSorted(int iters, int size) {
+  BenchmarkSuspender susp;
+  std::vector<ValueType> sorted(gData.begin(), gData.begin() + size);
+  std::sort(sorted.begin(), sorted.end());
+  susp.dismiss();
+
+  for (int i = 0; i < iters; ++i) {
+    auto skipList =
+      SkipListType::createInstanceFromSorted(sorted.begin(), sorted.end());
+    susp.rehire();
+    skipList.reset();
+    susp.dismiss();
+  }
+}
+
+// Visiting iters elements in ranges of 1000 (within a list of size),
+// by iterating from lower_bound() and by forEachInRange()
+void BM_IterateRangeSkipList(int iters, int size) {
+  BenchmarkSuspender susp;
+  auto skipList = SkipListType::create(kInitHeadHeight);
+  for (int i = 0; i < size; ++i) {
+    skipList.add(gData[i]);
+  }
+  const int kRange = kMaxValue / size * 1000;
+  int64_t sum = 0;
+  susp.dismiss();
+
+  for (int visited = 0, from = 0; visited < iters; ) {
+    for (auto it = skipList.lower_bound(from);
+         it != skipList.end() && *it < from + kRange; ++it) {
+      sum += *it;
+      ++visited;
+    }
+    from = from + kRange >= kMaxValue ? 0 : from + kRange;
+  }
+  doNotOptimizeAway(sum);
+  susp.rehire();
+}
+
+void BM_ForEachInRangeSkipList(int iters, int size) {
+  BenchmarkSuspender susp;
+  auto skipList = SkipListType::create(kInitHeadHeight);
+  for (int i = 0; i < size; ++i) {
+    skipList.add(gData[i]);
+  }
+  const int kRange = kMaxValue / size * 1000;
+  int64_t sum = 0;
+  susp.dismiss();
+
+  for (int visited = 0, from = 0; visited < iters; ) {
+    visited += skipList.forEachInRange(
+        from, from + kRange, [&](ValueType v) { sum += v; });
+    from = from + kRange >= kMaxValue ? 0 : from + kRange;
+  }
+  doNotOptimizeAway(sum);
+  susp.rehire();
+}
+
 BENCHMARK(Accessor, iters) {
   BenchmarkSuspender susp;
   auto skiplist = SkipListType::createInstance(kInitHeadHeight);
@@ -565,6 +642,22 @@ BENCHMARK_PARAM(BM_AddSet,      1000000);
 BENCHMARK_PARAM(BM_AddSkipList, 1000000);
 BENCHMARK_DRAW_LINE();
 
+BENCHMARK_PARAM(BM_AddSortedSkipList,        1000);
+BENCHMARK_PARAM(BM_CreateSkipListFromSorted, 1000);
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_PARAM(BM_AddSortedSkipList,        1000000);
+BENCHMARK_PARAM(BM_CreateSkipListFromSorted, 1000000);
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_PARAM(BM_IterateRangeSkipList,   65536);
+BENCHMARK_PARAM(BM_ForEachInRangeSkipList, 65536);
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_PARAM(BM_IterateRangeSkipList,   4000000);
+BENCHMARK_PARAM(BM_ForEachInRangeSkipList, 4000000);
+BENCHMARK_DRAW_LINE();
+
 BENCHMARK_PARAM(BM_SetMerge,             1000);
 BENCHMARK_PARAM(BM_CSLMergeIntersection, 1000);
 BENCHMARK_PARAM(BM_CSLMergeLookup,       1000);
@@ -452,6 +452,67 @@ struct NonTrivialValue {
 std::atomic<int> NonTrivialValue::InstanceCounter(0);
 const int NonTrivialValue::kBadPayLoad = 0xDEADBEEF;
 
+TEST(ConcurrentSkipList, CreateFromSorted) {
+  VectorType values;
+  for (int i = 0; i < 10000; ++i) {
+    values.push_back(i * 2);
+    if (i % 10 == 0) {
+      values.push_back(i * 2);  // duplicates are stored once
+    }
+  }
+  auto list = SkipListType::createInstanceFromSorted(
+      values.begin(), values.end());
+  SkipListAccessor skipList(list);
+  EXPECT_EQ(10000, skipList.size());
+  EXPECT_GT(skipList.height(), kHeadHeight);
+  int expected = 0;
+  for (auto v : skipList) {
+    EXPECT_EQ(expected, v);
+    expected += 2;
+  }
+  EXPECT_EQ(20000, expected);
+  EXPECT_TRUE(skipList.contains(9998));
+  EXPECT_FALSE(skipList.contains(9999));
+  EXPECT_EQ(19998, *skipList.last());
+
+  // The result is an ordinary list
+  EXPECT_TRUE(skipList.add(9999));
+  EXPECT_TRUE(skipList.remove(0));
+  EXPECT_FALSE(skipList.add(2));
+  EXPECT_EQ(10000, skipList.size());
+  EXPECT_EQ(2, *skipList.first());
+
+  VectorType empty;
+  auto emptyList = SkipListType::createInstanceFromSorted(
+      empty.begin(), empty.end());
+  EXPECT_TRUE(SkipListAccessor(emptyList).empty());
+}
+
+TEST(ConcurrentSkipList, ForEachInRange) {
+  auto skipList = SkipListType::create(kHeadHeight);
+  for (int i = 0; i < 1000; i += 3) {
+    skipList.add(i);
+  }
+  skipList.remove(300);
+
+  VectorType visited;
+  auto count = skipList.forEachInRange(
+      100, 400, [&](int v) { visited.push_back(v); });
+  EXPECT_EQ(visited.size(), count);
+  VectorType expected;
+  for (auto it = skipList.lower_bound(100); it != skipList.end() && *it < 400;
+       ++it) {
+    expected.push_back(*it);
+  }
+  EXPECT_EQ(expected, visited);
+  EXPECT_EQ(102, visited.front());
+  EXPECT_EQ(399, visited.back());
+
+  EXPECT_EQ(0, skipList.forEachInRange(400, 400, [](int) {}));
+  EXPECT_EQ(0, skipList.forEachInRange(2000, 3000, [](int) {}));
+  EXPECT_EQ(334 - 1, skipList.forEachInRange(-1, 1000, [](int) {}));
+}
+
 template <typename SkipListPtrType>
 void TestNonTrivialDeallocation(SkipListPtrType& list) {
   {
@@ -492,6 +553,54 @@ TEST(ConcurrentSkipList, NonTrivialDeallocationWithSysArena) {
   TestNonTrivialDeallocation(list);
 }
 
+TEST(ConcurrentSkipList, ReclaimWithOverlappingAccessors) {
+  using SkipListType = ConcurrentSkipList<NonTrivialValue>;
+  static const int N = 1000;
+  auto list = SkipListType::createInstance(10);
+  {
+    SkipListType::Accessor populate(list);
+    for (int i = 0; i < N; ++i) {
+      populate.add(NonTrivialValue(i));
+    }
+  }
+  // N values plus the head
+  EXPECT_EQ(N + 1, NonTrivialValue::InstanceCounter);
+
+  // There is always some Accessor alive, yet removed nodes get freed once
+  // the Accessors older than their removal are gone.
+  std::unique_ptr<SkipListType::Accessor> older(
+      new SkipListType::Accessor(list));
+  for (int i = 0; i < N / 2; ++i) {
+    std::unique_ptr<SkipListType::Accessor> newer(
+        new SkipListType::Accessor(list));
+    newer->remove(NonTrivialValue(i));
+    older = std::move(newer);
+  }
+  EXPECT_LT(NonTrivialValue::InstanceCounter, N + 1 - N / 4);
+
+  // But an Accessor from before a removal keeps the node alive
+  {
+    SkipListType::Accessor reader(list);
+    auto it = reader.find(NonTrivialValue(N - 1));
+    ASSERT_TRUE(it != reader.end());
+    {
+      SkipListType::Accessor writer(list);
+      for (int i = N / 2; i < N; ++i) {
+        writer.remove(NonTrivialValue(i));
+      }
+    }
+    older.reset();
+    for (int i = 0; i < 4; ++i) {
+      SkipListType::Accessor(list).add(NonTrivialValue(-1 - i));
+    }
+    EXPECT_FALSE(*it < NonTrivialValue(N - 1));
+    EXPECT_FALSE(NonTrivialValue(N - 1) < *it);
+  }
+  EXPECT_EQ(4, SkipListType::Accessor(list).size());
+  list.reset();
+  EXPECT_EQ(0, NonTrivialValue::InstanceCounter);
+}
+
 }  // namespace
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2016 Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/sorted_vector_types.h>
+
+#include <random>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+
+using namespace folly;
+
+namespace {
+
+// Keys are the even numbers below 2 * size, so half the lookups miss
+std::vector<int> randomKeys(int size) {
+  std::vector<int> keys(1 << 16);
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> dist(0, 2 * size - 1);
+  for (auto& key : keys) {
+    key = dist(rng);
+  }
+  return keys;
+}
+
+sorted_vector_set<int> evenNumbers(int size) {
+  std::vector<int> values(size);
+  for (int i = 0; i < size; ++i) {
+    values[i] = 2 * i;
+  }
+  return sorted_vector_set<int>(values.begin(), values.end());
+}
+
+template <class Set>
+void findKeys(const Set& set, const std::vector<int>& keys, size_t iters) {
+  size_t found = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    found += set.find(keys[i & (keys.size() - 1)]) != set.end();
+  }
+  doNotOptimizeAway(found);
+}
+
+void BM_SortedVectorFind(int iters, int size) {
+  BenchmarkSuspender susp;
+  auto set = evenNumbers(size);
+  auto keys = randomKeys(size);
+  susp.dismiss();
+  findKeys(set, keys, iters);
+  susp.rehire();
+}
+
+template <class Layout>
+void frozenFind(int iters, int size) {
+  BenchmarkSuspender susp;
+  frozen_sorted_vector_set<int, std::less<int>, std::allocator<int>, Layout>
+    set(evenNumbers(size));
+  auto keys = randomKeys(size);
+  susp.dismiss();
+  findKeys(set, keys, iters);
+  susp.rehire();
+}
+
+void BM_FrozenSortedFind(int iters, int size) {
+  frozenFind<sorted_layout>(iters, size);
+}
+
+void BM_FrozenEytzingerFind(int iters, int size) {
+  frozenFind<eytzinger_layout>(iters, size);
+}
+
+// Inserting size random elements into a set of size elements
+void BM_InsertOneByOne(int iters, int size) {
+  BenchmarkSuspender susp;
+  auto keys = randomKeys(size);
+  keys.resize(size);
+  for (int i = 0; i < iters; ++i) {
+    auto set = evenNumbers(size);
+    susp.dismiss();
+    for (auto key : keys) {
+      set.insert(set.end(), key);
+    }
+    susp.rehire();
+  }
+}
+
+void BM_InsertRange(int iters, int size) {
+  BenchmarkSuspender susp;
+  auto keys = randomKeys(size);
+  keys.resize(size);
+  for (int i = 0; i < iters; ++i) {
+    auto set = evenNumbers(size);
+    susp.dismiss();
+    set.insert(keys.begin(), keys.end());
+    susp.rehire();
+  }
+}
+
+}
+
+BENCHMARK_PARAM(BM_SortedVectorFind, 1000);
+BENCHMARK_RELATIVE_PARAM(BM_FrozenSortedFind, 1000);
+BENCHMARK_RELATIVE_PARAM(BM_FrozenEytzingerFind, 1000);
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(BM_SortedVectorFind, 1000000);
+BENCHMARK_RELATIVE_PARAM(BM_FrozenSortedFind, 1000000);
+BENCHMARK_RELATIVE_PARAM(BM_FrozenEytzingerFind, 1000000);
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(BM_SortedVectorFind, 16000000);
+BENCHMARK_RELATIVE_PARAM(BM_FrozenSortedFind, 16000000);
+BENCHMARK_RELATIVE_PARAM(BM_FrozenEytzingerFind, 16000000);
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(BM_InsertOneByOne, 1000);
+BENCHMARK_RELATIVE_PARAM(BM_InsertRange, 1000);
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(BM_InsertOneByOne, 30000);
+BENCHMARK_RELATIVE_PARAM(BM_InsertRange, 30000);
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  runBenchmarks();
+  return 0;
+}
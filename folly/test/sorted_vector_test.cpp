@@ -16,11 +16,17 @@
 
 #include <folly/sorted_vector_types.h>
 #include <gtest/gtest.h>
+#include <iterator>
 #include <list>
 #include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
 
 using folly::sorted_vector_set;
 using folly::sorted_vector_map;
+using folly::frozen_sorted_vector_set;
+using folly::frozen_sorted_vector_map;
 
 namespace {
 
@@ -337,3 +343,171 @@ TEST(SortedVectorTest, ShrinkTest) {
   // vector::shrink_to_fit respects the caller.
   EXPECT_EQ(s.capacity(), s.size());
 }
+
+TEST(SortedVectorTypes, BulkInsert) {
+  sorted_vector_set<int> s{10, 20, 30};
+  std::vector<int> v{25, 5, 20, 35, 5, 15};
+  s.insert(v.begin(), v.end());
+  check_invariant(s);
+  EXPECT_EQ(std::vector<int>({5, 10, 15, 20, 25, 30, 35}),
+            std::vector<int>(s.begin(), s.end()));
+
+  // Input iterators, and ranges that are already sorted
+  std::istringstream in("1 2 3 40 40 41");
+  s.insert(std::istream_iterator<int>(in), std::istream_iterator<int>());
+  check_invariant(s);
+  EXPECT_EQ(12, s.size());
+  EXPECT_EQ(41, *s.rbegin());
+
+  std::set<int> expected(s.begin(), s.end());
+  for (int i = 0; i < 1000; ++i) {
+    v.push_back((i * 7919) % 500);
+  }
+  s.insert(v.begin(), v.end());
+  expected.insert(v.begin(), v.end());
+  check_invariant(s);
+  EXPECT_EQ(std::vector<int>(expected.begin(), expected.end()),
+            std::vector<int>(s.begin(), s.end()));
+
+  // Like insert(), keeps the element that is already there, or that
+  // comes first
+  sorted_vector_map<int,int> m{{1, 1}, {3, 3}};
+  std::vector<std::pair<int,int>> pairs{{3, 30}, {2, 20}, {2, 21}, {0, 0}};
+  m.insert(pairs.begin(), pairs.end());
+  check_invariant(m);
+  EXPECT_EQ(4, m.size());
+  EXPECT_EQ(3, m.at(3));
+  EXPECT_EQ(20, m.at(2));
+}
+
+namespace {
+// Throws on the nth comparison from now
+struct ThrowingLess {
+  std::shared_ptr<int> countdown = std::make_shared<int>(-1);
+
+  bool operator()(int a, int b) const {
+    if (--*countdown == 0) {
+      throw std::runtime_error("comparison failed");
+    }
+    return a < b;
+  }
+};
+}
+
+TEST(SortedVectorTypes, BulkInsertThrows) {
+  std::vector<int> initial;
+  for (int i = 0; i < 100; i += 2) {
+    initial.push_back(i);
+  }
+  std::vector<int> more;
+  for (int i = 0; i < 100; ++i) {
+    more.push_back((i * 37) % 101);
+  }
+  // Whichever comparison throws, the set keeps its old contents
+  for (int n = 1;; ++n) {
+    ThrowingLess less;
+    sorted_vector_set<int, ThrowingLess> s(initial.begin(), initial.end(),
+                                           less);
+    *less.countdown = n;
+    try {
+      s.insert(more.begin(), more.end());
+    } catch (const std::runtime_error&) {
+      *less.countdown = -1;
+      EXPECT_EQ(initial, std::vector<int>(s.begin(), s.end())) << n;
+      continue;
+    }
+    *less.countdown = -1;
+    check_invariant(s);
+    std::set<int> expected(initial.begin(), initial.end());
+    expected.insert(more.begin(), more.end());
+    EXPECT_EQ(std::vector<int>(expected.begin(), expected.end()),
+              std::vector<int>(s.begin(), s.end()));
+    break;
+  }
+}
+
+template<class Layout>
+void testFrozenSet() {
+  typedef frozen_sorted_vector_set<int, std::less<int>, std::allocator<int>,
+                                   Layout> FrozenSet;
+  for (int n = 0; n < 70; ++n) {
+    sorted_vector_set<int> sorted;
+    for (int i = 0; i < n; ++i) {
+      sorted.insert(2 * i);
+    }
+    FrozenSet frozen{sorted_vector_set<int>(sorted)};
+    EXPECT_EQ(n, frozen.size());
+    EXPECT_EQ(std::vector<int>(sorted.begin(), sorted.end()),
+              std::vector<int>(frozen.begin(), frozen.end()));
+    std::vector<int> reversed;
+    for (auto it = frozen.end(); it != frozen.begin(); ) {
+      reversed.push_back(*--it);
+    }
+    EXPECT_EQ(std::vector<int>(sorted.rbegin(), sorted.rend()), reversed);
+
+    auto same = [&](sorted_vector_set<int>::iterator a,
+                    typename FrozenSet::const_iterator b) {
+      return a == sorted.end() ? b == frozen.end()
+                               : b != frozen.end() && *a == *b;
+    };
+    for (int key = -1; key <= 2 * n; ++key) {
+      EXPECT_TRUE(same(sorted.find(key), frozen.find(key))) << n << " " << key;
+      EXPECT_TRUE(same(sorted.lower_bound(key), frozen.lower_bound(key)));
+      EXPECT_TRUE(same(sorted.upper_bound(key), frozen.upper_bound(key)));
+      EXPECT_EQ(sorted.count(key), frozen.count(key));
+      auto range = frozen.equal_range(key);
+      EXPECT_EQ(sorted.count(key), std::distance(range.first, range.second));
+    }
+  }
+}
+
+TEST(SortedVectorTypes, FrozenSetEytzinger) {
+  testFrozenSet<folly::eytzinger_layout>();
+}
+
+TEST(SortedVectorTypes, FrozenSetSorted) {
+  testFrozenSet<folly::sorted_layout>();
+}
+
+TEST(SortedVectorTypes, FrozenSetConstruction) {
+  frozen_sorted_vector_set<int> empty{};
+  EXPECT_TRUE(empty.empty());
+  EXPECT_TRUE(empty.begin() == empty.end());
+  EXPECT_TRUE(empty.find(1) == empty.end());
+
+  frozen_sorted_vector_set<int> s{5, 3, 1, 3};
+  EXPECT_EQ(3, s.size());
+  EXPECT_EQ(std::vector<int>({1, 3, 5}), std::vector<int>(s.begin(), s.end()));
+
+  frozen_sorted_vector_set<int, less_invert<int>> inverted{1, 2, 3};
+  EXPECT_EQ(std::vector<int>({3, 2, 1}),
+            std::vector<int>(inverted.begin(), inverted.end()));
+  EXPECT_EQ(1, *inverted.lower_bound(1));
+  EXPECT_TRUE(inverted.upper_bound(1) == inverted.end());
+}
+
+TEST(SortedVectorTypes, FrozenMap) {
+  sorted_vector_map<int, std::unique_ptr<int>> sorted;
+  for (int i = 0; i < 100; ++i) {
+    sorted[i * 3].reset(new int(i));
+  }
+  frozen_sorted_vector_map<int, std::unique_ptr<int>> m(std::move(sorted));
+  EXPECT_TRUE(sorted.empty());
+  EXPECT_EQ(100, m.size());
+  EXPECT_EQ(33, *m.at(99));
+  EXPECT_THROW(m.at(100), std::out_of_range);
+  EXPECT_TRUE(m.find(1) == m.end());
+  EXPECT_EQ(1, m.count(3));
+  EXPECT_EQ(102, m.lower_bound(100)->first);
+
+  int prev = -1;
+  for (auto& entry : m) {
+    EXPECT_LT(prev, entry.first);
+    prev = entry.first;
+  }
+  EXPECT_EQ(297, prev);
+
+  frozen_sorted_vector_map<int,int> fromList{{2, 20}, {1, 10}};
+  EXPECT_EQ(10, fromList.at(1));
+  EXPECT_EQ(1, fromList.begin()->first);
+}